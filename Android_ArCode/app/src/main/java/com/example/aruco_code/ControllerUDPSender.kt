@@ -6,6 +6,9 @@ import java.net.DatagramSocket
 import java.net.InetAddress
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
+import kotlin.math.abs
+import kotlin.math.roundToInt
+import kotlin.math.sqrt
 
 /**
  * ControllerUDPSender — packs pose data into a fixed-length binary UDP packet
@@ -38,16 +41,84 @@ import java.nio.ByteOrder
  * Little-endian byte order is used because most modern PCs (x86) are
  * little-endian, so the Hub can memcpy floats directly into C structs on the
  * Windows side without byte-swapping.
+ *
+ * ── Protocol v2 (useProtocolV2 = true, see sendDevices) ─────────────────────
+ *
+ * All devices seen in one camera frame go into a single datagram with
+ * compressed fields (layout shared with the SteamVR driver, packet_format.h):
+ *
+ *   header  magic 0xC5, version 2, flags, record count, base packet_number (uint32)
+ *   record  controller_id, record flags, packet_number - base (uint8, or the
+ *           full uint32 with REC_SEQUENCE32), quaternion smallest-three (6 bytes),
+ *           then only the non-zero optional fields: position 3 × int16 / 2048 m,
+ *           gyro 3 × int16 / 1024 rad/s, buttons uint16 + trigger uint8
+ *   trailer CRC-32C of all previous bytes (uint32)
+ *
+ * A frame with all three markers is 8 + 3 × 15 + 4 = 57 bytes instead of
+ * 3 × 49 bytes in three datagrams.
+ *
+ * ── Rate hints ───────────────────────────────────────────────────────────────
+ *
+ * With rate_hints on, the driver sends the Hub a 24-byte v2 message once a
+ * second with the send rate it wants (low while the controllers are still or
+ * SteamVR is in standby, up to the display rate during fast motion), and the
+ * Hub relays it here. A background thread reads it, and sendDevices drops
+ * frames that come sooner than the requested interval. That saves CPU work,
+ * battery and Wi-Fi airtime when the camera produces more frames than
+ * needed. The camera frame rate is still the upper limit.
  */
 class ControllerUDPSender(
     private val serverIp: String,
-    private val hubPort: Int = 5554   // must match the Hub's listen port
+    private val hubPort: Int = 5554,   // must match the Hub's listen port
+    private val useProtocolV2: Boolean = false
 ) {
+    /** One device's pose for [sendDevices]. */
+    data class DeviceSample(
+        val controllerId: Int,
+        val quaternion: FloatArray,   // [w, x, y, z]
+        val position: FloatArray,     // [x, y, z] metres
+        val gyro: FloatArray = floatArrayOf(0f, 0f, 0f),
+        val buttons: Int = 0,
+        val trigger: Int = 0
+    )
+
     // UDP is connectionless — DatagramSocket just binds a local ephemeral port.
     // All sends go to the single (serverAddress, hubPort) destination.
     private val socket = DatagramSocket()
     private val serverAddress = InetAddress.getByName(serverIp)
 
+    // Minimum time between sendDevices datagrams: 0 - every frame.
+    // Written by the rate hint thread, read by the frame thread.
+    @Volatile private var minSendIntervalNs = 0L
+    private var lastSendNs = 0L
+
+    /** Send rate the driver last asked for, 0 if none yet. */
+    @Volatile var requestedRateHz = 0f
+        private set
+
+    // Rate hints arrive on the same socket; receive() returns once close() runs
+    private val hintThread = Thread({
+        val buffer = ByteArray(64)
+        val packet = DatagramPacket(buffer, buffer.size)
+        while (!socket.isClosed) {
+            try {
+                packet.length = buffer.size
+                socket.receive(packet)
+                val rate = parseRateHint(buffer, packet.length) ?: continue
+                if (rate != requestedRateHz) {
+                    Log.i("ControllerUDPSender", "Driver requests $rate Hz")
+                }
+                requestedRateHz = rate
+                minSendIntervalNs = if (rate > 0f) (1_000_000_000L / rate).toLong() else 0L
+            } catch (e: Exception) {
+                if (!socket.isClosed) Log.w("ControllerUDPSender", "Rate hint receive: ${e.message}")
+            }
+        }
+    }, "RateHintReceiver").apply {
+        isDaemon = true
+        start()
+    }
+
     // Per-device monotonically increasing counter.
     // The Hub uses this to detect dropped or out-of-order packets.
     private val packetNumbers = mutableMapOf(
@@ -148,6 +219,119 @@ class ControllerUDPSender(
         }
     }
 
+    /**
+     * Sends several devices at once: one protocol v2 datagram when
+     * useProtocolV2 is set, otherwise one 49-byte packet per device.
+     */
+    fun sendDevices(samples: List<DeviceSample>) {
+        if (samples.isEmpty()) return
+        // Rate hint: skip frames that come sooner than the driver needs.
+        // 10% slack so a camera at exactly the requested rate is not halved.
+        val now = System.nanoTime()
+        if (now - lastSendNs < minSendIntervalNs * 9 / 10) return
+        lastSendNs = now
+        if (!useProtocolV2) {
+            for (s in samples) {
+                sendControllerData(s.controllerId, s.quaternion, s.position, s.gyro, s.buttons, s.trigger)
+            }
+            return
+        }
+
+        try {
+            val numbers = samples.map { s ->
+                val packetNum = packetNumbers[s.controllerId] ?: 0L
+                packetNumbers[s.controllerId] = packetNum + 1
+                packetNum and 0xFFFFFFFFL
+            }
+            val dataBytes = encodeV2(samples, numbers)
+            socket.send(DatagramPacket(dataBytes, dataBytes.size, serverAddress, hubPort))
+            Log.d("ControllerUDPSender", "v2 datagram: ${samples.size} devices, ${dataBytes.size} bytes")
+        } catch (e: Exception) {
+            Log.e("ControllerUDPSender", "Error sending v2 datagram: ${e.message}")
+        }
+    }
+
+    private fun encodeV2(samples: List<DeviceSample>, numbers: List<Long>): ByteArray {
+        val base = numbers.minOrNull() ?: 0L
+        // Worst case: 27 bytes per record
+        val buffer = ByteBuffer.allocate(V2_HEADER_SIZE + samples.size * 27 + 4).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.put(V2_MAGIC.toByte())
+        buffer.put(V2_VERSION.toByte())
+        buffer.put(0.toByte())               // datagram flags
+        buffer.put(samples.size.toByte())
+        buffer.putInt(base.toInt())
+
+        for ((i, s) in samples.withIndex()) {
+            val delta = numbers[i] - base
+            var flags = 0
+            if (delta > 0xFF) flags = flags or REC_SEQUENCE32
+            if (s.position.any { it != 0f }) flags = flags or REC_POSITION
+            if (s.gyro.any { it != 0f }) flags = flags or REC_ANGULAR_VELOCITY
+            if (s.buttons != 0 || s.trigger != 0) flags = flags or REC_INPUT
+
+            buffer.put(s.controllerId.toByte())
+            buffer.put(flags.toByte())
+            if (flags and REC_SEQUENCE32 != 0) buffer.putInt(numbers[i].toInt()) else buffer.put(delta.toByte())
+            putQuaternion(buffer, s.quaternion)
+            if (flags and REC_POSITION != 0) putFixed3(buffer, s.position, V2_POSITION_SCALE)
+            if (flags and REC_ANGULAR_VELOCITY != 0) putFixed3(buffer, s.gyro, V2_ANGULAR_SCALE)
+            if (flags and REC_INPUT != 0) {
+                buffer.putShort(s.buttons.toShort())
+                buffer.put(s.trigger.toByte())
+            }
+        }
+
+        val length = buffer.position()
+        buffer.putInt(crc32c(buffer.array(), length))
+        return buffer.array().copyOf(length + 4)
+    }
+
+    /**
+     * Requested rate in Hz from a driver rate hint (packet_format.h), or null
+     * if the datagram is not one: v2 header with FLAG_RATE_HINT and 0 records,
+     * [8:10] requested Hz, CRC-32C at [20:24].
+     */
+    private fun parseRateHint(data: ByteArray, length: Int): Float? {
+        if (length != V2_RATE_HINT_SIZE) return null
+        if (data[0] != V2_MAGIC.toByte() || data[1] != V2_VERSION.toByte()) return null
+        if (data[2] != V2_FLAG_RATE_HINT.toByte() || data[3] != 0.toByte()) return null
+        val buffer = ByteBuffer.wrap(data, 0, length).order(ByteOrder.LITTLE_ENDIAN)
+        if (buffer.getInt(length - 4) != crc32c(data, length - 4)) return null
+        return (buffer.getShort(8).toInt() and 0xFFFF).toFloat()
+    }
+
+    /** CRC-32C (Castagnoli), same polynomial and init as crc32c.h in the driver. */
+    private fun crc32c(data: ByteArray, length: Int): Int {
+        var crc = -1   // 0xFFFFFFFF
+        for (i in 0 until length) {
+            crc = (crc ushr 8) xor CRC32C_TABLE[(crc xor data[i].toInt()) and 0xFF]
+        }
+        return crc.inv()
+    }
+
+    /** Smallest-three: the largest component is dropped and restored from the norm. */
+    private fun putQuaternion(buffer: ByteBuffer, quaternion: FloatArray) {
+        val norm = sqrt(quaternion.sumOf { (it * it).toDouble() }).toFloat()
+        val q = if (norm > 1e-6f) FloatArray(4) { quaternion[it] / norm } else floatArrayOf(1f, 0f, 0f, 0f)
+        var largest = 0
+        for (i in 1 until 4) if (abs(q[i]) > abs(q[largest])) largest = i
+        val sign = if (q[largest] < 0f) -1f else 1f
+
+        var packed = largest.toLong()
+        for (i in 0 until 4) {
+            if (i == largest) continue
+            val v = (sign * q[i]).coerceIn(-QUAT_MAX, QUAT_MAX) / QUAT_MAX
+            packed = (packed shl 15) or ((v * 16383f).roundToInt() + 16383).toLong()
+        }
+        for (i in 0 until 6) buffer.put((packed shr (8 * i)).toByte())
+    }
+
+    private fun putFixed3(buffer: ByteBuffer, values: FloatArray, scale: Float) {
+        for (i in 0 until 3) {
+            buffer.putShort((values[i] * scale).roundToInt().coerceIn(-32767, 32767).toShort())
+        }
+    }
+
     /**
      * Computes the checksum over [length] bytes of [data].
      * Algorithm: sum every byte (treated as unsigned 0-255), then take & 0xFF.
@@ -183,4 +367,25 @@ class ControllerUDPSender(
             Log.e("ControllerUDPSender", "Error closing socket: ${e.message}")
         }
     }
-}
\ No newline at end of file
+
+    private companion object {
+        const val V2_MAGIC = 0xC5
+        const val V2_VERSION = 2
+        const val V2_HEADER_SIZE = 8
+        const val V2_FLAG_RATE_HINT = 0x20
+        const val V2_RATE_HINT_SIZE = 24
+        const val REC_POSITION = 0x01
+        const val REC_ANGULAR_VELOCITY = 0x02
+        const val REC_INPUT = 0x04
+        const val REC_SEQUENCE32 = 0x08
+        const val V2_POSITION_SCALE = 2048f
+        const val V2_ANGULAR_SCALE = 1024f
+        const val QUAT_MAX = 0.70710678f
+
+        val CRC32C_TABLE = IntArray(256) { n ->
+            var crc = n
+            repeat(8) { crc = if (crc and 1 != 0) (crc ushr 1) xor 0x82F63B78.toInt() else crc ushr 1 }
+            crc
+        }
+    }
+}
@@ -38,7 +38,7 @@ import java.io.ByteArrayOutputStream
  *     → Bitmap → OpenCV gray Mat
  *     → ArucoDetector.detectMarkers()
  *     → ArUcoTransform.estimatePose()   (solvePnP → position + quaternion)
- *     → ControllerUDPSender.sendControllerData()  (49-byte UDP packet to VR Hub)
+ *     → ControllerUDPSender.sendDevices()  (49-byte packets or one v2 datagram to VR Hub)
  *
  * Camera selection:
  *   On startup we enumerate all back-facing cameras via CameraManager.
@@ -61,6 +61,11 @@ import java.io.ByteArrayOutputStream
  *   detection workload with little accuracy gain for markers that are
  *   ≥ 5 cm and held within ~1-2 m.
  */
+
+// Send all markers of a frame as one protocol v2 datagram (the Hub accepts
+// both formats). false keeps the 49-byte packet per marker.
+private const val USE_PROTOCOL_V2 = false
+
 class MainActivity : AppCompatActivity() {
 
     // ─── UI references ───────────────────────────────────────────────────────
@@ -205,7 +210,7 @@ class MainActivity : AppCompatActivity() {
                 CoroutineScope(Dispatchers.IO).launch {
                     try {
                         udpSender?.close()
-                        udpSender = ControllerUDPSender(ip, 5554)
+                        udpSender = ControllerUDPSender(ip, 5554, useProtocolV2 = USE_PROTOCOL_V2)
                         isConnected = true
 
                         runOnUiThread {
@@ -681,6 +686,7 @@ class MainActivity : AppCompatActivity() {
             val markerCount = corners.size
 
             if (markerCount > 0 && !ids.empty()) {
+                val frameSamples = ArrayList<ControllerUDPSender.DeviceSample>(markerCount)
                 for (i in 0 until markerCount) {
                     val idArray = IntArray(1)
                     ids.get(i, 0, idArray)
@@ -698,11 +704,13 @@ class MainActivity : AppCompatActivity() {
                         lastPositions[markerId] = pose.position
                         lastQuaternions[markerId] = pose.quaternion
 
-                        // Send the 49-byte UDP packet to the VR Tracking Hub
-                        udpSender?.sendControllerData(
-                            controllerId = pose.controllerId,
-                            quaternion = pose.quaternion,
-                            position = pose.position
+                        // Collected for this frame; sent together after the loop
+                        frameSamples.add(
+                            ControllerUDPSender.DeviceSample(
+                                controllerId = pose.controllerId,
+                                quaternion = pose.quaternion,
+                                position = pose.position
+                            )
                         )
 
                         // Log every 30th detection to avoid flooding the UI
@@ -723,6 +731,8 @@ class MainActivity : AppCompatActivity() {
                         }
                     }
                 }
+                // One v2 datagram for all markers of the frame (or 49-byte packets)
+                udpSender?.sendDevices(frameSamples)
             }
         } catch (e: Exception) {
             Log.e("MainActivity", "ArUco detection error", e)
@@ -12,13 +12,249 @@ Packet format (49 bytes) — used for BOTH directions (Android → Hub and Hub 
   [45:47] buttons         (uint16, little-endian)
   [47]    trigger         (uint8)
   [48]    checksum        (uint8: sum of bytes [0..47] & 0xFF)
+
+Protocol v2 (same as steamVR-controller-driver-C/src/packet_format.h) — several
+devices per datagram, compressed fields, all little-endian:
+  header  [0] magic 0xC5, [1] version 2, [2] flags, [3] record count,
+          [4:8] base packet_number (uint32)
+  record  [0] controller_id, [1] record flags,
+          packet_number - base (uint8) or full uint32 (REC_SEQUENCE32),
+          quaternion smallest-three (48 bits: index << 45 | 3 x 15 bits,
+          each round(v / sqrt(0.5) * 16383) + 16383),
+          position 3 x int16 / 2048 m            (REC_POSITION),
+          angular velocity 3 x int16 / 1024 rad/s (REC_ANGULAR_VELOCITY),
+          buttons uint16 + trigger uint8          (REC_INPUT),
+          capture time, low 32 bits of monotonic microseconds (REC_TIMESTAMP)
+  trailer CRC-32C of all previous bytes (uint32)
+Omitted fields are zero, so every record still stands on its own.
+
+Clock sync: the driver sends 20-byte requests (V2_FLAG_TIME_REQUEST) back to
+the address the datagrams come from; answer_time_requests() replies with the
+hub's receive/transmit times so the driver can map capture times onto its clock.
+
+Rate hints: with rate_hints on, the driver also sends a 24-byte message once a
+second (V2_FLAG_RATE_HINT) with the send rate it wants. The hub keeps the
+latest one in rate_hint and relays it unchanged to the phone, which sets the
+actual rate (ControllerUDPSender).
 """
+import math
 import socket
 import struct
-from typing import Optional, Callable
+import time
+from typing import Optional, Callable, Iterable, List
 from data_structures import ControllerData
 
 
+V2_MAGIC = 0xC5
+V2_VERSION = 2
+V2_HEADER_SIZE = 8
+V2_MIN_RECORD_SIZE = 9
+V2_FLAG_GYROMOUSE = 0x01          # ids relative to the driver's gyromouse_device_id
+V2_FLAG_RATE_HINT = 0x20          # driver -> hub requested send rate
+V2_FLAG_TIME_REQUEST = 0x40       # driver -> hub clock-sync request
+V2_FLAG_TIME_REPLY = 0x80         # hub -> driver clock-sync reply
+V2_TIME_REQUEST_SIZE = 20
+V2_RATE_HINT_SIZE = 24
+
+REC_POSITION = 0x01
+REC_ANGULAR_VELOCITY = 0x02
+REC_INPUT = 0x04
+REC_SEQUENCE32 = 0x08
+REC_TIMESTAMP = 0x10
+
+V2_POSITION_SCALE = 2048.0
+V2_ANGULAR_SCALE = 1024.0
+_QUAT_MAX = 0.70710678
+_QUAT_MASK = (1 << 15) - 1
+_QUAT_HALF_RANGE = 16383
+
+
+def _make_crc32c_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+        table.append(crc)
+    return table
+
+
+_CRC32C_TABLE = _make_crc32c_table()
+
+
+def crc32c(data) -> int:
+    """CRC-32C (Castagnoli), same as crc32c.h in the driver."""
+    crc = 0xFFFFFFFF
+    for b in data:
+        crc = (crc >> 8) ^ _CRC32C_TABLE[(crc ^ b) & 0xFF]
+    return crc ^ 0xFFFFFFFF
+
+
+def monotonic_us() -> int:
+    """Hub clock for capture timestamps and clock-sync replies."""
+    return time.monotonic_ns() // 1000
+
+
+def _fixed3(values, scale):
+    return [max(-32767, min(32767, int(round(v * scale)))) for v in values]
+
+
+def _pack_quaternion(quat):
+    """Smallest-three: drop the largest component, it is restored from the norm."""
+    norm = math.sqrt(sum(c * c for c in quat))
+    q = [c / norm for c in quat] if norm > 1e-6 else [1.0, 0.0, 0.0, 0.0]
+    largest = max(range(4), key=lambda i: abs(q[i]))
+    sign = -1.0 if q[largest] < 0.0 else 1.0
+    packed = largest
+    for i in range(4):
+        if i == largest:
+            continue
+        v = max(-_QUAT_MAX, min(_QUAT_MAX, sign * q[i]))
+        packed = (packed << 15) | (int(round(v / _QUAT_MAX * _QUAT_HALF_RANGE)) + _QUAT_HALF_RANGE)
+    return packed.to_bytes(6, 'little')
+
+
+def _unpack_quaternion(data: bytes):
+    packed = int.from_bytes(data[:6], 'little')
+    largest = (packed >> 45) & 0x03
+    q = [0.0] * 4
+    shift = 30
+    for i in range(4):
+        if i == largest:
+            continue
+        steps = ((packed >> shift) & _QUAT_MASK) - _QUAT_HALF_RANGE
+        q[i] = steps / _QUAT_HALF_RANGE * _QUAT_MAX
+        shift -= 15
+    q[largest] = math.sqrt(max(0.0, 1.0 - sum(c * c for c in q)))
+    return q
+
+
+def build_v2_datagram(records, flags: int = 0) -> bytes:
+    """
+    Pack several devices into one v2 datagram.
+    records: iterable of objects with controller_id, packet_number, quaternion,
+    position, gyro, buttons, trigger (data_structures.ControllerData fits).
+    Records with last_update > 0 are stamped with their capture time.
+    """
+    records = list(records)
+    now_us, now_wall = monotonic_us(), time.time()
+    base = min(r.packet_number & 0xFFFFFFFF for r in records)
+    out = bytearray(struct.pack('<BBBBI', V2_MAGIC, V2_VERSION, flags, len(records), base))
+    for r in records:
+        number = r.packet_number & 0xFFFFFFFF
+        delta = number - base
+        rec_flags = 0
+        if delta > 0xFF:
+            rec_flags |= REC_SEQUENCE32
+        if any(r.position):
+            rec_flags |= REC_POSITION
+        if any(r.gyro):
+            rec_flags |= REC_ANGULAR_VELOCITY
+        if r.buttons or r.trigger:
+            rec_flags |= REC_INPUT
+        last_update = getattr(r, 'last_update', 0.0)
+        if last_update > 0:
+            rec_flags |= REC_TIMESTAMP
+
+        out += bytes((r.controller_id & 0xFF, rec_flags))
+        out += struct.pack('<I', number) if rec_flags & REC_SEQUENCE32 else bytes((delta,))
+        out += _pack_quaternion(r.quaternion)
+        if rec_flags & REC_POSITION:
+            out += struct.pack('<3h', *_fixed3(r.position, V2_POSITION_SCALE))
+        if rec_flags & REC_ANGULAR_VELOCITY:
+            out += struct.pack('<3h', *_fixed3(r.gyro, V2_ANGULAR_SCALE))
+        if rec_flags & REC_INPUT:
+            out += struct.pack('<HB', r.buttons & 0xFFFF, r.trigger & 0xFF)
+        if rec_flags & REC_TIMESTAMP:
+            # last_update is wall time; age it back from the monotonic "now"
+            capture_us = now_us - int(max(0.0, now_wall - last_update) * 1e6)
+            out += struct.pack('<I', capture_us & 0xFFFFFFFF)
+    out += struct.pack('<I', crc32c(out))
+    return bytes(out)
+
+
+def parse_v2_datagram(data: bytes) -> Optional[List[dict]]:
+    """Unpack a v2 datagram into the same dicts parse_aruco_packet returns."""
+    if len(data) < V2_HEADER_SIZE + 4 or data[0] != V2_MAGIC or data[1] != V2_VERSION:
+        return None
+    if crc32c(data[:-4]) != struct.unpack_from('<I', data, len(data) - 4)[0]:
+        return None
+    _, _, _, count, base = struct.unpack_from('<BBBBI', data, 0)
+    end = len(data) - 4
+    offset = V2_HEADER_SIZE
+    result = []
+    for _ in range(count):
+        if end - offset < V2_MIN_RECORD_SIZE:
+            return None
+        controller_id, rec_flags = data[offset], data[offset + 1]
+        offset += 2
+        if rec_flags & REC_SEQUENCE32:
+            packet_number = struct.unpack_from('<I', data, offset)[0]
+            offset += 4
+        else:
+            packet_number = (base + data[offset]) & 0xFFFFFFFF
+            offset += 1
+        quat = _unpack_quaternion(data[offset:offset + 6])
+        offset += 6
+        pos, gyro, buttons, trigger = [0.0, 0.0, 0.0], [0.0, 0.0, 0.0], 0, 0
+        if rec_flags & REC_POSITION:
+            pos = [v / V2_POSITION_SCALE for v in struct.unpack_from('<3h', data, offset)]
+            offset += 6
+        if rec_flags & REC_ANGULAR_VELOCITY:
+            gyro = [v / V2_ANGULAR_SCALE for v in struct.unpack_from('<3h', data, offset)]
+            offset += 6
+        if rec_flags & REC_INPUT:
+            buttons, trigger = struct.unpack_from('<HB', data, offset)
+            offset += 3
+        if rec_flags & REC_TIMESTAMP:
+            offset += 4  # capture time is only meaningful to the driver
+        if offset > end:
+            return None
+        result.append({
+            'controller_id':     controller_id,
+            'packet_number':     packet_number,
+            'marker_quaternion': quat,
+            'marker_position':   pos,
+            'gyro':              gyro,
+            'buttons':           buttons,
+            'trigger':           trigger,
+        })
+    return result if offset == end else None
+
+
+def build_time_reply(request: bytes, receive_us: int) -> Optional[bytes]:
+    """Reply to a driver clock-sync request; None if request is not one."""
+    if (len(request) != V2_TIME_REQUEST_SIZE or request[0] != V2_MAGIC or request[1] != V2_VERSION
+            or request[2] != V2_FLAG_TIME_REQUEST or request[3] != 0):
+        return None
+    if crc32c(request[:-4]) != struct.unpack_from('<I', request, len(request) - 4)[0]:
+        return None
+    sequence, request_us = struct.unpack_from('<IQ', request, 4)
+    out = bytearray(struct.pack('<BBBBIQQQ', V2_MAGIC, V2_VERSION, V2_FLAG_TIME_REPLY, 0,
+                                sequence, request_us, receive_us, monotonic_us()))
+    out += struct.pack('<I', crc32c(out))
+    return bytes(out)
+
+
+def parse_rate_hint(data: bytes) -> Optional[dict]:
+    """Decode a driver rate hint; None if data is not one."""
+    if (len(data) != V2_RATE_HINT_SIZE or data[0] != V2_MAGIC or data[1] != V2_VERSION
+            or data[2] != V2_FLAG_RATE_HINT or data[3] != 0):
+        return None
+    if crc32c(data[:-4]) != struct.unpack_from('<I', data, len(data) - 4)[0]:
+        return None
+    sequence, requested, display, loss, jitter, flags = struct.unpack_from('<IHHHHB', data, 4)
+    return {
+        'sequence': sequence,
+        'requested_hz': float(requested),
+        'display_hz': display / 100.0,
+        'loss': loss / 10000.0,
+        'jitter_ms': jitter / 100.0,
+        'standby': bool(flags & 0x01),
+        'idle': bool(flags & 0x02),
+    }
+
+
 class NetworkHandler:
     """
     Handles all UDP network communication:
@@ -28,9 +264,14 @@ class NetworkHandler:
 
     def __init__(self, log_callback: Optional[Callable] = None):
         self.socket_android = None
+        # Send all devices in one protocol v2 datagram instead of one 49-byte packet each
+        self.use_protocol_v2 = False
         self.socket_steamvr = None
         # Store target address for sendto (no connect — matches original)
         self._steamvr_addr: Optional[tuple] = None
+        # Phone address (from its packets) and the driver's latest rate hint
+        self._android_addr: Optional[tuple] = None
+        self.rate_hint: Optional[dict] = None
         self.log_callback = log_callback
 
     def log(self, message: str, level: str = "INFO"):
@@ -64,6 +305,7 @@ class NetworkHandler:
         """
         try:
             data, addr = self.socket_android.recvfrom(1024)
+            self._android_addr = addr
             return (data, addr)
         except socket.timeout:
             return None
@@ -108,6 +350,16 @@ class NetworkHandler:
             self.log(f"Error parsing packet: {e}", "ERROR")
             return None
 
+    def parse_packets(self, data: bytes) -> List[dict]:
+        """
+        Parse a legacy 49-byte packet or a v2 datagram (several devices).
+        Returns a list of dicts in the parse_aruco_packet format; empty if invalid.
+        """
+        if data and data[0] == V2_MAGIC:
+            return parse_v2_datagram(data) or []
+        parsed = self.parse_aruco_packet(data)
+        return [parsed] if parsed else []
+
     # -------------------------------------------------------------------------
     # SteamVR sender
     # -------------------------------------------------------------------------
@@ -170,6 +422,65 @@ class NetworkHandler:
             self.log(f"SteamVR sender error: {e}", "ERROR")
             return False
 
+    def send_all_to_steamvr(self, controllers: Iterable[ControllerData]) -> int:
+        """
+        Send a set of devices to the SteamVR driver: one v2 datagram when
+        use_protocol_v2 is set, otherwise one 49-byte packet per device.
+        Returns the number of devices sent.
+        """
+        controllers = list(controllers)
+        if not self.use_protocol_v2:
+            return sum(1 for c in controllers if self.send_to_steamvr(c))
+        try:
+            self.socket_steamvr.sendto(build_v2_datagram(controllers), self._steamvr_addr)
+            self.answer_time_requests()
+            return len(controllers)
+        except Exception as e:
+            self.log(f"SteamVR sender error: {e}", "ERROR")
+            return 0
+
+    def answer_time_requests(self) -> int:
+        """
+        Answer the driver's clock-sync requests waiting on the SteamVR socket.
+        Never blocks. Returns the number of replies sent.
+        """
+        answered = 0
+        self.socket_steamvr.setblocking(False)
+        try:
+            while True:
+                try:
+                    request, addr = self.socket_steamvr.recvfrom(64)
+                except (BlockingIOError, InterruptedError):
+                    break
+                except ConnectionResetError:
+                    continue  # Windows: ICMP "port unreachable" from an earlier sendto
+                except OSError:
+                    break
+                reply = build_time_reply(request, monotonic_us())
+                if reply:
+                    self.socket_steamvr.sendto(reply, addr)
+                    answered += 1
+                    continue
+                hint = parse_rate_hint(request)
+                if hint:
+                    self._relay_rate_hint(request, hint)
+        finally:
+            self.socket_steamvr.setblocking(True)
+        return answered
+
+    def _relay_rate_hint(self, data: bytes, hint: dict):
+        """Keep the driver's rate hint and pass it on to the phone as is."""
+        previous = self.rate_hint
+        self.rate_hint = hint
+        if previous is None or previous['requested_hz'] != hint['requested_hz']:
+            self.log(f"Driver requests {hint['requested_hz']:.0f} Hz "
+                     f"(display {hint['display_hz']:.1f} Hz, loss {hint['loss'] * 100:.1f}%)")
+        if self.socket_android and self._android_addr:
+            try:
+                self.socket_android.sendto(data, self._android_addr)
+            except OSError:
+                pass  # phone gone; the next hint is a second away
+
     # -------------------------------------------------------------------------
     # Cleanup
     # -------------------------------------------------------------------------
@@ -96,7 +96,8 @@ class VRTrackingHub:
             'marker_size': 0.05,              # Physical size of ArUco markers in meters (used by webcam)
             'left_controller_id': 0,          # ArUco marker ID for left controller (enables multi-player)
             'right_controller_id': 1,         # ArUco marker ID for right controller
-            'hmd_controller_id': 2            # ArUco marker ID for HMD/headset
+            'hmd_controller_id': 2,           # ArUco marker ID for HMD/headset
+            'steamvr_protocol_v2': False      # all devices in one compact datagram (driver protocol v2)
             # Future: allows tracking multiple players with different marker IDs
         }
         
@@ -335,29 +336,31 @@ class VRTrackingHub:
                 continue
             
             data, addr = result
-            parsed = self.network.parse_aruco_packet(data)
+            # Legacy 49-byte packet or a v2 datagram with several devices
+            packets = self.network.parse_packets(data)
             
-            if not parsed:
+            if not packets:
                 self.stats['errors'] += 1
                 continue
             
-            cid = parsed['controller_id']
-            if cid not in self.controllers:
-                continue
-            
-            controller = self.controllers[cid]
-            # Update ArUco marker data from Android
-            controller.aruco_position = parsed['marker_position']
-            controller.aruco_quaternion = parsed['marker_quaternion']
-            controller.aruco_last_update = time.time()
-            
-            # Update other sensor data
-            controller.gyro = parsed['gyro']
-            controller.buttons = parsed['buttons']
-            controller.trigger = parsed['trigger']
-            controller.packet_number = parsed['packet_number']
-            controller.last_update = time.time()
-            controller.source = f"android:{addr[0]}"
+            for parsed in packets:
+                cid = parsed['controller_id']
+                if cid not in self.controllers:
+                    continue
+                
+                controller = self.controllers[cid]
+                # Update ArUco marker data from Android
+                controller.aruco_position = parsed['marker_position']
+                controller.aruco_quaternion = parsed['marker_quaternion']
+                controller.aruco_last_update = time.time()
+                
+                # Update other sensor data
+                controller.gyro = parsed['gyro']
+                controller.buttons = parsed['buttons']
+                controller.trigger = parsed['trigger']
+                controller.packet_number = parsed['packet_number']
+                controller.last_update = time.time()
+                controller.source = f"android:{addr[0]}"
             
             self.stats['android_packets'] += 1
         
@@ -445,9 +448,9 @@ class VRTrackingHub:
                     self.controllers[cid].trigger = trigger
                 
                 # Send all controllers to SteamVR
-                for cid in [0, 1, 2]:
-                    if self.network.send_to_steamvr(self.controllers[cid]):
-                        self.stats['steamvr_packets'] += 1
+                self.network.use_protocol_v2 = bool(self.general_settings.get('steamvr_protocol_v2', False))
+                self.stats['steamvr_packets'] += self.network.send_all_to_steamvr(
+                    self.controllers[cid] for cid in [0, 1, 2])
                 
                 time.sleep(0.011)  # ~90 Hz update rate
                 
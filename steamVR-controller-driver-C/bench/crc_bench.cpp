@@ -0,0 +1,77 @@
+// bench/crc_bench.cpp
+// Стоимость проверки целостности одного пакета: прежняя сумма байт
+// против CRC-32C (SSE4.2 и табличный вариант).
+//
+//   cmake -DCVDRIVER_BUILD_BENCHMARKS=ON ..
+//   cmake --build . --target cvdriver_crc_bench --config Release
+#include "crc32c.h"
+#include "packet_format.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Та же проверка, что VerifyByteSum в packet_format.cpp
+uint8_t ByteSum(const uint8_t* data, size_t size) {
+    uint8_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Компилятор не должен выкинуть результат
+volatile uint32_t g_sink;
+
+template <typename Fn>
+double NanosecondsPerPacket(const std::vector<uint8_t>& packets, size_t packetSize, size_t iterations, Fn fn) {
+    size_t count = packets.size() / packetSize;
+    uint32_t accumulator = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < count; i++) {
+            accumulator += fn(packets.data() + i * packetSize, packetSize);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    g_sink = accumulator;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (double)(iterations * count);
+}
+
+} // namespace
+
+int main() {
+    // v2 с 1 и 8 устройствами, legacy ControllerData, полная датаграмма
+    const size_t sizes[] = { 30, sizeof(ControllerData), 8 + 8 * 24 + 4, kMaxDatagramSize };
+    const size_t kPackets = 1024;
+
+    std::mt19937 rng(42);
+    printf("SSE4.2 crc32: %s\n\n", Crc32cHardwareAvailable() ? "yes" : "no");
+    printf("%8s %14s %14s %14s %14s\n", "bytes", "byte sum ns", "crc32c ns", "crc32c hw ns", "crc32c tbl ns");
+
+    for (size_t size : sizes) {
+        std::vector<uint8_t> packets(size * kPackets);
+        for (uint8_t& b : packets) {
+            b = static_cast<uint8_t>(rng());
+        }
+        size_t iterations = std::max<size_t>(1, 400000000 / (size * kPackets));
+
+        double sumNs = NanosecondsPerPacket(packets, size, iterations,
+            [](const uint8_t* p, size_t n) { return (uint32_t)ByteSum(p, n); });
+        double crcNs = NanosecondsPerPacket(packets, size, iterations,
+            [](const uint8_t* p, size_t n) { return Crc32c(p, n); });
+        double tableNs = NanosecondsPerPacket(packets, size, iterations,
+            [](const uint8_t* p, size_t n) { return Crc32cTable(p, n); });
+        double hwNs = Crc32cHardwareAvailable()
+            ? NanosecondsPerPacket(packets, size, iterations,
+                [](const uint8_t* p, size_t n) { return Crc32cHardware(p, n); })
+            : 0.0;
+
+        printf("%8zu %14.1f %14.1f %14.1f %14.1f\n", size, sumNs, crcNs, hwNs, tableNs);
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+// bench/fusion_bench.cpp
+// FusionEngine против прежнего пути встроенного хаба на синтетической
+// траектории: гиромышь 1 кГц с дрейфом и шумом, ArUco 30 Гц с шумом
+// 5 мм / 1 градус и задержкой камеры 40 мс. Ошибка, дрожание и задержка
+// выхода на каждом сэмпле гироскопа, плюс стоимость вызовов.
+//
+//   cmake -DCVDRIVER_BUILD_BENCHMARKS=ON ..
+//   cmake --build . --target cvdriver_fusion_bench --config Release
+#include "fusion_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDurationSec = 60.0;
+constexpr double kWarmupSec = 5.0;
+constexpr double kGyroPeriodSec = 0.001;
+constexpr double kOpticalPeriodSec = 1.0 / 30.0;
+constexpr double kOpticalLatencySec = 0.040;
+constexpr double kPositionNoiseM = 0.005;
+constexpr double kRotationNoiseDeg = 1.0;
+constexpr double kGyroNoiseDeg = 0.05;
+constexpr double kGyroDriftDegPerSec = 0.5;
+constexpr double kTimeConstantSec = 2.0;   // native_hub_fusion_ms по умолчанию
+
+FusionQuaternion Multiply(const FusionQuaternion& a, const FusionQuaternion& b) {
+    FusionQuaternion q;
+    q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    return q;
+}
+
+FusionQuaternion Conjugate(const FusionQuaternion& q) {
+    FusionQuaternion c = q;
+    c.x = -q.x;
+    c.y = -q.y;
+    c.z = -q.z;
+    return c;
+}
+
+FusionQuaternion Normalize(const FusionQuaternion& q) {
+    double norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    FusionQuaternion n;
+    n.w = q.w / norm;
+    n.x = q.x / norm;
+    n.y = q.y / norm;
+    n.z = q.z / norm;
+    return n;
+}
+
+FusionQuaternion Nlerp(const FusionQuaternion& a, const FusionQuaternion& b, double t) {
+    double sign = (a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z) < 0.0 ? -1.0 : 1.0;
+    FusionQuaternion q;
+    q.w = a.w + (sign * b.w - a.w) * t;
+    q.x = a.x + (sign * b.x - a.x) * t;
+    q.y = a.y + (sign * b.y - a.y) * t;
+    q.z = a.z + (sign * b.z - a.z) * t;
+    return Normalize(q);
+}
+
+// Поворот на угол (рад) вокруг оси (x, y, z), ось не обязана быть единичной
+FusionQuaternion AxisAngle(double x, double y, double z, double angle) {
+    double norm = std::sqrt(x * x + y * y + z * z);
+    FusionQuaternion q;
+    if (norm < 1e-12) {
+        return q;
+    }
+    double s = std::sin(angle * 0.5) / norm;
+    q.w = std::cos(angle * 0.5);
+    q.x = x * s;
+    q.y = y * s;
+    q.z = z * s;
+    return q;
+}
+
+double AngleDeg(const FusionQuaternion& a, const FusionQuaternion& b) {
+    double dot = std::fabs(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+    return 2.0 * std::acos(std::min(1.0, dot)) * 180.0 / kPi;
+}
+
+// Истинная поза: рука качается по трем осям, кисть - по рысканию и тангажу
+void TruePosition(double t, double out[3]) {
+    out[0] = 0.20 * std::sin(2.0 * kPi * 0.5 * t);
+    out[1] = 1.20 + 0.10 * std::sin(2.0 * kPi * 1.1 * t + 0.7);
+    out[2] = -0.30 + 0.15 * std::sin(2.0 * kPi * 0.8 * t + 1.9);
+}
+
+FusionQuaternion TrueRotation(double t) {
+    FusionQuaternion yaw = AxisAngle(0.0, 1.0, 0.0, 1.0 * std::sin(2.0 * kPi * 0.4 * t));
+    FusionQuaternion pitch = AxisAngle(1.0, 0.0, 0.0, 0.5 * std::sin(2.0 * kPi * 0.7 * t + 0.3));
+    return Multiply(yaw, pitch);
+}
+
+struct Output {
+    double position[3];
+    FusionQuaternion rotation;
+};
+
+struct Stats {
+    double positionMeanMm, positionP99Mm;
+    double rotationMeanDeg, rotationP99Deg;
+    double jitterMm;     // СКО шага ошибки позиции между сэмплами
+    double latencyMs;    // сдвиг, при котором выход лучше всего совпадает с истиной
+};
+
+double Percentile(std::vector<double> values, double p) {
+    size_t index = std::min(values.size() - 1, (size_t)(p * (double)values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+Stats Evaluate(const std::vector<Output>& outputs, const std::vector<double>& times) {
+    std::vector<double> positionErrors, rotationErrors;
+    double jitterSum = 0.0;
+    size_t jitterCount = 0;
+    double previousError[3] = { 0.0, 0.0, 0.0 };
+    bool hasPrevious = false;
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (times[i] < kWarmupSec) continue;
+        double truth[3];
+        TruePosition(times[i], truth);
+        double error[3], squared = 0.0;
+        for (int axis = 0; axis < 3; axis++) {
+            error[axis] = outputs[i].position[axis] - truth[axis];
+            squared += error[axis] * error[axis];
+        }
+        positionErrors.push_back(std::sqrt(squared) * 1000.0);
+        rotationErrors.push_back(AngleDeg(outputs[i].rotation, TrueRotation(times[i])));
+        if (hasPrevious) {
+            for (int axis = 0; axis < 3; axis++) {
+                double step = (error[axis] - previousError[axis]) * 1000.0;
+                jitterSum += step * step;
+            }
+            jitterCount++;
+        }
+        for (int axis = 0; axis < 3; axis++) previousError[axis] = error[axis];
+        hasPrevious = true;
+    }
+
+    Stats stats;
+    double sum = 0.0;
+    for (double e : positionErrors) sum += e;
+    stats.positionMeanMm = sum / (double)positionErrors.size();
+    stats.positionP99Mm = Percentile(positionErrors, 0.99);
+    sum = 0.0;
+    for (double e : rotationErrors) sum += e;
+    stats.rotationMeanDeg = sum / (double)rotationErrors.size();
+    stats.rotationP99Deg = Percentile(rotationErrors, 0.99);
+    stats.jitterMm = std::sqrt(jitterSum / (double)std::max<size_t>(1, jitterCount));
+
+    // Задержка позиции: сдвиг истины назад, дающий наименьшую ошибку
+    double bestError = 1e30;
+    stats.latencyMs = 0.0;
+    for (int shiftMs = -20; shiftMs <= 150; shiftMs++) {
+        double total = 0.0;
+        for (size_t i = 0; i < outputs.size(); i += 10) {
+            if (times[i] < kWarmupSec) continue;
+            double truth[3];
+            TruePosition(times[i] - shiftMs * 0.001, truth);
+            for (int axis = 0; axis < 3; axis++) {
+                double e = outputs[i].position[axis] - truth[axis];
+                total += e * e;
+            }
+        }
+        if (total < bestError) {
+            bestError = total;
+            stats.latencyMs = shiftMs;
+        }
+    }
+    return stats;
+}
+
+// Компилятор не должен выкинуть результат
+volatile double g_sink;
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    const double degToRad = kPi / 180.0;
+    // Система гиромыши повернута относительно мировой и уплывает по рысканию
+    const FusionQuaternion mount = AxisAngle(0.3, 1.0, 0.1, 40.0 * degToRad);
+
+    FusionSettings settings;
+    settings.orientationTimeConstantSec = kTimeConstantSec;
+    settings.positionNoiseM = kPositionNoiseM;
+    FusionEngine fused;          // метки захвата (ClockSync)
+    FusionEngine fusedArrival;   // без ClockSync: время прихода
+    fused.Configure(settings);
+    fusedArrival.Configure(settings);
+
+    // Прежний путь: позиция - последняя пришедшая засечка, поворот гироскопа
+    // подтягивается к ней по приходу, против последнего сэмпла гироскопа
+    bool rawHasFix = false, rawHasCorrection = false;
+    double rawPosition[3] = { 0.0, 0.0, 0.0 };
+    FusionQuaternion rawCorrection;
+    double rawCorrectedAt = 0.0;
+
+    struct PendingFix {
+        double captured;
+        double position[3];
+        FusionQuaternion rotation;
+    };
+    std::vector<PendingFix> inFlight;
+
+    size_t steps = (size_t)(kDurationSec / kGyroPeriodSec);
+    std::vector<double> times(steps);
+    std::vector<Output> rawOut(steps), fusedOut(steps), arrivalOut(steps);
+    double nextCapture = 0.0;
+    double engineNs = 0.0;
+    size_t gyroCalls = 0, opticalCalls = 0;
+    const Clock::time_point epoch = Clock::now();
+    auto at = [&](double t) {
+        return epoch + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t));
+    };
+
+    for (size_t i = 0; i < steps; i++) {
+        double t = (double)i * kGyroPeriodSec;
+        times[i] = t;
+
+        // Кадр камеры захвачен - засечка придет через kOpticalLatencySec
+        if (t >= nextCapture) {
+            PendingFix fix;
+            fix.captured = t;
+            TruePosition(t, fix.position);
+            for (double& p : fix.position) p += normal(rng) * kPositionNoiseM;
+            fix.rotation = Multiply(AxisAngle(normal(rng), normal(rng), normal(rng),
+                                              kRotationNoiseDeg * degToRad * std::fabs(normal(rng))),
+                                    TrueRotation(t));
+            inFlight.push_back(fix);
+            nextCapture += kOpticalPeriodSec;
+        }
+
+        FusionQuaternion drift = AxisAngle(0.0, 1.0, 0.0, kGyroDriftDegPerSec * degToRad * t);
+        FusionQuaternion noise = AxisAngle(normal(rng), normal(rng), normal(rng),
+                                           kGyroNoiseDeg * degToRad * std::fabs(normal(rng)));
+        FusionQuaternion gyro = Normalize(Multiply(noise, Multiply(drift, Multiply(Conjugate(mount), TrueRotation(t)))));
+
+        auto start = Clock::now();
+        fused.AddGyro(gyro, at(t));
+        engineNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        gyroCalls++;
+        fusedArrival.AddGyro(gyro, at(t));
+
+        while (!inFlight.empty() && inFlight.front().captured + kOpticalLatencySec <= t) {
+            const PendingFix& fix = inFlight.front();
+            start = Clock::now();
+            fused.AddOptical(fix.position, fix.rotation, at(fix.captured));
+            engineNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            opticalCalls++;
+            fusedArrival.AddOptical(fix.position, fix.rotation, at(t));
+
+            FusionQuaternion measured = Normalize(Multiply(fix.rotation, Conjugate(gyro)));
+            if (!rawHasCorrection) {
+                rawCorrection = measured;
+                rawHasCorrection = true;
+            } else {
+                rawCorrection = Nlerp(rawCorrection, measured, 1.0 - std::exp(-(t - rawCorrectedAt) / kTimeConstantSec));
+            }
+            rawCorrectedAt = t;
+            for (int axis = 0; axis < 3; axis++) rawPosition[axis] = fix.position[axis];
+            rawHasFix = true;
+            inFlight.erase(inFlight.begin());
+        }
+
+        FusedPose pose;
+        start = Clock::now();
+        fused.Output(at(t), pose);
+        engineNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        for (int axis = 0; axis < 3; axis++) fusedOut[i].position[axis] = pose.position[axis];
+        fusedOut[i].rotation = pose.rotation;
+
+        fusedArrival.Output(at(t), pose);
+        for (int axis = 0; axis < 3; axis++) arrivalOut[i].position[axis] = pose.position[axis];
+        arrivalOut[i].rotation = pose.rotation;
+
+        for (int axis = 0; axis < 3; axis++) rawOut[i].position[axis] = rawHasFix ? rawPosition[axis] : 0.0;
+        rawOut[i].rotation = rawHasCorrection ? Normalize(Multiply(rawCorrection, gyro)) : gyro;
+    }
+    g_sink = fusedOut.back().position[0];
+
+    printf("gyro %.0f Hz, optical %.0f Hz, camera latency %.0f ms, %.0f s (first %.0f s skipped)\n\n",
+        1.0 / kGyroPeriodSec, 1.0 / kOpticalPeriodSec, kOpticalLatencySec * 1000.0, kDurationSec, kWarmupSec);
+    printf("%-26s %9s %9s %9s %9s %10s %11s\n",
+        "path", "pos mm", "pos p99", "rot deg", "rot p99", "jitter mm", "latency ms");
+    const struct { const char* name; const std::vector<Output>* out; } rows[] = {
+        { "raw (hold last fix)", &rawOut },
+        { "fusion, arrival time", &arrivalOut },
+        { "fusion, capture time", &fusedOut },
+    };
+    for (const auto& row : rows) {
+        Stats s = Evaluate(*row.out, times);
+        printf("%-26s %9.2f %9.2f %9.3f %9.3f %10.3f %11.0f\n", row.name,
+            s.positionMeanMm, s.positionP99Mm, s.rotationMeanDeg, s.rotationP99Deg, s.jitterMm, s.latencyMs);
+    }
+    printf("\nFusionEngine cost: %.1f ns per gyro sample (AddGyro + Output, %zu optical fixes included)\n",
+        engineNs / (double)gyroCalls, opticalCalls);
+    return 0;
+}
@@ -0,0 +1,925 @@
+// bench/load_bench.cpp
+// Нагрузочный стенд драйвера без SteamVR. Настоящий CVDriver (src/main.cpp,
+// HmdDriverFactory) запускается с заглушками интерфейсов vrserver: настройки
+// из памяти, свойства и ввод принимаются и отбрасываются, IVRServerDriverHost
+// меряет позы. Потоки-генераторы шлют UDP на loopback от N устройств с
+// заданной частотой, форматом и потерями/перестановками, поток кадра зовет
+// RunFrame, как vrserver.
+//
+// Задержка - от sendto генератора до TrackedDevicePoseUpdated, по одним
+// часам: номер пакета (младшие 15 бит) зашит в позицию X в шаге
+// 1/kV2PositionScale, поэтому он переживает и v1, и квантование v2. Фильтр,
+// калибровка и экстраполяция выключены, позиция доходит до хоста как есть.
+//
+//   cmake -DCVDRIVER_BUILD_BENCHMARKS=ON ..
+//   cmake --build . --target cvdriver_load_bench --config Release
+//   cvdriver_load_bench [--devices N] [--rate HZ] [--format v1|v2|v2-batch] [--senders N]
+//       [--seconds S] [--warmup-ms MS] [--loss FRACTION] [--burst N] [--reorder FRACTION]
+//       [--frame-hz HZ] [--frame-only] [--max-submit-hz HZ] [--host-cost-us US]
+//       [--registered-io] [--port PORT] [--seed N] [--verbose]
+//
+// CPU драйвера - процесс минус потоки-генераторы: сетевой поток, поток
+// кадра (RunFrame), фоновый лог и --host-cost-us. Конкуренция за мьютекс
+// отправки - счетчики самого драйвера (PoseSubmitter, строки "submit").
+#include "packet_format.h"
+#include "packet_batch.h"
+#include "driver_settings.h"
+#include <openvr_driver.h>
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma comment(lib, "ws2_32.lib")
+
+extern "C" void* HmdDriverFactory(const char* pInterfaceName, int* pReturnCode);
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Номер пакета в позиции X: 15 бит в диапазоне int16 протокола v2
+constexpr uint32_t kTagCount = 1u << 15;
+// Гистограмма задержки: шаг 1 мкс, дальше - в последнюю корзину
+constexpr size_t kLatencyBuckets = 50000;
+
+enum class Format { V1, V2, V2Batch };
+
+struct Options {
+    size_t devices = 4;
+    double rateHz = 500.0;
+    Format format = Format::V2;
+    size_t senders = 1;
+    double seconds = 15.0;
+    int warmupMs = 1000;
+    double loss = 0.0;
+    uint32_t burst = 1;
+    double reorder = 0.0;
+    double frameHz = 90.0;
+    bool frameOnly = false;
+    float maxSubmitHz = -1.0f;   // < 0 - как в драйвере по умолчанию
+    int hostCostUs = 0;
+    bool registeredIo = false;
+    uint16_t port = 15555;
+    uint32_t seed = 1;
+    bool verbose = false;
+};
+
+const char* FormatName(Format format) {
+    switch (format) {
+    case Format::V1:      return "v1";
+    case Format::V2:      return "v2";
+    case Format::V2Batch: return "v2-batch";
+    }
+    return "?";
+}
+
+float TagToPosition(uint32_t tag) {
+    return ((int32_t)tag - (int32_t)(kTagCount / 2)) / kV2PositionScale;
+}
+
+uint32_t PositionToTag(double x) {
+    return (uint32_t)(std::lround(x * kV2PositionScale) + (long)(kTagCount / 2)) & (kTagCount - 1);
+}
+
+int64_t Ticks(Clock::time_point time) {
+    return time.time_since_epoch().count();
+}
+
+uint64_t FileTimeTo100ns(const FILETIME& time) {
+    return ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+}
+
+double ProcessCpuSec() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    return (FileTimeTo100ns(kernel) + FileTimeTo100ns(user)) / 1e7;
+}
+
+double ThreadCpuSec(HANDLE thread) {
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    return (FileTimeTo100ns(kernel) + FileTimeTo100ns(user)) / 1e7;
+}
+
+// Все, что меряется; пишут сетевой поток, поток кадра и генераторы
+struct LoadState {
+    // Время sendto каждого пакета (Ticks + 1, 0 - нет): [устройство][tag]
+    std::array<std::unique_ptr<std::atomic<int64_t>[]>, kMaxTrackedDevices> sendTicks;
+    std::atomic<bool> measuring{false};
+
+    std::atomic<uint64_t> immediatePoses{0};
+    std::atomic<uint64_t> framePoses{0};
+    std::atomic<uint64_t> matched{0};
+    std::array<std::atomic<uint64_t>, kLatencyBuckets> latency;
+    std::atomic<uint64_t> maxLatencyUs{0};
+
+    LoadState() {
+        for (auto& ticks : sendTicks) {
+            ticks.reset(new std::atomic<int64_t>[kTagCount]);
+            for (uint32_t i = 0; i < kTagCount; i++) ticks[i].store(0, std::memory_order_relaxed);
+        }
+        ResetCounters();
+    }
+
+    void ResetCounters() {
+        immediatePoses = 0;
+        framePoses = 0;
+        matched = 0;
+        maxLatencyUs = 0;
+        for (auto& bucket : latency) bucket.store(0, std::memory_order_relaxed);
+    }
+};
+
+LoadState g_state;
+thread_local bool t_frameThread = false;
+
+// --- Заглушки vrserver ---
+
+class BenchDriverLog : public vr::IVRDriverLog {
+public:
+    bool verbose = false;
+
+    void Log(const char* pchLogMessage) override {
+        std::string line = pchLogMessage;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (verbose) {
+            fprintf(stderr, "%s\n", line.c_str());
+        }
+        m_lines.push_back(line);
+        // Последняя статистика каждого пути отправки и цикла приема - в отчет
+        size_t submit = line.find(" submit - ");
+        if (submit != std::string::npos) {
+            m_latest[line.substr(0, submit)] = line;
+        } else if (line.compare(0, 19, "CVDriver: I/O loop ") == 0) {
+            m_latest["~io"] = line;
+        }
+    }
+
+    std::vector<std::string> Lines() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lines;
+    }
+
+    std::map<std::string, std::string> Latest() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_latest;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::string> m_lines;
+    std::map<std::string, std::string> m_latest;
+};
+
+// Настройки из памяти; ключа нет - ошибка, драйвер берет значение по умолчанию
+class BenchSettings : public vr::IVRSettings {
+public:
+    void Set(const char* section, const char* key, const std::string& value) {
+        m_values[std::string(section) + "/" + key] = value;
+    }
+
+    const char* GetSettingsErrorNameFromEnum(vr::EVRSettingsError eError) override {
+        return eError == vr::VRSettingsError_None ? "None" : "UnsetSettingHasNoDefault";
+    }
+
+    void SetBool(const char* pchSection, const char* pchSettingsKey, bool bValue,
+                 vr::EVRSettingsError* peError) override {
+        Set(pchSection, pchSettingsKey, bValue ? "true" : "false");
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+    void SetInt32(const char* pchSection, const char* pchSettingsKey, int32_t nValue,
+                  vr::EVRSettingsError* peError) override {
+        Set(pchSection, pchSettingsKey, std::to_string(nValue));
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+    void SetFloat(const char* pchSection, const char* pchSettingsKey, float flValue,
+                  vr::EVRSettingsError* peError) override {
+        Set(pchSection, pchSettingsKey, std::to_string(flValue));
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+    void SetString(const char* pchSection, const char* pchSettingsKey, const char* pchValue,
+                   vr::EVRSettingsError* peError) override {
+        Set(pchSection, pchSettingsKey, pchValue);
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+    bool GetBool(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError) override {
+        const std::string* value = Find(pchSection, pchSettingsKey, peError);
+        return value && (*value == "true" || *value == "1");
+    }
+
+    int32_t GetInt32(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError) override {
+        const std::string* value = Find(pchSection, pchSettingsKey, peError);
+        return value ? atoi(value->c_str()) : 0;
+    }
+
+    float GetFloat(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError) override {
+        const std::string* value = Find(pchSection, pchSettingsKey, peError);
+        return value ? (float)atof(value->c_str()) : 0.0f;
+    }
+
+    void GetString(const char* pchSection, const char* pchSettingsKey, char* pchValue, uint32_t unValueLen,
+                   vr::EVRSettingsError* peError) override {
+        const std::string* value = Find(pchSection, pchSettingsKey, peError);
+        if (unValueLen > 0) {
+            snprintf(pchValue, unValueLen, "%s", value ? value->c_str() : "");
+        }
+    }
+
+    void RemoveSection(const char* pchSection, vr::EVRSettingsError* peError) override {
+        std::string prefix = std::string(pchSection) + "/";
+        for (auto it = m_values.begin(); it != m_values.end();) {
+            it = it->first.compare(0, prefix.size(), prefix) == 0 ? m_values.erase(it) : std::next(it);
+        }
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+    void RemoveKeyInSection(const char* pchSection, const char* pchSettingsKey, vr::EVRSettingsError* peError) override {
+        m_values.erase(std::string(pchSection) + "/" + pchSettingsKey);
+        if (peError) *peError = vr::VRSettingsError_None;
+    }
+
+private:
+    const std::string* Find(const char* section, const char* key, vr::EVRSettingsError* error) {
+        auto it = m_values.find(std::string(section) + "/" + key);
+        if (error) {
+            *error = it != m_values.end() ? vr::VRSettingsError_None : vr::VRSettingsError_UnsetSettingHasNoDefault;
+        }
+        return it != m_values.end() ? &it->second : nullptr;
+    }
+
+    std::map<std::string, std::string> m_values;   // "<section>/<key>"; только Init
+};
+
+// Свойства записываются в никуда; чтение - "нет такого свойства"
+class BenchProperties : public vr::IVRProperties {
+public:
+    vr::ETrackedPropertyError ReadPropertyBatch(vr::PropertyContainerHandle_t, vr::PropertyRead_t* pBatch,
+                                                uint32_t unBatchEntryCount) override {
+        for (uint32_t i = 0; i < unBatchEntryCount; i++) {
+            pBatch[i].eError = vr::TrackedProp_UnknownProperty;
+            pBatch[i].unRequiredBufferSize = 0;
+            pBatch[i].unTag = 0;
+        }
+        return vr::TrackedProp_Success;
+    }
+
+    vr::ETrackedPropertyError WritePropertyBatch(vr::PropertyContainerHandle_t, vr::PropertyWrite_t* pBatch,
+                                                 uint32_t unBatchEntryCount) override {
+        for (uint32_t i = 0; i < unBatchEntryCount; i++) {
+            pBatch[i].eError = vr::TrackedProp_Success;
+        }
+        return vr::TrackedProp_Success;
+    }
+
+    const char* GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override {
+        return error == vr::TrackedProp_Success ? "Success" : "UnknownProperty";
+    }
+
+    vr::PropertyContainerHandle_t TrackedDeviceToPropertyContainer(vr::TrackedDeviceIndex_t nDevice) override {
+        return (vr::PropertyContainerHandle_t)nDevice + 1;
+    }
+};
+
+class BenchDriverInput : public vr::IVRDriverInput {
+public:
+    vr::EVRInputError CreateBooleanComponent(vr::PropertyContainerHandle_t, const char*,
+                                             vr::VRInputComponentHandle_t* pHandle) override {
+        return Create(pHandle);
+    }
+
+    vr::EVRInputError UpdateBooleanComponent(vr::VRInputComponentHandle_t, bool, double) override {
+        return vr::VRInputError_None;
+    }
+
+    vr::EVRInputError CreateScalarComponent(vr::PropertyContainerHandle_t, const char*,
+                                            vr::VRInputComponentHandle_t* pHandle,
+                                            vr::EVRScalarType, vr::EVRScalarUnits) override {
+        return Create(pHandle);
+    }
+
+    vr::EVRInputError UpdateScalarComponent(vr::VRInputComponentHandle_t, float, double) override {
+        return vr::VRInputError_None;
+    }
+
+    vr::EVRInputError CreateHapticComponent(vr::PropertyContainerHandle_t, const char*,
+                                            vr::VRInputComponentHandle_t* pHandle) override {
+        return Create(pHandle);
+    }
+
+    vr::EVRInputError CreateSkeletonComponent(vr::PropertyContainerHandle_t, const char*, const char*, const char*,
+                                              vr::EVRSkeletalTrackingLevel, const vr::VRBoneTransform_t*, uint32_t,
+                                              vr::VRInputComponentHandle_t* pHandle) override {
+        return Create(pHandle);
+    }
+
+    vr::EVRInputError UpdateSkeletonComponent(vr::VRInputComponentHandle_t, vr::EVRSkeletalMotionRange,
+                                              const vr::VRBoneTransform_t*, uint32_t) override {
+        return vr::VRInputError_None;
+    }
+
+private:
+    vr::EVRInputError Create(vr::VRInputComponentHandle_t* handle) {
+        if (handle) *handle = ++m_nextHandle;
+        return vr::VRInputError_None;
+    }
+
+    vr::VRInputComponentHandle_t m_nextHandle = 0;
+};
+
+// Хост: устройства активируются сразу, позы меряются
+class BenchServerHost : public vr::IVRServerDriverHost {
+public:
+    int hostCostUs = 0;
+
+    size_t DeviceCount() const { return m_count; }
+
+    bool TrackedDeviceAdded(const char* pchDeviceSerialNumber, vr::ETrackedDeviceClass,
+                            vr::ITrackedDeviceServerDriver* pDriver) override {
+        // Устройства добавляются только в Init, до старта сетевого потока
+        unsigned id = 0;
+        if (m_count >= m_ids.size() || sscanf(pchDeviceSerialNumber, "LOAD_%u", &id) != 1 ||
+            id >= kMaxTrackedDevices) {
+            return false;
+        }
+        uint32_t index = (uint32_t)m_count;
+        m_ids[m_count++] = (uint8_t)id;
+        return pDriver->Activate(index) == vr::VRInitError_None;
+    }
+
+    void TrackedDevicePoseUpdated(uint32_t unWhichDevice, const vr::DriverPose_t& newPose, uint32_t) override {
+        Clock::time_point now = Clock::now();
+        if (hostCostUs > 0) {
+            // Стоимость IPC vrserver: держит мьютекс отправки устройства
+            Clock::time_point until = now + std::chrono::microseconds(hostCostUs);
+            while (Clock::now() < until) {}
+        }
+        if (unWhichDevice >= m_count || !g_state.measuring.load(std::memory_order_relaxed)) {
+            return;
+        }
+        (t_frameThread ? g_state.framePoses : g_state.immediatePoses).fetch_add(1, std::memory_order_relaxed);
+
+        // Первая поза сэмпла; повтор (RunFrame после тайм-аута и т.п.) не считается
+        uint8_t id = m_ids[unWhichDevice];
+        uint32_t tag = PositionToTag(newPose.vecPosition[0]);
+        int64_t sent = g_state.sendTicks[id][tag].exchange(0, std::memory_order_relaxed);
+        if (sent == 0) {
+            return;
+        }
+        int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - Clock::time_point(Clock::duration(sent - 1))).count();
+        latencyUs = std::max<int64_t>(0, latencyUs);
+        g_state.latency[std::min<size_t>((size_t)latencyUs, kLatencyBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+        g_state.matched.fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = g_state.maxLatencyUs.load(std::memory_order_relaxed);
+        while ((uint64_t)latencyUs > max &&
+               !g_state.maxLatencyUs.compare_exchange_weak(max, (uint64_t)latencyUs, std::memory_order_relaxed)) {}
+    }
+
+    void VsyncEvent(double) override {}
+    void VendorSpecificEvent(uint32_t, vr::EVREventType, const vr::VREvent_Data_t&, double) override {}
+    bool IsExiting() override { return false; }
+    bool PollNextEvent(vr::VREvent_t*, uint32_t) override { return false; }
+    void GetRawTrackedDevicePoses(float, vr::TrackedDevicePose_t*, uint32_t) override {}
+    void RequestRestart(const char*, const char*, const char*, const char*) override {}
+    uint32_t GetFrameTimings(vr::Compositor_FrameTiming*, uint32_t) override { return 0; }
+    void SetDisplayEyeToHead(uint32_t, const vr::HmdMatrix34_t&, const vr::HmdMatrix34_t&) override {}
+    void SetDisplayProjectionRaw(uint32_t, const vr::HmdRect2_t&, const vr::HmdRect2_t&) override {}
+    void SetRecommendedRenderTargetSize(uint32_t, uint32_t, uint32_t) override {}
+
+private:
+    std::array<uint8_t, kMaxTrackedDevices> m_ids = {};   // индекс SteamVR -> controller_id
+    size_t m_count = 0;
+};
+
+class BenchDriverContext : public vr::IVRDriverContext {
+public:
+    BenchDriverLog log;
+    BenchSettings settings;
+    BenchProperties properties;
+    BenchDriverInput input;
+    BenchServerHost host;
+
+    void* GetGenericInterface(const char* pchInterfaceVersion, vr::EVRInitError* peError) override {
+        void* result = nullptr;
+        if (strcmp(pchInterfaceVersion, vr::IVRServerDriverHost_Version) == 0) {
+            result = static_cast<vr::IVRServerDriverHost*>(&host);
+        } else if (strcmp(pchInterfaceVersion, vr::IVRSettings_Version) == 0) {
+            result = static_cast<vr::IVRSettings*>(&settings);
+        } else if (strcmp(pchInterfaceVersion, vr::IVRProperties_Version) == 0) {
+            result = static_cast<vr::IVRProperties*>(&properties);
+        } else if (strcmp(pchInterfaceVersion, vr::IVRDriverLog_Version) == 0) {
+            result = static_cast<vr::IVRDriverLog*>(&log);
+        } else if (strcmp(pchInterfaceVersion, vr::IVRDriverInput_Version) == 0) {
+            result = static_cast<vr::IVRDriverInput*>(&input);
+        }
+        if (peError) {
+            *peError = result ? vr::VRInitError_None : vr::VRInitError_Init_InterfaceNotFound;
+        }
+        return result;
+    }
+
+    vr::DriverHandle_t GetDriverHandle() override { return 1; }
+};
+
+// --- Генератор ---
+
+struct OutDatagram {
+    uint8_t data[kMaxDatagramSize];
+    size_t size = 0;
+    size_t count = 0;
+    uint8_t ids[kMaxTrackedDevices];
+    uint16_t tags[kMaxTrackedDevices];
+};
+
+// Поток датаграмм, к которому применяются потери и перестановки:
+// устройство, а в v2-batch - весь генератор
+struct Stream {
+    std::mt19937 random;
+    uint32_t lossRun = 0;
+    bool holding = false;
+    OutDatagram held;
+};
+
+struct SenderStats {
+    std::atomic<uint64_t> datagrams{0};
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> lostRecords{0};   // выброшено по --loss
+    std::atomic<uint64_t> reordered{0};
+    std::atomic<uint64_t> errors{0};
+};
+
+struct Sender {
+    std::vector<uint8_t> ids;
+    SenderStats stats;
+    std::thread thread;
+    std::atomic<HANDLE> handle{nullptr};   // для GetThreadTimes; ставит сам поток
+};
+
+ControllerData MakeRecord(uint8_t id, uint32_t packet, double timeSec) {
+    ControllerData record = {};
+    record.controller_id = id;
+    record.packet_number = packet;
+    // Медленный поворот вокруг Y; X позиции - номер пакета
+    float yaw = 0.5f * (float)std::sin(timeSec + id);
+    record.quat_w = std::cos(0.5f * yaw);
+    record.quat_y = std::sin(0.5f * yaw);
+    record.accel_x = TagToPosition(packet & (kTagCount - 1));
+    record.accel_y = 1.0f + 0.1f * (float)std::sin(2.0 * timeSec + id);
+    record.accel_z = -0.5f + 0.1f * (float)std::cos(2.0 * timeSec + id);
+    record.gyro_y = 0.5f * (float)std::cos(timeSec + id);
+    return record;
+}
+
+void EncodeV1(const ControllerData& record, OutDatagram& out) {
+    memcpy(out.data, &record, sizeof(record));
+    uint8_t sum = 0;
+    for (size_t i = 0; i + 1 < sizeof(record); i++) {
+        sum += out.data[i];
+    }
+    out.data[sizeof(record) - 1] = sum;
+    out.size = sizeof(record);
+}
+
+class Generator {
+public:
+    Generator(const Options& options, SOCKET socket, const sockaddr_in& target, Sender& sender)
+        : m_options(options), m_socket(socket), m_target(target), m_sender(sender) {}
+
+    void Run(const std::atomic<bool>& running) {
+        size_t streamCount = m_options.format == Format::V2Batch ? 1 : m_sender.ids.size();
+        m_streams.resize(streamCount);
+        for (size_t i = 0; i < streamCount; i++) {
+            m_streams[i].random.seed(m_options.seed * 7919u + m_sender.ids[i] * 131u + (uint32_t)i);
+        }
+
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.rateHz));
+        Clock::time_point start = Clock::now();
+        Clock::time_point next = start;
+        uint32_t packet = 1;
+        std::vector<ControllerData> records(m_sender.ids.size());
+        OutDatagram datagram;
+
+        while (running.load(std::memory_order_relaxed)) {
+            double timeSec = std::chrono::duration<double>(next - start).count();
+            for (size_t i = 0; i < m_sender.ids.size(); i++) {
+                records[i] = MakeRecord(m_sender.ids[i], packet, timeSec);
+            }
+
+            if (m_options.format == Format::V2Batch) {
+                datagram.size = EncodeDatagramV2(records.data(), records.size(), 0, datagram.data, sizeof(datagram.data));
+                datagram.count = records.size();
+                for (size_t i = 0; i < records.size(); i++) {
+                    datagram.ids[i] = records[i].controller_id;
+                    datagram.tags[i] = (uint16_t)(packet & (kTagCount - 1));
+                }
+                Emit(m_streams[0], datagram);
+            } else {
+                for (size_t i = 0; i < records.size(); i++) {
+                    if (m_options.format == Format::V1) {
+                        EncodeV1(records[i], datagram);
+                    } else {
+                        datagram.size = EncodeDatagramV2(&records[i], 1, 0, datagram.data, sizeof(datagram.data));
+                    }
+                    datagram.count = 1;
+                    datagram.ids[0] = records[i].controller_id;
+                    datagram.tags[0] = (uint16_t)(packet & (kTagCount - 1));
+                    Emit(m_streams[i], datagram);
+                }
+            }
+            packet++;
+
+            // Пауза до следующего тика: sleep, пока далеко, дальше - yield
+            next += period;
+            Clock::time_point now = Clock::now();
+            while (now < next && running.load(std::memory_order_relaxed)) {
+                if (next - now > std::chrono::milliseconds(2)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                } else {
+                    std::this_thread::yield();
+                }
+                now = Clock::now();
+            }
+            // Отстали (система занята) - не догоняем пачкой
+            if (now - next > std::chrono::milliseconds(50)) {
+                next = now;
+            }
+        }
+    }
+
+private:
+    // Потери сериями по --burst подряд, в среднем --loss; перестановка -
+    // датаграмма уходит после следующей
+    void Emit(Stream& stream, const OutDatagram& datagram) {
+        SenderStats& stats = m_sender.stats;
+        if (stream.lossRun > 0) {
+            stream.lossRun--;
+            stats.lostRecords.fetch_add(datagram.count, std::memory_order_relaxed);
+            return;
+        }
+        if (m_options.loss > 0.0 && m_uniform(stream.random) < m_options.loss / m_options.burst) {
+            stream.lossRun = m_options.burst - 1;
+            stats.lostRecords.fetch_add(datagram.count, std::memory_order_relaxed);
+            return;
+        }
+        if (stream.holding) {
+            Send(datagram);
+            Send(stream.held);
+            stream.holding = false;
+            stats.reordered.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (m_options.reorder > 0.0 && m_uniform(stream.random) < m_options.reorder) {
+            stream.held = datagram;
+            stream.holding = true;
+            return;
+        }
+        Send(datagram);
+    }
+
+    void Send(const OutDatagram& datagram) {
+        // Метка до sendto: драйвер может разобрать пакет раньше, чем sendto вернется
+        int64_t ticks = Ticks(Clock::now()) + 1;
+        for (size_t i = 0; i < datagram.count; i++) {
+            g_state.sendTicks[datagram.ids[i]][datagram.tags[i]].store(ticks, std::memory_order_relaxed);
+        }
+        SenderStats& stats = m_sender.stats;
+        if (sendto(m_socket, reinterpret_cast<const char*>(datagram.data), (int)datagram.size, 0,
+                   reinterpret_cast<const sockaddr*>(&m_target), sizeof(m_target)) == SOCKET_ERROR) {
+            stats.errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        stats.datagrams.fetch_add(1, std::memory_order_relaxed);
+        stats.records.fetch_add(datagram.count, std::memory_order_relaxed);
+    }
+
+    const Options& m_options;
+    SOCKET m_socket;
+    sockaddr_in m_target;
+    Sender& m_sender;
+    std::vector<Stream> m_streams;
+    std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+};
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--frame-only") {
+            options.frameOnly = true;
+        } else if (arg == "--registered-io") {
+            options.registeredIo = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--devices" && hasValue) {
+            options.devices = (size_t)std::max(1, atoi(argv[++i]));
+        } else if (arg == "--rate" && hasValue) {
+            options.rateHz = atof(argv[++i]);
+        } else if (arg == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format == "v1") options.format = Format::V1;
+            else if (format == "v2") options.format = Format::V2;
+            else if (format == "v2-batch") options.format = Format::V2Batch;
+            else return false;
+        } else if (arg == "--senders" && hasValue) {
+            options.senders = (size_t)std::max(1, atoi(argv[++i]));
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = atof(argv[++i]);
+        } else if (arg == "--warmup-ms" && hasValue) {
+            options.warmupMs = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--loss" && hasValue) {
+            options.loss = atof(argv[++i]);
+        } else if (arg == "--burst" && hasValue) {
+            options.burst = (uint32_t)std::max(1, atoi(argv[++i]));
+        } else if (arg == "--reorder" && hasValue) {
+            options.reorder = atof(argv[++i]);
+        } else if (arg == "--frame-hz" && hasValue) {
+            options.frameHz = atof(argv[++i]);
+        } else if (arg == "--max-submit-hz" && hasValue) {
+            options.maxSubmitHz = (float)atof(argv[++i]);
+        } else if (arg == "--host-cost-us" && hasValue) {
+            options.hostCostUs = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--port" && hasValue) {
+            options.port = (uint16_t)atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = (uint32_t)atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    if (options.devices > kMaxTrackedDevices || options.rateHz <= 0.0 || options.seconds <= 0.0 ||
+        options.loss < 0.0 || options.loss >= 1.0 || options.reorder < 0.0 || options.reorder >= 1.0) {
+        return false;
+    }
+    // v2-batch: все устройства генератора - одна датаграмма
+    options.senders = std::min(options.senders, options.devices);
+    if (options.frameOnly && options.frameHz <= 0.0) {
+        return false;
+    }
+    return true;
+}
+
+void ConfigureDriver(const Options& options, BenchSettings& settings) {
+    const char* section = kDriverSettingsSection;
+    std::string devices;
+    for (size_t i = 0; i < options.devices; i++) {
+        if (!devices.empty()) devices += ";";
+        devices += std::to_string(i) + ":tracker:LOAD_" + std::to_string(i);
+    }
+    settings.Set(section, "devices", devices);
+    settings.Set(section, "hub_port", std::to_string(options.port));
+    settings.Set(section, "auto_add_trackers", "false");
+    settings.Set(section, "native_hub_enable", "false");
+    settings.Set(section, "shared_memory_name", "");
+    settings.Set(section, "capture_file", "");
+    settings.Set(section, "calibration_file", "");
+    settings.Set(section, "registered_io", options.registeredIo ? "true" : "false");
+    // Поза доходит до хоста такой, какой ее прислали (номер пакета в X)
+    settings.Set(section, "filter_enable", "false");
+    settings.Set(section, "extrapolate_in_driver", "false");
+    settings.Set(section, "interpolation_delay_ms", "0");
+    settings.Set(section, "immediate_submit", options.frameOnly ? "false" : "true");
+    if (options.maxSubmitHz >= 0.0f) {
+        settings.Set(section, "immediate_submit_max_hz", std::to_string(options.maxSubmitHz));
+    }
+}
+
+double Percentile(const std::vector<uint64_t>& histogram, uint64_t total, double fraction) {
+    if (total == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)std::ceil(fraction * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        seen += histogram[i];
+        if (seen >= std::max<uint64_t>(rank, 1)) {
+            return (double)i;
+        }
+    }
+    return (double)(histogram.size() - 1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr,
+            "usage: cvdriver_load_bench [--devices N] [--rate HZ] [--format v1|v2|v2-batch] [--senders N]\n"
+            "                           [--seconds S] [--warmup-ms MS] [--loss FRACTION] [--burst N]\n"
+            "                           [--reorder FRACTION] [--frame-hz HZ] [--frame-only]\n"
+            "                           [--max-submit-hz HZ] [--host-cost-us US] [--registered-io]\n"
+            "                           [--port PORT] [--seed N] [--verbose]\n");
+        return 2;
+    }
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed\n");
+        return 1;
+    }
+
+    // Не удаляется: деструктор глобального CVDriver при выходе еще пишет в лог
+    BenchDriverContext& context = *new BenchDriverContext();
+    context.log.verbose = options.verbose;
+    context.host.hostCostUs = options.hostCostUs;
+    ConfigureDriver(options, context.settings);
+
+    int factoryError = 0;
+    auto* provider = static_cast<vr::IServerTrackedDeviceProvider*>(
+        HmdDriverFactory(vr::IServerTrackedDeviceProvider_Version, &factoryError));
+    if (!provider) {
+        fprintf(stderr, "HmdDriverFactory failed (%d)\n", factoryError);
+        return 1;
+    }
+    if (provider->Init(&context) != vr::VRInitError_None || context.host.DeviceCount() != options.devices) {
+        fprintf(stderr, "driver Init failed:\n");
+        if (!options.verbose) {
+            for (const std::string& line : context.log.Lines()) {
+                fprintf(stderr, "  %s\n", line.c_str());
+            }
+        }
+        provider->Cleanup();
+        return 1;
+    }
+
+    std::atomic<bool> running{true};
+
+    // Поток кадра - как vrserver: RunFrame с частотой дисплея
+    std::thread frameThread;
+    if (options.frameHz > 0.0) {
+        frameThread = std::thread([&]() {
+            t_frameThread = true;
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.frameHz));
+            Clock::time_point next = Clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                provider->RunFrame();
+                next += period;
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(options.port);
+    inet_pton(AF_INET, "127.0.0.1", &target.sin_addr);
+
+    std::vector<std::unique_ptr<Sender>> senders(options.senders);
+    for (size_t i = 0; i < senders.size(); i++) {
+        senders[i] = std::make_unique<Sender>();
+    }
+    for (size_t i = 0; i < options.devices; i++) {
+        senders[i % senders.size()]->ids.push_back((uint8_t)i);
+    }
+    std::vector<SOCKET> sockets;
+    for (auto& sender : senders) {
+        SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == INVALID_SOCKET) {
+            fprintf(stderr, "socket failed (%d)\n", WSAGetLastError());
+            running = false;
+            break;
+        }
+        sockets.push_back(s);
+        Sender* owner = sender.get();
+        sender->thread = std::thread([&options, s, target, owner, &running]() {
+            owner->handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+            Generator generator(options, s, target, *owner);
+            generator.Run(running);
+        });
+    }
+
+    // Окно замера - после прогрева (MotionModel, первые пробуждения)
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.warmupMs));
+    struct SenderSnapshot { uint64_t datagrams, records, lost, reordered, errors; double cpuSec; };
+    auto snapshot = [&](std::vector<SenderSnapshot>& out) {
+        out.clear();
+        for (auto& sender : senders) {
+            const SenderStats& stats = sender->stats;
+            out.push_back({ stats.datagrams.load(), stats.records.load(), stats.lostRecords.load(),
+                            stats.reordered.load(), stats.errors.load(),
+                            sender->handle ? ThreadCpuSec(sender->handle) : 0.0 });
+        }
+    };
+    std::vector<SenderSnapshot> before, after;
+    g_state.ResetCounters();
+    g_state.measuring = true;
+    snapshot(before);
+    double processCpuBefore = ProcessCpuSec();
+    Clock::time_point windowStart = Clock::now();
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+
+    g_state.measuring = false;
+    Clock::time_point windowEnd = Clock::now();
+    double processCpuAfter = ProcessCpuSec();
+    snapshot(after);
+
+    running = false;
+    for (auto& sender : senders) {
+        if (sender->thread.joinable()) sender->thread.join();
+        if (sender->handle) CloseHandle(sender->handle);
+    }
+    if (frameThread.joinable()) {
+        frameThread.join();
+    }
+    for (SOCKET s : sockets) {
+        closesocket(s);
+    }
+    provider->Cleanup();
+    WSACleanup();
+
+    // --- Отчет ---
+    double windowSec = std::chrono::duration<double>(windowEnd - windowStart).count();
+    uint64_t datagrams = 0, records = 0, lost = 0, reordered = 0, errors = 0;
+    double generatorCpuSec = 0.0;
+    for (size_t i = 0; i < after.size() && i < before.size(); i++) {
+        datagrams += after[i].datagrams - before[i].datagrams;
+        records += after[i].records - before[i].records;
+        lost += after[i].lost - before[i].lost;
+        reordered += after[i].reordered - before[i].reordered;
+        errors += after[i].errors - before[i].errors;
+        generatorCpuSec += after[i].cpuSec - before[i].cpuSec;
+    }
+    uint64_t immediatePoses = g_state.immediatePoses.load();
+    uint64_t framePoses = g_state.framePoses.load();
+    uint64_t poses = immediatePoses + framePoses;
+    uint64_t matched = g_state.matched.load();
+    double driverCpuSec = std::max(0.0, processCpuAfter - processCpuBefore - generatorCpuSec);
+
+    printf("load: %zu devices x %.0f Hz, %s, %zu sender(s), loss %.1f%% (burst %u), reorder %.1f%%, "
+           "frame %.0f Hz, %s submit%s\n",
+           options.devices, options.rateHz, FormatName(options.format), options.senders,
+           options.loss * 100.0, options.burst, options.reorder * 100.0, options.frameHz,
+           options.frameOnly ? "frame" : "immediate", options.registeredIo ? ", registered I/O" : "");
+    printf("window %.3f s\n\n", windowSec);
+
+    printf("sent     %llu records in %llu datagrams (%.0f records/s, %.0f datagrams/s), %llu dropped by --loss, "
+           "%llu reordered, %llu send errors\n",
+           (unsigned long long)records, (unsigned long long)datagrams, records / windowSec, datagrams / windowSec,
+           (unsigned long long)lost, (unsigned long long)reordered, (unsigned long long)errors);
+    printf("poses    %llu (%.0f/s): %llu from the network thread, %llu from RunFrame; %llu traced to a sent record, "
+           "%llu records coalesced, stale or lost on loopback\n",
+           (unsigned long long)poses, poses / windowSec, (unsigned long long)immediatePoses,
+           (unsigned long long)framePoses, (unsigned long long)matched,
+           (unsigned long long)(records > matched ? records - matched : 0));
+
+    std::vector<uint64_t> histogram(kLatencyBuckets);
+    uint64_t total = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < kLatencyBuckets; i++) {
+        histogram[i] = g_state.latency[i].load();
+        total += histogram[i];
+        sum += (double)i * histogram[i];
+    }
+    printf("\n%-34s %8s %8s %8s %8s %8s %8s\n", "latency us (send -> pose updated)", "mean", "p50", "p90", "p99", "p99.9", "max");
+    printf("%-34s %8.1f %8.0f %8.0f %8.0f %8.0f %8llu\n", "", total ? sum / total : 0.0,
+           Percentile(histogram, total, 0.50), Percentile(histogram, total, 0.90),
+           Percentile(histogram, total, 0.99), Percentile(histogram, total, 0.999),
+           (unsigned long long)g_state.maxLatencyUs.load());
+    if (histogram[kLatencyBuckets - 1] > 0) {
+        printf("%-34s %llu samples >= %zu us\n", "", (unsigned long long)histogram[kLatencyBuckets - 1], kLatencyBuckets - 1);
+    }
+
+    printf("\ncpu      driver %.3f s (%.1f%% of one core), %.2f us per record received, %.2f us per pose; "
+           "generators %.3f s\n",
+           driverCpuSec, driverCpuSec / windowSec * 100.0,
+           records > 0 ? driverCpuSec * 1e6 / records : 0.0, poses > 0 ? driverCpuSec * 1e6 / poses : 0.0,
+           generatorCpuSec);
+
+    // Статистика самого драйвера за последний период (раз в 10 с)
+    printf("\ndriver statistics (last period):\n");
+    std::map<std::string, std::string> latest = context.log.Latest();
+    if (latest.empty()) {
+        printf("  none yet - the driver logs them every 10 s, run with --seconds 15 or more\n");
+    }
+    for (const auto& entry : latest) {
+        printf("  %s\n", entry.second.c_str());
+    }
+    return 0;
+}
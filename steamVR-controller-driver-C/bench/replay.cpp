@@ -0,0 +1,443 @@
+// bench/replay.cpp
+// Воспроизведение записи сетевого потока (vrsettings "capture_file",
+// src/capture_file.h) через тот же конвейер, что и в драйвере: разбор
+// NetworkClient -> PacketBatch -> встроенный хаб (FusionEngine) -> фильтр и
+// MotionModel устройства -> поза к отправке (ApplyPrediction).
+//
+// "Сейчас" для конвейера - время прихода из записи, поэтому позы на выходе
+// зависят только от записи и кода: две сборки сравниваются по хэшу поз или
+// по файлу --poses (значения в %a, бит в бит). Время каждой стадии меряется
+// по настоящим часам. --realtime выдерживает исходные интервалы между
+// пробуждениями, без него - как можно быстрее.
+//
+//   cmake -DCVDRIVER_BUILD_BENCHMARKS=ON ..
+//   cmake --build . --target cvdriver_replay --config Release
+//   cvdriver_replay capture.cvcap [--realtime] [--repeat N] [--poses poses.txt]
+//       [--filter] [--extrapolate] [--prediction-ms X]
+//       [--native-hub-config vr_config.json] [--native-hub-orientation 0=3]
+//
+// Устройство воспроизводится как DevicePosePipeline::Update без
+// calibration.json и без ввода: только поза.
+#include "driver.h"
+#include "packet_batch.h"
+#include "native_hub.h"
+#include "json_lite.h"
+#include "async_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string capturePath;
+    std::string posesPath;
+    bool realtime = false;
+    int repeat = 1;
+    bool filter = false;
+    PredictionSettings prediction;
+    std::string hubConfig;
+    std::string hubOrientation;
+};
+
+// Стадии конвейера, время каждой - на пробуждение
+enum Stage { kDecode, kHub, kDevice, kSubmit, kStageCount };
+const char* const kStageNames[kStageCount] = { "decode + batch", "native hub", "filter + motion", "prediction" };
+
+struct ReplayDevice {
+    PoseFilter filter;
+    MotionModel motion;
+    vr::DriverPose_t pose;
+};
+
+struct PassResult {
+    uint64_t wakeups = 0;
+    uint64_t datagrams = 0;
+    uint64_t poses = 0;
+    uint64_t rejected = 0;
+    uint64_t lateWakeups = 0;   // --realtime: пробуждение позже записанного
+    uint64_t hash = 1469598103934665603ull;   // FNV-1a по всем позам
+    double wallSec = 0.0;
+    std::vector<double> stageUs[kStageCount];
+};
+
+void PrintLine(const char* line) {
+    fprintf(stderr, "%s\n", line);
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0);
+    data.resize((size_t)size);
+    return size == 0 || (bool)file.read(reinterpret_cast<char*>(data.data()), size);
+}
+
+void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+double Micros(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+double Percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = (size_t)(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--realtime") {
+            options.realtime = true;
+        } else if (arg == "--filter") {
+            options.filter = true;
+        } else if (arg == "--extrapolate") {
+            options.prediction.extrapolateInDriver = true;
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--poses" && hasValue) {
+            options.posesPath = argv[++i];
+        } else if (arg == "--prediction-ms" && hasValue) {
+            options.prediction.predictionSec = (float)(atof(argv[++i]) / 1000.0);
+        } else if (arg == "--native-hub-config" && hasValue) {
+            options.hubConfig = argv[++i];
+        } else if (arg == "--native-hub-orientation" && hasValue) {
+            options.hubOrientation = argv[++i];
+        } else if (arg[0] != '-' && options.capturePath.empty()) {
+            options.capturePath = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.capturePath.empty();
+}
+
+// Позиция сэмпла устройства - как DevicePosePipeline::Update
+void UpdateDevice(ReplayDevice& device, const CoalescedSample& sample, Clock::time_point receivedAt) {
+    const ControllerData& data = sample.latest;
+    vr::DriverPose_t& pose = device.pose;
+    pose.qRotation.w = data.quat_w;
+    pose.qRotation.x = data.quat_x;
+    pose.qRotation.y = data.quat_y;
+    pose.qRotation.z = data.quat_z;
+    pose.vecPosition[0] = data.accel_x;
+    pose.vecPosition[1] = data.accel_y;
+    pose.vecPosition[2] = data.accel_z;
+    pose.vecAngularVelocity[0] = data.gyro_x;
+    pose.vecAngularVelocity[1] = data.gyro_y;
+    pose.vecAngularVelocity[2] = data.gyro_z;
+
+    if (sample.restarted) {
+        device.motion.Reset();
+        device.filter.Reset();
+    }
+    device.filter.Apply(pose.vecPosition, pose.qRotation, device.motion.SampleInterval(data.packet_number));
+
+    Clock::time_point sampleTime = sample.capturedAt != Clock::time_point() ? sample.capturedAt : receivedAt;
+    device.motion.AddSample(data.packet_number, sampleTime, pose.vecPosition);
+    device.motion.FillPose(pose);
+    if (sample.hasVelocity) {
+        for (int i = 0; i < 3; i++) {
+            pose.vecVelocity[i] = sample.velocity[i];
+            pose.vecAcceleration[i] = 0.0;
+        }
+    }
+    pose.poseIsValid = true;
+    pose.result = vr::TrackingResult_Running_OK;
+    pose.deviceIsConnected = true;
+}
+
+// Один проход по записи. poses - nullptr, кроме первого прохода с --poses
+bool RunPass(const Options& options, CaptureReader& reader, FILE* poses, PassResult& result) {
+    const CaptureFileHeader& header = reader.Header();
+
+    // Конвейер заново на каждый проход: состояние фильтров не переносится
+    NetworkClient client;
+    DecodeOptions decodeOptions;
+    decodeOptions.gyroMouseDeviceId = header.gyroMouseDeviceId;
+    client.SetDecodeOptions(decodeOptions);
+    bool hasHubPort = false;
+    for (size_t i = 0; i < header.portCount; i++) {
+        client.AddPort(header.ports[i], (PortRole)header.roles[i]);
+        hasHubPort = hasHubPort || (PortRole)header.roles[i] == PortRole::NativeHub;
+    }
+
+    NativeHub hub;
+    if (hasHubPort || !options.hubOrientation.empty()) {
+        NativeHubSettings settings;
+        settings.enabled = true;
+        settings.orientation = options.hubOrientation;
+        HubCalibrationTable calibration;
+        std::string error;
+        if (!options.hubConfig.empty()) {
+            std::string text;
+            if (!ReadTextFile(options.hubConfig, text) || !ParseHubConfig(text, calibration, error)) {
+                fprintf(stderr, "native hub config %s rejected (%s), markers uncalibrated\n",
+                        options.hubConfig.c_str(), error.empty() ? "cannot read file" : error.c_str());
+                calibration = HubCalibrationTable();
+            }
+        }
+        if (!hub.Configure(settings, calibration, error)) {
+            fprintf(stderr, "invalid --native-hub-orientation (%s)\n", error.c_str());
+            return false;
+        }
+    }
+
+    std::vector<ReplayDevice> devices(kMaxTrackedDevices);
+    for (ReplayDevice& device : devices) {
+        memset(&device.pose, 0, sizeof(device.pose));
+        device.pose.qWorldFromDriverRotation = { 1, 0, 0, 0 };
+        device.pose.qDriverFromHeadRotation = { 1, 0, 0, 0 };
+        device.pose.qRotation = { 1, 0, 0, 0 };
+        FilterSettings filter;
+        filter.enabled = options.filter;
+        device.filter.Configure(filter);
+    }
+
+    PacketBatch batch;
+    PacketBatch hubBatch;
+    std::array<CoalescedSample, kMaxTrackedDevices> hubSamples;
+    std::vector<const CoalescedSample*> dispatch;
+    dispatch.reserve(2 * kMaxTrackedDevices);
+    std::vector<vr::DriverPose_t> submitted(2 * kMaxTrackedDevices);
+
+    reader.Rewind();
+    const CaptureRecordHeader* record = nullptr;
+    const uint8_t* payload = nullptr;
+    bool hasRecord = reader.Next(record, payload);
+    int64_t firstArrivalUs = hasRecord ? record->arrivalUs : 0;
+    Clock::time_point wallStart = Clock::now();
+
+    while (hasRecord) {
+        uint32_t wakeup = record->wakeup;
+        Clock::time_point wakeTime = FromLocalMicros(record->arrivalUs);
+        if (options.realtime) {
+            Clock::time_point due = wallStart + std::chrono::microseconds(record->arrivalUs - firstArrivalUs);
+            if (Clock::now() > due + std::chrono::milliseconds(1)) {
+                result.lateWakeups++;
+            }
+            std::this_thread::sleep_until(due);
+        }
+
+        // Драйвер забывает замолчавших отправителей по таймауту ожидания,
+        // до того как разберет следующую пачку
+        client.ExpireClockSources(wakeTime);
+
+        // Записи одного ReceiveBatch - одна пачка; запросы часов отправлены
+        // после нее
+        Clock::time_point stageStart = Clock::now();
+        batch.Clear();
+        hubBatch.Clear();
+        Clock::time_point receivedAt = wakeTime;
+        while (hasRecord && record->wakeup == wakeup) {
+            Clock::time_point arrival = FromLocalMicros(record->arrivalUs);
+            switch ((CaptureSource)record->source) {
+            case CaptureSource::Datagram: {
+                bool toHub = record->socketIndex < header.portCount && hub.Enabled() &&
+                             (PortRole)header.roles[record->socketIndex] == PortRole::NativeHub;
+                client.ReplayDatagram(record->socketIndex, payload, record->size, record->address,
+                                      record->port, arrival, toHub ? hubBatch : batch);
+                result.datagrams++;
+                receivedAt = arrival;
+                break;
+            }
+            case CaptureSource::SharedRing: {
+                ControllerData data;
+                if (record->size != sizeof(data)) {
+                    batch.AddRejected();
+                    break;
+                }
+                memcpy(&data, payload, sizeof(data));
+                Clock::time_point capturedAt;
+                if (record->captureAgeUs >= 0) {
+                    capturedAt = arrival - std::chrono::microseconds(record->captureAgeUs);
+                }
+                client.ReplaySharedRingRecord(data, record->flags, capturedAt, arrival, batch);
+                result.datagrams++;
+                receivedAt = arrival;
+                break;
+            }
+            case CaptureSource::ClockRequest:
+                client.ReplayClockRequest(record->address, record->port, arrival);
+                break;
+            }
+            hasRecord = reader.Next(record, payload);
+        }
+        Clock::time_point decodeEnd = Clock::now();
+
+        dispatch.clear();
+        for (size_t i = 0; i < batch.DeviceCount(); i++) {
+            const CoalescedSample& sample = batch.Device(i);
+            if (hub.IsOrientationSource(sample.latest.controller_id)) {
+                hub.AddOrientation(sample, wakeTime);
+                continue;
+            }
+            dispatch.push_back(&sample);
+        }
+        if (hub.Enabled()) {
+            for (size_t i = 0; i < hubBatch.DeviceCount(); i++) {
+                hub.AddMarker(hubBatch.Device(i), wakeTime);
+            }
+            size_t fused = hub.Fuse(wakeTime, hubSamples);
+            for (size_t i = 0; i < fused; i++) {
+                dispatch.push_back(&hubSamples[i]);
+            }
+        }
+        Clock::time_point hubEnd = Clock::now();
+
+        for (const CoalescedSample* sample : dispatch) {
+            UpdateDevice(devices[sample->latest.controller_id], *sample, receivedAt);
+        }
+        Clock::time_point deviceEnd = Clock::now();
+
+        // Поза к отправке - как немедленная отправка устройства
+        for (size_t i = 0; i < dispatch.size(); i++) {
+            const CoalescedSample* sample = dispatch[i];
+            Clock::time_point sampleTime = sample->capturedAt != Clock::time_point() ? sample->capturedAt : receivedAt;
+            submitted[i] = devices[sample->latest.controller_id].pose;
+            ApplyPrediction(submitted[i], std::chrono::duration<double>(receivedAt - sampleTime).count(),
+                            options.prediction);
+        }
+        Clock::time_point submitEnd = Clock::now();
+
+        // Вывод - вне замеров
+        for (size_t i = 0; i < dispatch.size(); i++) {
+            const CoalescedSample* sample = dispatch[i];
+            const vr::DriverPose_t& pose = submitted[i];
+            uint8_t id = sample->latest.controller_id;
+            HashBytes(result.hash, &id, sizeof(id));
+            HashBytes(result.hash, pose.vecPosition, sizeof(pose.vecPosition));
+            HashBytes(result.hash, &pose.qRotation, sizeof(pose.qRotation));
+            HashBytes(result.hash, pose.vecVelocity, sizeof(pose.vecVelocity));
+            HashBytes(result.hash, &pose.poseTimeOffset, sizeof(pose.poseTimeOffset));
+            if (poses) {
+                Clock::time_point sampleTime = sample->capturedAt != Clock::time_point() ? sample->capturedAt : receivedAt;
+                fprintf(poses, "%u %u %lld %a %a %a %a %a %a %a %a %a %a %a\n", wakeup, (unsigned)id,
+                        (long long)(LocalMicros(sampleTime) - header.startUs),
+                        pose.vecPosition[0], pose.vecPosition[1], pose.vecPosition[2],
+                        pose.qRotation.w, pose.qRotation.x, pose.qRotation.y, pose.qRotation.z,
+                        pose.vecVelocity[0], pose.vecVelocity[1], pose.vecVelocity[2], pose.poseTimeOffset);
+            }
+            result.poses++;
+        }
+
+        result.wakeups++;
+        result.rejected += batch.RejectedCount() + hubBatch.RejectedCount() +
+                           batch.ChecksumFailureCount() + hubBatch.ChecksumFailureCount();
+        result.stageUs[kDecode].push_back(Micros(stageStart, decodeEnd));
+        result.stageUs[kHub].push_back(Micros(decodeEnd, hubEnd));
+        result.stageUs[kDevice].push_back(Micros(hubEnd, deviceEnd));
+        result.stageUs[kSubmit].push_back(Micros(deviceEnd, submitEnd));
+    }
+    result.wallSec = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr,
+            "usage: cvdriver_replay capture.cvcap [--realtime] [--repeat N] [--poses poses.txt]\n"
+            "                       [--filter] [--extrapolate] [--prediction-ms X]\n"
+            "                       [--native-hub-config vr_config.json] [--native-hub-orientation 0=3]\n");
+        return 2;
+    }
+    // Сообщения драйвера (отправители, часы) - в stderr, без SteamVR
+    AsyncLog::Instance().SetSink(&PrintLine);
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(options.capturePath, data)) {
+        fprintf(stderr, "cannot read %s\n", options.capturePath.c_str());
+        return 1;
+    }
+    CaptureReader reader;
+    std::string error;
+    if (!reader.Open(data.data(), data.size(), error)) {
+        fprintf(stderr, "%s: %s\n", options.capturePath.c_str(), error.c_str());
+        return 1;
+    }
+
+    FILE* poses = nullptr;
+    if (!options.posesPath.empty()) {
+        poses = fopen(options.posesPath.c_str(), "w");
+        if (!poses) {
+            fprintf(stderr, "cannot write %s\n", options.posesPath.c_str());
+            return 1;
+        }
+    }
+
+    PassResult total;
+    uint64_t hash = 0;
+    for (int pass = 0; pass < options.repeat; pass++) {
+        PassResult result;
+        if (!RunPass(options, reader, pass == 0 ? poses : nullptr, result)) {
+            return 1;
+        }
+        if (pass == 0) {
+            hash = result.hash;
+            total = result;
+        } else {
+            if (result.hash != hash) {
+                fprintf(stderr, "pass %d: pose output differs from pass 1 (nondeterministic pipeline)\n", pass + 1);
+            }
+            total.wallSec += result.wallSec;
+            total.lateWakeups += result.lateWakeups;
+            for (int s = 0; s < kStageCount; s++) {
+                total.stageUs[s].insert(total.stageUs[s].end(), result.stageUs[s].begin(), result.stageUs[s].end());
+            }
+        }
+    }
+    if (poses) {
+        fclose(poses);
+    }
+
+    const CaptureFileHeader& header = reader.Header();
+    printf("%s: %u ports, %llu wakeups, %llu datagrams/records, %llu rejected, %llu poses\n",
+           options.capturePath.c_str(), (unsigned)header.portCount, (unsigned long long)total.wakeups,
+           (unsigned long long)total.datagrams, (unsigned long long)total.rejected,
+           (unsigned long long)total.poses);
+    printf("%s x%d, %.3f s wall%s\n\n", options.realtime ? "real time" : "as fast as possible",
+           options.repeat, total.wallSec,
+           options.realtime ? (", " + std::to_string(total.lateWakeups) + " wakeups late > 1 ms").c_str() : "");
+
+    printf("%-18s %10s %10s %10s %10s %12s\n", "stage (per wakeup)", "mean us", "p50 us", "p99 us", "max us", "total ms");
+    for (int s = 0; s < kStageCount; s++) {
+        std::vector<double>& values = total.stageUs[s];
+        double sum = 0.0;
+        double max = 0.0;
+        for (double value : values) {
+            sum += value;
+            max = std::max(max, value);
+        }
+        double mean = values.empty() ? 0.0 : sum / values.size();
+        double p50 = Percentile(values, 0.50);
+        double p99 = Percentile(values, 0.99);
+        printf("%-18s %10.3f %10.3f %10.3f %10.3f %12.3f\n", kStageNames[s], mean, p50, p99, max, sum / 1000.0);
+    }
+    printf("\npose output hash %016llx\n", (unsigned long long)hash);
+    return 0;
+}
@@ -26,6 +26,7 @@ set PROJECT_PATH=%~dp0
 echo [INFO] Creating folder structure...
 mkdir "%STEAMVR_PATH%\bin\win64" 2>nul
 mkdir "%STEAMVR_PATH%\resources\input" 2>nul
+mkdir "%STEAMVR_PATH%\resources\settings" 2>nul
 
 echo [INFO] Copying driver DLL...
 copy /Y "%PROJECT_PATH%build\Release\driver_cvdriver.dll" "%STEAMVR_PATH%\bin\win64\"
@@ -59,6 +60,14 @@ if %errorLevel% NEQ 0 (
     exit /b 1
 )
 
+echo [INFO] Copying default settings...
+copy /Y "%PROJECT_PATH%resources\settings\default.vrsettings" "%STEAMVR_PATH%\resources\settings\"
+if %errorLevel% NEQ 0 (
+    echo [ERROR] Failed to copy default.vrsettings
+    pause
+    exit /b 1
+)
+
 echo.
 echo ========================================
 echo [SUCCESS] Installation completed!
@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+"""
+Protocol v2 encoder/decoder for the simulators (same layout as src/packet_format.h).
+
+Several devices per datagram, compressed fields, all little-endian:
+  header  [0] magic 0xC5, [1] version 2, [2] flags, [3] record count,
+          [4:8] base packet_number (uint32)
+  record  [0] controller_id, [1] record flags,
+          packet_number - base (uint8) or full uint32 (REC_SEQUENCE32),
+          quaternion smallest-three (48 bits: index << 45 | 3 x 15 bits,
+          each round(v / sqrt(0.5) * 16383) + 16383),
+          position 3 x int16 / 2048 m             (REC_POSITION),
+          angular velocity 3 x int16 / 1024 rad/s (REC_ANGULAR_VELOCITY),
+          buttons uint16 + trigger uint8          (REC_INPUT)
+          capture time, low 32 bits of the sender's monotonic
+          microseconds (uint32)                   (REC_TIMESTAMP)
+  trailer CRC-32C of all previous bytes (uint32)
+Omitted fields are zero, so every record still stands on its own.
+
+Clock sync: the driver sends a 20-byte request (FLAG_TIME_REQUEST, count 0,
+[4:8] sequence, [8:16] t1) to every sender that stamps its records. The
+sender answers with 36 bytes (FLAG_TIME_REPLY, same sequence and t1, then
+t2 = request received and t3 = reply sent, both monotonic_us()). Without
+replies the driver falls back to arrival time.
+
+Rate hints: with rate_hints on, the driver sends each sender a 24-byte
+message once a second (FLAG_RATE_HINT, count 0, [4:8] sequence):
+[8:10] requested send rate in Hz, [10:12] SteamVR display frequency in
+1/100 Hz (0 if unknown), [12:14] loss over the last second in 1/10000,
+[14:16] arrival jitter in 1/100 ms, [16] RATE_HINT_* flags, zero padding
+up to the CRC at [20:24]. Senders may ignore them.
+
+Record tuples: (controller_id, packet_number, quat[w,x,y,z], position[x,y,z],
+                gyro[x,y,z], buttons, trigger[, capture_us])
+capture_us is monotonic_us() when the sample was taken; None or missing
+sends no timestamp. decode_datagram always returns 8-tuples.
+"""
+import math
+import struct
+import time
+
+MAGIC = 0xC5
+VERSION = 2
+HEADER_SIZE = 8
+MIN_RECORD_SIZE = 9
+FLAG_GYROMOUSE = 0x01          # ids relative to the driver's gyromouse_device_id
+FLAG_RATE_HINT = 0x20
+FLAG_TIME_REQUEST = 0x40
+FLAG_TIME_REPLY = 0x80
+TIME_REQUEST_SIZE = 20
+RATE_HINT_SIZE = 24
+
+RATE_HINT_STANDBY = 0x01       # SteamVR is in standby
+RATE_HINT_IDLE = 0x02          # all of the sender's devices are still
+
+REC_POSITION = 0x01
+REC_ANGULAR_VELOCITY = 0x02
+REC_INPUT = 0x04
+REC_SEQUENCE32 = 0x08
+REC_TIMESTAMP = 0x10
+
+POSITION_SCALE = 2048.0
+ANGULAR_SCALE = 1024.0
+_QUAT_MAX = 0.70710678
+_QUAT_MASK = (1 << 15) - 1
+_QUAT_HALF_RANGE = 16383
+
+
+def _make_crc32c_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+        table.append(crc)
+    return table
+
+
+_CRC32C_TABLE = _make_crc32c_table()
+
+
+def crc32c(data) -> int:
+    """CRC-32C (Castagnoli), same as crc32c.h in the driver."""
+    crc = 0xFFFFFFFF
+    for b in data:
+        crc = (crc >> 8) ^ _CRC32C_TABLE[(crc ^ b) & 0xFF]
+    return crc ^ 0xFFFFFFFF
+
+
+def monotonic_us() -> int:
+    """Sender clock for capture timestamps and clock-sync replies."""
+    return time.monotonic_ns() // 1000
+
+
+def _fixed3(values, scale):
+    return [max(-32767, min(32767, int(round(v * scale)))) for v in values]
+
+
+def pack_quaternion(quat):
+    """Smallest-three: drop the largest component, it is restored from the norm."""
+    norm = math.sqrt(sum(c * c for c in quat))
+    q = [c / norm for c in quat] if norm > 1e-6 else [1.0, 0.0, 0.0, 0.0]
+    largest = max(range(4), key=lambda i: abs(q[i]))
+    sign = -1.0 if q[largest] < 0.0 else 1.0
+    packed = largest
+    for i in range(4):
+        if i == largest:
+            continue
+        v = max(-_QUAT_MAX, min(_QUAT_MAX, sign * q[i]))
+        packed = (packed << 15) | (int(round(v / _QUAT_MAX * _QUAT_HALF_RANGE)) + _QUAT_HALF_RANGE)
+    return packed.to_bytes(6, 'little')
+
+
+def unpack_quaternion(data):
+    packed = int.from_bytes(data[:6], 'little')
+    largest = (packed >> 45) & 0x03
+    q = [0.0] * 4
+    shift = 30
+    for i in range(4):
+        if i == largest:
+            continue
+        q[i] = (((packed >> shift) & _QUAT_MASK) - _QUAT_HALF_RANGE) / _QUAT_HALF_RANGE * _QUAT_MAX
+        shift -= 15
+    q[largest] = math.sqrt(max(0.0, 1.0 - sum(c * c for c in q)))
+    return q
+
+
+def encode_datagram(records, flags=0):
+    """Pack record tuples into one v2 datagram."""
+    records = list(records)
+    base = min(r[1] & 0xFFFFFFFF for r in records)
+    out = bytearray(struct.pack('<BBBBI', MAGIC, VERSION, flags, len(records), base))
+    for record in records:
+        controller_id, packet_number, quat, position, gyro, buttons, trigger = record[:7]
+        capture_us = record[7] if len(record) > 7 else None
+        number = packet_number & 0xFFFFFFFF
+        delta = number - base
+        rec_flags = 0
+        if delta > 0xFF:
+            rec_flags |= REC_SEQUENCE32
+        if any(position):
+            rec_flags |= REC_POSITION
+        if any(gyro):
+            rec_flags |= REC_ANGULAR_VELOCITY
+        if buttons or trigger:
+            rec_flags |= REC_INPUT
+        if capture_us is not None:
+            rec_flags |= REC_TIMESTAMP
+
+        out += bytes((controller_id & 0xFF, rec_flags))
+        out += struct.pack('<I', number) if rec_flags & REC_SEQUENCE32 else bytes((delta,))
+        out += pack_quaternion(quat)
+        if rec_flags & REC_POSITION:
+            out += struct.pack('<3h', *_fixed3(position, POSITION_SCALE))
+        if rec_flags & REC_ANGULAR_VELOCITY:
+            out += struct.pack('<3h', *_fixed3(gyro, ANGULAR_SCALE))
+        if rec_flags & REC_INPUT:
+            out += struct.pack('<HB', buttons & 0xFFFF, trigger & 0xFF)
+        if rec_flags & REC_TIMESTAMP:
+            out += struct.pack('<I', capture_us & 0xFFFFFFFF)
+    out += struct.pack('<I', crc32c(out))
+    return bytes(out)
+
+
+def decode_datagram(data):
+    """Unpack a v2 datagram into record tuples; None if it is malformed."""
+    if len(data) < HEADER_SIZE + 4 or data[0] != MAGIC or data[1] != VERSION:
+        return None
+    if crc32c(data[:-4]) != struct.unpack_from('<I', data, len(data) - 4)[0]:
+        return None
+    _, _, _, count, base = struct.unpack_from('<BBBBI', data, 0)
+    end = len(data) - 4
+    offset = HEADER_SIZE
+    records = []
+    for _ in range(count):
+        if end - offset < MIN_RECORD_SIZE:
+            return None
+        controller_id, rec_flags = data[offset], data[offset + 1]
+        offset += 2
+        if rec_flags & REC_SEQUENCE32:
+            packet_number = struct.unpack_from('<I', data, offset)[0]
+            offset += 4
+        else:
+            packet_number = (base + data[offset]) & 0xFFFFFFFF
+            offset += 1
+        quat = unpack_quaternion(data[offset:offset + 6])
+        offset += 6
+        position, gyro, buttons, trigger, capture_us = [0.0] * 3, [0.0] * 3, 0, 0, None
+        if rec_flags & REC_POSITION:
+            position = [v / POSITION_SCALE for v in struct.unpack_from('<3h', data, offset)]
+            offset += 6
+        if rec_flags & REC_ANGULAR_VELOCITY:
+            gyro = [v / ANGULAR_SCALE for v in struct.unpack_from('<3h', data, offset)]
+            offset += 6
+        if rec_flags & REC_INPUT:
+            buttons, trigger = struct.unpack_from('<HB', data, offset)
+            offset += 3
+        if rec_flags & REC_TIMESTAMP:
+            if end - offset < 4:
+                return None
+            capture_us = struct.unpack_from('<I', data, offset)[0]
+            offset += 4
+        if offset > end:
+            return None
+        records.append((controller_id, packet_number, quat, position, gyro, buttons, trigger, capture_us))
+    return records if offset == end else None
+
+
+def build_time_reply(request, receive_us):
+    """Reply to a driver clock-sync request; None if request is not one."""
+    if (len(request) != TIME_REQUEST_SIZE or request[0] != MAGIC or request[1] != VERSION
+            or request[2] != FLAG_TIME_REQUEST or request[3] != 0):
+        return None
+    if crc32c(request[:-4]) != struct.unpack_from('<I', request, len(request) - 4)[0]:
+        return None
+    sequence, request_us = struct.unpack_from('<IQ', request, 4)
+    out = bytearray(struct.pack('<BBBBIQQQ', MAGIC, VERSION, FLAG_TIME_REPLY, 0,
+                                sequence, request_us, receive_us, monotonic_us()))
+    out += struct.pack('<I', crc32c(out))
+    return bytes(out)
+
+
+def parse_rate_hint(data):
+    """
+    Decode a driver rate hint into a dict (requested_hz, display_hz, loss,
+    jitter_ms, standby, idle); None if data is not one.
+    """
+    if (len(data) != RATE_HINT_SIZE or data[0] != MAGIC or data[1] != VERSION
+            or data[2] != FLAG_RATE_HINT or data[3] != 0):
+        return None
+    if crc32c(data[:-4]) != struct.unpack_from('<I', data, len(data) - 4)[0]:
+        return None
+    sequence, requested, display, loss, jitter, flags = struct.unpack_from('<IHHHHB', data, 4)
+    return {
+        'sequence': sequence,
+        'requested_hz': float(requested),
+        'display_hz': display / 100.0,
+        'loss': loss / 10000.0,
+        'jitter_ms': jitter / 100.0,
+        'standby': bool(flags & RATE_HINT_STANDBY),
+        'idle': bool(flags & RATE_HINT_IDLE),
+    }
+
+
+def answer_time_requests(sock, on_rate_hint=None):
+    """
+    Answer the clock-sync requests waiting on sock (the socket the datagrams
+    are sent from). Never blocks; call it once per send loop iteration.
+    Rate hints read along the way go to on_rate_hint(hint) if it is given.
+    Returns the number of replies sent.
+    """
+    answered = 0
+    sock.setblocking(False)
+    try:
+        while True:
+            try:
+                request, addr = sock.recvfrom(64)
+            except (BlockingIOError, InterruptedError):
+                break
+            except ConnectionResetError:
+                continue  # Windows: ICMP "port unreachable" from an earlier sendto
+            except OSError:
+                break     # not bound yet: nothing has been sent
+            reply = build_time_reply(request, monotonic_us())
+            if reply:
+                sock.sendto(reply, addr)
+                answered += 1
+                continue
+            hint = parse_rate_hint(request) if on_rate_hint else None
+            if hint:
+                on_rate_hint(hint)
+    finally:
+        sock.setblocking(True)
+    return answered
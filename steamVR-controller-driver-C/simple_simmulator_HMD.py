@@ -11,10 +11,14 @@ import struct
 import time
 import math
 
+import protocol_v2
+
 class CompleteVRSimulator:
-    def __init__(self, host='127.0.0.1', port=5555):
+    def __init__(self, host='127.0.0.1', port=5555, use_v2=False):
         self.host = host
         self.port = port
+        self.use_v2 = use_v2  # all three devices in one protocol v2 datagram
+        self.send_interval = 0.016  # seconds; rate hints from the driver change it
         self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.packet_numbers = {0: 0, 1: 0, 2: 0}  # Separate packet numbers for each device
     
@@ -181,6 +185,34 @@ class CompleteVRSimulator:
         
         return [w, x, y, z]
     
+    def send_legacy_packets(self, current_time):
+        """Send each device as its own 49-byte packet"""
+        # ===== SEND HMD DATA =====
+        hmd_quat, hmd_pos, hmd_gyro = self.get_hmd_data(current_time)
+        packet = self.pack_device_data(2, hmd_quat, hmd_pos, hmd_gyro, buttons=0, trigger=0)
+        self.sock.sendto(packet, (self.host, self.port))
+        
+        # ===== SEND LEFT CONTROLLER =====
+        left_quat, left_pos, left_gyro, left_btn, left_trg = self.get_controller_data(0, current_time)
+        packet = self.pack_device_data(0, left_quat, left_pos, left_gyro, left_btn, left_trg)
+        self.sock.sendto(packet, (self.host, self.port))
+        
+        # ===== SEND RIGHT CONTROLLER =====
+        right_quat, right_pos, right_gyro, right_btn, right_trg = self.get_controller_data(1, current_time)
+        packet = self.pack_device_data(1, right_quat, right_pos, right_gyro, right_btn, right_trg)
+        self.sock.sendto(packet, (self.host, self.port))
+        
+        return hmd_quat, hmd_pos, left_pos, left_btn, left_trg, right_pos, right_btn, right_trg
+    
+    def on_rate_hint(self, hint):
+        """Follow the driver's requested rate (rate_hints on, --v2 only)."""
+        rate = max(1.0, min(hint['requested_hz'], 250.0))
+        if abs(1.0 / rate - self.send_interval) > 0.001:
+            print(f"Driver requests {rate:.0f} Hz (display {hint['display_hz']:.1f} Hz, "
+                  f"loss {hint['loss'] * 100:.1f}%, jitter {hint['jitter_ms']:.2f} ms"
+                  f"{', standby' if hint['standby'] else ', idle' if hint['idle'] else ''})")
+        self.send_interval = 1.0 / rate
+
     def run(self):
         print("=" * 80)
         print(" " * 20 + "Complete VR System Simulator")
@@ -217,23 +249,26 @@ class CompleteVRSimulator:
             while True:
                 current_time = time.time() - start_time
                 
-                # ===== SEND HMD DATA =====
-                hmd_quat, hmd_pos, hmd_gyro = self.get_hmd_data(current_time)
-                packet = self.pack_device_data(2, hmd_quat, hmd_pos, hmd_gyro, buttons=0, trigger=0)
-                self.sock.sendto(packet, (self.host, self.port))
-                packet_count += 1
-                
-                # ===== SEND LEFT CONTROLLER =====
-                left_quat, left_pos, left_gyro, left_btn, left_trg = self.get_controller_data(0, current_time)
-                packet = self.pack_device_data(0, left_quat, left_pos, left_gyro, left_btn, left_trg)
-                self.sock.sendto(packet, (self.host, self.port))
-                packet_count += 1
-                
-                # ===== SEND RIGHT CONTROLLER =====
-                right_quat, right_pos, right_gyro, right_btn, right_trg = self.get_controller_data(1, current_time)
-                packet = self.pack_device_data(1, right_quat, right_pos, right_gyro, right_btn, right_trg)
-                self.sock.sendto(packet, (self.host, self.port))
-                packet_count += 1
+                if self.use_v2:
+                    # ===== ALL DEVICES IN ONE DATAGRAM =====
+                    hmd_quat, hmd_pos, hmd_gyro = self.get_hmd_data(current_time)
+                    left_quat, left_pos, left_gyro, left_btn, left_trg = self.get_controller_data(0, current_time)
+                    right_quat, right_pos, right_gyro, right_btn, right_trg = self.get_controller_data(1, current_time)
+                    captured = protocol_v2.monotonic_us()
+                    records = [
+                        (2, self.packet_numbers[2], hmd_quat, hmd_pos, hmd_gyro, 0, 0, captured),
+                        (0, self.packet_numbers[0], left_quat, left_pos, left_gyro, left_btn, left_trg, captured),
+                        (1, self.packet_numbers[1], right_quat, right_pos, right_gyro, right_btn, right_trg, captured),
+                    ]
+                    for device_id in [0, 1, 2]:
+                        self.packet_numbers[device_id] += 1
+                    self.sock.sendto(protocol_v2.encode_datagram(records), (self.host, self.port))
+                    protocol_v2.answer_time_requests(self.sock, self.on_rate_hint)
+                    packet_count += 1
+                else:
+                    hmd_quat, hmd_pos, left_pos, left_btn, left_trg, right_pos, right_btn, right_trg = \
+                        self.send_legacy_packets(current_time)
+                    packet_count += 3
                 
                 # Print status every 2 seconds
                 if current_time - last_print >= 2.0:
@@ -247,7 +282,7 @@ class CompleteVRSimulator:
                     print()
                     last_print = current_time
                 
-                time.sleep(0.016)  # ~60 FPS (16.6ms per frame)
+                time.sleep(self.send_interval)  # ~60 FPS (16.6ms per frame) unless the driver asks otherwise
                 
         except KeyboardInterrupt:
             print("\n" + "=" * 80)
@@ -264,11 +299,15 @@ if __name__ == "__main__":
     host = "127.0.0.1"
     port = 5555
     
-    if len(sys.argv) > 1:
-        host = sys.argv[1]
-    if len(sys.argv) > 2:
-        port = int(sys.argv[2])
+    # --v2: send the compact multi-device protocol instead of 49-byte packets
+    use_v2 = '--v2' in sys.argv[1:]
+    args = [a for a in sys.argv[1:] if a != '--v2']
+    
+    if len(args) > 0:
+        host = args[0]
+    if len(args) > 1:
+        port = int(args[1])
     
     print()
-    simulator = CompleteVRSimulator(host, port)
+    simulator = CompleteVRSimulator(host, port, use_v2)
     simulator.run()
\ No newline at end of file
@@ -9,12 +9,16 @@ import struct
 import time
 import math
 
+import protocol_v2
+
 class SimpleControllerSimulator:
-    def __init__(self, host='127.0.0.1', port=5555):
+    def __init__(self, host='127.0.0.1', port=5555, use_v2=False):
         self.host = host
         self.port = port
+        self.use_v2 = use_v2  # both controllers in one protocol v2 datagram
         self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.packet_numbers = {0: 0, 1: 0}  # Separate packet numbers for each controller
+        self.send_interval = 0.016  # seconds; rate hints from the driver change it
     
     def calculate_checksum(self, data):
         return sum(data) & 0xFF
@@ -104,11 +108,20 @@ class SimpleControllerSimulator:
         
         return quat, position, gyro, buttons, trigger
     
+    def on_rate_hint(self, hint):
+        """Follow the driver's requested rate (rate_hints on, --v2 only)."""
+        rate = max(1.0, min(hint['requested_hz'], 250.0))
+        if abs(1.0 / rate - self.send_interval) > 0.001:
+            print(f"Driver requests {rate:.0f} Hz (display {hint['display_hz']:.1f} Hz, "
+                  f"loss {hint['loss'] * 100:.1f}%, jitter {hint['jitter_ms']:.2f} ms"
+                  f"{', standby' if hint['standby'] else ', idle' if hint['idle'] else ''})")
+        self.send_interval = 1.0 / rate
+
     def run(self):
         print("=" * 60)
         print("Simple Controller Simulator - Position Based")
         print("=" * 60)
-        print(f"Sending to: {self.host}:{self.port}")
+        print(f"Sending to: {self.host}:{self.port} ({'protocol v2' if self.use_v2 else '49-byte packets'})")
         print()
         print("Simulation:")
         print("  - 2 controllers orbiting in a circle")
@@ -128,10 +141,21 @@ class SimpleControllerSimulator:
                 current_time = time.time() - start_time
                 
                 # Send data for both controllers
+                records = []
                 for controller_id in [0, 1]:  # Left (0) and Right (1) controllers
                     quat, position, gyro, buttons, trigger = self.get_simulated_data(controller_id, current_time)
+                    if self.use_v2:
+                        # Capture time lets the driver measure end-to-end latency
+                        records.append((controller_id, self.packet_numbers[controller_id],
+                                        quat, position, gyro, buttons, trigger,
+                                        protocol_v2.monotonic_us()))
+                        self.packet_numbers[controller_id] += 1
+                        continue
                     packet = self.pack_controller_data(controller_id, quat, position, gyro, buttons, trigger)
                     self.sock.sendto(packet, (self.host, self.port))
+                if records:
+                    self.sock.sendto(protocol_v2.encode_datagram(records), (self.host, self.port))
+                    protocol_v2.answer_time_requests(self.sock, self.on_rate_hint)
                 
                 # Print status every second
                 if current_time - last_print >= 1.0:
@@ -147,7 +171,7 @@ class SimpleControllerSimulator:
                     print()
                     last_print = current_time
                 
-                time.sleep(0.016)  # ~60 FPS
+                time.sleep(self.send_interval)  # ~60 FPS unless the driver asks otherwise
                 
         except KeyboardInterrupt:
             print("\n" + "=" * 60)
@@ -157,5 +181,8 @@ class SimpleControllerSimulator:
             self.sock.close()
 
 if __name__ == "__main__":
-    simulator = SimpleControllerSimulator()
+    import sys
+    
+    # --v2: send the compact multi-device protocol instead of 49-byte packets
+    simulator = SimpleControllerSimulator(use_v2='--v2' in sys.argv[1:])
     simulator.run()
\ No newline at end of file
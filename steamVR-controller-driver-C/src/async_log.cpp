@@ -0,0 +1,287 @@
+// src/async_log.cpp
+#include "async_log.h"
+#include <openvr_driver.h>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+struct CategoryInfo {
+    const char* name;
+    uint32_t perSecond;   // лимит записей в секунду
+};
+
+// Обычный поток сообщений укладывается с запасом; лимит срабатывает,
+// только если горячий путь начнет писать в цикле
+const CategoryInfo kCategories[static_cast<size_t>(LogCategory::Count)] = {
+    { "packets",    2 },
+    { "io loop",    8 },     // цикл, поток, транспорт
+    { "clock sync", 16 },    // строка на отправителя, до kMaxClockSources
+    { "submit",     64 },    // два пути на устройство
+    { "link",       32 },    // строка на устройство
+};
+
+// Как часто фоновый поток просыпается без Stop
+constexpr int kFlushPeriodMs = 20;
+
+constexpr size_t kLineSize = 1024;
+
+int64_t NowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool IsOneOf(char c, const char* set) {
+    return c != '\0' && strchr(set, c) != nullptr;
+}
+
+} // namespace
+
+void FormatLogArgs(const void* payload, char* out, size_t size) {
+    if (!out || size == 0) {
+        return;
+    }
+    const LogArgs& args = *static_cast<const LogArgs*>(payload);
+    const char* f = args.format ? args.format : "";
+    size_t length = 0;
+    uint8_t next = 0;
+
+    while (*f && length + 1 < size) {
+        if (*f != '%') {
+            out[length++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[length++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // %[флаги][ширина][.точность][длина]тип
+        const char* start = f++;
+        while (IsOneOf(*f, "-+ #0")) f++;
+        while ((*f >= '0' && *f <= '9') || *f == '.') f++;
+        const char* lengthStart = f;
+        while (IsOneOf(*f, "hlLqjzt")) f++;
+        char conversion = *f;
+        if (conversion == '\0') {
+            break;
+        }
+        f++;
+
+        char spec[32];
+        size_t specLength = static_cast<size_t>(lengthStart - start);
+        if (specLength > sizeof(spec) - 4) specLength = sizeof(spec) - 4;
+        memcpy(spec, start, specLength);
+
+        if (next >= args.count) {
+            out[length++] = '?';   // аргументов меньше, чем спецификаторов
+            continue;
+        }
+        LogArgs::Type type = args.types[next];
+        LogArgs::Value value = args.values[next];
+        next++;
+
+        long long asSigned = type == LogArgs::Real ? (long long)value.d : (long long)value.i;
+        unsigned long long asUnsigned = type == LogArgs::Real ? (unsigned long long)value.d : value.u;
+        double asReal = type == LogArgs::Real ? value.d
+                      : type == LogArgs::Signed ? (double)value.i : (double)value.u;
+
+        int written = 0;
+        switch (conversion) {
+        case 'd': case 'i':
+            memcpy(spec + specLength, "lld", 4);
+            written = snprintf(out + length, size - length, spec, asSigned);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[specLength] = 'l';
+            spec[specLength + 1] = 'l';
+            spec[specLength + 2] = conversion;
+            spec[specLength + 3] = '\0';
+            written = snprintf(out + length, size - length, spec, asUnsigned);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            spec[specLength] = conversion;
+            spec[specLength + 1] = '\0';
+            written = snprintf(out + length, size - length, spec, asReal);
+            break;
+        case 'c':
+            memcpy(spec + specLength, "c", 2);
+            written = snprintf(out + length, size - length, spec, (int)asSigned);
+            break;
+        case 's':
+            memcpy(spec + specLength, "s", 2);
+            written = snprintf(out + length, size - length, spec,
+                type == LogArgs::Text ? args.text + value.u : "?");
+            break;
+        default:
+            written = snprintf(out + length, size - length, "?");
+            break;
+        }
+        if (written < 0) {
+            break;
+        }
+        length += static_cast<size_t>(written);
+    }
+    if (length >= size) length = size - 1;
+    out[length] = '\0';
+}
+
+AsyncLog& AsyncLog::Instance() {
+    static AsyncLog instance;
+    return instance;
+}
+
+AsyncLog::AsyncLog()
+    : m_slots(new Slot[kCapacity]), m_enqueuePos(0), m_dequeuePos(0),
+      m_dropped(0), m_reportedDropped(0), m_running(false) {
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+    for (size_t i = 0; i < kCapacity; i++) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncLog::~AsyncLog() {
+    Stop();
+}
+
+void AsyncLog::Start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&AsyncLog::Run, this);
+}
+
+void AsyncLog::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        if (!m_running.exchange(false)) {
+            return;
+        }
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool AsyncLog::Admit(LogCategory category) {
+    size_t index = static_cast<size_t>(category);
+    if (index >= static_cast<size_t>(LogCategory::Count)) {
+        return false;
+    }
+    CategoryState& state = m_categories[index];
+
+    // Окно в одну секунду; сброс счетчика при гонке может пропустить
+    // лишнюю запись-другую - для лимита лога это неважно
+    int64_t second = NowSeconds();
+    int64_t window = state.windowSec.load(std::memory_order_relaxed);
+    if (window != second &&
+        state.windowSec.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        state.windowCount.store(0, std::memory_order_relaxed);
+    }
+    if (state.windowCount.fetch_add(1, std::memory_order_relaxed) >= kCategories[index].perSecond) {
+        state.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AsyncLog::Submit(const LogRecord& record) {
+    if (!m_running.load(std::memory_order_acquire)) {
+        Emit(record);
+        return;
+    }
+    if (!TryPush(record)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool AsyncLog::TryPush(const LogRecord& record) {
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &m_slots[pos & (kCapacity - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // кольцо полно
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = record;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLog::TryPop(LogRecord& record) {
+    Slot& slot = m_slots[m_dequeuePos & (kCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) {
+        return false;
+    }
+    record = slot.record;
+    slot.sequence.store(m_dequeuePos + kCapacity, std::memory_order_release);
+    m_dequeuePos++;
+    return true;
+}
+
+void AsyncLog::Emit(const LogRecord& record) {
+    char line[kLineSize];
+    line[0] = '\0';
+    record.format(record.payload, line, sizeof(line));
+    Output(line);
+}
+
+void AsyncLog::Output(const char* line) {
+    if (m_sink) {
+        m_sink(line);
+        return;
+    }
+    vr::VRDriverLog()->Log(line);
+}
+
+void AsyncLog::Drain() {
+    LogRecord record;
+    while (TryPop(record)) {
+        Emit(record);
+    }
+}
+
+void AsyncLog::ReportLosses() {
+    char line[256];
+    for (size_t i = 0; i < static_cast<size_t>(LogCategory::Count); i++) {
+        CategoryState& state = m_categories[i];
+        uint64_t suppressed = state.suppressed.load(std::memory_order_relaxed);
+        if (suppressed != state.reported) {
+            snprintf(line, sizeof(line), "CVDriver: Log - %llu '%s' messages suppressed (limit %u/s)",
+                (unsigned long long)(suppressed - state.reported), kCategories[i].name,
+                kCategories[i].perSecond);
+            Output(line);
+            state.reported = suppressed;
+        }
+    }
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped) {
+        snprintf(line, sizeof(line), "CVDriver: Log - %llu messages dropped, ring full",
+            (unsigned long long)(dropped - m_reportedDropped));
+        Output(line);
+        m_reportedDropped = dropped;
+    }
+}
+
+void AsyncLog::Run() {
+    while (m_running.load(std::memory_order_acquire)) {
+        Drain();
+        ReportLosses();
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait_for(lock, std::chrono::milliseconds(kFlushPeriodMs),
+            [this] { return !m_running.load(std::memory_order_acquire); });
+    }
+    Drain();
+    ReportLosses();
+}
@@ -0,0 +1,202 @@
+// src/async_log.h
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Категории сообщений горячих путей; у каждой свой лимит сообщений в секунду
+enum class LogCategory : uint8_t {
+    Packets,     // выборочные пакеты сетевого потока
+    IoLoop,      // статистика I/O цикла
+    ClockSync,   // состояние синхронизации часов отправителей
+    Submit,      // статистика отправки поз
+    Link,        // телеметрия канала устройств
+    Count
+};
+
+// Запись кольца: сырые данные + функция, которая превратит их в строку
+// уже в фоновом потоке
+constexpr size_t kLogPayloadSize = 224;
+using LogFormatFn = void (*)(const void* payload, char* out, size_t size);
+
+struct LogRecord {
+    LogCategory category;
+    LogFormatFn format;
+    alignas(8) unsigned char payload[kLogPayloadSize];
+};
+
+// Полезная нагрузка обычного сообщения: printf-формат (строковый литерал,
+// хранится указатель) и типизированные аргументы. Строки копируются.
+constexpr size_t kLogMaxArgs = 12;
+
+struct LogArgs {
+    enum Type : uint8_t { Signed, Unsigned, Real, Text };
+    union Value {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+
+    const char* format;
+    uint8_t count;
+    uint8_t textUsed;
+    Type types[kLogMaxArgs];
+    Value values[kLogMaxArgs];
+    char text[96];   // строки аргументов подряд, с нулями; не влезло - обрезается
+};
+static_assert(sizeof(LogArgs) <= kLogPayloadSize, "LogArgs must fit a log record");
+
+// Форматирует LogArgs (для LogFormatFn): спецификаторы printf без '*',
+// модификаторы длины игнорируются - тип берется из аргумента
+void FormatLogArgs(const void* payload, char* out, size_t size);
+
+namespace async_log_detail {
+
+inline void PackText(LogArgs& args, const char* text) {
+    if (!text) text = "(null)";
+    size_t room = sizeof(args.text) - args.textUsed;
+    size_t length = room > 0 ? strnlen(text, room - 1) : 0;
+    args.types[args.count] = LogArgs::Text;
+    args.values[args.count].u = args.textUsed;
+    if (room > 0) {
+        memcpy(args.text + args.textUsed, text, length);
+        args.text[args.textUsed + length] = '\0';
+        args.textUsed = static_cast<uint8_t>(args.textUsed + length + 1);
+    }
+    args.count++;
+}
+
+inline void Pack(LogArgs& args, const std::string& text) {
+    PackText(args, text.c_str());
+}
+
+template <typename T>
+void Pack(LogArgs& args, const T& value) {
+    if constexpr (std::is_convertible<T, const char*>::value) {
+        PackText(args, value);
+    } else if constexpr (std::is_floating_point<T>::value) {
+        args.types[args.count] = LogArgs::Real;
+        args.values[args.count++].d = static_cast<double>(value);
+    } else if constexpr (std::is_signed<T>::value) {
+        args.types[args.count] = LogArgs::Signed;
+        args.values[args.count++].i = static_cast<int64_t>(value);
+    } else {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                      "async log arguments: numbers and strings only");
+        args.types[args.count] = LogArgs::Unsigned;
+        args.values[args.count++].u = static_cast<uint64_t>(value);
+    }
+}
+
+} // namespace async_log_detail
+
+// Асинхронный лог для горячих путей (сетевой поток, отправка поз, RunFrame).
+//
+// Писатели кладут сырую запись в кольцо MPSC без блокировок (очередь
+// Вьюкова: номер последовательности в каждом слоте) - без snprintf и без
+// вызовов VRDriverLog. Фоновый поток форматирует и отдает их в SteamVR.
+// Кольцо полно или категория превысила лимит - запись отбрасывается и
+// учитывается; потери фоновый поток сам сообщает в лог.
+//
+// До Start и после Stop запись форматируется и пишется синхронно.
+class AsyncLog {
+public:
+    static constexpr size_t kCapacity = 256;   // степень двойки
+
+    static AsyncLog& Instance();
+
+    // Init/Cleanup драйвера. Stop дописывает оставшееся; вызывать после
+    // остановки потоков, которые пишут в лог
+    void Start();
+    void Stop();
+
+    // Куда уходят готовые строки; nullptr - VRDriverLog. Для инструментов
+    // вне vrserver (bench/replay.cpp), до первой записи
+    using Sink = void (*)(const char* line);
+    void SetSink(Sink sink) { m_sink = sink; }
+
+    // format - строковый литерал: хранится только указатель
+    template <typename... Args>
+    void Write(LogCategory category, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= kLogMaxArgs, "too many async log arguments");
+        if (!Admit(category)) {
+            return;
+        }
+        LogRecord record;
+        record.category = category;
+        record.format = &FormatLogArgs;
+        LogArgs* packed = reinterpret_cast<LogArgs*>(record.payload);
+        packed->format = format;
+        packed->count = 0;
+        packed->textUsed = 0;
+        (async_log_detail::Pack(*packed, args), ...);
+        Submit(record);
+    }
+
+    // Своя запись: payload копируется побайтно, format вызывается в фоне
+    template <typename Payload>
+    void WriteRecord(LogCategory category, LogFormatFn format, const Payload& payload) {
+        static_assert(sizeof(Payload) <= kLogPayloadSize, "payload must fit a log record");
+        static_assert(std::is_trivially_copyable<Payload>::value, "payload is copied as bytes");
+        if (!Admit(category)) {
+            return;
+        }
+        LogRecord record;
+        record.category = category;
+        record.format = format;
+        memcpy(record.payload, &payload, sizeof(Payload));
+        Submit(record);
+    }
+
+private:
+    AsyncLog();
+    ~AsyncLog();
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    struct CategoryState {
+        std::atomic<int64_t> windowSec{-1};
+        std::atomic<uint32_t> windowCount{0};
+        std::atomic<uint64_t> suppressed{0};
+        uint64_t reported = 0;   // фоновый поток
+    };
+
+    bool Admit(LogCategory category);
+    void Submit(const LogRecord& record);
+    bool TryPush(const LogRecord& record);
+    bool TryPop(LogRecord& record);
+    void Emit(const LogRecord& record);
+    void Output(const char* line);
+    void Drain();
+    void ReportLosses();
+    void Run();
+
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) size_t m_dequeuePos;   // фоновый поток
+    std::atomic<uint64_t> m_dropped;
+    uint64_t m_reportedDropped;        // фоновый поток
+    CategoryState m_categories[static_cast<size_t>(LogCategory::Count)];
+
+    std::atomic<bool> m_running;
+    Sink m_sink = nullptr;
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+};
+
+template <typename... Args>
+inline void LogAsync(LogCategory category, const char* format, const Args&... args) {
+    AsyncLog::Instance().Write(category, format, args...);
+}
@@ -0,0 +1,244 @@
+// src/calibration.cpp
+#include "calibration.h"
+#include "json_lite.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace vr;
+
+namespace {
+
+constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+
+// Ключи калибровки одного уровня (верхний или "devices.<id>")
+struct CalibrationKeys {
+    double offset[3] = { 0.0, 0.0, 0.0 };
+    double scale[3] = { 1.0, 1.0, 1.0 };
+    double rotationDeg[3] = { 0.0, 0.0, 0.0 };
+};
+
+// {"x":..,"y":..,"z":..} (отсутствующая ось не меняется) или [x, y, z]
+bool ParseVector(const JsonValue& value, double out[3]) {
+    if (value.IsArray()) {
+        if (value.items.size() != 3) {
+            return false;
+        }
+        for (size_t i = 0; i < 3; i++) {
+            if (!value.items[i].IsNumber()) return false;
+            out[i] = value.items[i].number;
+        }
+    } else if (value.IsObject()) {
+        static const char* const kAxes[3] = { "x", "y", "z" };
+        for (size_t i = 0; i < 3; i++) {
+            const JsonValue* axis = value.Find(kAxes[i]);
+            if (axis == nullptr) continue;
+            if (!axis->IsNumber()) return false;
+            out[i] = axis->number;
+        }
+    } else {
+        return false;
+    }
+    return std::isfinite(out[0]) && std::isfinite(out[1]) && std::isfinite(out[2]);
+}
+
+bool ParseKeys(const JsonValue& object, CalibrationKeys& keys, const std::string& where, std::string& error) {
+    if (const JsonValue* value = object.Find("position_offset")) {
+        if (!ParseVector(*value, keys.offset)) {
+            error = "bad position_offset" + where;
+            return false;
+        }
+    }
+    if (const JsonValue* value = object.Find("position_scale")) {
+        if (!ParseVector(*value, keys.scale) ||
+            keys.scale[0] == 0.0 || keys.scale[1] == 0.0 || keys.scale[2] == 0.0) {
+            error = "bad position_scale" + where;
+            return false;
+        }
+    }
+    if (const JsonValue* value = object.Find("rotation_offset")) {
+        if (!ParseVector(*value, keys.rotationDeg)) {
+            error = "bad rotation_offset" + where;
+            return false;
+        }
+    }
+    return true;
+}
+
+HmdQuaternion_t Multiply(const HmdQuaternion_t& a, const HmdQuaternion_t& b) {
+    HmdQuaternion_t q;
+    q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    return q;
+}
+
+// Поворот Эйлера: сначала X, затем Y, затем Z (q = qz * qy * qx)
+HmdQuaternion_t EulerDegreesToQuaternion(const double degrees[3]) {
+    double hx = degrees[0] * kDegToRad * 0.5;
+    double hy = degrees[1] * kDegToRad * 0.5;
+    double hz = degrees[2] * kDegToRad * 0.5;
+    HmdQuaternion_t qx = { std::cos(hx), std::sin(hx), 0.0, 0.0 };
+    HmdQuaternion_t qy = { std::cos(hy), 0.0, std::sin(hy), 0.0 };
+    HmdQuaternion_t qz = { std::cos(hz), 0.0, 0.0, std::sin(hz) };
+    return Multiply(qz, Multiply(qy, qx));
+}
+
+CalibrationTransform MakeTransform(const CalibrationKeys& keys) {
+    CalibrationTransform transform;
+    for (size_t i = 0; i < 3; i++) {
+        transform.scale[i] = keys.scale[i];
+        transform.offset[i] = keys.offset[i];
+    }
+    transform.rotation = EulerDegreesToQuaternion(keys.rotationDeg);
+    return transform;
+}
+
+} // namespace
+
+bool ParseCalibration(const std::string& text, CalibrationSet& set, std::string& error) {
+    JsonValue root;
+    if (!ParseJson(text, root, error)) {
+        return false;
+    }
+    if (!root.IsObject()) {
+        error = "top level is not an object";
+        return false;
+    }
+
+    CalibrationKeys common;
+    if (!ParseKeys(root, common, "", error)) {
+        return false;
+    }
+    CalibrationTransform commonTransform = MakeTransform(common);
+    for (auto& transform : set.devices) {
+        transform = commonTransform;
+    }
+
+    const JsonValue* devices = root.Find("devices");
+    if (devices == nullptr) {
+        return true;
+    }
+    if (!devices->IsObject()) {
+        error = "'devices' is not an object";
+        return false;
+    }
+    for (const auto& member : devices->members) {
+        char* end = nullptr;
+        long id = strtol(member.first.c_str(), &end, 10);
+        if (member.first.empty() || *end != 0 || id < 0 || id >= (long)kMaxTrackedDevices) {
+            error = "bad controller_id '" + member.first + "' in devices";
+            return false;
+        }
+        if (!member.second.IsObject()) {
+            error = "devices." + member.first + " is not an object";
+            return false;
+        }
+        // Ключи (и оси) устройства - поверх общих
+        CalibrationKeys device = common;
+        if (!ParseKeys(member.second, device, " for device " + member.first, error)) {
+            return false;
+        }
+        set.devices[id] = MakeTransform(device);
+    }
+    return true;
+}
+
+CalibrationStore::CalibrationStore()
+    : m_current(nullptr), m_hasStamp(false), m_stamp(0), m_size(0), m_lastFailed(false), m_running(false) {
+    // До загрузки файла (и без него) - identity
+    m_sets.push_back(std::make_unique<CalibrationSet>());
+    m_current.store(m_sets.back().get(), std::memory_order_release);
+}
+
+CalibrationStore::~CalibrationStore() {
+    Stop();
+}
+
+void CalibrationStore::Start(const std::string& path) {
+    char logMsg[512];
+    if (path.empty()) {
+        VRDriverLog()->Log("CVDriver: Calibration - off (calibration_file not set)");
+        return;
+    }
+    m_path = path;
+
+    // Первая загрузка синхронно: первые позы уже с калибровкой
+    if (Reload(true)) {
+        snprintf(logMsg, sizeof(logMsg), "CVDriver: Calibration loaded from %s (watching for changes)", m_path.c_str());
+    } else {
+        snprintf(logMsg, sizeof(logMsg), "CVDriver: Calibration - using identity until %s is valid", m_path.c_str());
+    }
+    VRDriverLog()->Log(logMsg);
+
+    m_running = true;
+    m_thread = std::thread(&CalibrationStore::Run, this);
+}
+
+void CalibrationStore::Stop() {
+    if (m_running.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+        }
+        m_wake.notify_all();
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool CalibrationStore::Reload(bool initial) {
+    // Время изменения + размер: копирование файла поверх может не менять mtime
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(m_path, ec);
+    long long stamp = ec ? 0 : (long long)writeTime.time_since_epoch().count();
+    uintmax_t size = ec ? 0 : std::filesystem::file_size(m_path, ec);
+    if (ec) {
+        size = 0;
+    }
+    if (!initial && m_hasStamp && stamp == m_stamp && size == m_size) {
+        return !m_lastFailed;
+    }
+    m_hasStamp = true;
+    m_stamp = stamp;
+    m_size = size;
+
+    char logMsg[512];
+    std::string text;
+    std::string error;
+    auto set = std::make_unique<CalibrationSet>();
+    if (!ReadTextFile(m_path, text)) {
+        error = "cannot read file";
+    } else if (ParseCalibration(text, *set, error)) {
+        m_current.store(set.get(), std::memory_order_release);
+        m_sets.push_back(std::move(set));
+        if (!initial) {
+            snprintf(logMsg, sizeof(logMsg), "CVDriver: Calibration reloaded from %s", m_path.c_str());
+            VRDriverLog()->Log(logMsg);
+        }
+        m_lastFailed = false;
+        return true;
+    }
+
+    // Остается прежняя калибровка; об ошибке - один раз на версию файла
+    snprintf(logMsg, sizeof(logMsg), "CVDriver: Calibration file %s rejected (%s), keeping previous",
+        m_path.c_str(), error.c_str());
+    VRDriverLog()->Log(logMsg);
+    m_lastFailed = true;
+    return false;
+}
+
+void CalibrationStore::Run() {
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (m_running) {
+        m_wake.wait_for(lock, std::chrono::milliseconds(kPollMs), [this] { return !m_running; });
+        if (!m_running) {
+            break;
+        }
+        lock.unlock();
+        Reload(false);
+        lock.lock();
+    }
+}
@@ -0,0 +1,107 @@
+// src/calibration.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "packet_batch.h"
+
+// Калибровка одного устройства, сведенная к одному преобразованию:
+//   world = R * (scale * raw) + offset
+// Масштаб (по осям) применяется к позиции в драйвере, поворот и смещение
+// уходят в qWorldFromDriverRotation / vecWorldFromDriverTranslation -
+// их SteamVR применяет сам, в том числе к скоростям.
+struct CalibrationTransform {
+    double scale[3] = { 1.0, 1.0, 1.0 };
+    vr::HmdQuaternion_t rotation = { 1.0, 0.0, 0.0, 0.0 };
+    double offset[3] = { 0.0, 0.0, 0.0 };
+
+    // Сетевой поток, после заполнения vecPosition сырыми данными
+    void Apply(vr::DriverPose_t& pose) const {
+        pose.vecPosition[0] *= scale[0];
+        pose.vecPosition[1] *= scale[1];
+        pose.vecPosition[2] *= scale[2];
+        pose.qWorldFromDriverRotation = rotation;
+        pose.vecWorldFromDriverTranslation[0] = offset[0];
+        pose.vecWorldFromDriverTranslation[1] = offset[1];
+        pose.vecWorldFromDriverTranslation[2] = offset[2];
+    }
+
+    // Скорость, посчитанная до калибровки, - в масштаб позиции
+    void ScaleVector(double v[3]) const {
+        v[0] *= scale[0];
+        v[1] *= scale[1];
+        v[2] *= scale[2];
+    }
+};
+
+// Калибровка всех устройств по controller_id
+struct CalibrationSet {
+    std::array<CalibrationTransform, kMaxTrackedDevices> devices;
+};
+
+// Разбирает calibration.json:
+//   {
+//     "position_offset": {"x": .., "y": .., "z": ..},   метры
+//     "position_scale":  {"x": .., "y": .., "z": ..},
+//     "rotation_offset": {"x": .., "y": .., "z": ..},   градусы: X, затем Y, затем Z
+//     "devices": { "<controller_id>": { те же ключи } }
+//   }
+// Ключи верхнего уровня - для всех устройств, "devices" переопределяет их
+// поштучно: не заданные у устройства ключи и оси берутся с верхнего уровня.
+// Вектор можно задать и массивом [x, y, z]. Нет ключа - без изменений.
+bool ParseCalibration(const std::string& text, CalibrationSet& set, std::string& error);
+
+// Калибровка из файла с перечитыванием при его изменении.
+//
+// Фоновый поток раз в kPollMs сверяет время изменения файла, разбирает
+// его и публикует новый неизменяемый CalibrationSet одним атомарным
+// указателем. Сетевой поток только читает указатель - без блокировок и
+// файлового ввода-вывода. Старые наборы живут до Stop: перечитывание
+// бывает редко, а читатель мог еще не отпустить предыдущий.
+class CalibrationStore {
+public:
+    static constexpr int kPollMs = 500;
+
+    CalibrationStore();
+    ~CalibrationStore();
+
+    // Init: загружает файл и начинает следить за ним. Пустой путь -
+    // калибровки нет (identity), поток не запускается.
+    void Start(const std::string& path);
+    // Cleanup, после остановки сетевого потока
+    void Stop();
+
+    // Сетевой поток
+    const CalibrationTransform& For(uint8_t id) const {
+        const CalibrationSet* set = m_current.load(std::memory_order_acquire);
+        return set->devices[id < kMaxTrackedDevices ? id : 0];
+    }
+
+private:
+    bool Reload(bool initial);
+    void Run();
+
+    std::string m_path;
+    std::vector<std::unique_ptr<CalibrationSet>> m_sets;   // поток Start/фоновый
+    std::atomic<const CalibrationSet*> m_current;
+
+    // Фоновый поток
+    bool m_hasStamp;
+    long long m_stamp;          // время изменения файла последней попытки
+    uintmax_t m_size;
+    bool m_lastFailed;
+
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+};
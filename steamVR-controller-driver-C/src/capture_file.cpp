@@ -0,0 +1,108 @@
+// src/capture_file.cpp
+#include "capture_file.h"
+#include <cstring>
+
+namespace {
+
+constexpr size_t kWriteBufferSize = 1 << 20;
+
+} // namespace
+
+bool CaptureWriter::Open(const std::string& path, const CaptureFileHeader& header) {
+    Close();
+    if (path.empty()) {
+        return false;
+    }
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    m_buffer.reset(new char[kWriteBufferSize]);
+    setvbuf(m_file, m_buffer.get(), _IOFBF, kWriteBufferSize);
+
+    CaptureFileHeader fileHeader = header;
+    fileHeader.magic = kCaptureMagic;
+    fileHeader.version = kCaptureVersion;
+    fileHeader.headerSize = sizeof(CaptureFileHeader);
+    fileHeader.recordHeaderSize = sizeof(CaptureRecordHeader);
+    m_records = 0;
+    m_bytes = 0;
+    m_failed = fwrite(&fileHeader, sizeof(fileHeader), 1, m_file) != 1;
+    // Заголовок сразу на диск: файл читается, даже если vrserver упадет
+    fflush(m_file);
+    return !m_failed;
+}
+
+void CaptureWriter::Close() {
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+    m_buffer.reset();
+}
+
+void CaptureWriter::Write(const CaptureRecordHeader& record, const void* payload) {
+    if (!m_file || m_failed) {
+        return;
+    }
+    static const uint8_t kPadding[kCaptureAlignment] = {};
+    size_t stride = CaptureRecordStride(record.size);
+    size_t padding = stride - sizeof(CaptureRecordHeader) - record.size;
+    // Копии в буфер stdio, на диск - раз в kWriteBufferSize
+    if (fwrite(&record, sizeof(record), 1, m_file) != 1 ||
+        (record.size > 0 && fwrite(payload, record.size, 1, m_file) != 1) ||
+        (padding > 0 && fwrite(kPadding, padding, 1, m_file) != 1)) {
+        m_failed = true;
+        return;
+    }
+    m_records++;
+    m_bytes += stride;
+}
+
+void CaptureWriter::Flush() {
+    if (m_file && !m_failed) {
+        fflush(m_file);
+    }
+}
+
+bool CaptureReader::Open(const uint8_t* data, size_t size, std::string& error) {
+    m_data = nullptr;
+    m_size = 0;
+    if (size < sizeof(CaptureFileHeader)) {
+        error = "file is too short";
+        return false;
+    }
+    memcpy(&m_header, data, sizeof(m_header));
+    if (m_header.magic != kCaptureMagic) {
+        error = "not a capture file";
+        return false;
+    }
+    if (m_header.version != kCaptureVersion || m_header.headerSize != sizeof(CaptureFileHeader) ||
+        m_header.recordHeaderSize != sizeof(CaptureRecordHeader)) {
+        error = "unsupported capture version " + std::to_string(m_header.version);
+        return false;
+    }
+    if (m_header.portCount > kCaptureMaxPorts) {
+        error = "invalid port count";
+        return false;
+    }
+    m_data = data;
+    m_size = size;
+    Rewind();
+    return true;
+}
+
+bool CaptureReader::Next(const CaptureRecordHeader*& record, const uint8_t*& payload) {
+    if (!m_data || m_size - m_offset < sizeof(CaptureRecordHeader)) {
+        return false;
+    }
+    const CaptureRecordHeader* header = reinterpret_cast<const CaptureRecordHeader*>(m_data + m_offset);
+    size_t stride = CaptureRecordStride(header->size);
+    if (m_size - m_offset < stride) {
+        return false;
+    }
+    record = header;
+    payload = m_data + m_offset + sizeof(CaptureRecordHeader);
+    m_offset += stride;
+    return true;
+}
@@ -0,0 +1,119 @@
+// src/capture_file.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Запись всего, что принял NetworkClient, для воспроизведения без железа
+// (bench/replay.cpp): задержку и дрожание можно сравнить между двумя
+// сборками на одном и том же потоке пакетов.
+//
+// Файл - CaptureFileHeader и записи подряд. Все поля фиксированной ширины,
+// каждая запись выровнена на kCaptureAlignment: файл можно отобразить в
+// память и идти по записям на месте, без разбора. Порядок байт - как у
+// x86/ARM Windows (little-endian).
+//
+// Запись - одна датаграмма в том виде, в каком пришла (до разбора, включая
+// ответы синхронизации часов), или одна запись кольца общей памяти. У
+// каждой - время прихода по часам драйвера и номер пробуждения сетевого
+// потока, так что replay собирает те же пачки, что и драйвер. Отправленные
+// запросы часов тоже пишутся: по ним replay принимает ответы.
+constexpr uint32_t kCaptureMagic = 0x50435643;   // "CVCP"
+constexpr uint32_t kCaptureVersion = 1;
+constexpr size_t kCaptureMaxPorts = 4;
+constexpr size_t kCaptureAlignment = 8;
+
+enum class CaptureSource : uint8_t {
+    Datagram = 0,     // UDP, payload - байты датаграммы
+    SharedRing = 1,   // кольцо общей памяти, payload - ControllerData
+    ClockRequest = 2  // запрос синхронизации часов, отправленный address:port
+};
+
+struct CaptureFileHeader {
+    uint32_t magic;             // kCaptureMagic
+    uint32_t version;           // kCaptureVersion
+    uint32_t headerSize;        // sizeof(CaptureFileHeader)
+    uint32_t recordHeaderSize;  // sizeof(CaptureRecordHeader)
+    int64_t startUs;            // LocalMicros в момент начала записи
+    uint16_t ports[kCaptureMaxPorts];   // UDP-порт сокета с этим индексом
+    uint8_t roles[kCaptureMaxPorts];    // PortRole сокета
+    uint8_t portCount;
+    uint8_t gyroMouseDeviceId;          // DecodeOptions на момент записи
+    uint8_t reserved[26];
+};
+
+static_assert(sizeof(CaptureFileHeader) == 64, "capture header layout is part of the file format");
+
+struct CaptureRecordHeader {
+    int64_t arrivalUs;          // LocalMicros прихода
+    uint32_t wakeup;            // номер вызова ReceiveBatch
+    uint32_t address;           // IPv4 отправителя, сетевой порядок байт; 0 - кольцо
+    uint16_t port;              // сетевой порядок байт
+    uint16_t size;              // байт payload (без выравнивания)
+    uint8_t source;             // CaptureSource
+    uint8_t socketIndex;        // Datagram, ClockRequest: индекс в ports/roles
+    uint8_t flags;              // SharedRing: флаги записи (kSharedRing*)
+    uint8_t reserved;
+    int32_t captureAgeUs;       // SharedRing: возраст по captureTicks, -1 - неизвестен
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(CaptureRecordHeader) == 32, "capture record layout is part of the file format");
+
+// Размер записи в файле вместе с выравниванием payload
+inline size_t CaptureRecordStride(size_t payloadSize) {
+    return sizeof(CaptureRecordHeader) + (payloadSize + kCaptureAlignment - 1) / kCaptureAlignment * kCaptureAlignment;
+}
+
+// Запись в файл; только сетевой поток. Буфер stdio большой, чтобы запись
+// на диск шла кусками, а не на каждую датаграмму.
+class CaptureWriter {
+public:
+    CaptureWriter() = default;
+    ~CaptureWriter() { Close(); }
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // magic, version и размеры заголовка заполняются здесь
+    bool Open(const std::string& path, const CaptureFileHeader& header);
+    void Close();
+    bool IsOpen() const { return m_file != nullptr; }
+
+    void Write(const CaptureRecordHeader& record, const void* payload);
+    void Flush();
+
+    uint64_t RecordCount() const { return m_records; }
+    uint64_t ByteCount() const { return m_bytes; }
+    bool Failed() const { return m_failed; }
+
+private:
+    FILE* m_file = nullptr;
+    std::unique_ptr<char[]> m_buffer;
+    uint64_t m_records = 0;
+    uint64_t m_bytes = 0;
+    bool m_failed = false;   // диск полон и т.п.: дальше не пишем
+};
+
+// Чтение записи из памяти (отображение файла или прочитанный целиком файл)
+class CaptureReader {
+public:
+    // false - не файл записи или другая версия формата (error)
+    bool Open(const uint8_t* data, size_t size, std::string& error);
+
+    const CaptureFileHeader& Header() const { return m_header; }
+
+    // Следующая запись; false - конец файла. Оборванная последняя запись
+    // (драйвер не закрыл файл) считается концом.
+    bool Next(const CaptureRecordHeader*& record, const uint8_t*& payload);
+    // Вернуться к первой записи
+    void Rewind() { m_offset = sizeof(CaptureFileHeader); }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+    CaptureFileHeader m_header = {};
+};
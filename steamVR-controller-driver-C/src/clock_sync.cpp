@@ -0,0 +1,111 @@
+// src/clock_sync.cpp
+#include "clock_sync.h"
+#include <cmath>
+
+namespace {
+
+// Столько обменов нужно, чтобы фильтр выбрал хоть сколько-то честный
+constexpr size_t kMinExchanges = 4;
+
+// Дрейф меряется между лучшими обменами не ближе этого интервала:
+// при разбросе delay ~200 мкс на 8 с это ~25 ppm шума до сглаживания
+constexpr int64_t kDriftSpanUs = 8000000;
+constexpr double kDriftAlpha = 0.2;
+// Кварцы расходятся на десятки ppm; больше - ошибка измерения
+constexpr double kMaxDrift = 500e-6;
+
+// Смещение ушло дальше этого (сверх погрешности delay/2) - часы
+// отправителя перезапущены, старая история не нужна
+constexpr double kClockStepUs = 50000.0;
+
+} // namespace
+
+void ClockSync::Reset() {
+    m_head = 0;
+    m_count = 0;
+    m_exchanges = 0;
+    m_hasRef = false;
+    m_refLocal = 0;
+    m_refOffset = 0.0;
+    m_refDelay = 0;
+    m_hasDriftAnchor = false;
+    m_driftAnchorLocal = 0;
+    m_driftAnchorOffset = 0.0;
+    m_hasDrift = false;
+    m_drift = 0.0;
+}
+
+void ClockSync::AddExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    if (t4 < t1 || t3 < t2) {
+        return;   // ответ не на наш запрос или испорченные метки
+    }
+
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    if (delay < 0) delay = 0;
+    double offset = (static_cast<double>(t2 - t1) + static_cast<double>(t3 - t4)) / 2.0;
+
+    if (IsSynced() && std::fabs(offset - OffsetAt(t4)) > kClockStepUs + delay / 2.0) {
+        Reset();
+    }
+
+    m_window[m_head] = { t4, offset, delay };
+    m_head = (m_head + 1) % kWindow;
+    if (m_count < kWindow) m_count++;
+    m_exchanges++;
+
+    // Фильтр часов: обмен с наименьшей задержкой, при равенстве - новее
+    const Exchange* best = nullptr;
+    for (size_t i = 0; i < m_count; i++) {
+        const Exchange& candidate = m_window[i];
+        if (!best || candidate.delayUs < best->delayUs ||
+            (candidate.delayUs == best->delayUs && candidate.localUs > best->localUs)) {
+            best = &candidate;
+        }
+    }
+
+    if (m_hasRef && best->localUs == m_refLocal) {
+        return;   // лучший обмен не изменился
+    }
+    m_hasRef = true;
+    m_refLocal = best->localUs;
+    m_refOffset = best->offsetUs;
+    m_refDelay = best->delayUs;
+
+    if (!m_hasDriftAnchor) {
+        m_hasDriftAnchor = true;
+        m_driftAnchorLocal = best->localUs;
+        m_driftAnchorOffset = best->offsetUs;
+        return;
+    }
+
+    int64_t span = best->localUs - m_driftAnchorLocal;
+    if (span >= kDriftSpanUs) {
+        double drift = (best->offsetUs - m_driftAnchorOffset) / static_cast<double>(span);
+        drift = drift > kMaxDrift ? kMaxDrift : (drift < -kMaxDrift ? -kMaxDrift : drift);
+        m_drift = m_hasDrift ? m_drift + kDriftAlpha * (drift - m_drift) : drift;
+        m_hasDrift = true;
+        m_driftAnchorLocal = best->localUs;
+        m_driftAnchorOffset = best->offsetUs;
+    }
+}
+
+bool ClockSync::IsSynced() const {
+    return m_hasRef && m_count >= kMinExchanges;
+}
+
+double ClockSync::OffsetAt(int64_t localUs) const {
+    return m_refOffset + m_drift * static_cast<double>(localUs - m_refLocal);
+}
+
+bool ClockSync::ToLocal(uint32_t senderUs, int64_t nowLocalUs, int64_t& localUs) const {
+    if (!IsSynced()) {
+        return false;
+    }
+    // Восстанавливаем старшие биты по ожидаемому "сейчас" отправителя
+    double offset = OffsetAt(nowLocalUs);
+    int64_t expectedSender = nowLocalUs + static_cast<int64_t>(std::llround(offset));
+    int64_t sender = expectedSender
+        + static_cast<int32_t>(senderUs - static_cast<uint32_t>(expectedSender));
+    localUs = sender - static_cast<int64_t>(std::llround(offset));
+    return true;
+}
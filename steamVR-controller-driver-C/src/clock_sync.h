@@ -0,0 +1,77 @@
+// src/clock_sync.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Часы драйвера в микросекундах (steady_clock), в них считаются t1/t4
+inline int64_t LocalMicros(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+inline std::chrono::steady_clock::time_point FromLocalMicros(int64_t us) {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(us)));
+}
+
+// Оценка смещения и дрейфа часов одного отправителя относительно часов
+// драйвера по NTP-подобным обменам (t1 - запрос ушел, t2 - отправитель
+// принял, t3 - отправитель ответил, t4 - ответ пришел):
+//   offset = ((t2 - t1) + (t3 - t4)) / 2,  delay = (t4 - t1) - (t3 - t2)
+//
+// Wi-Fi добавляет асимметричную задержку, поэтому берется обмен с
+// наименьшим delay из последних kWindow (фильтр часов NTP). Дрейф - наклон
+// между соседними такими лучшими обменами, сглаженный.
+//
+// Используется только сетевым потоком.
+class ClockSync {
+public:
+    static constexpr size_t kWindow = 8;
+
+    ClockSync() { Reset(); }
+
+    void Reset();
+
+    // t1, t4 - часы драйвера; t2, t3 - часы отправителя; все в мкс
+    void AddExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+    // Достаточно обменов, чтобы доверять оценке
+    bool IsSynced() const;
+
+    // Смещение "отправитель - драйвер" на момент localUs
+    double OffsetAt(int64_t localUs) const;
+    double DriftPpm() const { return m_drift * 1e6; }
+    int64_t BestDelayUs() const { return m_refDelay; }
+    uint32_t Exchanges() const { return m_exchanges; }
+
+    // Время захвата (младшие 32 бита мкс отправителя) -> часы драйвера.
+    // nowLocalUs нужен, чтобы развернуть 32-битное значение.
+    // false, если часы еще не синхронизированы.
+    bool ToLocal(uint32_t senderUs, int64_t nowLocalUs, int64_t& localUs) const;
+
+private:
+    struct Exchange {
+        int64_t localUs;    // t4
+        double offsetUs;
+        int64_t delayUs;
+    };
+
+    std::array<Exchange, kWindow> m_window;
+    size_t m_head;
+    size_t m_count;
+    uint32_t m_exchanges;
+
+    // Опорный (лучший) обмен, от которого экстраполируется смещение
+    bool m_hasRef;
+    int64_t m_refLocal;
+    double m_refOffset;
+    int64_t m_refDelay;
+    // Лучший обмен, от которого меряется следующий наклон дрейфа
+    bool m_hasDriftAnchor;
+    int64_t m_driftAnchorLocal;
+    double m_driftAnchorOffset;
+    bool m_hasDrift;
+    double m_drift;   // доля: мкс смещения на мкс часов драйвера
+};
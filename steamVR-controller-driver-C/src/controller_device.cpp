@@ -1,58 +1,115 @@
 // src/controller_device.cpp
 #include "driver.h"
-#include <cmath>
+#include "debug_request.h"
+#include "packet_batch.h"
 #include <iostream>
 
 using namespace vr;
 
-CVController::CVController(vr::ETrackedControllerRole role, uint8_t expected_id)
-    : m_role(role), m_expectedControllerId(expected_id),
-      m_unObjectId(vr::k_unTrackedDeviceIndexInvalid), m_ulPropertyContainer(0) {
+namespace {
+
+// Старше этого событие ввода не датируется: SteamVR все равно применит
+// его сейчас, а большое смещение только путает сглаживание ввода
+constexpr double kMaxInputAgeSec = 0.1;
+
+} // namespace
+
+ControllerProfile MakeCVControllerProfile(vr::ETrackedControllerRole role) {
+    ControllerProfile profile;
+    profile.modelNumber = "CV_Controller_MK1";
+    profile.serialNumber = role == TrackedControllerRole_LeftHand ? "CV_LEFT_001" : "CV_RIGHT_001";
+    profile.manufacturer = "CVDriver";
+    profile.trackingSystem = "cvtracking";
+    profile.renderModel = "vr_controller_vive_1_5";
+    profile.controllerType = "vive_controller";
+    profile.inputProfilePath = "{cvdriver}/input/cvcontroller_profile.json";
+    profile.deviceClass = TrackedDeviceClass_Controller;
+    profile.hasTriggerValue = true;
+    profile.inputMapping = DefaultInputMapping(profile.hasTriggerValue);
+    return profile;
+}
+
+ControllerProfile MakeGyroMouseProfile(vr::ETrackedControllerRole role, const char* driverName) {
+    ControllerProfile profile;
+    profile.modelNumber = "GyroMouse_Controller_MK1";
+    profile.serialNumber = role == TrackedControllerRole_LeftHand ? "GYROMOUSE_LEFT_001" : "GYROMOUSE_RIGHT_001";
+    profile.manufacturer = "GyroMouse";
+    profile.trackingSystem = "gyromouse_aruco";
+    profile.renderModel = "vr_controller_vive_1_5";
+    profile.controllerType = "vive_controller";
+    profile.deviceClass = TrackedDeviceClass_Controller;
+    // В составе cvdriver профиля гиромыши нет - у cvcontroller те же кнопки
+    profile.inputProfilePath = strcmp(driverName, "gyromouse") == 0
+        ? "{gyromouse}/input/gyromouse_profile.json"
+        : std::string("{") + driverName + "}/input/cvcontroller_profile.json";
+    profile.hasTriggerValue = false;
+    profile.inputMapping = DefaultInputMapping(profile.hasTriggerValue);
+    return profile;
+}
+
+ControllerProfile MakeTrackerProfile(const std::string& serialNumber) {
+    ControllerProfile profile;
+    profile.modelNumber = "CV_Tracker_MK1";
+    profile.serialNumber = serialNumber;
+    profile.manufacturer = "CVDriver";
+    profile.trackingSystem = "cvtracking";
+    // Модель и профиль ввода трекера Vive - SteamVR показывает его в "Manage Trackers"
+    profile.renderModel = "{htc}vr_tracker_vive_1_0";
+    profile.controllerType = "vive_tracker";
+    profile.inputProfilePath = "{htc}/input/vive_tracker_profile.json";
+    profile.deviceClass = TrackedDeviceClass_GenericTracker;
+    profile.hasTriggerValue = false;
+    profile.inputMapping = DefaultInputMapping(profile.hasTriggerValue);
+    return profile;
+}
+
+CVController::CVController(vr::ETrackedControllerRole role, const ControllerProfile& profile)
+    : m_role(role), m_profile(profile),
+      m_unObjectId(vr::k_unTrackedDeviceIndexInvalid), m_ulPropertyContainer(0),
+      m_posePipeline("CVController"), m_inputReady(false), m_lastButtons(0) {
     
-    memset(&m_pose, 0, sizeof(m_pose));
-    m_pose.poseIsValid = true;
-    m_pose.result = TrackingResult_Running_OK;
-    m_pose.deviceIsConnected = true;
+    DriverPose_t pose;
+    memset(&pose, 0, sizeof(pose));
+    pose.poseIsValid = true;
+    pose.result = TrackingResult_Running_OK;
+    pose.deviceIsConnected = true;
     
-    m_pose.qWorldFromDriverRotation = {1, 0, 0, 0};
-    m_pose.qDriverFromHeadRotation = {1, 0, 0, 0};
+    pose.qWorldFromDriverRotation = {1, 0, 0, 0};
+    pose.qDriverFromHeadRotation = {1, 0, 0, 0};
     
     // Начальная позиция (примерно на уровне груди)
-    m_pose.vecPosition[0] = (role == TrackedControllerRole_LeftHand) ? -0.2f : 0.2f;
-    m_pose.vecPosition[1] = 1.0f;
-    m_pose.vecPosition[2] = -0.3f;
+    pose.vecPosition[0] = (role == TrackedControllerRole_LeftHand) ? -0.2f : 0.2f;
+    pose.vecPosition[1] = 1.0f;
+    pose.vecPosition[2] = -0.3f;
     
-    m_pose.qRotation = {1, 0, 0, 0};
+    pose.qRotation = {1, 0, 0, 0};
     
-    m_lastUpdateTime = std::chrono::steady_clock::now();
-    
-    // Инициализируем хендлы компонентов ввода
-    memset(m_inputComponentHandles, 0, sizeof(m_inputComponentHandles));
+    m_posePipeline.SetInitialPose(pose);
 }
 
 vr::EVRInitError CVController::Activate(uint32_t unObjectId) {
     VRDriverLog()->Log("CVController: Activate called!");
     
     m_unObjectId = unObjectId;
+    m_posePipeline.SetDeviceIndex(unObjectId);
     m_ulPropertyContainer = VRProperties()->TrackedDeviceToPropertyContainer(unObjectId);
     
     // Основные свойства
     VRProperties()->SetStringProperty(m_ulPropertyContainer, 
-        Prop_ModelNumber_String, "CV_Controller_MK1");
+        Prop_ModelNumber_String, m_profile.modelNumber.c_str());
     
     VRProperties()->SetStringProperty(m_ulPropertyContainer,
-        Prop_SerialNumber_String, 
-        m_role == TrackedControllerRole_LeftHand ? "CV_LEFT_001" : "CV_RIGHT_001");
+        Prop_SerialNumber_String, m_profile.serialNumber.c_str());
     
-    // Используем модель контроллера Vive как временную
+    // Используем модель Vive (контроллер/трекер) как временную
     VRProperties()->SetStringProperty(m_ulPropertyContainer,
-        Prop_RenderModelName_String, "vr_controller_vive_1_5");
+        Prop_RenderModelName_String, m_profile.renderModel.c_str());
     
     VRProperties()->SetStringProperty(m_ulPropertyContainer,
-        Prop_ManufacturerName_String, "CVDriver");
+        Prop_ManufacturerName_String, m_profile.manufacturer.c_str());
     
     VRProperties()->SetStringProperty(m_ulPropertyContainer,
-        Prop_TrackingSystemName_String, "cvtracking");
+        Prop_TrackingSystemName_String, m_profile.trackingSystem.c_str());
     
     VRProperties()->SetUint64Property(m_ulPropertyContainer, 
         Prop_CurrentUniverseId_Uint64, 2);
@@ -61,43 +118,48 @@ vr::EVRInitError CVController::Activate(uint32_t unObjectId) {
         Prop_ControllerRoleHint_Int32, m_role);
     
     VRProperties()->SetStringProperty(m_ulPropertyContainer,
-        Prop_ControllerType_String, "vive_controller");
+        Prop_ControllerType_String, m_profile.controllerType.c_str());
     
     VRProperties()->SetStringProperty(m_ulPropertyContainer, 
-        Prop_InputProfilePath_String, "{cvdriver}/input/cvcontroller_profile.json");
-    
-    VRProperties()->SetInt32Property(m_ulPropertyContainer,
-        Prop_DeviceClass_Int32, TrackedDeviceClass_Controller);
-    
-    VRProperties()->SetInt32Property(m_ulPropertyContainer,
-        Prop_Axis0Type_Int32, k_eControllerAxis_TrackPad);
+        Prop_InputProfilePath_String, m_profile.inputProfilePath.c_str());
     
     VRProperties()->SetInt32Property(m_ulPropertyContainer,
-        Prop_Axis1Type_Int32, k_eControllerAxis_Trigger);
+        Prop_DeviceClass_Int32, m_profile.deviceClass);
     
-    // Создаем компоненты ввода
-    VRDriverInput()->CreateBooleanComponent(m_ulPropertyContainer, 
-        "/input/trigger/click", &m_inputComponentHandles[0]);
-    
-    VRDriverInput()->CreateBooleanComponent(m_ulPropertyContainer, 
-        "/input/grip/click", &m_inputComponentHandles[1]);
-    
-    VRDriverInput()->CreateBooleanComponent(m_ulPropertyContainer, 
-        "/input/application_menu/click", &m_inputComponentHandles[2]);
+    if (m_profile.hasTriggerValue) {
+        VRProperties()->SetInt32Property(m_ulPropertyContainer,
+            Prop_Axis0Type_Int32, k_eControllerAxis_TrackPad);
+        
+        VRProperties()->SetInt32Property(m_ulPropertyContainer,
+            Prop_Axis1Type_Int32, k_eControllerAxis_Trigger);
+    }
     
-    VRDriverInput()->CreateBooleanComponent(m_ulPropertyContainer, 
-        "/input/system/click", &m_inputComponentHandles[3]);
+    // Создаем компоненты ввода по раскладке; ошибочная раскладка из
+    // настроек заменяется раскладкой по умолчанию
+    InputMappingSpec mapping;
+    std::string mappingError;
+    char logMsg[256];
+    if (!ParseInputMapping(m_profile.inputMapping.c_str(), mapping, mappingError)) {
+        snprintf(logMsg, sizeof(logMsg), "CVController: Invalid input mapping (%s), using default",
+            mappingError.c_str());
+        VRDriverLog()->Log(logMsg);
+        ParseInputMapping(DefaultInputMapping(m_profile.hasTriggerValue).c_str(), mapping, mappingError);
+    }
+    m_inputMap.Build(mapping, m_ulPropertyContainer);
+    m_inputReady.store(true, std::memory_order_release);
     
-    VRDriverInput()->CreateScalarComponent(m_ulPropertyContainer, 
-        "/input/trigger/value", &m_inputComponentHandles[4], 
-        VRScalarType_Absolute, VRScalarUnits_NormalizedOneSided);
+    snprintf(logMsg, sizeof(logMsg), "CVController: Input mapping - %zu buttons, trigger %s, %zu axes",
+        m_inputMap.ButtonCount(), m_inputMap.HasTrigger() ? "on" : "off", m_inputMap.AxisCount());
+    VRDriverLog()->Log(logMsg);
     
     VRDriverLog()->Log("CVController: Activate completed successfully!");
     return VRInitError_None;
 }
 
 void CVController::Deactivate() {
+    m_inputReady.store(false, std::memory_order_release);
     m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
+    m_posePipeline.SetDeviceIndex(m_unObjectId);
 }
 
 void CVController::EnterStandby() {}
@@ -108,111 +170,50 @@ void* CVController::GetComponent(const char* pchComponentNameAndVersion) {
 
 void CVController::DebugRequest(const char* pchRequest, char* pchResponseBuffer, 
                          uint32_t unResponseBufferSize) {
-    if (unResponseBufferSize >= 1) {
-        pchResponseBuffer[0] = 0;
-    }
-}
-
-vr::DriverPose_t CVController::GetPose() {
-    std::lock_guard<std::mutex> lock(m_poseMutex);
-    return m_pose;
-}
-
-void CVController::RunFrame() {
-    // КРИТИЧЕСКИ ВАЖНО! Отправляем обновления позы в SteamVR каждый кадр
-    if (m_unObjectId != vr::k_unTrackedDeviceIndexInvalid) {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        VRServerDriverHost()->TrackedDevicePoseUpdated(m_unObjectId, m_pose, sizeof(DriverPose_t));
-    }
-}
-
-void CVController::UpdateFromArduino(const ControllerData& data) {
-    if (data.controller_id != m_expectedControllerId) {
+    // Телеметрия и задержка интерполяции - команды позы
+    DebugCommand command;
+    if (ParseDebugCommand(pchRequest, command) &&
+        m_posePipeline.HandleDebugCommand(command, pchResponseBuffer, unResponseBufferSize)) {
         return;
     }
     
-    {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        
-        // Обновляем ориентацию
-        m_pose.qRotation.w = data.quat_w;
-        m_pose.qRotation.x = data.quat_x;
-        m_pose.qRotation.y = data.quat_y;
-        m_pose.qRotation.z = data.quat_z;
-        
-        // ИСПРАВЛЕНИЕ: accel содержит ПОЗИЦИЮ, а не ускорение!
-        // Напрямую используем данные как позицию
-        m_pose.vecPosition[0] = data.accel_x;
-        m_pose.vecPosition[1] = data.accel_y;
-        m_pose.vecPosition[2] = data.accel_z;
-        
-        // Обновляем угловую скорость из гироскопа
-        m_pose.vecAngularVelocity[0] = data.gyro_x;
-        m_pose.vecAngularVelocity[1] = data.gyro_y;
-        m_pose.vecAngularVelocity[2] = data.gyro_z;
-        
-        // Обнуляем линейную скорость, так как мы используем прямое позиционирование
-        m_pose.vecVelocity[0] = 0.0;
-        m_pose.vecVelocity[1] = 0.0;
-        m_pose.vecVelocity[2] = 0.0;
-        
-        m_pose.poseIsValid = true;
-        m_pose.result = TrackingResult_Running_OK;
-        m_pose.deviceIsConnected = true;
-        
-        m_lastUpdateTime = std::chrono::steady_clock::now();
-        
-        // ОТЛАДОЧНЫЙ ВЫВОД каждые 100 обновлений
-        static int updateCounter = 0;
-        updateCounter++;
-        if (updateCounter % 100 == 0) {
-            char logMsg[512];
-            snprintf(logMsg, sizeof(logMsg), 
-                "Controller %d: Pos(%.3f, %.3f, %.3f) Quat(%.3f, %.3f, %.3f, %.3f)",
-                (int)data.controller_id,
-                m_pose.vecPosition[0], m_pose.vecPosition[1], m_pose.vecPosition[2],
-                m_pose.qRotation.w, m_pose.qRotation.x, m_pose.qRotation.y, m_pose.qRotation.z);
-            VRDriverLog()->Log(logMsg);
-        }
+    if (unResponseBufferSize >= 1) {
+        pchResponseBuffer[0] = 0;
     }
-    
-    // Обновляем состояние кнопок
-    UpdateButtonState(data.buttons, data.trigger);
 }
 
-void CVController::CheckConnection() {
-    auto now = std::chrono::steady_clock::now();
-    float time_since_update = std::chrono::duration<float>(now - m_lastUpdateTime).count();
-    
-    if (time_since_update > 1.0f) {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        m_pose.deviceIsConnected = false;
-        m_pose.poseIsValid = false;
+void CVController::UpdateFromSample(const CoalescedSample& sample) {
+    // Поза: калибровка, фильтр, MotionModel, публикация и немедленная отправка
+    const ControllerData& data = sample.latest;
+    auto sampleTime = m_posePipeline.Update(sample);
+    
+    // Обновляем состояние кнопок: воспроизводим все фронты пачки,
+    // чтобы клик между двумя позами не потерялся. Событие датируется
+    // временем сэмпла: fTimeOffset отрицательный, не старше kMaxInputAgeSec
+    auto inputNow = std::chrono::steady_clock::now();
+    double timeOffset = -std::chrono::duration<double>(inputNow - sampleTime).count();
+    if (timeOffset > 0.0) timeOffset = 0.0;
+    if (timeOffset < -kMaxInputAgeSec) timeOffset = -kMaxInputAgeSec;
+    
+    uint16_t states[3];
+    int stateCount = ExpandButtonEdges(m_lastButtons, sample, states);
+    for (int i = 0; i < stateCount; i++) {
+        UpdateButtonState(states[i], data.trigger, inputNow, timeOffset);
     }
+    if (stateCount == 0) {
+        // Кнопки не менялись - обновляем только аналоговый триггер
+        // (и повтор раз в InputChangeFilter::kKeepAlive)
+        UpdateButtonState(m_lastButtons, data.trigger, inputNow, timeOffset);
+    }
+    m_lastButtons = data.buttons;
 }
 
-void CVController::UpdateButtonState(uint16_t buttons, uint8_t trigger) {
-    if (m_unObjectId == vr::k_unTrackedDeviceIndexInvalid) {
+void CVController::UpdateButtonState(uint16_t buttons, uint8_t trigger,
+                                     std::chrono::steady_clock::time_point now, double timeOffset) {
+    if (!m_inputReady.load(std::memory_order_acquire)) {
         return;
     }
     
-    // Обновляем клик триггера
-    VRDriverInput()->UpdateBooleanComponent(m_inputComponentHandles[0], 
-        (buttons & 0x01) != 0, 0);
-    
-    // Обновляем grip
-    VRDriverInput()->UpdateBooleanComponent(m_inputComponentHandles[1], 
-        (buttons & 0x02) != 0, 0);
-    
-    // Обновляем меню приложения
-    VRDriverInput()->UpdateBooleanComponent(m_inputComponentHandles[2], 
-        (buttons & 0x04) != 0, 0);
-    
-    // Обновляем системную кнопку
-    VRDriverInput()->UpdateBooleanComponent(m_inputComponentHandles[3], 
-        (buttons & 0x08) != 0, 0);
-    
-    // Обновляем аналоговое значение триггера
-    VRDriverInput()->UpdateScalarComponent(m_inputComponentHandles[4], 
-        trigger / 255.0f, 0);
+    // Кнопки - только фронты, триггер и оси - при изменении
+    m_inputMap.Apply(buttons, trigger, now, timeOffset, m_inputState);
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+// src/crc32c.cpp
+#include "crc32c.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CVDRIVER_CRC32C_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CVDRIVER_TARGET_SSE42
+#else
+#include <cpuid.h>
+#include <nmmintrin.h>
+// GCC/Clang: инструкция разрешена только в этих функциях, остальной код
+// собирается без -msse4.2 и работает на любом x86
+#define CVDRIVER_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82F63B78;   // отраженный 0x1EDC6F41
+
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32cTables& Tables() {
+    static const Crc32cTables tables;
+    return tables;
+}
+
+#ifdef CVDRIVER_CRC32C_X86
+bool DetectSse42() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ecx & bit_SSE4_2) != 0;
+#endif
+}
+#endif
+
+} // namespace
+
+uint32_t Crc32cTable(const uint8_t* data, size_t size) {
+    const auto& t = Tables().table;
+    uint32_t crc = 0xFFFFFFFF;
+
+    // Slicing-by-8: восемь байт за итерацию через восемь таблиц
+    while (size >= 8) {
+        uint32_t low, high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+              t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^
+              t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+#ifdef CVDRIVER_CRC32C_X86
+
+CVDRIVER_TARGET_SSE42
+uint32_t Crc32cHardware(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+#if defined(_M_X64) || defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t value;
+        memcpy(&value, data, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    while (size >= 4) {
+        uint32_t value;
+        memcpy(&value, data, 4);
+        crc = _mm_crc32_u32(crc, value);
+        data += 4;
+        size -= 4;
+    }
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+bool Crc32cHardwareAvailable() {
+    static const bool available = DetectSse42();
+    return available;
+}
+
+#else
+
+uint32_t Crc32cHardware(const uint8_t* data, size_t size) {
+    return Crc32cTable(data, size);
+}
+
+bool Crc32cHardwareAvailable() {
+    return false;
+}
+
+#endif
+
+uint32_t Crc32c(const uint8_t* data, size_t size) {
+    return Crc32cHardwareAvailable() ? Crc32cHardware(data, size) : Crc32cTable(data, size);
+}
@@ -0,0 +1,18 @@
+// src/crc32c.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli): полином 0x1EDC6F41 (отраженный 0x82F63B78),
+// начальное значение и финальный XOR 0xFFFFFFFF. Контрольное значение
+// для "123456789" - 0xE3069283.
+//
+// На x86 с SSE4.2 считается инструкцией crc32 (8 байт за такт), иначе -
+// таблицами slicing-by-8. Выбор делается один раз по cpuid.
+uint32_t Crc32c(const uint8_t* data, size_t size);
+
+// Реализации по отдельности - для бенчмарка и для проверки друг друга
+uint32_t Crc32cTable(const uint8_t* data, size_t size);
+uint32_t Crc32cHardware(const uint8_t* data, size_t size);   // только если Crc32cHardwareAvailable()
+bool Crc32cHardwareAvailable();
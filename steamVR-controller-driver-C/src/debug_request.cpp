@@ -0,0 +1,47 @@
+// src/debug_request.cpp
+#include "debug_request.h"
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+bool ParseDebugCommand(const char* request, DebugCommand& command) {
+    command.name[0] = 0;
+    command.hasValue = false;
+    command.value = 0.0;
+    if (!request) {
+        return false;
+    }
+
+    while (isspace((unsigned char)*request)) request++;
+
+    size_t length = 0;
+    while (*request && *request != '=' && !isspace((unsigned char)*request)) {
+        if (length + 1 >= sizeof(command.name)) {
+            return false;
+        }
+        command.name[length++] = *request++;
+    }
+    command.name[length] = 0;
+    if (length == 0) {
+        return false;
+    }
+
+    while (isspace((unsigned char)*request) || *request == '=') request++;
+    if (*request) {
+        char* end = nullptr;
+        command.value = strtod(request, &end);
+        command.hasValue = end != request;
+    }
+    return true;
+}
+
+void WriteDebugResponse(char* buffer, uint32_t bufferSize, const char* format, ...) {
+    if (!buffer || bufferSize == 0) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, bufferSize, format, args);
+    va_end(args);
+}
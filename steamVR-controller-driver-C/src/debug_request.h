@@ -0,0 +1,18 @@
+// src/debug_request.h
+#pragma once
+
+#include <cstdint>
+
+// Команда DebugRequest: "name", "name value" или "name=value".
+// Отправляется, например, через vrcmd или веб-консоль SteamVR.
+struct DebugCommand {
+    char name[64];
+    bool hasValue;
+    double value;
+};
+
+// Возвращает false для пустой или слишком длинной команды
+bool ParseDebugCommand(const char* request, DebugCommand& command);
+
+// snprintf в буфер ответа DebugRequest (с учетом нулевого размера)
+void WriteDebugResponse(char* buffer, uint32_t bufferSize, const char* format, ...);
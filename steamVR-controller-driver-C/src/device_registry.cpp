@@ -0,0 +1,124 @@
+// src/device_registry.cpp
+#include "device_registry.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool ParseDeviceType(const std::string& name, DeviceType& type) {
+    static const struct { const char* name; DeviceType type; } kTypes[] = {
+        { "hmd", DeviceType::Hmd },
+        { "left", DeviceType::LeftController },
+        { "right", DeviceType::RightController },
+        { "gyromouse", DeviceType::GyroMouse },
+        { "tracker", DeviceType::Tracker },
+    };
+    for (const auto& entry : kTypes) {
+        if (name == entry.name) {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+const char* DeviceTypeName(DeviceType type) {
+    switch (type) {
+    case DeviceType::Hmd:             return "hmd";
+    case DeviceType::LeftController:  return "left";
+    case DeviceType::RightController: return "right";
+    case DeviceType::GyroMouse:       return "gyromouse";
+    case DeviceType::Tracker:         return "tracker";
+    }
+    return "unknown";
+}
+
+bool ParseDeviceSpecs(const char* text, std::vector<DeviceSpec>& specs, std::string& error) {
+    specs.clear();
+    std::string list = text ? text : "";
+
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find_first_of(";,", start);
+        if (end == std::string::npos) end = list.size();
+        std::string entry = Trim(list.substr(start, end - start));
+        start = end + 1;
+        if (entry.empty()) {
+            continue;
+        }
+
+        // <id>:<type>[:<serial>]
+        size_t first = entry.find(':');
+        size_t second = first == std::string::npos ? std::string::npos : entry.find(':', first + 1);
+        if (first == std::string::npos) {
+            error = "missing type in '" + entry + "'";
+            return false;
+        }
+
+        std::string idText = Trim(entry.substr(0, first));
+        char* idEnd = nullptr;
+        long id = strtol(idText.c_str(), &idEnd, 10);
+        if (idText.empty() || *idEnd != 0 || id < 0 || id >= (long)kMaxTrackedDevices) {
+            error = "bad controller id in '" + entry + "'";
+            return false;
+        }
+
+        DeviceSpec spec;
+        spec.id = static_cast<uint8_t>(id);
+        std::string typeName = Trim(entry.substr(first + 1,
+            second == std::string::npos ? std::string::npos : second - first - 1));
+        if (!ParseDeviceType(typeName, spec.type)) {
+            error = "unknown device type '" + typeName + "'";
+            return false;
+        }
+        if (second != std::string::npos) {
+            spec.serial = Trim(entry.substr(second + 1));
+        }
+
+        for (const DeviceSpec& other : specs) {
+            if (other.id == spec.id) {
+                error = "duplicate controller id in '" + entry + "'";
+                return false;
+            }
+        }
+        specs.push_back(spec);
+    }
+    return true;
+}
+
+DeviceRegistry::DeviceRegistry() : m_count(0), m_requested(0) {
+    for (auto& entry : m_table) {
+        entry.store(nullptr, std::memory_order_relaxed);
+    }
+    m_order.fill(0);
+}
+
+bool DeviceRegistry::Add(uint8_t id, std::unique_ptr<CVDevice> device) {
+    if (id >= kMaxTrackedDevices || m_owned[id] || !device) {
+        return false;
+    }
+    m_owned[id] = std::move(device);
+    m_order[m_count++] = id;
+    // Публикуем для сетевого потока только полностью готовое устройство
+    m_table[id].store(m_owned[id].get(), std::memory_order_release);
+    return true;
+}
+
+void DeviceRegistry::Clear() {
+    for (auto& entry : m_table) {
+        entry.store(nullptr, std::memory_order_relaxed);
+    }
+    for (auto& device : m_owned) {
+        device.reset();
+    }
+    m_count = 0;
+    m_requested.store(0, std::memory_order_relaxed);
+}
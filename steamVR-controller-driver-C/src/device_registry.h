@@ -0,0 +1,83 @@
+// src/device_registry.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "driver.h"
+#include "packet_batch.h"
+
+// Типы устройств, которые можно описать в настройке "devices"
+enum class DeviceType {
+    Hmd,
+    LeftController,
+    RightController,
+    GyroMouse,   // левый контроллер с профилем гиромыши, пакеты MouseControllerData
+    Tracker
+};
+
+// Одно устройство из настройки "devices": "<id>:<type>[:<serial>]"
+struct DeviceSpec {
+    uint8_t id;
+    DeviceType type;
+    std::string serial;   // пусто - серийный номер по умолчанию для типа
+};
+
+const char* DeviceTypeName(DeviceType type);
+
+// Разбирает список вида "0:left;1:right;2:hmd;4:tracker:CV_WAIST".
+// Типы: hmd, left, right, gyromouse, tracker. При ошибке возвращает false
+// и описание в error; specs содержит устройства, разобранные до ошибки.
+bool ParseDeviceSpecs(const char* text, std::vector<DeviceSpec>& specs, std::string& error);
+
+// Устройства драйвера, индексированные по controller_id.
+//
+// Сетевой поток находит устройство за O(1) по предвыделенной таблице
+// указателей, без блокировок. Добавлять устройства можно и после старта
+// (поток кадра): указатель публикуется атомарно, после того как объект
+// полностью построен. Удаляются устройства только при остановке драйвера -
+// SteamVR не умеет убирать устройство, пропавшее устройство просто
+// становится "disconnected" по таймауту.
+class DeviceRegistry {
+public:
+    DeviceRegistry();
+
+    // Поток Init / кадра. false - id занят или вне диапазона.
+    bool Add(uint8_t id, std::unique_ptr<CVDevice> device);
+    bool Contains(uint8_t id) const { return id < kMaxTrackedDevices && m_owned[id] != nullptr; }
+
+    // Поток кадра: устройства в порядке регистрации
+    size_t Count() const { return m_count; }
+    CVDevice& At(size_t index) const { return *m_owned[m_order[index]]; }
+    uint8_t IdAt(size_t index) const { return m_order[index]; }
+
+    // Только после остановки сетевого потока
+    void Clear();
+
+    // Сетевой поток: устройство для controller_id или nullptr
+    CVDevice* Find(uint8_t id) const {
+        return id < kMaxTrackedDevices ? m_table[id].load(std::memory_order_acquire) : nullptr;
+    }
+
+    // Сетевой поток: пришли данные для незарегистрированного id
+    void RequestDevice(uint8_t id) {
+        if (id < kMaxTrackedDevices) {
+            m_requested.fetch_or(1u << id, std::memory_order_relaxed);
+        }
+    }
+    // Поток кадра: забирает накопленные запросы (бит на каждый id)
+    uint32_t TakeRequests() { return m_requested.exchange(0, std::memory_order_relaxed); }
+
+private:
+    static_assert(kMaxTrackedDevices <= 32, "request mask holds one bit per device");
+
+    std::array<std::unique_ptr<CVDevice>, kMaxTrackedDevices> m_owned;
+    std::array<std::atomic<CVDevice*>, kMaxTrackedDevices> m_table;
+    std::array<uint8_t, kMaxTrackedDevices> m_order;
+    size_t m_count;
+    std::atomic<uint32_t> m_requested;
+};
@@ -0,0 +1,277 @@
+// src/device_telemetry.cpp
+#include "device_telemetry.h"
+#include "debug_request.h"
+#include "async_log.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Скачок номера больше этого значения - перезапуск отправителя, а не
+// потеря (как в MotionModel): ~10 с потока на 90 Гц
+constexpr int32_t kRestartGap = 1000;
+// Откат номера после такой паузы потока - тоже перезапуск (как
+// kMaxSampleGapSec в MotionModel): опоздавший пакет столько не живет
+constexpr auto kRestartSilence = std::chrono::milliseconds(250);
+
+// Период вывода телеметрии в лог
+constexpr int kTelemetryLogPeriodSec = 10;
+
+// Сглаживание среднего интервала и дрожания (1/16 - как в RFC 3550)
+constexpr double kIntervalAlpha = 1.0 / 16.0;
+// Интервал длиннее этого - пауза потока, а не дрожание
+constexpr double kMaxJitterIntervalUs = 250000.0;
+
+const char* const kIntervalLabels[kIntervalBuckets] = {
+    "<1", "<2", "<4", "<8", "<16", "<32", "<64", "64+"
+};
+
+size_t IntervalBucket(double intervalMs) {
+    size_t bucket = 0;
+    double upper = 1.0;
+    while (bucket + 1 < kIntervalBuckets && intervalMs >= upper) {
+        bucket++;
+        upper *= 2.0;
+    }
+    return bucket;
+}
+
+// Запись лога за период: форматируется в фоновом потоке лога
+struct TelemetryLogRecord {
+    char name[32];
+    TelemetrySnapshot period;
+};
+
+void FormatTelemetryLog(const void* payload, char* out, size_t size) {
+    const TelemetryLogRecord& record = *static_cast<const TelemetryLogRecord*>(payload);
+    char line[512];
+    FormatTelemetry(record.period, line, sizeof(line));
+    snprintf(out, size, "%s: link - %s", record.name, line);
+}
+
+void StoreMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+PacketOrder SequenceTracker::Track(uint32_t packetNumber, uint64_t sender,
+                                   std::chrono::steady_clock::time_point arrivedAt) {
+    m_counters.received++;
+    if (!m_hasPacket) {
+        m_hasPacket = true;
+        m_highest = packetNumber;
+        m_sender = sender;
+        m_highestAt = arrivedAt;
+        return PacketOrder::InOrder;
+    }
+
+    int32_t dn = static_cast<int32_t>(packetNumber - m_highest);
+    if (dn == 0) {
+        m_counters.duplicates++;
+        return PacketOrder::Duplicate;
+    }
+    bool senderChanged = sender != 0 && m_sender != 0 && sender != m_sender;
+    bool silent = arrivedAt != std::chrono::steady_clock::time_point() &&
+                  m_highestAt != std::chrono::steady_clock::time_point() &&
+                  arrivedAt - m_highestAt > kRestartSilence;
+    if (dn > kRestartGap || dn <= -kRestartGap || (dn < 0 && (senderChanged || silent))) {
+        m_counters.restarts++;
+        m_highest = packetNumber;
+        m_sender = sender;
+        m_highestAt = arrivedAt;
+        return PacketOrder::Restart;
+    }
+    if (dn < 0) {
+        // Пакет был учтен в разрыве как потерянный, но все-таки пришел
+        m_counters.outOfOrder++;
+        if (m_counters.dropped > 0) m_counters.dropped--;
+        return PacketOrder::Late;
+    }
+
+    m_counters.dropped += static_cast<uint64_t>(dn - 1);
+    m_highest = packetNumber;
+    m_sender = sender;
+    m_highestAt = arrivedAt;
+    return PacketOrder::InOrder;
+}
+
+DeviceTelemetry::DeviceTelemetry()
+    : m_received(0), m_dropped(0), m_outOfOrder(0), m_duplicates(0), m_restarts(0),
+      m_checksumFailures(0), m_submitted(0), m_totalLatencyUs(0), m_maxLatencyUs(0),
+      m_periodMaxLatencyUs(0), m_captured(0), m_totalCaptureAgeUs(0), m_maxCaptureAgeUs(0),
+      m_periodMaxCaptureAgeUs(0), m_coasts(0), m_outOfRange(0), m_disconnects(0), m_hasArrival(false),
+      m_meanIntervalUs(0.0), m_jitterUs(0.0),
+      m_periodStart(std::chrono::steady_clock::now()) {
+    for (auto& bucket : m_intervals) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_periodBase = Snapshot();
+}
+
+void DeviceTelemetry::UpdateCounters(const LinkCounters& counters) {
+    m_received.store(counters.received, std::memory_order_relaxed);
+    m_dropped.store(counters.dropped, std::memory_order_relaxed);
+    m_outOfOrder.store(counters.outOfOrder, std::memory_order_relaxed);
+    m_duplicates.store(counters.duplicates, std::memory_order_relaxed);
+    m_restarts.store(counters.restarts, std::memory_order_relaxed);
+    m_checksumFailures.store(counters.checksumFailures, std::memory_order_relaxed);
+}
+
+void DeviceTelemetry::RecordArrival(std::chrono::steady_clock::time_point receivedAt) {
+    if (m_hasArrival) {
+        double intervalUs = std::chrono::duration<double, std::micro>(receivedAt - m_lastArrival).count();
+        m_intervals[IntervalBucket(intervalUs / 1000.0)].fetch_add(1, std::memory_order_relaxed);
+        if (intervalUs < kMaxJitterIntervalUs) {
+            if (m_meanIntervalUs <= 0.0) {
+                m_meanIntervalUs = intervalUs;
+            }
+            m_meanIntervalUs += (intervalUs - m_meanIntervalUs) * kIntervalAlpha;
+            m_jitterUs += (std::fabs(intervalUs - m_meanIntervalUs) - m_jitterUs) * kIntervalAlpha;
+        }
+    }
+    m_hasArrival = true;
+    m_lastArrival = receivedAt;
+}
+
+void DeviceTelemetry::RecordSubmit(double latencyUs) {
+    uint64_t latency = latencyUs > 0.0 ? static_cast<uint64_t>(latencyUs + 0.5) : 0;
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+    m_totalLatencyUs.fetch_add(latency, std::memory_order_relaxed);
+    StoreMax(m_maxLatencyUs, latency);
+    StoreMax(m_periodMaxLatencyUs, latency);
+}
+
+void DeviceTelemetry::RecordCaptureAge(double ageUs) {
+    uint64_t age = ageUs > 0.0 ? static_cast<uint64_t>(ageUs + 0.5) : 0;
+    m_captured.fetch_add(1, std::memory_order_relaxed);
+    m_totalCaptureAgeUs.fetch_add(age, std::memory_order_relaxed);
+    StoreMax(m_maxCaptureAgeUs, age);
+    StoreMax(m_periodMaxCaptureAgeUs, age);
+}
+
+void DeviceTelemetry::RecordCoastState(CoastState state) {
+    switch (state) {
+    case CoastState::Coasting:     m_coasts.fetch_add(1, std::memory_order_relaxed); break;
+    case CoastState::OutOfRange:   m_outOfRange.fetch_add(1, std::memory_order_relaxed); break;
+    case CoastState::Disconnected: m_disconnects.fetch_add(1, std::memory_order_relaxed); break;
+    default: break;
+    }
+}
+
+TelemetrySnapshot DeviceTelemetry::Snapshot() const {
+    TelemetrySnapshot snapshot;
+    snapshot.counters.received = m_received.load(std::memory_order_relaxed);
+    snapshot.counters.dropped = m_dropped.load(std::memory_order_relaxed);
+    snapshot.counters.outOfOrder = m_outOfOrder.load(std::memory_order_relaxed);
+    snapshot.counters.duplicates = m_duplicates.load(std::memory_order_relaxed);
+    snapshot.counters.restarts = m_restarts.load(std::memory_order_relaxed);
+    snapshot.counters.checksumFailures = m_checksumFailures.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kIntervalBuckets; i++) {
+        snapshot.intervals[i] = m_intervals[i].load(std::memory_order_relaxed);
+    }
+    snapshot.submitted = m_submitted.load(std::memory_order_relaxed);
+    snapshot.totalLatencyUs = m_totalLatencyUs.load(std::memory_order_relaxed);
+    snapshot.maxLatencyUs = m_maxLatencyUs.load(std::memory_order_relaxed);
+    snapshot.captured = m_captured.load(std::memory_order_relaxed);
+    snapshot.totalCaptureAgeUs = m_totalCaptureAgeUs.load(std::memory_order_relaxed);
+    snapshot.maxCaptureAgeUs = m_maxCaptureAgeUs.load(std::memory_order_relaxed);
+    snapshot.coasts = m_coasts.load(std::memory_order_relaxed);
+    snapshot.outOfRange = m_outOfRange.load(std::memory_order_relaxed);
+    snapshot.disconnects = m_disconnects.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void DeviceTelemetry::WriteReport(char* buffer, uint32_t bufferSize) const {
+    char line[512];
+    FormatTelemetry(Snapshot(), line, sizeof(line));
+    WriteDebugResponse(buffer, bufferSize, "%s", line);
+}
+
+void DeviceTelemetry::MaybeLog(std::chrono::steady_clock::time_point now) {
+    if (now - m_periodStart < std::chrono::seconds(kTelemetryLogPeriodSec)) {
+        return;
+    }
+
+    TelemetrySnapshot total = Snapshot();
+    uint64_t periodMax = m_periodMaxLatencyUs.exchange(0, std::memory_order_relaxed);
+    uint64_t periodMaxCaptureAge = m_periodMaxCaptureAgeUs.exchange(0, std::memory_order_relaxed);
+
+    // Счетчики за период; молчащее устройство лог не засоряет (кроме
+    // периода, в котором оно пропало)
+    if (total.counters.received != m_periodBase.counters.received ||
+        total.counters.checksumFailures != m_periodBase.counters.checksumFailures ||
+        total.disconnects != m_periodBase.disconnects) {
+        TelemetryLogRecord record;
+        strncpy(record.name, m_name.c_str(), sizeof(record.name) - 1);
+        record.name[sizeof(record.name) - 1] = '\0';
+        TelemetrySnapshot& period = record.period;
+        period.counters.received = total.counters.received - m_periodBase.counters.received;
+        period.counters.dropped = total.counters.dropped - m_periodBase.counters.dropped;
+        period.counters.outOfOrder = total.counters.outOfOrder - m_periodBase.counters.outOfOrder;
+        period.counters.duplicates = total.counters.duplicates - m_periodBase.counters.duplicates;
+        period.counters.restarts = total.counters.restarts - m_periodBase.counters.restarts;
+        period.counters.checksumFailures = total.counters.checksumFailures - m_periodBase.counters.checksumFailures;
+        for (size_t i = 0; i < kIntervalBuckets; i++) {
+            period.intervals[i] = total.intervals[i] - m_periodBase.intervals[i];
+        }
+        period.submitted = total.submitted - m_periodBase.submitted;
+        period.totalLatencyUs = total.totalLatencyUs - m_periodBase.totalLatencyUs;
+        period.maxLatencyUs = periodMax;
+        period.captured = total.captured - m_periodBase.captured;
+        period.totalCaptureAgeUs = total.totalCaptureAgeUs - m_periodBase.totalCaptureAgeUs;
+        period.maxCaptureAgeUs = periodMaxCaptureAge;
+        period.coasts = total.coasts - m_periodBase.coasts;
+        period.outOfRange = total.outOfRange - m_periodBase.outOfRange;
+        period.disconnects = total.disconnects - m_periodBase.disconnects;
+
+        AsyncLog::Instance().WriteRecord(LogCategory::Link, &FormatTelemetryLog, record);
+    }
+
+    m_periodBase = total;
+    m_periodStart = now;
+}
+
+void FormatTelemetry(const TelemetrySnapshot& snapshot, char* buffer, size_t bufferSize) {
+    if (!buffer || bufferSize == 0) {
+        return;
+    }
+
+    const LinkCounters& c = snapshot.counters;
+    int length = snprintf(buffer, bufferSize,
+        "rx %llu drop %llu ooo %llu dup %llu restart %llu crc %llu, interval ms",
+        (unsigned long long)c.received, (unsigned long long)c.dropped,
+        (unsigned long long)c.outOfOrder, (unsigned long long)c.duplicates,
+        (unsigned long long)c.restarts, (unsigned long long)c.checksumFailures);
+
+    for (size_t i = 0; i < kIntervalBuckets && length > 0 && (size_t)length < bufferSize; i++) {
+        length += snprintf(buffer + length, bufferSize - length, " %s:%llu",
+            kIntervalLabels[i], (unsigned long long)snapshot.intervals[i]);
+    }
+
+    if (length > 0 && (size_t)length < bufferSize) {
+        double avgMs = snapshot.submitted > 0
+            ? (double)snapshot.totalLatencyUs / snapshot.submitted / 1000.0 : 0.0;
+        length += snprintf(buffer + length, bufferSize - length, ", submit %llu avg %.2f ms max %.2f ms",
+            (unsigned long long)snapshot.submitted, avgMs, snapshot.maxLatencyUs / 1000.0);
+    }
+
+    // Только для отправителей с метками времени
+    if (snapshot.captured > 0 && length > 0 && (size_t)length < bufferSize) {
+        length += snprintf(buffer + length, bufferSize - length, ", capture->rx avg %.2f ms max %.2f ms",
+            (double)snapshot.totalCaptureAgeUs / snapshot.captured / 1000.0,
+            snapshot.maxCaptureAgeUs / 1000.0);
+    }
+
+    // Только если данные пропадали
+    if ((snapshot.coasts > 0 || snapshot.outOfRange > 0 || snapshot.disconnects > 0) &&
+        length > 0 && (size_t)length < bufferSize) {
+        snprintf(buffer + length, bufferSize - length, ", gaps coast %llu oor %llu lost %llu",
+            (unsigned long long)snapshot.coasts, (unsigned long long)snapshot.outOfRange,
+            (unsigned long long)snapshot.disconnects);
+    }
+}
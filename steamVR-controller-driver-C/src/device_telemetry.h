@@ -0,0 +1,143 @@
+// src/device_telemetry.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "motion_model.h"
+
+// Накопительные счетчики потока пакетов одного устройства
+struct LinkCounters {
+    uint64_t received = 0;           // валидных пакетов, включая отброшенные устаревшие
+    uint64_t dropped = 0;            // не пришли: разрывы packet_number
+    uint64_t outOfOrder = 0;         // пришли после более нового - отброшены
+    uint64_t duplicates = 0;         // повтор последнего packet_number
+    uint64_t restarts = 0;           // перезапуск отправителя (скачок номера)
+    uint64_t checksumFailures = 0;   // legacy-датаграммы с этим controller_id, не прошедшие checksum
+};
+
+// Как пакет лег в последовательность packet_number устройства
+enum class PacketOrder {
+    InOrder,     // новее последнего (в том числе после разрыва)
+    Duplicate,   // тот же номер - применяется: хаб досылает кнопки с тем же номером
+    Late,        // старше последнего - отбрасывается
+    Restart      // большой скачок или откат - отправитель перезапущен
+};
+
+// Сетевой поток: номер последнего пакета устройства между пачками.
+// Пакет, пришедший после более нового, считается устаревшим - кроме
+// отката от другого отправителя или после паузы потока: перезапущенный
+// отправитель снова считает с 0, и ждать, пока номер догонит старый, нельзя.
+class SequenceTracker {
+public:
+    SequenceTracker() : m_hasPacket(false), m_highest(0), m_sender(0) {}
+
+    // sender - адрес:порт отправителя, 0 - неизвестен (общая память);
+    // arrivedAt - время прихода, time_point() - неизвестно
+    PacketOrder Track(uint32_t packetNumber, uint64_t sender = 0,
+                      std::chrono::steady_clock::time_point arrivedAt = std::chrono::steady_clock::time_point());
+    void CountChecksumFailure() { m_counters.checksumFailures++; }
+    const LinkCounters& Counters() const { return m_counters; }
+
+private:
+    bool m_hasPacket;
+    uint32_t m_highest;   // самый новый принятый номер
+    uint64_t m_sender;    // отправитель m_highest
+    std::chrono::steady_clock::time_point m_highestAt;   // когда он пришел
+    LinkCounters m_counters;
+};
+
+// Гистограмма интервалов между сэмплами по степеням двойки:
+// [0,1) [1,2) [2,4) ... [32,64) [64,inf) мс
+constexpr size_t kIntervalBuckets = 8;
+
+// Снимок телеметрии устройства (поля накопительные)
+struct TelemetrySnapshot {
+    LinkCounters counters;
+    uint64_t intervals[kIntervalBuckets];
+    uint64_t submitted;          // поз отправлено в SteamVR впервые
+    uint64_t totalLatencyUs;     // сумма задержек "сэмпл принят -> отправлен"
+    uint64_t maxLatencyUs;
+    uint64_t captured;           // сэмплов со временем захвата (синхронизированные часы)
+    uint64_t totalCaptureAgeUs;  // сумма задержек "захват у отправителя -> прием"
+    uint64_t maxCaptureAgeUs;
+    // Пропадания данных (PredictFramePose): сколько раз поза кадра перешла
+    // в это состояние
+    uint64_t coasts;
+    uint64_t outOfRange;
+    uint64_t disconnects;
+};
+
+// Телеметрия одного устройства для DebugRequest "telemetry" и
+// периодической строки в логе.
+//
+// Пишут сетевой поток (счетчики, интервалы) и оба пути отправки позы
+// (задержка), читать можно из любого потока: поля атомарные, relaxed.
+class DeviceTelemetry {
+public:
+    DeviceTelemetry();
+
+    // Вызывать до старта потоков
+    void SetName(const char* name) { m_name = name; }
+
+    // Сетевой поток
+    void UpdateCounters(const LinkCounters& counters);
+    void RecordArrival(std::chrono::steady_clock::time_point receivedAt);
+    // Задержка "захват у отправителя -> прием драйвером" (сквозная до драйвера)
+    void RecordCaptureAge(double ageUs);
+    // Дрожание интервала прихода: сглаженное отклонение от среднего
+    // интервала, как interarrival jitter RFC 3550
+    double JitterUs() const { return m_jitterUs; }
+
+    // Сетевой поток или поток кадра: поза сэмпла ушла в SteamVR
+    void RecordSubmit(double latencyUs);
+    // Поток кадра: состояние позы кадра сменилось на state
+    void RecordCoastState(CoastState state);
+
+    TelemetrySnapshot Snapshot() const;
+
+    // Ответ на DebugRequest "telemetry": все счетчики с момента запуска
+    void WriteReport(char* buffer, uint32_t bufferSize) const;
+
+    // Поток кадра: раз в период пишет в лог счетчики за период
+    void MaybeLog(std::chrono::steady_clock::time_point now);
+
+private:
+    std::string m_name;
+
+    std::atomic<uint64_t> m_received;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_outOfOrder;
+    std::atomic<uint64_t> m_duplicates;
+    std::atomic<uint64_t> m_restarts;
+    std::atomic<uint64_t> m_checksumFailures;
+    std::atomic<uint64_t> m_intervals[kIntervalBuckets];
+    std::atomic<uint64_t> m_submitted;
+    std::atomic<uint64_t> m_totalLatencyUs;
+    std::atomic<uint64_t> m_maxLatencyUs;
+    std::atomic<uint64_t> m_periodMaxLatencyUs;   // сбрасывает MaybeLog
+    std::atomic<uint64_t> m_captured;
+    std::atomic<uint64_t> m_totalCaptureAgeUs;
+    std::atomic<uint64_t> m_maxCaptureAgeUs;
+    std::atomic<uint64_t> m_periodMaxCaptureAgeUs;   // сбрасывает MaybeLog
+    std::atomic<uint64_t> m_coasts;
+    std::atomic<uint64_t> m_outOfRange;
+    std::atomic<uint64_t> m_disconnects;
+
+    // Сетевой поток
+    bool m_hasArrival;
+    std::chrono::steady_clock::time_point m_lastArrival;
+    double m_meanIntervalUs;
+    double m_jitterUs;
+
+    // Поток кадра
+    std::chrono::steady_clock::time_point m_periodStart;
+    TelemetrySnapshot m_periodBase;
+};
+
+// Компактная строка "rx .. drop .. ooo .. dup .. restart .. crc .., interval ms ..,
+// submit avg .. max ..[, capture->rx avg .. max ..][, gaps coast .. oor .. lost ..]". Максимумы берутся из snapshot как есть.
+void FormatTelemetry(const TelemetrySnapshot& snapshot, char* buffer, size_t bufferSize);
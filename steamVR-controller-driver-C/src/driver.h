@@ -12,25 +12,76 @@
 #include <iostream>
 #include <cstring>
 
-// Структура данных от Arduino контроллера
-#pragma pack(push, 1)
-struct ControllerData {
-    uint8_t controller_id;      // 0 = левый, 1 = правый, 2 = HMD
-    uint32_t packet_number;     // Номер пакета
-    float quat_w, quat_x, quat_y, quat_z;  // Кватернион
-    float accel_x, accel_y, accel_z;       // ПОЗИЦИЯ (не ускорение!)
-    float gyro_x, gyro_y, gyro_z;          // Угловая скорость
-    uint16_t buttons;           // Флаги кнопок
-    uint8_t trigger;            // Значение триггера
-    uint8_t checksum;           // Контрольная сумма
+#include "pose_slot.h"
+#include "motion_model.h"
+#include "pose_submitter.h"
+#include "pose_history.h"
+#include "pose_filter.h"
+#include "pose_pipeline.h"
+#include "packet_format.h"
+#include "device_telemetry.h"
+#include "clock_sync.h"
+#include "shared_ring.h"
+#include "capture_file.h"
+#include "input_mapping.h"
+
+struct CoalescedSample;
+struct DeviceLinkState;
+class PacketBatch;
+class CalibrationStore;
+class RioReceiver;
+
+// Устройство драйвера, получающее данные из сети. Сетевой поток находит
+// его по controller_id в DeviceRegistry, поток кадра вызывает CheckConnection/RunFrame.
+class CVDevice : public vr::ITrackedDeviceServerDriver {
+public:
+    virtual ~CVDevice() = default;
+    
+    // Сетевой поток: применяет слитые за пачку данные устройства
+    virtual void UpdateFromSample(const CoalescedSample& sample) = 0;
+    // Сетевой поток: счетчики потока пакетов устройства (телеметрия)
+    virtual void UpdateLinkCounters(const LinkCounters& counters) = 0;
+    // Сетевой поток: счетчики, дрожание и скорость для подсказки частоты
+    virtual void ReadLinkState(DeviceLinkState& state) const = 0;
+    // Поток кадра: забирает свежую позу и строит позу кадра (с учетом
+    // пропадания данных); now - одно время на весь кадр
+    virtual void CheckConnection(std::chrono::steady_clock::time_point now) = 0;
+    virtual void RunFrame() = 0;
+    
+    // Настройка до старта потоков (интерполяция - из любого потока)
+    virtual void SetPredictionSettings(const PredictionSettings& settings) = 0;
+    virtual void SetFilterSettings(const FilterSettings& settings) = 0;
+    virtual void SetSubmitSettings(const SubmitSettings& settings, const char* name) = 0;
+    virtual void SetInterpolationDelay(float seconds) = 0;
+    // Калибровка по controller_id устройства; store живет дольше сетевого потока
+    virtual void SetCalibration(const CalibrationStore* store, uint8_t id) = 0;
+};
+
+// Чем отличаются контроллеры разных источников (хаб, гиромышь, трекеры):
+// свойства для SteamVR и набор компонентов ввода
+struct ControllerProfile {
+    std::string modelNumber;
+    std::string serialNumber;
+    std::string manufacturer;
+    std::string trackingSystem;
+    std::string renderModel;
+    std::string controllerType;
+    std::string inputProfilePath;
+    vr::ETrackedDeviceClass deviceClass;
+    bool hasTriggerValue;   // аналоговый /input/trigger/value и оси Vive
+    std::string inputMapping;   // раскладка ввода (input_mapping.h), разбирается в Activate
 };
-#pragma pack(pop)
 
-static_assert(sizeof(ControllerData) == 49, "ControllerData size mismatch!");
+// Контроллер из хаба (Android ArUco / Arduino)
+ControllerProfile MakeCVControllerProfile(vr::ETrackedControllerRole role);
+// Гиромышь; driverName - имя драйвера для пути к профилю ввода
+ControllerProfile MakeGyroMouseProfile(vr::ETrackedControllerRole role, const char* driverName);
+// Трекер (пояс, ноги, ...); роль назначается в SteamVR "Manage Trackers"
+ControllerProfile MakeTrackerProfile(const std::string& serialNumber);
 
-class CVController : public vr::ITrackedDeviceServerDriver {
+class CVController : public CVDevice {
 public:
-    CVController(vr::ETrackedControllerRole role, uint8_t expected_id);
+    CVController(vr::ETrackedControllerRole role, const ControllerProfile& profile);
     virtual ~CVController() = default;
     
     // ITrackedDeviceServerDriver методы
@@ -39,36 +90,50 @@ public:
     virtual void EnterStandby() override;
     virtual void* GetComponent(const char* pchComponentNameAndVersion) override;
     virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize) override;
-    virtual vr::DriverPose_t GetPose() override;
+    virtual vr::DriverPose_t GetPose() override { return m_posePipeline.SubmittedPose(); }
     
-    // Наши методы
-    void UpdateFromArduino(const ControllerData& data);
-    void CheckConnection();
-    void RunFrame(); // КРИТИЧЕСКИ ВАЖНО: Отправляет обновления позы в SteamVR каждый кадр
+    // CVDevice методы
+    // Применяет слитые за пачку данные: одна поза + все фронты кнопок
+    virtual void UpdateFromSample(const CoalescedSample& sample) override;
+    virtual void UpdateLinkCounters(const LinkCounters& counters) override { m_posePipeline.UpdateLinkCounters(counters); }
+    virtual void ReadLinkState(DeviceLinkState& state) const override { m_posePipeline.ReadLinkState(state); }
+    virtual void SetPredictionSettings(const PredictionSettings& settings) override { m_posePipeline.SetPredictionSettings(settings); }
+    virtual void SetFilterSettings(const FilterSettings& settings) override { m_posePipeline.SetFilterSettings(settings); }
+    virtual void SetSubmitSettings(const SubmitSettings& settings, const char* name) override {
+        m_posePipeline.SetSubmitSettings(settings, name);
+    }
+    // Задержка воспроизведения для интерполяции (0 - выключено); из любого потока
+    virtual void SetInterpolationDelay(float seconds) override { m_posePipeline.SetInterpolationDelay(seconds); }
+    virtual void SetCalibration(const CalibrationStore* store, uint8_t id) override {
+        m_posePipeline.SetCalibration(store, id);
+    }
+    // Поток кадра: забирает свежую позу и проверяет таймаут
+    virtual void CheckConnection(std::chrono::steady_clock::time_point now) override { m_posePipeline.CheckConnection(now); }
+    // КРИТИЧЕСКИ ВАЖНО: Отправляет обновления позы в SteamVR каждый кадр
+    virtual void RunFrame() override { m_posePipeline.RunFrame(); }
     
 private:
-    void UpdateButtonState(uint16_t buttons, uint8_t trigger);
+    // Отправляет только изменившиеся компоненты; timeOffset - возраст сэмпла (<= 0)
+    void UpdateButtonState(uint16_t buttons, uint8_t trigger,
+                           std::chrono::steady_clock::time_point now, double timeOffset);
     
     vr::ETrackedControllerRole m_role;
-    uint8_t m_expectedControllerId;
+    ControllerProfile m_profile;
     vr::TrackedDeviceIndex_t m_unObjectId;
     vr::PropertyContainerHandle_t m_ulPropertyContainer;
     
-    std::mutex m_poseMutex;
-    vr::DriverPose_t m_pose;
+    DevicePosePipeline m_posePipeline;   // поза: сетевой поток -> SteamVR
     
-    // Хендлы для компонентов ввода (кнопки, триггер и т.д.)
-    vr::VRInputComponentHandle_t m_inputComponentHandles[5]; 
-    // [0] = trigger_click
-    // [1] = grip
-    // [2] = application_menu
-    // [3] = system
-    // [4] = trigger_value (аналоговое значение)
+    // Компоненты ввода по раскладке профиля; строятся в Activate и
+    // публикуются для сетевого потока через m_inputReady
+    InputMap m_inputMap;
+    std::atomic<bool> m_inputReady;
     
-    std::chrono::steady_clock::time_point m_lastUpdateTime;
+    uint16_t m_lastButtons;  // последнее отправленное состояние кнопок (сетевой поток)
+    InputChangeFilter m_inputState;   // сетевой поток: что уже ушло в SteamVR
 };
 
-class CVHeadset : public vr::ITrackedDeviceServerDriver {
+class CVHeadset : public CVDevice {
 public:
     CVHeadset();
     virtual ~CVHeadset() = default;
@@ -79,37 +144,219 @@ public:
     virtual void EnterStandby() override;
     virtual void* GetComponent(const char* pchComponentNameAndVersion) override;
     virtual void DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize) override;
-    virtual vr::DriverPose_t GetPose() override;
+    virtual vr::DriverPose_t GetPose() override { return m_posePipeline.SubmittedPose(); }
     
-    // Наши методы
-    void UpdateFromNetwork(const ControllerData& data);
-    void CheckConnection();
-    void RunFrame();
+    // CVDevice методы
+    // У HMD нет кнопок - нужна только поза из самого нового пакета
+    virtual void UpdateFromSample(const CoalescedSample& sample) override { m_posePipeline.Update(sample); }
+    virtual void UpdateLinkCounters(const LinkCounters& counters) override { m_posePipeline.UpdateLinkCounters(counters); }
+    virtual void ReadLinkState(DeviceLinkState& state) const override { m_posePipeline.ReadLinkState(state); }
+    virtual void SetPredictionSettings(const PredictionSettings& settings) override { m_posePipeline.SetPredictionSettings(settings); }
+    virtual void SetFilterSettings(const FilterSettings& settings) override { m_posePipeline.SetFilterSettings(settings); }
+    virtual void SetSubmitSettings(const SubmitSettings& settings, const char* name) override {
+        m_posePipeline.SetSubmitSettings(settings, name);
+    }
+    // Задержка воспроизведения для интерполяции (0 - выключено); из любого потока
+    virtual void SetInterpolationDelay(float seconds) override { m_posePipeline.SetInterpolationDelay(seconds); }
+    virtual void SetCalibration(const CalibrationStore* store, uint8_t id) override {
+        m_posePipeline.SetCalibration(store, id);
+    }
+    // Поток кадра: забирает свежую позу и проверяет таймаут
+    virtual void CheckConnection(std::chrono::steady_clock::time_point now) override { m_posePipeline.CheckConnection(now); }
+    virtual void RunFrame() override { m_posePipeline.RunFrame(); }
     
 private:
     vr::TrackedDeviceIndex_t m_unObjectId;
     std::string m_sSerialNumber;
     std::string m_sModelNumber;
     
-    std::mutex m_poseMutex;
-    vr::DriverPose_t m_pose;
-    
-    std::chrono::steady_clock::time_point m_lastUpdateTime;
+    DevicePosePipeline m_posePipeline;   // поза: сетевой поток -> SteamVR
+};
+
+// Результат одной попытки чтения из сокета
+enum class ReceiveStatus {
+    Ok,         // принят валидный пакет
+    Invalid,    // датаграмма прочитана, но отброшена (размер/checksum), учтена в пачке
+    Empty       // очередь сокета пуста - можно снова ждать
+};
+
+// Сколько UDP-портов может слушать один NetworkClient
+constexpr size_t kMaxListenPorts = 4;
+
+// Куда идут пакеты порта
+enum class PortRole {
+    Devices,     // готовые позы устройств (хаб, гиромышь, симуляторы)
+    NativeHub    // сырые маркеры телефона для встроенного хаба (native_hub.h)
+};
+// Сколько отправителей с метками времени синхронизируется одновременно
+constexpr size_t kMaxClockSources = 8;
+// Размер таблицы отправителей по controller_id (не меньше kMaxTrackedDevices)
+constexpr size_t kMaxSenderPins = 32;
+
+// Адрес отправителя записей устройства и сокет, на который они пришли
+struct SenderAddress {
+    uint32_t address = 0;   // IPv4, сетевой порядок байт
+    uint16_t port = 0;      // сетевой порядок байт
+    size_t socketIndex = 0;
 };
 
+// Прием датаграмм со всех портов драйвера в одном потоке: все сокеты
+// сигналят одно событие, формат определяется по содержимому (packet_format.h).
+// Отправители на этой же машине могут писать в кольцо общей памяти
+// (shared_ring.h) - его записи попадают в ту же пачку, что и датаграммы.
+// С SetRegisteredIo датаграммы забираются пачками через RIO (rio_receiver.h),
+// а не по одной через recvfrom; разбор и дальнейший путь те же.
 class NetworkClient {
 public:
-    NetworkClient(uint16_t port = 5555);
+    NetworkClient();
     ~NetworkClient();
     
+    // Добавляет порт для прослушивания; вызывать до Start().
+    // false - портов слишком много или порт уже добавлен с другой ролью.
+    bool AddPort(uint16_t port, PortRole role = PortRole::Devices);
+    void SetDecodeOptions(const DecodeOptions& options) { m_decodeOptions = options; }
+    // Имя кольца общей памяти для локальных отправителей; вызывать до
+    // Start(). Пусто - только UDP.
+    void SetSharedRing(const std::string& name) { m_sharedRingName = name; }
+    // Прием через Registered I/O (rio_receiver.h) вместо recvfrom; вызывать
+    // до Start(). RIO недоступен - Start() остается на обычных сокетах.
+    void SetRegisteredIo(bool enabled) { m_registeredIoRequested = enabled; }
+    // Закрепить за controller_id первого отправителя: записи того же id с
+    // другого адреса отбрасываются, пока закрепленный не замолчит
+    void SetPinSenders(bool enabled) { m_pinSenders = enabled; }
+    // Записывать все принятое в файл (capture_file.h); вызывать до Start().
+    // Пусто - без записи.
+    void SetCaptureFile(const std::string& path) { m_capturePath = path; }
+    
+    // Кольцо общей памяти не открылось - не ошибка: остается UDP
     bool Start();
     void Stop();
-    bool Receive(ControllerData& data);
+    bool SharedRingOpen() const { return m_sharedRing.IsOpen(); }
+    bool RegisteredIoActive() const;
+    // RIO запрошен, но не запустился: что не удалось, для лога
+    const std::string& RegisteredIoError() const { return m_registeredIoError; }
+    bool CaptureOpen() const { return m_capture.IsOpen(); }
+    
+    // Блокируется до прихода данных на любой порт, вызова Wake() или
+    // истечения таймаута. Возвращает true, если есть данные для чтения.
+    bool WaitForData(uint32_t timeoutMs);
+    // Будит поток, ожидающий в WaitForData (используется при остановке)
+    void Wake();
+    // Вычитывает до maxDatagrams ожидающих датаграмм со всех портов в batch,
+    // пакеты портов PortRole::NativeHub - в hubBatch (без него - в batch),
+    // и еще до maxDatagrams записей кольца общей памяти - в batch.
+    // Возвращает число прочитанных датаграмм и записей (включая отброшенные).
+    size_t ReceiveBatch(PacketBatch& batch, size_t maxDatagrams, PacketBatch* hubBatch = nullptr);
+    
+    // Воспроизведение записи (bench/replay.cpp) без Start и сокетов: тот же
+    // разбор, что у принятой датаграммы от address:port на порт index или у
+    // записи кольца. now - время прихода из записи. Порты и роли - через AddPort.
+    ReceiveStatus ReplayDatagram(size_t index, const uint8_t* data, size_t size, uint32_t address,
+                                 uint16_t port, std::chrono::steady_clock::time_point now,
+                                 PacketBatch& batch);
+    void ReplaySharedRingRecord(const ControllerData& data, uint8_t flags,
+                                std::chrono::steady_clock::time_point capturedAt,
+                                std::chrono::steady_clock::time_point now, PacketBatch& batch);
+    // Запрос часов, отправленный тогда отправителю address:port: ответы на
+    // него принимаются так же, как при записи (сам запрос не шлется)
+    void ReplayClockRequest(uint32_t address, uint16_t port, std::chrono::steady_clock::time_point now);
+    
+    // Сетевой поток, после каждого пробуждения: шлет запросы синхронизации
+    // часов отправителям, чьи пакеты несут время захвата
+    void PollClockSync(std::chrono::steady_clock::time_point now);
+    // Забывает отправителей, замолчавших дольше таймаута (часть PollClockSync)
+    void ExpireClockSources(std::chrono::steady_clock::time_point now);
+    // Сетевой поток: кто последним прислал записи controller_id на порт
+    // PortRole::Devices. false - никто в пределах таймаута закрепления
+    // (или только через кольцо общей памяти).
+    bool SenderOf(uint8_t id, std::chrono::steady_clock::time_point now, SenderAddress& sender) const;
+    // Сетевой поток: подсказка частоты отправителю (rate_hint.h); номер
+    // подсказки ставится здесь
+    void SendRateHint(const SenderAddress& sender, RateHint hint);
+    // Пишет в лог смещение/дрейф часов каждого отправителя
+    void LogClockSync() const;
+    // Пишет в лог, сколько записей пришло через общую память и сколько
+    // потеряно, сколько отброшено от незакрепленных отправителей и сколько
+    // записано в файл записи
+    void LogTransportStats();
     
 private:
-    bool VerifyChecksum(const ControllerData& data);
+    // Отправитель с метками времени (адрес + порт, с которого он шлет)
+    struct ClockSource {
+        bool active = false;
+        uint32_t address = 0;   // IPv4, сетевой порядок байт
+        uint16_t port = 0;      // сетевой порядок байт
+        size_t socketIndex = 0; // через этот сокет шлем запросы
+        ClockSync clock;
+        uint32_t nextSequence = 0;
+        uint32_t requestsSent = 0;
+        uint32_t repliesReceived = 0;
+        std::chrono::steady_clock::time_point lastSeen;
+        std::chrono::steady_clock::time_point nextRequest;
+    };
+    
+    // Последний отправитель записей controller_id
+    struct SenderPin {
+        bool valid = false;
+        uint32_t address = 0;   // IPv4, сетевой порядок байт
+        uint16_t port = 0;      // сетевой порядок байт
+        size_t socketIndex = 0;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+    
+    // Неблокирующее чтение одной датаграммы из сокета index
+    ReceiveStatus Receive(size_t index, PacketBatch& batch);
+    // Разбор датаграммы от address:port, пришедшей на сокет index (общий для
+    // recvfrom и RIO)
+    ReceiveStatus ProcessDatagram(size_t index, const uint8_t* data, size_t size,
+                                  uint32_t address, uint16_t port,
+                                  std::chrono::steady_clock::time_point now, PacketBatch& batch);
+    // Запись кольца в batch (гиромышь - со сдвигом controller_id)
+    void AddSharedRingRecord(const ControllerData& data, uint8_t flags,
+                             std::chrono::steady_clock::time_point capturedAt,
+                             std::chrono::steady_clock::time_point now, PacketBatch& batch);
+    void CaptureDatagram(size_t index, const uint8_t* data, size_t size, uint32_t address,
+                         uint16_t port, int64_t arrivalUs);
+    // Завершенные приемы RIO (до max) в batch/hubBatch; возвращает их число
+    size_t ReceiveRegisteredIo(PacketBatch& batch, size_t max, PacketBatch* hubBatch);
+    // Запоминает отправителя записи id; false - id закреплен за другим
+    bool AcceptSender(uint8_t id, uint32_t address, uint16_t port, size_t socketIndex,
+                      std::chrono::steady_clock::time_point now);
+    // Записи кольца общей памяти (до max) в batch; возвращает их число
+    size_t ReceiveSharedRing(PacketBatch& batch, size_t max);
+    void CloseSockets();
+    // create - завести запись, если отправителя нет (nullptr, если таблица полна)
+    ClockSource* FindClockSource(uint32_t address, uint16_t port, size_t socketIndex, bool create,
+                                 std::chrono::steady_clock::time_point now);
+    // Запрос отправлен: следующий номер и время следующего запроса
+    void AdvanceClockRequest(ClockSource& source, std::chrono::steady_clock::time_point now);
     
-    uint16_t m_port;
-    void* m_socket;
+    std::array<uint16_t, kMaxListenPorts> m_ports;
+    std::array<PortRole, kMaxListenPorts> m_roles;
+    std::array<void*, kMaxListenPorts> m_sockets;
+    size_t m_portCount;
+    DecodeOptions m_decodeOptions;
+    void* m_readEvent;   // WSAEVENT, сигналится по FD_READ любого сокета
+    void* m_wakeEvent;   // WSAEVENT для пробуждения при остановке
     std::atomic<bool> m_running;
+    std::array<ClockSource, kMaxClockSources> m_clockSources;   // сетевой поток
+    
+    std::string m_sharedRingName;
+    SharedRingReader m_sharedRing;
+    uint64_t m_sharedRingRecords = 0;    // с прошлого LogSharedRing
+    uint32_t m_sharedRingDropped = 0;    // dropped кольца на прошлом LogSharedRing
+    uint32_t m_sharedRingSkipped = 0;
+    
+    bool m_registeredIoRequested = false;
+    std::unique_ptr<RioReceiver> m_rio;   // есть, только пока RIO запущен
+    std::string m_registeredIoError;
+    bool m_pinSenders = false;
+    std::array<SenderPin, kMaxSenderPins> m_senderPins;   // сетевой поток
+    uint64_t m_foreignRecords = 0;   // отброшено закреплением, с прошлого LogTransportStats
+    uint32_t m_rateHintSequence = 0;
+    
+    std::string m_capturePath;
+    CaptureWriter m_capture;   // сетевой поток
+    uint32_t m_wakeup = 0;     // номер ReceiveBatch для записи
+    uint64_t m_captureLoggedRecords = 0;
 };
\ No newline at end of file
@@ -0,0 +1,161 @@
+// src/driver_settings.cpp
+#include "driver_settings.h"
+#include <openvr_driver.h>
+#include <algorithm>
+#include <string>
+
+using namespace vr;
+
+namespace {
+
+bool GetBoolSetting(const char* section, const char* key, bool defaultValue) {
+    EVRSettingsError error = VRSettingsError_None;
+    bool value = VRSettings()->GetBool(section, key, &error);
+    return error == VRSettingsError_None ? value : defaultValue;
+}
+
+float GetFloatSetting(const char* section, const char* key, float defaultValue) {
+    EVRSettingsError error = VRSettingsError_None;
+    float value = VRSettings()->GetFloat(section, key, &error);
+    return error == VRSettingsError_None ? value : defaultValue;
+}
+
+int32_t GetIntSetting(const char* section, const char* key, int32_t defaultValue) {
+    EVRSettingsError error = VRSettingsError_None;
+    int32_t value = VRSettings()->GetInt32(section, key, &error);
+    return error == VRSettingsError_None ? value : defaultValue;
+}
+
+// Значение "<key>_<device>_<id>", если задано, иначе "<key>_<device>",
+// иначе "<key>", иначе defaultValue. Незаданный ключ - это отсутствующий
+// ключ: в default.vrsettings переопределений по устройству нет.
+bool GetDeviceBoolSetting(const char* section, const char* key, const char* device, uint8_t id, bool defaultValue) {
+    std::string deviceKey = std::string(key) + "_" + device;
+    std::string idKey = deviceKey + "_" + std::to_string(id);
+    bool value = GetBoolSetting(section, key, defaultValue);
+    value = GetBoolSetting(section, deviceKey.c_str(), value);
+    return GetBoolSetting(section, idKey.c_str(), value);
+}
+
+float GetDeviceFloatSetting(const char* section, const char* key, const char* device, uint8_t id, float defaultValue) {
+    std::string deviceKey = std::string(key) + "_" + device;
+    std::string idKey = deviceKey + "_" + std::to_string(id);
+    float value = GetFloatSetting(section, key, defaultValue);
+    value = GetFloatSetting(section, deviceKey.c_str(), value);
+    return GetFloatSetting(section, idKey.c_str(), value);
+}
+
+std::string GetStringSetting(const char* section, const char* key, const std::string& defaultValue) {
+    EVRSettingsError error = VRSettingsError_None;
+    char value[1024] = {};
+    VRSettings()->GetString(section, key, value, sizeof(value), &error);
+    return error == VRSettingsError_None ? std::string(value) : defaultValue;
+}
+
+} // namespace
+
+DriverSettings LoadDriverSettings(const char* section) {
+    DriverSettings settings;
+
+#ifdef CVDRIVER_PRESET_GYROMOUSE
+    // Отдельная сборка gyromouse: только гиромышь, как прежний драйвер
+    settings.hubDevicesEnabled = false;
+    settings.gyroMouseEnabled = true;
+    settings.gyroMouseDeviceId = 0;
+#endif
+
+    settings.hubDevicesEnabled = GetBoolSetting(section, "hub_devices_enable", settings.hubDevicesEnabled);
+    settings.hubPort = static_cast<uint16_t>(GetIntSetting(section, "hub_port", settings.hubPort));
+    settings.gyroMouseEnabled = GetBoolSetting(section, "gyromouse_enable", settings.gyroMouseEnabled);
+    settings.gyroMousePort = static_cast<uint16_t>(GetIntSetting(section, "gyromouse_port", settings.gyroMousePort));
+    settings.gyroMouseDeviceId = static_cast<uint8_t>(GetIntSetting(section,
+        "gyromouse_device_id", settings.gyroMouseDeviceId));
+    settings.devices = GetStringSetting(section, "devices", settings.devices);
+    settings.autoAddTrackers = GetBoolSetting(section, "auto_add_trackers", settings.autoAddTrackers);
+    settings.sharedMemoryName = GetStringSetting(section, "shared_memory_name", settings.sharedMemoryName);
+    settings.registeredIo = GetBoolSetting(section, "registered_io", settings.registeredIo);
+    settings.pinSenders = GetBoolSetting(section, "pin_senders", settings.pinSenders);
+    settings.captureFile = GetStringSetting(section, "capture_file", settings.captureFile);
+
+    RateHintSettings& hints = settings.rateHints;
+    hints.enabled = GetBoolSetting(section, "rate_hints", hints.enabled);
+    hints.idleHz = std::max(1.0f, GetFloatSetting(section, "rate_hint_idle_hz", hints.idleHz));
+    hints.maxHz = std::max(0.0f, GetFloatSetting(section, "rate_hint_max_hz", hints.maxHz));
+
+    IoThreadSettings& io = settings.ioThread;
+    io.mmcssTask = GetStringSetting(section, "io_thread_mmcss", io.mmcssTask);
+    io.priority = GetStringSetting(section, "io_thread_priority", io.priority);
+    io.core = GetIntSetting(section, "io_thread_core", io.core);
+    io.timerResolutionMs = static_cast<uint32_t>(std::max(0, GetIntSetting(section,
+        "timer_resolution_ms", static_cast<int32_t>(io.timerResolutionMs))));
+
+    settings.prediction.extrapolateInDriver = GetBoolSetting(section,
+        "extrapolate_in_driver", settings.prediction.extrapolateInDriver);
+    settings.prediction.predictionSec = GetFloatSetting(section,
+        "prediction_ms", settings.prediction.predictionSec * 1000.0f) / 1000.0f;
+    settings.prediction.maxExtrapolationSec = GetFloatSetting(section,
+        "max_extrapolation_ms", settings.prediction.maxExtrapolationSec * 1000.0f) / 1000.0f;
+    // Пропадание данных: coast <= disconnect, иначе окна затухания нет
+    PredictionSettings& prediction = settings.prediction;
+    prediction.disconnectSec = std::max(0.0f, GetFloatSetting(section,
+        "disconnect_ms", prediction.disconnectSec * 1000.0f) / 1000.0f);
+    prediction.coastSec = std::min(prediction.disconnectSec, std::max(0.0f, GetFloatSetting(section,
+        "coast_ms", prediction.coastSec * 1000.0f) / 1000.0f));
+    prediction.coastDecaySec = std::max(0.0f, GetFloatSetting(section,
+        "coast_decay_ms", prediction.coastDecaySec * 1000.0f) / 1000.0f);
+
+    settings.submit.immediate = GetBoolSetting(section,
+        "immediate_submit", settings.submit.immediate);
+    settings.submit.maxRateHz = GetFloatSetting(section,
+        "immediate_submit_max_hz", settings.submit.maxRateHz);
+
+    settings.interpolationDelaySec = GetFloatSetting(section,
+        "interpolation_delay_ms", settings.interpolationDelaySec * 1000.0f) / 1000.0f;
+
+    settings.calibrationFile = GetStringSetting(section, "calibration_file", settings.calibrationFile);
+
+    NativeHubSettings& hub = settings.nativeHub;
+    hub.enabled = GetBoolSetting(section, "native_hub_enable", hub.enabled);
+    hub.port = static_cast<uint16_t>(GetIntSetting(section, "native_hub_port", hub.port));
+    hub.configFile = GetStringSetting(section, "native_hub_config", hub.configFile);
+    hub.orientation = GetStringSetting(section, "native_hub_orientation", hub.orientation);
+    FusionSettings& fusion = hub.fusion;
+    fusion.orientationTimeConstantSec = GetFloatSetting(section,
+        "native_hub_fusion_ms", static_cast<float>(fusion.orientationTimeConstantSec * 1000.0)) / 1000.0;
+    fusion.positionNoiseM = GetFloatSetting(section,
+        "native_hub_position_noise_mm", static_cast<float>(fusion.positionNoiseM * 1000.0)) / 1000.0;
+    fusion.accelerationNoise = GetFloatSetting(section,
+        "native_hub_accel_noise", static_cast<float>(fusion.accelerationNoise));
+    fusion.maxPredictionSec = GetFloatSetting(section,
+        "native_hub_max_prediction_ms", static_cast<float>(fusion.maxPredictionSec * 1000.0)) / 1000.0;
+
+    return settings;
+}
+
+SubmitSettings LoadSubmitSettings(const char* section, const char* device, const SubmitSettings& defaults) {
+    SubmitSettings settings = defaults;
+    std::string key = std::string("immediate_submit_") + device;
+    settings.immediate = GetBoolSetting(section, key.c_str(), defaults.immediate);
+    return settings;
+}
+
+FilterSettings LoadFilterSettings(const char* section, const char* device, uint8_t id) {
+    FilterSettings settings;
+
+    settings.enabled = GetDeviceBoolSetting(section, "filter_enable", device, id, settings.enabled);
+    settings.minCutoffHz = GetDeviceFloatSetting(section, "filter_min_cutoff", device, id, settings.minCutoffHz);
+    settings.beta = GetDeviceFloatSetting(section, "filter_beta", device, id, settings.beta);
+    settings.derivativeCutoffHz = GetDeviceFloatSetting(section, "filter_d_cutoff", device, id,
+        settings.derivativeCutoffHz);
+    settings.rotationMinCutoffHz = GetDeviceFloatSetting(section, "filter_rot_min_cutoff", device, id,
+        settings.rotationMinCutoffHz);
+    settings.rotationBeta = GetDeviceFloatSetting(section, "filter_rot_beta", device, id, settings.rotationBeta);
+
+    return settings;
+}
+
+std::string LoadInputMapping(const char* section, const char* device, const std::string& defaultMapping) {
+    std::string key = std::string("input_mapping_") + device;
+    std::string mapping = GetStringSetting(section, key.c_str(), defaultMapping);
+    return mapping.empty() ? defaultMapping : mapping;
+}
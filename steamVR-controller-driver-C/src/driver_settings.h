@@ -0,0 +1,76 @@
+// src/driver_settings.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "motion_model.h"
+#include "pose_submitter.h"
+#include "pose_filter.h"
+#include "native_hub.h"
+#include "thread_scheduling.h"
+#include "rate_hint.h"
+
+// Один и тот же код собирается как cvdriver и как gyromouse
+// (steamVR-controller-fromGyroMouse/CMakeLists.txt задает CVDRIVER_PRESET_GYROMOUSE).
+// Пресет меняет только имя драйвера и значения настроек по умолчанию.
+#ifdef CVDRIVER_PRESET_GYROMOUSE
+constexpr const char* kDriverName = "gyromouse";
+constexpr const char* kDriverSettingsSection = "driver_gyromouse";
+#else
+constexpr const char* kDriverName = "cvdriver";
+constexpr const char* kDriverSettingsSection = "driver_cvdriver";
+#endif
+
+// Настройки драйвера из секции vrsettings (resources/settings/default.vrsettings)
+struct DriverSettings {
+    // Источники данных: все порты обслуживает один сетевой поток
+    bool hubDevicesEnabled = true;    // HMD и два контроллера хаба (ControllerData)
+    uint16_t hubPort = 5555;
+    bool gyroMouseEnabled = false;    // контроллер гиромыши (MouseControllerData)
+    uint16_t gyroMousePort = 5556;
+    uint8_t gyroMouseDeviceId = 3;    // controller_id, под которым гиромышь видна драйверу
+    // Явный список устройств "id:type[:serial];..." (device_registry.h).
+    // Пусто - список строится из hub_devices_enable / gyromouse_enable.
+    std::string devices;
+    bool autoAddTrackers = false;     // неизвестный controller_id на порту хаба -> новый трекер
+    // Кольцо общей памяти для отправителей на этой же машине (shared_ring.h),
+    // принимается наравне с UDP. Пусто - только UDP.
+    std::string sharedMemoryName = std::string("Local\\") + kDriverName + "_input";
+    // Прием UDP через Registered I/O (Windows 8+) - для 8-10 устройств
+    bool registeredIo = false;
+    // controller_id закрепляется за первым отправителем (network_client.cpp)
+    bool pinSenders = false;
+    // Запись всех принятых пакетов (capture_file.h) для bench/replay.cpp;
+    // относительный путь - от папки драйвера. Пусто - без записи.
+    std::string captureFile;
+    // Планирование сетевого потока: MMCSS, приоритет, ядро, разрешение таймера
+    IoThreadSettings ioThread;
+    // Подсказки частоты отправителям (rate_hint.h)
+    RateHintSettings rateHints;
+
+    PredictionSettings prediction;
+    SubmitSettings submit;   // общие для всех устройств, см. LoadSubmitSettings
+    float interpolationDelaySec = 0.0f;   // задержка воспроизведения, 0 - без интерполяции
+    // calibration.json (calibration.h); относительный путь - от папки драйвера.
+    // Пусто - без калибровки в драйвере (ее применяет хаб).
+    std::string calibrationFile;
+    NativeHubSettings nativeHub;   // встроенный хаб вместо Python-хаба
+};
+
+// Читает настройки из секции section; отсутствующие ключи получают значения по умолчанию.
+// Вызывать после VR_INIT_SERVER_DRIVER_CONTEXT.
+DriverSettings LoadDriverSettings(const char* section);
+
+// Настройки отправки позы для одного устройства: ключ "immediate_submit_<device>"
+// переопределяет общий "immediate_submit" из defaults.
+SubmitSettings LoadSubmitSettings(const char* section, const char* device, const SubmitSettings& defaults);
+
+// Параметры фильтра позы для одного устройства: "filter_*_<device>_<id>"
+// (по controller_id, например filter_beta_tracker_5) переопределяет
+// "filter_*_<device>", тот - общий "filter_*".
+FilterSettings LoadFilterSettings(const char* section, const char* device, uint8_t id);
+
+// Раскладка ввода устройства "input_mapping_<device>" (input_mapping.h);
+// пустая строка или отсутствующий ключ - defaultMapping из профиля.
+std::string LoadInputMapping(const char* section, const char* device, const std::string& defaultMapping);
@@ -0,0 +1,250 @@
+// src/fusion_engine.cpp
+#include "fusion_engine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Сглаживание угловой скорости, выведенной из соседних сэмплов гироскопа
+constexpr double kRateSmoothingSec = 0.01;
+// Меньше этого интервала скорость по двум сэмплам не считается
+constexpr double kMinRateIntervalSec = 1e-4;
+
+double Seconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+FusionQuaternion Multiply(const FusionQuaternion& a, const FusionQuaternion& b) {
+    FusionQuaternion q;
+    q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    return q;
+}
+
+FusionQuaternion Conjugate(const FusionQuaternion& q) {
+    FusionQuaternion c;
+    c.w = q.w;
+    c.x = -q.x;
+    c.y = -q.y;
+    c.z = -q.z;
+    return c;
+}
+
+FusionQuaternion Normalize(const FusionQuaternion& q) {
+    double norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    FusionQuaternion n;
+    if (norm < 1e-9) {
+        return n;
+    }
+    n.w = q.w / norm;
+    n.x = q.x / norm;
+    n.y = q.y / norm;
+    n.z = q.z / norm;
+    return n;
+}
+
+// Нормализованная интерполяция по кратчайшей дуге: шаги малы
+FusionQuaternion Nlerp(const FusionQuaternion& a, const FusionQuaternion& b, double t) {
+    double sign = (a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z) < 0.0 ? -1.0 : 1.0;
+    FusionQuaternion q;
+    q.w = a.w + (sign * b.w - a.w) * t;
+    q.x = a.x + (sign * b.x - a.x) * t;
+    q.y = a.y + (sign * b.y - a.y) * t;
+    q.z = a.z + (sign * b.z - a.z) * t;
+    return Normalize(q);
+}
+
+void Rotate(const FusionQuaternion& q, const double v[3], double out[3]) {
+    FusionQuaternion p;
+    p.w = 0.0;
+    p.x = v[0];
+    p.y = v[1];
+    p.z = v[2];
+    FusionQuaternion r = Multiply(Multiply(q, p), Conjugate(q));
+    out[0] = r.x;
+    out[1] = r.y;
+    out[2] = r.z;
+}
+
+// Поворот от a к b (b = d * a) как вектор угла, рад
+void RotationVector(const FusionQuaternion& a, const FusionQuaternion& b, double out[3]) {
+    FusionQuaternion d = Multiply(b, Conjugate(a));
+    if (d.w < 0.0) {
+        d.w = -d.w;
+        d.x = -d.x;
+        d.y = -d.y;
+        d.z = -d.z;
+    }
+    double sinHalf = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    double scale = sinHalf < 1e-9 ? 2.0 : 2.0 * std::atan2(sinHalf, d.w) / sinHalf;
+    out[0] = d.x * scale;
+    out[1] = d.y * scale;
+    out[2] = d.z * scale;
+}
+
+} // namespace
+
+void FusionEngine::Reset() {
+    m_gyroHead = 0;
+    m_gyroCount = 0;
+    m_hasAngularVelocity = false;
+    m_hasCorrection = false;
+    m_correction = FusionQuaternion();
+    m_hasFix = false;
+    m_fixRotation = FusionQuaternion();
+    for (int i = 0; i < 3; i++) {
+        m_angularVelocity[i] = 0.0;
+        m_position[i] = 0.0;
+        m_velocity[i] = 0.0;
+        m_pp[i] = m_pv[i] = m_vv[i] = 0.0;
+    }
+}
+
+void FusionEngine::AddGyro(const FusionQuaternion& orientation, Clock::time_point t) {
+    FusionQuaternion q = Normalize(orientation);
+
+    if (m_gyroCount > 0) {
+        const GyroSample& newest = m_gyro[m_gyroHead];
+        double dt = Seconds(t - newest.time);
+        if (dt < 0.0) {
+            return;   // старше уже принятого
+        }
+        if (dt < kMinRateIntervalSec) {
+            // Тот же момент (пачка без меток времени) - только обновляем
+            m_gyro[m_gyroHead].orientation = q;
+            return;
+        }
+
+        double rate[3];
+        RotationVector(newest.orientation, q, rate);
+        double alpha = m_hasAngularVelocity ? 1.0 - std::exp(-dt / kRateSmoothingSec) : 1.0;
+        for (int i = 0; i < 3; i++) {
+            m_angularVelocity[i] += (rate[i] / dt - m_angularVelocity[i]) * alpha;
+        }
+        m_hasAngularVelocity = true;
+
+        m_gyroHead = (m_gyroHead + 1) % kGyroHistory;
+    }
+    m_gyro[m_gyroHead] = { q, t };
+    if (m_gyroCount < kGyroHistory) {
+        m_gyroCount++;
+    }
+}
+
+FusionQuaternion FusionEngine::GyroAt(Clock::time_point t) const {
+    // От нового к старому: первый сэмпл не позже t и следующий за ним
+    size_t newer = m_gyroHead;
+    for (size_t n = 0; n < m_gyroCount; n++) {
+        size_t index = (m_gyroHead + kGyroHistory - n) % kGyroHistory;
+        const GyroSample& sample = m_gyro[index];
+        if (sample.time <= t) {
+            if (n == 0) {
+                return sample.orientation;   // t новее всей истории
+            }
+            const GyroSample& next = m_gyro[newer];
+            double span = Seconds(next.time - sample.time);
+            double k = span > 0.0 ? Seconds(t - sample.time) / span : 0.0;
+            return Nlerp(sample.orientation, next.orientation, k);
+        }
+        newer = index;
+    }
+    // t старше всей истории - ближайший имеющийся
+    return m_gyro[newer].orientation;
+}
+
+void FusionEngine::UpdatePosition(const double position[3], double dt) {
+    double r = m_settings.positionNoiseM * m_settings.positionNoiseM;
+    double q = m_settings.accelerationNoise * m_settings.accelerationNoise;
+    double dt2 = dt * dt;
+
+    for (int i = 0; i < 3; i++) {
+        // Прогноз: p += v*dt, P = F P F' + Q (белое ускорение)
+        double p = m_position[i] + m_velocity[i] * dt;
+        double pp = m_pp[i] + 2.0 * dt * m_pv[i] + dt2 * m_vv[i] + q * dt2 * dt2 * 0.25;
+        double pv = m_pv[i] + dt * m_vv[i] + q * dt2 * dt * 0.5;
+        double vv = m_vv[i] + q * dt2;
+
+        // Коррекция по засечке
+        double s = pp + r;
+        double k0 = pp / s;
+        double k1 = pv / s;
+        double innovation = position[i] - p;
+        m_position[i] = p + k0 * innovation;
+        m_velocity[i] += k1 * innovation;
+        m_pp[i] = (1.0 - k0) * pp;
+        m_pv[i] = (1.0 - k0) * pv;
+        m_vv[i] = vv - k1 * pv;
+    }
+}
+
+void FusionEngine::AddOptical(const double position[3], const FusionQuaternion& rotation, Clock::time_point t) {
+    FusionQuaternion q = Normalize(rotation);
+    double dt = m_hasFix ? Seconds(t - m_fixTime) : 0.0;
+    if (m_hasFix && dt <= 0.0) {
+        return;   // засечка не новее принятой
+    }
+
+    if (!m_hasFix || dt > kMaxFixGapSec) {
+        // Первая засечка или после перерыва: скорость неизвестна
+        double r = m_settings.positionNoiseM * m_settings.positionNoiseM;
+        for (int i = 0; i < 3; i++) {
+            m_position[i] = position[i];
+            m_velocity[i] = 0.0;
+            m_pp[i] = r;
+            m_pv[i] = 0.0;
+            m_vv[i] = 1.0;
+        }
+    } else {
+        UpdatePosition(position, dt);
+    }
+
+    // Поворот гироскопа в мировые оси - по гироскопу на момент захвата
+    // кадра, плавно, чтобы шум детектора не дергал руку
+    if (m_gyroCount > 0) {
+        FusionQuaternion measured = Normalize(Multiply(q, Conjugate(GyroAt(t))));
+        if (!m_hasCorrection) {
+            m_correction = measured;
+            m_hasCorrection = true;
+        } else {
+            double alpha = 1.0 - std::exp(-std::min(dt, kMaxFixGapSec) / m_settings.orientationTimeConstantSec);
+            m_correction = Nlerp(m_correction, measured, alpha);
+        }
+    }
+
+    m_hasFix = true;
+    m_fixTime = t;
+    m_fixRotation = q;
+}
+
+bool FusionEngine::Output(Clock::time_point t, FusedPose& out) const {
+    if (m_gyroCount == 0 && !m_hasFix) {
+        return false;
+    }
+
+    out.hasPosition = m_hasFix;
+    if (m_hasFix) {
+        double ahead = Seconds(t - m_fixTime);
+        bool coasting = ahead > m_settings.maxPredictionSec;
+        ahead = std::max(0.0, std::min(ahead, m_settings.maxPredictionSec));
+        for (int i = 0; i < 3; i++) {
+            out.position[i] = m_position[i] + m_velocity[i] * ahead;
+            // Дальше предела позиция стоит - и SteamVR не должен ее двигать
+            out.velocity[i] = coasting ? 0.0 : m_velocity[i];
+        }
+    }
+
+    if (m_gyroCount > 0) {
+        const FusionQuaternion& gyro = m_gyro[m_gyroHead].orientation;
+        out.rotation = m_hasCorrection ? Normalize(Multiply(m_correction, gyro)) : gyro;
+        out.hasAngularVelocity = m_hasAngularVelocity;
+        Rotate(m_correction, m_angularVelocity, out.angularVelocity);
+    } else {
+        // Без гироскопа - поворот последней засечки
+        out.rotation = m_fixRotation;
+        out.hasAngularVelocity = false;
+        out.angularVelocity[0] = out.angularVelocity[1] = out.angularVelocity[2] = 0.0;
+    }
+    return true;
+}
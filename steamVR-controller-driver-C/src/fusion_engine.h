@@ -0,0 +1,103 @@
+// src/fusion_engine.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+// Без зависимости от OpenVR SDK: собирается и в bench/fusion_bench.cpp
+struct FusionQuaternion {
+    double w = 1.0, x = 0.0, y = 0.0, z = 0.0;
+};
+
+// Параметры слияния (vrsettings native_hub_fusion_*)
+struct FusionSettings {
+    // За сколько оптика подтягивает ориентацию гироскопа (1/e)
+    double orientationTimeConstantSec = 2.0;
+    // СКО позиции оптической засечки, м
+    double positionNoiseM = 0.005;
+    // СКО ускорения между засечками (модель "белое ускорение"), м/с^2
+    double accelerationNoise = 5.0;
+    // Дальше этого позиция от последней засечки не экстраполируется
+    double maxPredictionSec = 0.1;
+};
+
+// Слитая поза на заданный момент
+struct FusedPose {
+    bool hasPosition = false;
+    double position[3] = { 0.0, 0.0, 0.0 };
+    double velocity[3] = { 0.0, 0.0, 0.0 };
+    FusionQuaternion rotation;
+    bool hasAngularVelocity = false;
+    double angularVelocity[3] = { 0.0, 0.0, 0.0 };   // мировые оси, рад/с
+};
+
+// Слияние ориентации гироскопа (гиромышь, ~1 кГц) с оптическими засечками
+// ArUco (~30 Гц, с задержкой) для одного устройства. Фиксированный размер,
+// без выделения памяти; только сетевой поток.
+//
+// Ориентация - комплементарный фильтр. Гироскоп задает поворот в своей
+// системе; поворот из нее в мировую (correction) уточняется по каждой
+// засечке. Засечка сравнивается с поворотом гироскопа на момент ее
+// захвата, из истории kGyroHistory сэмплов, а не с последним: иначе
+// задержка камеры выглядела бы как дрейф. Выход - correction * гироскоп,
+// то есть с частотой и задержкой гироскопа.
+//
+// Позиция - фильтр Калмана "позиция + скорость" по каждой оси. Между
+// засечками позиция экстраполируется по оцененной скорости (не дальше
+// maxPredictionSec), скорость отдается в SteamVR вместе с позой.
+class FusionEngine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 128 мс истории при 1 кГц - больше типичной задержки камеры телефона
+    static constexpr size_t kGyroHistory = 128;
+    // После такого перерыва засечек фильтр позиции начинается заново
+    static constexpr double kMaxFixGapSec = 0.5;
+
+    FusionEngine() { Reset(); }
+
+    void Configure(const FusionSettings& settings) { m_settings = settings; Reset(); }
+    void Reset();
+
+    // Ориентация гироскопа в его системе отсчета на момент t
+    void AddGyro(const FusionQuaternion& orientation, Clock::time_point t);
+    // Оптическая засечка в мировых осях, t - момент захвата
+    void AddOptical(const double position[3], const FusionQuaternion& rotation, Clock::time_point t);
+
+    bool HasGyro() const { return m_gyroCount > 0; }
+    bool HasOptical() const { return m_hasFix; }
+
+    // Поза на момент t (обычно время самого свежего входа). false - еще
+    // нет ни одного входа.
+    bool Output(Clock::time_point t, FusedPose& out) const;
+
+private:
+    struct GyroSample {
+        FusionQuaternion orientation;
+        Clock::time_point time;
+    };
+
+    // Поворот гироскопа на момент t: интерполяция по истории
+    FusionQuaternion GyroAt(Clock::time_point t) const;
+    void UpdatePosition(const double position[3], double dt);
+
+    FusionSettings m_settings;
+
+    std::array<GyroSample, kGyroHistory> m_gyro;   // кольцо
+    size_t m_gyroHead;    // индекс самого нового
+    size_t m_gyroCount;
+    double m_angularVelocity[3];   // система гироскопа, сглаженная
+    bool m_hasAngularVelocity;
+
+    bool m_hasCorrection;
+    FusionQuaternion m_correction;
+
+    bool m_hasFix;
+    Clock::time_point m_fixTime;
+    FusionQuaternion m_fixRotation;
+    // Калман по осям: состояние (p, v) и ковариация [pp pv; pv vv]
+    double m_position[3];
+    double m_velocity[3];
+    double m_pp[3], m_pv[3], m_vv[3];
+};
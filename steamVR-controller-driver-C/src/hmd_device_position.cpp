@@ -1,31 +1,38 @@
 // src/hmd_device_position.cpp
 #include "driver.h"
+#include "debug_request.h"
 
 using namespace vr;
 
-CVHeadset::CVHeadset() : m_unObjectId(k_unTrackedDeviceIndexInvalid) {
+CVHeadset::CVHeadset()
+    : m_unObjectId(k_unTrackedDeviceIndexInvalid), m_posePipeline("CVHeadset") {
     m_sSerialNumber = "CV_HMD_001";
     m_sModelNumber = "CV HMD v1.0";
     
-    memset(&m_pose, 0, sizeof(m_pose));
-    m_pose.poseIsValid = false;
-    m_pose.result = TrackingResult_Uninitialized;
-    m_pose.deviceIsConnected = false;
+    DriverPose_t pose;
+    memset(&pose, 0, sizeof(pose));
+    pose.poseIsValid = false;
+    pose.result = TrackingResult_Uninitialized;
+    pose.deviceIsConnected = false;
     
-    m_pose.qRotation.w = 1.0;
-    m_pose.qRotation.x = 0.0;
-    m_pose.qRotation.y = 0.0;
-    m_pose.qRotation.z = 0.0;
+    pose.qWorldFromDriverRotation = {1, 0, 0, 0};
+    pose.qDriverFromHeadRotation = {1, 0, 0, 0};
     
-    m_pose.vecPosition[0] = 0.0;
-    m_pose.vecPosition[1] = 1.6;
-    m_pose.vecPosition[2] = 0.0;
+    pose.qRotation.w = 1.0;
+    pose.qRotation.x = 0.0;
+    pose.qRotation.y = 0.0;
+    pose.qRotation.z = 0.0;
     
-    m_lastUpdateTime = std::chrono::steady_clock::now();
+    pose.vecPosition[0] = 0.0;
+    pose.vecPosition[1] = 1.6;
+    pose.vecPosition[2] = 0.0;
+    
+    m_posePipeline.SetInitialPose(pose);
 }
 
 vr::EVRInitError CVHeadset::Activate(uint32_t unObjectId) {
     m_unObjectId = unObjectId;
+    m_posePipeline.SetDeviceIndex(unObjectId);
     PropertyContainerHandle_t props = VRProperties()->TrackedDeviceToPropertyContainer(m_unObjectId);
     
     VRProperties()->SetStringProperty(props, Prop_TrackingSystemName_String, "cvtracking");
@@ -49,6 +56,7 @@ vr::EVRInitError CVHeadset::Activate(uint32_t unObjectId) {
 
 void CVHeadset::Deactivate() {
     m_unObjectId = k_unTrackedDeviceIndexInvalid;
+    m_posePipeline.SetDeviceIndex(m_unObjectId);
 }
 
 void CVHeadset::EnterStandby() {}
@@ -58,81 +66,14 @@ void* CVHeadset::GetComponent(const char* pchComponentNameAndVersion) {
 }
 
 void CVHeadset::DebugRequest(const char* pchRequest, char* pchResponseBuffer, uint32_t unResponseBufferSize) {
-    if (unResponseBufferSize >= 1) {
-        pchResponseBuffer[0] = 0;
-    }
-}
-
-vr::DriverPose_t CVHeadset::GetPose() {
-    std::lock_guard<std::mutex> lock(m_poseMutex);
-    return m_pose;
-}
-
-void CVHeadset::UpdateFromNetwork(const ControllerData& data) {
-    if (data.controller_id != 2) {
+    // Телеметрия и задержка интерполяции - команды позы
+    DebugCommand command;
+    if (ParseDebugCommand(pchRequest, command) &&
+        m_posePipeline.HandleDebugCommand(command, pchResponseBuffer, unResponseBufferSize)) {
         return;
     }
     
-    {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        
-        // Обновляем ориентацию (получаем от ALVR)
-        m_pose.qRotation.w = data.quat_w;
-        m_pose.qRotation.x = data.quat_x;
-        m_pose.qRotation.y = data.quat_y;
-        m_pose.qRotation.z = data.quat_z;
-        
-        // Обновляем позицию в мировом пространстве (X, Y, Z)
-        // accel_x/y/z содержит координаты позиции, полученные от Hub
-        m_pose.vecPosition[0] = data.accel_x;
-        m_pose.vecPosition[1] = data.accel_y;
-        m_pose.vecPosition[2] = data.accel_z;
-        
-        // Обновляем угловую скорость из гироскопа
-        m_pose.vecAngularVelocity[0] = data.gyro_x;
-        m_pose.vecAngularVelocity[1] = data.gyro_y;
-        m_pose.vecAngularVelocity[2] = data.gyro_z;
-        
-        // Обнуляем линейную скорость (используем прямое позиционирование)
-        m_pose.vecVelocity[0] = 0.0;
-        m_pose.vecVelocity[1] = 0.0;
-        m_pose.vecVelocity[2] = 0.0;
-        
-        m_pose.poseIsValid = true;
-        m_pose.result = TrackingResult_Running_OK;
-        m_pose.deviceIsConnected = true;
-        
-        m_lastUpdateTime = std::chrono::steady_clock::now();
-        
-        // ОТЛАДОЧНЫЙ ВЫВОД каждые 100 обновлений
-        static int updateCounter = 0;
-        updateCounter++;
-        if (updateCounter % 100 == 0) {
-            char logMsg[512];
-            snprintf(logMsg, sizeof(logMsg), 
-                "CVHeadset: Pos(%.3f, %.3f, %.3f) Quat(%.3f, %.3f, %.3f, %.3f)",
-                m_pose.vecPosition[0], m_pose.vecPosition[1], m_pose.vecPosition[2],
-                m_pose.qRotation.w, m_pose.qRotation.x, m_pose.qRotation.y, m_pose.qRotation.z);
-            VRDriverLog()->Log(logMsg);
-        }
-    }
-}
-
-void CVHeadset::CheckConnection() {
-    auto now = std::chrono::steady_clock::now();
-    float time_since_update = std::chrono::duration<float>(now - m_lastUpdateTime).count();
-    
-    if (time_since_update > 1.0f) {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        m_pose.deviceIsConnected = false;
-        m_pose.poseIsValid = false;
+    if (unResponseBufferSize >= 1) {
+        pchResponseBuffer[0] = 0;
     }
 }
-
-void CVHeadset::RunFrame() {
-    // КРИТИЧЕСКИ ВАЖНО! Отправляем обновления позы в SteamVR каждый кадр
-    if (m_unObjectId != k_unTrackedDeviceIndexInvalid) {
-        std::lock_guard<std::mutex> lock(m_poseMutex);
-        VRServerDriverHost()->TrackedDevicePoseUpdated(m_unObjectId, m_pose, sizeof(DriverPose_t));
-    }
-}
\ No newline at end of file
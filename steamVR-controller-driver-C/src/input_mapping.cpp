@@ -0,0 +1,211 @@
+// src/input_mapping.cpp
+#include "input_mapping.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace vr;
+
+namespace {
+
+constexpr size_t kButtonBits = 16;
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+// Части "a:b:c" без пробелов по краям
+std::vector<std::string> SplitFields(const std::string& text) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t end = text.find(':', start);
+        fields.push_back(Trim(text.substr(start, end == std::string::npos ? std::string::npos : end - start)));
+        if (end == std::string::npos) {
+            return fields;
+        }
+        start = end + 1;
+    }
+}
+
+bool ParseBit(const std::string& text, uint8_t& bit) {
+    char* end = nullptr;
+    long value = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != 0 || value < 0 || value >= (long)kButtonBits) {
+        return false;
+    }
+    bit = static_cast<uint8_t>(value);
+    return true;
+}
+
+bool ParseFloat(const std::string& text, float& value) {
+    char* end = nullptr;
+    value = strtof(text.c_str(), &end);
+    return !text.empty() && *end == 0 && std::isfinite(value);
+}
+
+bool IsInputPath(const std::string& path) {
+    return path.compare(0, 7, "/input/") == 0 && path.size() > 7;
+}
+
+bool PathUsed(const InputMappingSpec& spec, const std::string& path) {
+    for (const auto& button : spec.buttons) {
+        if (button.path == path) return true;
+    }
+    for (const auto& axis : spec.axes) {
+        if (axis.path == path) return true;
+    }
+    return spec.trigger.enabled && spec.trigger.path == path;
+}
+
+} // namespace
+
+std::string DefaultInputMapping(bool hasTriggerValue) {
+    std::string mapping =
+        "0=/input/trigger/click;1=/input/grip/click;2=/input/application_menu/click;3=/input/system/click";
+    if (hasTriggerValue) {
+        mapping += ";trigger=/input/trigger/value";
+    }
+    return mapping;
+}
+
+bool ParseInputMapping(const char* text, InputMappingSpec& spec, std::string& error) {
+    spec = InputMappingSpec();
+    std::string list = text ? text : "";
+
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find_first_of(";,", start);
+        if (end == std::string::npos) end = list.size();
+        std::string entry = Trim(list.substr(start, end - start));
+        start = end + 1;
+        if (entry.empty() || entry == "none") {
+            continue;
+        }
+
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            error = "missing '=' in '" + entry + "'";
+            return false;
+        }
+        std::string key = Trim(entry.substr(0, equals));
+        std::vector<std::string> fields = SplitFields(entry.substr(equals + 1));
+        const std::string& path = fields[0];
+        if (!IsInputPath(path)) {
+            error = "bad component path in '" + entry + "'";
+            return false;
+        }
+        if (PathUsed(spec, path)) {
+            error = "component mapped twice in '" + entry + "'";
+            return false;
+        }
+
+        if (key == "trigger") {
+            // trigger=<path>[:<deadzone>:<max>[:<gamma>]]
+            InputMappingSpec::Trigger trigger;
+            trigger.enabled = true;
+            trigger.path = path;
+            if (spec.trigger.enabled || fields.size() == 2 || fields.size() > 4 ||
+                (fields.size() >= 3 && (!ParseFloat(fields[1], trigger.deadzone) ||
+                                        !ParseFloat(fields[2], trigger.max))) ||
+                (fields.size() == 4 && !ParseFloat(fields[3], trigger.gamma))) {
+                error = "bad trigger in '" + entry + "'";
+                return false;
+            }
+            if (trigger.deadzone < 0.0f || trigger.max > 1.0f || trigger.max <= trigger.deadzone ||
+                trigger.gamma <= 0.0f || trigger.gamma > 10.0f) {
+                error = "trigger curve out of range in '" + entry + "'";
+                return false;
+            }
+            spec.trigger = trigger;
+        } else if (key == "axis") {
+            // axis=<path>:<negBit>:<posBit>
+            InputMappingSpec::Axis axis;
+            axis.path = path;
+            if (fields.size() != 3 || !ParseBit(fields[1], axis.negativeBit) ||
+                !ParseBit(fields[2], axis.positiveBit) || axis.negativeBit == axis.positiveBit) {
+                error = "bad axis in '" + entry + "'";
+                return false;
+            }
+            spec.axes.push_back(axis);
+        } else {
+            // <bit>=<path>
+            InputMappingSpec::Button button;
+            button.path = path;
+            if (fields.size() != 1 || !ParseBit(key, button.bit)) {
+                error = "bad button in '" + entry + "'";
+                return false;
+            }
+            spec.buttons.push_back(button);
+        }
+    }
+    return true;
+}
+
+void InputMap::Build(const InputMappingSpec& spec, PropertyContainerHandle_t container) {
+    m_buttonCount = 0;
+    for (const auto& button : spec.buttons) {
+        if (m_buttonCount == kMaxButtons) break;
+        ButtonEntry& entry = m_buttons[m_buttonCount++];
+        entry.mask = static_cast<uint16_t>(1u << button.bit);
+        entry.handle = k_ulInvalidInputComponentHandle;
+        VRDriverInput()->CreateBooleanComponent(container, button.path.c_str(), &entry.handle);
+    }
+
+    m_hasTrigger = spec.trigger.enabled;
+    m_triggerHandle = k_ulInvalidInputComponentHandle;
+    if (m_hasTrigger) {
+        VRDriverInput()->CreateScalarComponent(container, spec.trigger.path.c_str(), &m_triggerHandle,
+            VRScalarType_Absolute, VRScalarUnits_NormalizedOneSided);
+        // Кривая считается один раз: на пакет - только выборка по байту
+        const InputMappingSpec::Trigger& t = spec.trigger;
+        for (size_t raw = 0; raw < m_triggerCurve.size(); raw++) {
+            float x = (raw / 255.0f - t.deadzone) / (t.max - t.deadzone);
+            x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+            m_triggerCurve[raw] = t.gamma == 1.0f ? x : std::pow(x, t.gamma);
+        }
+    }
+
+    m_axisCount = 0;
+    for (const auto& axis : spec.axes) {
+        if (m_axisCount == kMaxAxes) break;
+        AxisEntry& entry = m_axes[m_axisCount++];
+        entry.negativeShift = axis.negativeBit;
+        entry.positiveShift = axis.positiveBit;
+        entry.handle = k_ulInvalidInputComponentHandle;
+        VRDriverInput()->CreateScalarComponent(container, axis.path.c_str(), &entry.handle,
+            VRScalarType_Absolute, VRScalarUnits_NormalizedTwoSided);
+    }
+}
+
+void InputMap::Apply(uint16_t buttons, uint8_t trigger, std::chrono::steady_clock::time_point now,
+                     double timeOffset, InputChangeFilter& filter) const {
+    size_t slot = 0;
+    for (size_t i = 0; i < m_buttonCount; i++, slot++) {
+        bool pressed = (buttons & m_buttons[i].mask) != 0;
+        if (filter.Boolean(slot, pressed, now)) {
+            VRDriverInput()->UpdateBooleanComponent(m_buttons[i].handle, pressed, timeOffset);
+        }
+    }
+
+    slot = kMaxButtons;
+    if (m_hasTrigger) {
+        float value = m_triggerCurve[trigger];
+        if (filter.Scalar(slot, value, now)) {
+            VRDriverInput()->UpdateScalarComponent(m_triggerHandle, value, timeOffset);
+        }
+    }
+
+    // Оба бита или ни одного - 0, иначе -1 / +1
+    static const float kAxisValues[4] = { 0.0f, -1.0f, 1.0f, 0.0f };
+    slot = kMaxButtons + 1;
+    for (size_t i = 0; i < m_axisCount; i++, slot++) {
+        const AxisEntry& axis = m_axes[i];
+        unsigned index = ((buttons >> axis.negativeShift) & 1u) | (((buttons >> axis.positiveShift) & 1u) << 1);
+        float value = kAxisValues[index];
+        if (filter.Scalar(slot, value, now)) {
+            VRDriverInput()->UpdateScalarComponent(axis.handle, value, timeOffset);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// src/input_mapping.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "input_state.h"
+
+// Раскладка ввода устройства: какие биты buttons и байт trigger пакета
+// становятся какими компонентами SteamVR. Задается строкой (настройка
+// "input_mapping_<device>", по умолчанию - ControllerProfile::inputMapping),
+// элементы через ';':
+//   <bit>=<path>                           бит 0..15 -> boolean-компонент
+//   trigger=<path>[:<deadzone>:<max>[:<gamma>]]
+//                                          trigger 0..255 -> скаляр 0..1 по кривой
+//   axis=<path>:<negBit>:<posBit>          пара битов -> ось -1/0/+1 (крестовина,
+//                                          кнопки джойстика/трекпада)
+//   none                                   без компонентов ввода
+// Пути компонентов должны быть объявлены в профиле ввода (input/*.json).
+struct InputMappingSpec {
+    struct Button {
+        uint8_t bit;
+        std::string path;
+    };
+    struct Trigger {
+        bool enabled = false;
+        std::string path;
+        float deadzone = 0.0f;   // доля хода, которая считается нулем
+        float max = 1.0f;        // доля хода, которая считается полным нажатием
+        float gamma = 1.0f;      // > 1 - точнее в начале хода
+    };
+    struct Axis {
+        std::string path;
+        uint8_t negativeBit;
+        uint8_t positiveBit;
+    };
+
+    std::vector<Button> buttons;
+    Trigger trigger;
+    std::vector<Axis> axes;
+};
+
+// Раскладка прежнего захардкоженного UpdateButtonState:
+// биты 0..3 - trigger/grip/application_menu/system, trigger - /input/trigger/value
+std::string DefaultInputMapping(bool hasTriggerValue);
+
+// false - ошибка (описание в error), spec содержит разобранное до ошибки
+bool ParseInputMapping(const char* text, InputMappingSpec& spec, std::string& error);
+
+// Раскладка, скомпилированная в таблицы при Activate.
+//
+// На пакет - проход по массиву кнопок и осей и выборка кривой триггера по
+// байту: без строк, поиска и ветвления по типу входа. Изменения
+// отсеивает InputChangeFilter (слоты: кнопки, затем триггер, затем оси).
+class InputMap {
+public:
+    static constexpr size_t kMaxButtons = 16;
+    static constexpr size_t kMaxAxes = 4;
+    static_assert(kMaxButtons + 1 + kMaxAxes <= InputChangeFilter::kMaxComponents,
+                  "every input needs a change filter slot");
+
+    InputMap() : m_buttonCount(0), m_hasTrigger(false), m_triggerHandle(0), m_axisCount(0) {}
+
+    // Поток Activate: создает компоненты SteamVR и строит таблицы.
+    // Лишние кнопки и оси (сверх kMax*) отбрасываются.
+    void Build(const InputMappingSpec& spec, vr::PropertyContainerHandle_t container);
+
+    // Сетевой поток
+    void Apply(uint16_t buttons, uint8_t trigger, std::chrono::steady_clock::time_point now,
+               double timeOffset, InputChangeFilter& filter) const;
+
+    size_t ButtonCount() const { return m_buttonCount; }
+    bool HasTrigger() const { return m_hasTrigger; }
+    size_t AxisCount() const { return m_axisCount; }
+
+private:
+    struct ButtonEntry {
+        uint16_t mask;
+        vr::VRInputComponentHandle_t handle;
+    };
+    struct AxisEntry {
+        uint8_t negativeShift;
+        uint8_t positiveShift;
+        vr::VRInputComponentHandle_t handle;
+    };
+
+    std::array<ButtonEntry, kMaxButtons> m_buttons;
+    size_t m_buttonCount;
+    bool m_hasTrigger;
+    vr::VRInputComponentHandle_t m_triggerHandle;
+    std::array<float, 256> m_triggerCurve;   // байт trigger -> значение компонента
+    std::array<AxisEntry, kMaxAxes> m_axes;
+    size_t m_axisCount;
+};
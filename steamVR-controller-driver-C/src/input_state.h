@@ -0,0 +1,62 @@
+// src/input_state.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+// Последнее отправленное в SteamVR состояние компонентов ввода устройства.
+//
+// Обновление нужно отправлять, только если значение изменилось: кнопка -
+// фронт, скаляр - сдвиг больше kScalarThreshold или выход на край
+// диапазона (отпущенный триггер должен дойти ровно до 0). Раз в kKeepAlive
+// компонент отправляется повторно, даже без изменений, - на случай, если
+// vrserver потерял событие.
+//
+// Используется только сетевым потоком. До первой отправки компонент
+// считается неотправленным, поэтому первое обновление уходит всегда.
+class InputChangeFilter {
+public:
+    static constexpr size_t kMaxComponents = 24;   // см. InputMap
+    // Шум АЦП триггера - 1-2 LSB из 255
+    static constexpr float kScalarThreshold = 0.01f;
+    static constexpr std::chrono::seconds kKeepAlive{1};
+
+    // true - значение надо отправить (и оно запомнено как отправленное)
+    bool Boolean(size_t index, bool value, std::chrono::steady_clock::time_point now) {
+        Component& c = m_components[index];
+        if (c.sent && c.value == (value ? 1.0f : 0.0f) && now - c.sentAt < kKeepAlive) {
+            return false;
+        }
+        Remember(c, value ? 1.0f : 0.0f, now);
+        return true;
+    }
+
+    bool Scalar(size_t index, float value, std::chrono::steady_clock::time_point now) {
+        Component& c = m_components[index];
+        if (c.sent && now - c.sentAt < kKeepAlive) {
+            bool atEdge = (value <= 0.0f || value >= 1.0f) && value != c.value;
+            if (!atEdge && std::fabs(value - c.value) < kScalarThreshold) {
+                return false;
+            }
+        }
+        Remember(c, value, now);
+        return true;
+    }
+
+private:
+    struct Component {
+        bool sent = false;
+        float value = 0.0f;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    static void Remember(Component& c, float value, std::chrono::steady_clock::time_point now) {
+        c.sent = true;
+        c.value = value;
+        c.sentAt = now;
+    }
+
+    std::array<Component, kMaxComponents> m_components;
+};
@@ -0,0 +1,222 @@
+// src/json_lite.cpp
+#include "json_lite.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Конфиги маленькие; глубже - скорее всего мусор
+constexpr int kMaxDepth = 32;
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : m_text(text), m_pos(0) {}
+
+    bool Parse(JsonValue& value, std::string& error) {
+        if (!ParseValue(value, 0)) {
+            error = m_error + " at offset " + std::to_string(m_pos);
+            return false;
+        }
+        SkipSpace();
+        if (m_pos != m_text.size()) {
+            error = "trailing data at offset " + std::to_string(m_pos);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool Fail(const char* message) {
+        m_error = message;
+        return false;
+    }
+
+    void SkipSpace() {
+        while (m_pos < m_text.size() && strchr(" \t\r\n", m_text[m_pos]) != nullptr) {
+            m_pos++;
+        }
+    }
+
+    bool Consume(const char* word) {
+        size_t length = strlen(word);
+        if (m_text.compare(m_pos, length, word) != 0) {
+            return false;
+        }
+        m_pos += length;
+        return true;
+    }
+
+    bool ParseValue(JsonValue& value, int depth) {
+        if (depth > kMaxDepth) {
+            return Fail("nesting too deep");
+        }
+        SkipSpace();
+        if (m_pos >= m_text.size()) {
+            return Fail("unexpected end");
+        }
+
+        char c = m_text[m_pos];
+        if (c == '{') return ParseObject(value, depth);
+        if (c == '[') return ParseArray(value, depth);
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return ParseString(value.text);
+        }
+        if (Consume("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (Consume("false")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+            return true;
+        }
+        if (Consume("null")) {
+            value.type = JsonValue::Type::Null;
+            return true;
+        }
+
+        const char* start = m_text.c_str() + m_pos;
+        char* end = nullptr;
+        double number = strtod(start, &end);
+        if (end == start || (c != '-' && (c < '0' || c > '9'))) {
+            return Fail("unexpected character");
+        }
+        value.type = JsonValue::Type::Number;
+        value.number = number;
+        m_pos += static_cast<size_t>(end - start);
+        return true;
+    }
+
+    bool ParseString(std::string& out) {
+        m_pos++;   // '"'
+        out.clear();
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) {
+                break;
+            }
+            char escape = m_text[m_pos++];
+            switch (escape) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+                // Ключам и путям драйвера юникод не нужен - оставляем как есть
+                out += "\\u";
+                break;
+            default: out += escape; break;   // \" \\ \/
+            }
+        }
+        return Fail("unterminated string");
+    }
+
+    bool ParseArray(JsonValue& value, int depth) {
+        m_pos++;   // '['
+        value.type = JsonValue::Type::Array;
+        SkipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == ']') {
+            m_pos++;
+            return true;
+        }
+        while (true) {
+            value.items.emplace_back();
+            if (!ParseValue(value.items.back(), depth + 1)) {
+                return false;
+            }
+            SkipSpace();
+            if (m_pos < m_text.size() && m_text[m_pos] == ',') {
+                m_pos++;
+                continue;
+            }
+            if (m_pos < m_text.size() && m_text[m_pos] == ']') {
+                m_pos++;
+                return true;
+            }
+            return Fail("expected ',' or ']'");
+        }
+    }
+
+    bool ParseObject(JsonValue& value, int depth) {
+        m_pos++;   // '{'
+        value.type = JsonValue::Type::Object;
+        SkipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == '}') {
+            m_pos++;
+            return true;
+        }
+        while (true) {
+            SkipSpace();
+            if (m_pos >= m_text.size() || m_text[m_pos] != '"') {
+                return Fail("expected member name");
+            }
+            std::string key;
+            if (!ParseString(key)) {
+                return false;
+            }
+            SkipSpace();
+            if (m_pos >= m_text.size() || m_text[m_pos] != ':') {
+                return Fail("expected ':'");
+            }
+            m_pos++;
+            value.members.emplace_back(key, JsonValue());
+            if (!ParseValue(value.members.back().second, depth + 1)) {
+                return false;
+            }
+            SkipSpace();
+            if (m_pos < m_text.size() && m_text[m_pos] == ',') {
+                m_pos++;
+                continue;
+            }
+            if (m_pos < m_text.size() && m_text[m_pos] == '}') {
+                m_pos++;
+                return true;
+            }
+            return Fail("expected ',' or '}'");
+        }
+    }
+
+    const std::string& m_text;
+    size_t m_pos;
+    std::string m_error;
+};
+
+} // namespace
+
+const JsonValue* JsonValue::Find(const char* key) const {
+    for (const auto& member : members) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error) {
+    value = JsonValue();
+    JsonParser parser(text);
+    return parser.Parse(value, error);
+}
+
+bool ReadTextFile(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return !file.bad();
+}
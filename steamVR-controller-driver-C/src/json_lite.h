@@ -0,0 +1,33 @@
+// src/json_lite.h
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Минимальный разбор JSON для файлов конфигурации драйвера (calibration.json):
+// объекты, массивы, числа, строки (\uXXXX не раскрываются), true/false/null.
+// Не для горячего пути - дерево строится целиком.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;                             // Array
+    std::vector<std::pair<std::string, JsonValue>> members;   // Object, в порядке файла
+
+    bool IsObject() const { return type == Type::Object; }
+    bool IsArray() const { return type == Type::Array; }
+    bool IsNumber() const { return type == Type::Number; }
+
+    // Член объекта или nullptr
+    const JsonValue* Find(const char* key) const;
+};
+
+// false - синтаксическая ошибка, описание (со смещением) в error
+bool ParseJson(const std::string& text, JsonValue& value, std::string& error);
+
+// Весь файл целиком; false - не открылся или ошибка чтения
+bool ReadTextFile(const std::string& path, std::string& text);
@@ -1,5 +1,15 @@
 // src/main.cpp
 #include "driver.h"
+#include "packet_batch.h"
+#include "driver_settings.h"
+#include "device_registry.h"
+#include "async_log.h"
+#include "calibration.h"
+#include "native_hub.h"
+#include "json_lite.h"
+#include "thread_scheduling.h"
+#include "rate_hint.h"
+#include <filesystem>
 #include <thread>
 #include <vector>
 #include <iostream>
@@ -10,7 +20,7 @@ using namespace vr;
 
 class CVDriver : public IServerTrackedDeviceProvider {
 public:
-    CVDriver() : m_networkClient(nullptr), m_headset(nullptr) {}
+    CVDriver() : m_networkClient(nullptr) {}
     
     virtual ~CVDriver() {
         Cleanup();
@@ -21,51 +31,146 @@ public:
         
         VRDriverLog()->Log("=== CVDriver v2.2 INIT START ===");
         
-        // Create HMD
-        m_headset = std::make_unique<CVHeadset>();
-        bool hmdAdded = VRServerDriverHost()->TrackedDeviceAdded(
-            "CV_HMD", 
-            TrackedDeviceClass_HMD,
-            m_headset.get());
+        // Горячие пути пишут в лог через кольцо, форматирует фоновый поток
+        AsyncLog::Instance().Start();
         
-        if (!hmdAdded) {
-            VRDriverLog()->Log("CVDriver: Failed to add HMD!");
-        } else {
-            VRDriverLog()->Log("CVDriver: HMD registered successfully");
-        }
+        DriverSettings settings = LoadDriverSettings(kDriverSettingsSection);
         
-        // Create controllers
-        m_leftController = std::make_unique<CVController>(
-            TrackedControllerRole_LeftHand, 0);
-        m_rightController = std::make_unique<CVController>(
-            TrackedControllerRole_RightHand, 1);
+        char settingsMsg[256];
+        snprintf(settingsMsg, sizeof(settingsMsg),
+            "CVDriver: Prediction - %s, look-ahead %.1f ms, max extrapolation %.1f ms",
+            settings.prediction.extrapolateInDriver ? "in driver" : "by SteamVR (velocity + poseTimeOffset)",
+            settings.prediction.predictionSec * 1000.0f, settings.prediction.maxExtrapolationSec * 1000.0f);
+        VRDriverLog()->Log(settingsMsg);
         
-        // Register controllers with SteamVR
-        bool leftAdded = VRServerDriverHost()->TrackedDeviceAdded(
-            "CV_Controller_Left", 
-            TrackedDeviceClass_Controller, 
-            m_leftController.get());
+        // Меняется на лету: DebugRequest "interpolation_delay_ms <value>"
+        snprintf(settingsMsg, sizeof(settingsMsg),
+            "CVDriver: Interpolation delay %.1f ms",
+            ClampInterpolationDelay(settings.interpolationDelaySec) * 1000.0f);
+        VRDriverLog()->Log(settingsMsg);
+        
+        // Набор устройств: явный список "devices" или устройства по умолчанию
+        std::vector<DeviceSpec> specs;
+        std::string specError;
+        std::string deviceList = settings.devices.empty() ? DefaultDeviceList(settings) : settings.devices;
+        if (!ParseDeviceSpecs(deviceList.c_str(), specs, specError)) {
+            snprintf(settingsMsg, sizeof(settingsMsg),
+                "CVDriver: Invalid 'devices' setting (%s): %s", specError.c_str(), deviceList.c_str());
+            VRDriverLog()->Log(settingsMsg);
+            return VRInitError_Init_Internal;
+        }
+        ThreadPriority ioPriority;
+        if (!ParseThreadPriority(settings.ioThread.priority, ioPriority)) {
+            snprintf(settingsMsg, sizeof(settingsMsg),
+                "CVDriver: Invalid 'io_thread_priority' setting: %s (normal, above_normal, highest, time_critical)",
+                settings.ioThread.priority.c_str());
+            VRDriverLog()->Log(settingsMsg);
+            return VRInitError_Init_Internal;
+        }
+        m_settings = settings;
         
-        bool rightAdded = VRServerDriverHost()->TrackedDeviceAdded(
-            "CV_Controller_Right", 
-            TrackedDeviceClass_Controller, 
-            m_rightController.get());
+        // Калибровка читается до создания устройств и дальше следит за файлом
+        m_calibration.Start(ResolveDriverPath(pDriverContext, settings.calibrationFile));
         
-        if (!leftAdded || !rightAdded) {
-            VRDriverLog()->Log("CVDriver: Failed to add controllers!");
+        if (settings.nativeHub.enabled && !ConfigureNativeHub(pDriverContext, settings.nativeHub)) {
             return VRInitError_Init_Internal;
         }
         
-        VRDriverLog()->Log("CVDriver: Controllers registered successfully");
+        // Все источники обслуживает один сетевой поток: один сокет на порт,
+        // формат датаграммы определяется по содержимому
+        m_networkClient = std::make_unique<NetworkClient>();
+        bool hubPortUsed = settings.autoAddTrackers;
+        bool gyroPortUsed = false;
+        DecodeOptions decodeOptions;
+        decodeOptions.gyroMouseDeviceId = settings.gyroMouseDeviceId;
+        
+        for (const DeviceSpec& spec : specs) {
+            if (!CreateDevice(spec)) {
+                return VRInitError_Init_Internal;
+            }
+            if (spec.type == DeviceType::GyroMouse) {
+                // Пакеты гиромыши адресуются относительно первого ее id
+                if (!gyroPortUsed) {
+                    decodeOptions.gyroMouseDeviceId = spec.id;
+                }
+                gyroPortUsed = true;
+            } else {
+                hubPortUsed = true;
+            }
+        }
+        
+        // Ориентацию встроенному хабу дает гиромышь со своего порта
+        if (m_nativeHub.HasOrientationSources()) {
+            gyroPortUsed = true;
+        }
+        
+        m_networkClient->SetDecodeOptions(decodeOptions);
+        m_networkClient->SetSharedRing(settings.sharedMemoryName);
+        m_networkClient->SetRegisteredIo(settings.registeredIo);
+        m_networkClient->SetPinSenders(settings.pinSenders);
+        m_rateHints.Configure(settings.rateHints);
+        std::string capturePath = ResolveDriverPath(pDriverContext, settings.captureFile);
+        m_networkClient->SetCaptureFile(capturePath);
+        if (hubPortUsed) {
+            m_networkClient->AddPort(settings.hubPort);
+        }
+        if (gyroPortUsed) {
+            m_networkClient->AddPort(settings.gyroMousePort);
+        }
+        if (m_nativeHub.Enabled() && !m_networkClient->AddPort(settings.nativeHub.port, PortRole::NativeHub)) {
+            snprintf(settingsMsg, sizeof(settingsMsg),
+                "CVDriver: Native hub port %d is already used for device packets", (int)settings.nativeHub.port);
+            VRDriverLog()->Log(settingsMsg);
+            return VRInitError_Init_Internal;
+        }
         
         // Start network client
-        m_networkClient = std::make_unique<NetworkClient>(5555);
         if (!m_networkClient->Start()) {
             VRDriverLog()->Log("CVDriver: Failed to start network client!");
             return VRInitError_Init_Internal;
         }
         
-        VRDriverLog()->Log("CVDriver: Network client started on port 5555");
+        snprintf(settingsMsg, sizeof(settingsMsg),
+            "CVDriver: Network client started - hub port %s, gyro mouse port %s, native hub port %s",
+            hubPortUsed ? std::to_string(settings.hubPort).c_str() : "off",
+            gyroPortUsed ? std::to_string(settings.gyroMousePort).c_str() : "off",
+            m_nativeHub.Enabled() ? std::to_string(settings.nativeHub.port).c_str() : "off");
+        VRDriverLog()->Log(settingsMsg);
+        
+        if (settings.registeredIo) {
+            if (m_networkClient->RegisteredIoActive()) {
+                VRDriverLog()->Log("CVDriver: Receiving through Registered I/O");
+            } else {
+                snprintf(settingsMsg, sizeof(settingsMsg),
+                    "CVDriver: Registered I/O unavailable (%s), receiving through recvfrom",
+                    m_networkClient->RegisteredIoError().c_str());
+                VRDriverLog()->Log(settingsMsg);
+            }
+        }
+        
+        if (!capturePath.empty()) {
+            snprintf(settingsMsg, sizeof(settingsMsg),
+                "CVDriver: Capture %s - %s", capturePath.c_str(),
+                m_networkClient->CaptureOpen() ? "recording" : "failed to open, not recording");
+            VRDriverLog()->Log(settingsMsg);
+        }
+        
+        if (!settings.sharedMemoryName.empty()) {
+            snprintf(settingsMsg, sizeof(settingsMsg),
+                "CVDriver: Shared memory input %s - %s", settings.sharedMemoryName.c_str(),
+                m_networkClient->SharedRingOpen() ? "open" : "failed to create, local senders use UDP");
+            VRDriverLog()->Log(settingsMsg);
+        }
+        
+        // Разрешение таймера - на весь vrserver, до Cleanup
+        if (settings.ioThread.timerResolutionMs > 0) {
+            uint32_t minMs = 0;
+            uint32_t maxMs = 0;
+            bool applied = m_timerResolution.Begin(settings.ioThread.timerResolutionMs, minMs, maxMs);
+            snprintf(settingsMsg, sizeof(settingsMsg), "CVDriver: Timer resolution %u ms %s (system range %u-%u ms)",
+                settings.ioThread.timerResolutionMs, applied ? "set" : "rejected", minMs, maxMs);
+            VRDriverLog()->Log(settingsMsg);
+        }
         
         // Start network thread
         m_running = true;
@@ -79,6 +184,9 @@ public:
         VRDriverLog()->Log("CVDriver: Cleaning up...");
         
         m_running = false;
+        if (m_networkClient) {
+            m_networkClient->Wake();
+        }
         if (m_networkThread.joinable()) {
             m_networkThread.join();
         }
@@ -87,10 +195,13 @@ public:
             m_networkClient->Stop();
             m_networkClient.reset();
         }
+        m_timerResolution.End();
+        
+        m_devices.Clear();
+        m_calibration.Stop();
         
-        m_headset.reset();
-        m_leftController.reset();
-        m_rightController.reset();
+        // Писателей больше нет - дописываем кольцо
+        AsyncLog::Instance().Stop();
         
         VRDriverLog()->Log("CVDriver: Cleanup complete");
     }
@@ -100,73 +211,501 @@ public:
     }
     
     virtual void RunFrame() override {
+        // Устройства, для которых сетевой поток увидел неизвестный id
+        uint32_t requests = m_devices.TakeRequests();
+        if (requests != 0) {
+            AddRequestedTrackers(requests);
+        }
+        
         // CRITICAL: This is called every frame by SteamVR
         // We must update all device poses here!
-        if (m_headset) {
-            m_headset->CheckConnection();
-            m_headset->RunFrame();
+        // Одно время кадра на все устройства
+        auto frameTime = std::chrono::steady_clock::now();
+        if (m_settings.rateHints.enabled && frameTime >= m_nextDisplayHzRead) {
+            ReadDisplayFrequency();
+            m_nextDisplayHzRead = frameTime + kDisplayHzReadPeriod;
         }
+        for (size_t i = 0; i < m_devices.Count(); i++) {
+            CVDevice& device = m_devices.At(i);
+            device.CheckConnection(frameTime);
+            device.RunFrame();
+        }
+    }
+    
+    virtual bool ShouldBlockStandbyMode() override { return false; }
+    // Ожидание SteamVR - отправителям в подсказках частоты
+    virtual void EnterStandby() override { m_standby.store(true, std::memory_order_relaxed); }
+    virtual void LeaveStandby() override { m_standby.store(false, std::memory_order_relaxed); }
+    
+private:
+    // Сколько датаграмм вычитывать за одно пробуждение. Если в сокете
+    // осталось больше, FD_READ останется взведенным и WaitForData вернется сразу.
+    static constexpr size_t kMaxPacketsPerWakeup = 256;
+    // Таймаут ожидания - только чтобы периодически проверять m_running
+    static constexpr uint32_t kWaitTimeoutMs = 100;
+    // Период вывода статистики цикла
+    static constexpr int kLoopStatsPeriodSec = 10;
+    // Период подсказок частоты отправителям и чтения частоты дисплея
+    static constexpr std::chrono::seconds kRateHintPeriod{1};
+    static constexpr std::chrono::seconds kDisplayHzReadPeriod{1};
+    
+    // Сколько собственно цикл приема добавляет к задержке: время от
+    // пробуждения до окончания разбора последней датаграммы пачки
+    struct LoopStats {
+        uint64_t wakeups = 0;
+        uint64_t packets = 0;
+        uint64_t rejected = 0;
+        uint64_t checksumFailures = 0;
+        uint64_t stale = 0;
+        uint64_t superseded = 0;
+        uint32_t maxPacketsPerWakeup = 0;
+        double totalDispatchUs = 0.0;
+        double maxDispatchUs = 0.0;
+        // Планирование потока: насколько позже срока кончаются тайм-ауты
+        // ожидания (разрешение таймера) и сколько раз поток сменил ядро
+        uint64_t timeouts = 0;
+        double totalTimeoutLateUs = 0.0;
+        double maxTimeoutLateUs = 0.0;
+        uint64_t coreChanges = 0;
         
-        if (m_leftController) {
-            m_leftController->CheckConnection();
-            m_leftController->RunFrame();
+        void Reset() { *this = LoopStats(); }
+    };
+    
+    // Устройства по умолчанию, когда "devices" не задан: как до появления списка
+    static std::string DefaultDeviceList(const DriverSettings& settings) {
+        std::string list;
+        if (settings.hubDevicesEnabled) {
+            list = "0:left:CV_Controller_Left;1:right:CV_Controller_Right;2:hmd:CV_HMD";
+        }
+        if (settings.gyroMouseEnabled) {
+            if (!list.empty()) list += ";";
+            list += std::to_string(settings.gyroMouseDeviceId) + ":gyromouse:GyroMouse_Controller";
+        }
+        return list;
+    }
+    
+    // Относительный путь из настроек - от папки установки драйвера
+    // (рабочая папка vrserver не определена)
+    static std::string ResolveDriverPath(vr::IVRDriverContext* context, const std::string& path) {
+        if (path.empty() || std::filesystem::path(path).is_absolute()) {
+            return path;
+        }
+        std::string installPath = VRProperties()->GetStringProperty(context->GetDriverHandle(), Prop_InstallPath_String);
+        if (installPath.empty()) {
+            return path;
+        }
+        return (std::filesystem::path(installPath) / path).string();
+    }
+    
+    // Калибровка маркеров из vr_config.json Python-хаба и источники ориентации
+    bool ConfigureNativeHub(vr::IVRDriverContext* context, const NativeHubSettings& settings) {
+        char logMsg[512];
+        HubCalibrationTable calibration;
+        std::string path = ResolveDriverPath(context, settings.configFile);
+        if (!path.empty()) {
+            std::string text;
+            std::string error;
+            if (!ReadTextFile(path, text)) {
+                error = "cannot read file";
+            } else {
+                ParseHubConfig(text, calibration, error);
+            }
+            if (!error.empty()) {
+                // Как хаб: без калибровки, но работаем
+                calibration = HubCalibrationTable();
+                snprintf(logMsg, sizeof(logMsg), "CVDriver: Native hub - %s rejected (%s), markers uncalibrated",
+                    path.c_str(), error.c_str());
+                VRDriverLog()->Log(logMsg);
+            }
         }
         
-        if (m_rightController) {
-            m_rightController->CheckConnection();
-            m_rightController->RunFrame();
+        std::string error;
+        if (!m_nativeHub.Configure(settings, calibration, error)) {
+            snprintf(logMsg, sizeof(logMsg), "CVDriver: Invalid 'native_hub_orientation' setting (%s): %s",
+                error.c_str(), settings.orientation.c_str());
+            VRDriverLog()->Log(logMsg);
+            return false;
         }
+        snprintf(logMsg, sizeof(logMsg),
+            "CVDriver: Native hub - markers on port %d, calibration %s, orientation sources '%s', "
+            "fusion %.0f ms, position noise %.1f mm, accel noise %.1f, max prediction %.0f ms",
+            (int)settings.port, path.empty() ? "off" : path.c_str(), settings.orientation.c_str(),
+            settings.fusion.orientationTimeConstantSec * 1000.0, settings.fusion.positionNoiseM * 1000.0,
+            settings.fusion.accelerationNoise, settings.fusion.maxPredictionSec * 1000.0);
+        VRDriverLog()->Log(logMsg);
+        return true;
     }
     
-    virtual bool ShouldBlockStandbyMode() override { return false; }
-    virtual void EnterStandby() override {}
-    virtual void LeaveStandby() override {}
+    // Создает, настраивает и регистрирует в SteamVR устройство из списка
+    bool CreateDevice(const DeviceSpec& spec) {
+        std::unique_ptr<CVDevice> device;
+        std::string serial = spec.serial;
+        const char* settingsName = DeviceTypeName(spec.type);
+        std::string logName;
+        ETrackedDeviceClass deviceClass = TrackedDeviceClass_Controller;
+        
+        switch (spec.type) {
+        case DeviceType::Hmd:
+            device = std::make_unique<CVHeadset>();
+            if (serial.empty()) serial = "CV_HMD";
+            logName = "CVHeadset";
+            deviceClass = TrackedDeviceClass_HMD;
+            break;
+        case DeviceType::LeftController:
+        case DeviceType::RightController: {
+            ETrackedControllerRole role = spec.type == DeviceType::LeftController
+                ? TrackedControllerRole_LeftHand : TrackedControllerRole_RightHand;
+            ControllerProfile profile = MakeCVControllerProfile(role);
+            if (serial.empty()) {
+                serial = role == TrackedControllerRole_LeftHand ? "CV_Controller_Left" : "CV_Controller_Right";
+            } else {
+                profile.serialNumber = serial;
+            }
+            profile.inputMapping = LoadInputMapping(kDriverSettingsSection, settingsName, profile.inputMapping);
+            device = std::make_unique<CVController>(role, profile);
+            logName = std::string("CVController ") + settingsName;
+            break;
+        }
+        case DeviceType::GyroMouse: {
+            // Гиромышь - такой же контроллер, но со своим профилем и портом
+            ControllerProfile profile = MakeGyroMouseProfile(TrackedControllerRole_LeftHand, kDriverName);
+            if (serial.empty()) {
+                serial = "GyroMouse_Controller";
+            } else {
+                profile.serialNumber = serial;
+            }
+            profile.inputMapping = LoadInputMapping(kDriverSettingsSection, settingsName, profile.inputMapping);
+            device = std::make_unique<CVController>(TrackedControllerRole_LeftHand, profile);
+            logName = "GyroMouseController";
+            break;
+        }
+        case DeviceType::Tracker: {
+            if (serial.empty()) serial = "CV_TRACKER_" + std::to_string(spec.id);
+            ControllerProfile profile = MakeTrackerProfile(serial);
+            profile.inputMapping = LoadInputMapping(kDriverSettingsSection, settingsName, profile.inputMapping);
+            device = std::make_unique<CVController>(TrackedControllerRole_OptOut, profile);
+            logName = serial;
+            deviceClass = TrackedDeviceClass_GenericTracker;
+            break;
+        }
+        }
+        
+        ConfigureDevice(*device, m_settings, settingsName, spec.id, logName.c_str());
+        device->SetCalibration(&m_calibration, spec.id);
+        
+        char logMsg[256];
+        if (!VRServerDriverHost()->TrackedDeviceAdded(serial.c_str(), deviceClass, device.get())) {
+            snprintf(logMsg, sizeof(logMsg), "CVDriver: Failed to add %s (id %d)!", serial.c_str(), (int)spec.id);
+            VRDriverLog()->Log(logMsg);
+            return false;
+        }
+        
+        // SteamVR держит указатель на устройство до Cleanup, поэтому
+        // регистрируем его в таблице только после успешного добавления
+        m_devices.Add(spec.id, std::move(device));
+        snprintf(logMsg, sizeof(logMsg), "CVDriver: %s registered as %s (controller_id %d)",
+            serial.c_str(), DeviceTypeName(spec.type), (int)spec.id);
+        VRDriverLog()->Log(logMsg);
+        return true;
+    }
+    
+    // Поток кадра: трекеры для id, которые пришли по сети, но не описаны в "devices".
+    // Id, который SteamVR не принял, больше не запрашивается: пакеты для
+    // него идут дальше, и иначе была бы попытка (и строка лога) каждый кадр.
+    void AddRequestedTrackers(uint32_t requests) {
+        requests &= ~m_failedTrackers;
+        for (uint8_t id = 0; id < kMaxTrackedDevices; id++) {
+            if ((requests & (1u << id)) == 0 || m_devices.Contains(id)) {
+                continue;
+            }
+            DeviceSpec spec;
+            spec.id = id;
+            spec.type = DeviceType::Tracker;
+            if (!CreateDevice(spec)) {
+                m_failedTrackers |= 1u << id;
+                char logMsg[128];
+                snprintf(logMsg, sizeof(logMsg),
+                    "CVDriver: controller_id %d is not retried until the driver restarts", (int)id);
+                VRDriverLog()->Log(logMsg);
+            }
+        }
+    }
+    
+    // Общие для всех устройств настройки + переопределения "<key>_<device>" (фильтр - и "<key>_<device>_<id>")
+    static void ConfigureDevice(CVDevice& device, const DriverSettings& settings,
+                                const char* settingsName, uint8_t id, const char* logName) {
+        SubmitSettings submit = LoadSubmitSettings(kDriverSettingsSection, settingsName, settings.submit);
+        FilterSettings filter = LoadFilterSettings(kDriverSettingsSection, settingsName, id);
+        
+        device.SetPredictionSettings(settings.prediction);
+        device.SetSubmitSettings(submit, logName);
+        device.SetInterpolationDelay(settings.interpolationDelaySec);
+        device.SetFilterSettings(filter);
+        
+        char logMsg[256];
+        snprintf(logMsg, sizeof(logMsg), "CVDriver: %s - immediate submit %s (max %.0f Hz)",
+            logName, submit.immediate ? "on" : "off", submit.maxRateHz);
+        VRDriverLog()->Log(logMsg);
+        LogFilterSettings(logName, filter);
+    }
+    
+    static void LogFilterSettings(const char* device, const FilterSettings& filter) {
+        char logMsg[256];
+        if (!filter.enabled) {
+            snprintf(logMsg, sizeof(logMsg), "CVDriver: Pose filter (%s) - off", device);
+        } else {
+            snprintf(logMsg, sizeof(logMsg),
+                "CVDriver: Pose filter (%s) - position min cutoff %.2f Hz beta %.2f, "
+                "rotation min cutoff %.2f Hz beta %.2f, d cutoff %.2f Hz",
+                device, filter.minCutoffHz, filter.beta,
+                filter.rotationMinCutoffHz, filter.rotationBeta, filter.derivativeCutoffHz);
+        }
+        VRDriverLog()->Log(logMsg);
+    }
+    
+    void LogLoopStats(const LoopStats& stats) {
+        if (stats.wakeups == 0) {
+            return;
+        }
+        LogAsync(LogCategory::IoLoop,
+            "CVDriver: I/O loop - %llu wakeups, %llu packets (%llu rejected, %llu checksum, "
+            "%llu stale, %llu coalesced), %.2f pkt/wakeup (max %u), dispatch avg %.1f us max %.1f us",
+            stats.wakeups, stats.packets, stats.rejected, stats.checksumFailures,
+            stats.stale, stats.superseded,
+            (double)stats.packets / stats.wakeups, stats.maxPacketsPerWakeup,
+            stats.totalDispatchUs / stats.wakeups, stats.maxDispatchUs);
+        LogAsync(LogCategory::IoLoop,
+            "CVDriver: I/O thread - %llu wait timeouts late avg %.2f ms max %.2f ms, %llu core changes",
+            stats.timeouts, stats.timeouts > 0 ? stats.totalTimeoutLateUs / stats.timeouts / 1000.0 : 0.0,
+            stats.maxTimeoutLateUs / 1000.0, stats.coreChanges);
+    }
+    
+    void DispatchSample(const CoalescedSample& sample) {
+        // Route data to appropriate device: O(1) по controller_id
+        uint8_t id = sample.latest.controller_id;
+        CVDevice* device = m_devices.Find(id);
+        if (device) {
+            device->UpdateFromSample(sample);
+        } else if (m_settings.autoAddTrackers) {
+            // Устройство создаст поток кадра; до этого пакеты отбрасываются
+            m_devices.RequestDevice(id);
+        }
+    }
+    
+    // Счетчики потока пакетов - в телеметрию устройств, в том числе тех,
+    // чьи пакеты в этой пачке все отброшены (устаревшие, checksum)
+    void PublishLinkCounters(const PacketBatch& batch) {
+        uint32_t changed = batch.ChangedCounters();
+        for (uint8_t id = 0; changed != 0; id++, changed >>= 1) {
+            if ((changed & 1u) == 0) {
+                continue;
+            }
+            if (CVDevice* device = m_devices.Find(id)) {
+                device->UpdateLinkCounters(batch.Counters(id));
+            }
+        }
+    }
+    
+    // Поток кадра: частота дисплея HMD (любого драйвера) для подсказок
+    void ReadDisplayFrequency() {
+        ETrackedPropertyError error = TrackedProp_Success;
+        float displayHz = VRProperties()->GetFloatProperty(
+            VRProperties()->TrackedDeviceToPropertyContainer(k_unTrackedDeviceIndex_Hmd),
+            Prop_DisplayFrequency_Float, &error);
+        m_displayHz.store(error == TrackedProp_Success ? displayHz : 0.0f, std::memory_order_relaxed);
+    }
+    
+    // Сетевой поток: одна подсказка частоты на отправителя - хаб шлет
+    // несколько устройств из одного сокета
+    void SendRateHints(std::chrono::steady_clock::time_point now) {
+        float displayHz = m_displayHz.load(std::memory_order_relaxed);
+        bool standby = m_standby.load(std::memory_order_relaxed);
+        m_rateHintCount = 0;
+        for (uint8_t id = 0; id < kMaxTrackedDevices; id++) {
+            CVDevice* device = m_devices.Find(id);
+            SenderAddress sender;
+            if (!device || !m_networkClient->SenderOf(id, now, sender)) {
+                continue;
+            }
+            DeviceLinkState state;
+            device->ReadLinkState(state);
+            RateHint hint = m_rateHints.Plan(id, state, displayHz, standby, now);
+            
+            size_t target = 0;
+            while (target < m_rateHintCount &&
+                   (m_rateHintTargets[target].sender.address != sender.address ||
+                    m_rateHintTargets[target].sender.port != sender.port)) {
+                target++;
+            }
+            if (target == m_rateHintCount) {
+                m_rateHintTargets[m_rateHintCount++] = { sender, hint };
+            } else {
+                MergeRateHint(m_rateHintTargets[target].hint, hint);
+            }
+        }
+        for (size_t i = 0; i < m_rateHintCount; i++) {
+            m_networkClient->SendRateHint(m_rateHintTargets[i].sender, m_rateHintTargets[i].hint);
+        }
+    }
+    
+    // Последние подсказки - рядом со статистикой цикла
+    void LogRateHints() const {
+        for (size_t i = 0; i < m_rateHintCount; i++) {
+            const RateHintTarget& target = m_rateHintTargets[i];
+            // Адрес и порт - в сетевом порядке байт
+            const uint8_t* ip = reinterpret_cast<const uint8_t*>(&target.sender.address);
+            const uint8_t* port = reinterpret_cast<const uint8_t*>(&target.sender.port);
+            const RateHint& hint = target.hint;
+            LogAsync(LogCategory::Link,
+                "CVDriver: Rate hint %u.%u.%u.%u:%u - %.0f Hz (display %.1f Hz, loss %.1f%%, jitter %.2f ms)%s",
+                ip[0], ip[1], ip[2], ip[3], (unsigned)(port[0] << 8 | port[1]), hint.requestedHz,
+                hint.displayHz, hint.loss * 100.0f, hint.jitterMs,
+                (hint.flags & kRateHintStandby) ? ", standby" : (hint.flags & kRateHintIdle) ? ", idle" : "");
+        }
+    }
     
-private:
     void NetworkThread() {
-        VRDriverLog()->Log("CVDriver: Network thread started, waiting for data on port 5555...");
+        // MMCSS, приоритет и ядро применяются к самому потоку
+        m_ioScheduling.Apply(m_settings.ioThread);
+        char logMsg[256];
+        snprintf(logMsg, sizeof(logMsg), "CVDriver: Network thread started (%s), waiting for data...",
+            m_ioScheduling.Describe().c_str());
+        VRDriverLog()->Log(logMsg);
         
-        int logCounter = 0;
-        ControllerData data;
+        uint64_t logCounter = 0;
+        LoopStats stats;
+        auto lastStatsTime = std::chrono::steady_clock::now();
+        uint32_t lastCore = CurrentProcessorNumber();
+        auto nextRateHint = lastStatsTime;
         
         while (m_running) {
-            if (m_networkClient && m_networkClient->Receive(data)) {
-                // Log every 1000 packets
-                if (logCounter % 1000 == 0) {
-                    char logMsg[256];
-                    snprintf(logMsg, sizeof(logMsg), 
-                        "CVDriver: Packet %u from device %d - Pos(%.2f,%.2f,%.2f)", 
-                        data.packet_number, (int)data.controller_id,
-                        data.accel_x, data.accel_y, data.accel_z);
-                    VRDriverLog()->Log(logMsg);
+            // Спим до прихода датаграммы (без опроса и sleep_for)
+            auto waitStart = std::chrono::steady_clock::now();
+            bool readable = m_networkClient && m_networkClient->WaitForData(kWaitTimeoutMs);
+            auto wakeTime = std::chrono::steady_clock::now();
+            
+            if (!readable) {
+                double waitedUs = std::chrono::duration<double, std::micro>(wakeTime - waitStart).count();
+                if (waitedUs >= kWaitTimeoutMs * 1000.0) {
+                    double lateUs = waitedUs - kWaitTimeoutMs * 1000.0;
+                    stats.timeouts++;
+                    stats.totalTimeoutLateUs += lateUs;
+                    if (lateUs > stats.maxTimeoutLateUs) stats.maxTimeoutLateUs = lateUs;
                 }
-                logCounter++;
+            }
+            uint32_t core = CurrentProcessorNumber();
+            if (core != lastCore) {
+                stats.coreChanges++;
+                lastCore = core;
+            }
+            
+            if (readable) {
+                // Вычитываем все, что накопилось в сокете, и сливаем пакеты
+                // по устройствам: одна поза на устройство за пробуждение
+                m_batch.Clear();
+                m_hubBatch.Clear();
+                m_networkClient->ReceiveBatch(m_batch, kMaxPacketsPerWakeup,
+                                              m_nativeHub.Enabled() ? &m_hubBatch : nullptr);
                 
-                // Route data to appropriate device
-                if (data.controller_id == 0 && m_leftController) {
-                    m_leftController->UpdateFromArduino(data);
-                } 
-                else if (data.controller_id == 1 && m_rightController) {
-                    m_rightController->UpdateFromArduino(data);
+                for (size_t i = 0; i < m_batch.DeviceCount(); i++) {
+                    const CoalescedSample& sample = m_batch.Device(i);
+                    
+                    // Log every 1000 packets
+                    uint64_t before = logCounter;
+                    logCounter += sample.packetCount;
+                    if (before / 1000 != logCounter / 1000 || before == 0) {
+                        const ControllerData& data = sample.latest;
+                        LogAsync(LogCategory::Packets,
+                            "CVDriver: Packet %u from device %d - Pos(%.2f,%.2f,%.2f)",
+                            data.packet_number, (int)data.controller_id,
+                            data.accel_x, data.accel_y, data.accel_z);
+                    }
+                    
+                    // Гиромышь - источник ориентации встроенного хаба, а не устройство
+                    if (m_nativeHub.IsOrientationSource(sample.latest.controller_id)) {
+                        m_nativeHub.AddOrientation(sample, wakeTime);
+                        continue;
+                    }
+                    DispatchSample(sample);
                 }
-                else if (data.controller_id == 2 && m_headset) {
-                    m_headset->UpdateFromNetwork(data);
+                if (m_nativeHub.Enabled()) {
+                    for (size_t i = 0; i < m_hubBatch.DeviceCount(); i++) {
+                        m_nativeHub.AddMarker(m_hubBatch.Device(i), wakeTime);
+                    }
+                    size_t fused = m_nativeHub.Fuse(wakeTime, m_hubSamples);
+                    for (size_t i = 0; i < fused; i++) {
+                        DispatchSample(m_hubSamples[i]);
+                    }
                 }
+                PublishLinkCounters(m_batch);
+                PublishLinkCounters(m_hubBatch);
+                
+                uint32_t received = m_batch.PacketCount() + m_hubBatch.PacketCount();
+                double dispatchUs = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - wakeTime).count();
+                stats.wakeups++;
+                stats.packets += received;
+                stats.rejected += m_batch.RejectedCount() + m_hubBatch.RejectedCount();
+                stats.checksumFailures += m_batch.ChecksumFailureCount() + m_hubBatch.ChecksumFailureCount();
+                stats.stale += m_batch.StaleCount() + m_hubBatch.StaleCount();
+                stats.superseded += m_batch.SupersededCount() + m_hubBatch.SupersededCount();
+                stats.totalDispatchUs += dispatchUs;
+                if (dispatchUs > stats.maxDispatchUs) stats.maxDispatchUs = dispatchUs;
+                if (received > stats.maxPacketsPerWakeup) stats.maxPacketsPerWakeup = received;
+            }
+            
+            // Запросы синхронизации часов отправителям с метками времени;
+            // таймаут ожидания гарантирует, что это происходит и без пакетов
+            if (m_networkClient) {
+                m_networkClient->PollClockSync(wakeTime);
+            }
+            if (m_settings.rateHints.enabled && m_networkClient && wakeTime >= nextRateHint) {
+                SendRateHints(wakeTime);
+                nextRateHint = wakeTime + kRateHintPeriod;
             }
             
-            // Small sleep to avoid CPU spinning
-            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            if (wakeTime - lastStatsTime >= std::chrono::seconds(kLoopStatsPeriodSec)) {
+                LogLoopStats(stats);
+                if (m_networkClient) {
+                    m_networkClient->LogClockSync();
+                    m_networkClient->LogTransportStats();
+                }
+                LogRateHints();
+                stats.Reset();
+                lastStatsTime = wakeTime;
+            }
         }
         
+        m_ioScheduling.Revert();
         VRDriverLog()->Log("CVDriver: Network thread stopped.");
     }
     
-    std::unique_ptr<CVHeadset> m_headset;
-    std::unique_ptr<CVController> m_leftController;
-    std::unique_ptr<CVController> m_rightController;
+    DriverSettings m_settings;   // прочитаны в Init, дальше только читаются
+    DeviceRegistry m_devices;
+    uint32_t m_failedTrackers = 0;   // поток кадра: id, которые TrackedDeviceAdded не принял
+    CalibrationStore m_calibration;   // переживает устройства: они читают из него
     std::unique_ptr<NetworkClient> m_networkClient;
+    PacketBatch m_batch;  // используется только сетевым потоком
+    // Встроенный хаб (сетевой поток): сырые маркеры и готовые сэмплы устройств
+    NativeHub m_nativeHub;
+    PacketBatch m_hubBatch;
+    std::array<CoalescedSample, kMaxTrackedDevices> m_hubSamples;
     std::thread m_networkThread;
+    ThreadScheduling m_ioScheduling;   // сетевой поток
+    TimerResolution m_timerResolution;
     std::atomic<bool> m_running{false};
+    
+    // Подсказки частоты отправителям (rate_hints)
+    struct RateHintTarget {
+        SenderAddress sender;
+        RateHint hint;
+    };
+    RateHintPlanner m_rateHints;   // сетевой поток
+    std::array<RateHintTarget, kMaxTrackedDevices> m_rateHintTargets;   // сетевой поток
+    size_t m_rateHintCount = 0;
+    std::atomic<bool> m_standby{false};
+    std::atomic<float> m_displayHz{0.0f};   // 0 - неизвестна
+    std::chrono::steady_clock::time_point m_nextDisplayHzRead;   // поток кадра
 };
 
 // Global driver instance
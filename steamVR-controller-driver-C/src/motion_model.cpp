@@ -0,0 +1,191 @@
+// src/motion_model.cpp
+#include "motion_model.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Сглаживание оценок (доля нового значения)
+constexpr double kPeriodAlpha = 0.05;
+constexpr double kVelocityAlpha = 0.5;
+constexpr double kAccelerationAlpha = 0.3;
+
+// Ограничение ускорения: все, что больше, считаем шумом трекинга
+constexpr double kMaxAcceleration = 50.0;   // м/с^2
+
+// Разрыв потока, после которого история сбрасывается
+constexpr int32_t kMaxPacketGap = 100;
+constexpr double kMaxSampleGapSec = 0.25;
+// Откат номера пакета больше этого значения - перезапуск отправителя
+constexpr int32_t kRestartGap = 1000;
+
+constexpr double kMinSampleDt = 1e-4;
+
+// Поворот позы на угловую скорость за dt (в пространстве драйвера): q' = dq * q
+void IntegrateRotation(vr::DriverPose_t& pose, double dt) {
+    const double* w = pose.vecAngularVelocity;
+    double rate = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    if (rate > 1e-6) {
+        double halfAngle = 0.5 * rate * dt;
+        double s = std::sin(halfAngle) / rate;
+        vr::HmdQuaternion_t dq = { std::cos(halfAngle), w[0] * s, w[1] * s, w[2] * s };
+        const vr::HmdQuaternion_t q = pose.qRotation;
+        pose.qRotation.w = dq.w * q.w - dq.x * q.x - dq.y * q.y - dq.z * q.z;
+        pose.qRotation.x = dq.w * q.x + dq.x * q.w + dq.y * q.z - dq.z * q.y;
+        pose.qRotation.y = dq.w * q.y - dq.x * q.z + dq.y * q.w + dq.z * q.x;
+        pose.qRotation.z = dq.w * q.z + dq.x * q.y - dq.y * q.x + dq.z * q.w;
+    }
+}
+
+// Постоянная затухания не меньше этого (деление в экспоненте)
+constexpr double kMinCoastDecaySec = 1e-3;
+
+} // namespace
+
+void MotionModel::Reset() {
+    m_hasSample = false;
+    m_hasVelocity = false;
+    m_lastPacket = 0;
+    m_periodDt = 0.0;
+    m_periodDn = 0.0;
+    for (int i = 0; i < 3; i++) {
+        m_lastPosition[i] = 0.0;
+        m_velocity[i] = 0.0;
+        m_acceleration[i] = 0.0;
+    }
+}
+
+bool MotionModel::AddSample(uint32_t packetNumber,
+                            std::chrono::steady_clock::time_point sampleTime,
+                            const double position[3]) {
+    if (m_hasSample) {
+        int32_t dn = static_cast<int32_t>(packetNumber - m_lastPacket);
+        double arrivalDt = std::chrono::duration<double>(sampleTime - m_lastTime).count();
+
+        // Откат после паузы - перезапуск отправителя (счет снова с 0),
+        // а не переупорядоченный пакет: как в SequenceTracker
+        if (dn <= 0 && dn > -kRestartGap && arrivalDt <= kMaxSampleGapSec) {
+            return false;   // повтор или переупорядоченный пакет
+        }
+
+        if (dn <= 0 || dn > kMaxPacketGap || arrivalDt > kMaxSampleGapSec) {
+            Reset();
+        } else {
+            // Период отправителя: отношение средних, устойчиво к пачкам
+            m_periodDt += kPeriodAlpha * (arrivalDt - m_periodDt);
+            m_periodDn += kPeriodAlpha * (dn - m_periodDn);
+
+            double dt = dn * SamplePeriod();
+            if (dt > kMinSampleDt) {
+                for (int i = 0; i < 3; i++) {
+                    double velocity = (position[i] - m_lastPosition[i]) / dt;
+                    double smoothed = m_hasVelocity
+                        ? m_velocity[i] + kVelocityAlpha * (velocity - m_velocity[i])
+                        : velocity;
+
+                    if (m_hasVelocity) {
+                        double acceleration = (smoothed - m_velocity[i]) / dt;
+                        acceleration = std::max(-kMaxAcceleration, std::min(kMaxAcceleration, acceleration));
+                        m_acceleration[i] += kAccelerationAlpha * (acceleration - m_acceleration[i]);
+                    }
+                    m_velocity[i] = smoothed;
+                }
+                m_hasVelocity = true;
+            }
+        }
+    }
+
+    if (!m_hasSample) {
+        // Первое приближение периода, пока нет истории
+        m_periodDt = 1.0 / 60.0;
+        m_periodDn = 1.0;
+        m_hasSample = true;
+    }
+
+    m_lastPacket = packetNumber;
+    m_lastTime = sampleTime;
+    for (int i = 0; i < 3; i++) {
+        m_lastPosition[i] = position[i];
+    }
+    return true;
+}
+
+double MotionModel::SampleInterval(uint32_t packetNumber) const {
+    if (!m_hasSample) {
+        return 0.0;
+    }
+    int32_t dn = static_cast<int32_t>(packetNumber - m_lastPacket);
+    if (dn <= 0 || dn > kMaxPacketGap) {
+        return 0.0;
+    }
+    return dn * SamplePeriod();
+}
+
+void MotionModel::FillPose(vr::DriverPose_t& pose) const {
+    for (int i = 0; i < 3; i++) {
+        pose.vecVelocity[i] = m_velocity[i];
+        pose.vecAcceleration[i] = m_acceleration[i];
+    }
+}
+
+void ApplyPrediction(vr::DriverPose_t& pose, double sampleAgeSec, const PredictionSettings& settings) {
+    double age = std::max(0.0, std::min(sampleAgeSec, (double)settings.maxExtrapolationSec));
+
+    if (!settings.extrapolateInDriver || !pose.poseIsValid) {
+        // SteamVR сам доведет позу от момента измерения до фотонов
+        pose.poseTimeOffset = -age;
+        return;
+    }
+
+    double dt = std::min(age + settings.predictionSec, (double)settings.maxExtrapolationSec);
+
+    for (int i = 0; i < 3; i++) {
+        pose.vecPosition[i] += pose.vecVelocity[i] * dt + 0.5 * pose.vecAcceleration[i] * dt * dt;
+    }
+
+    IntegrateRotation(pose, dt);
+
+    // Поза теперь относится к моменту "сейчас + упреждение"
+    pose.poseTimeOffset = dt - age;
+}
+
+CoastState PredictFramePose(vr::DriverPose_t& pose, double sinceUpdateSec, double sampleAgeSec,
+                            const PredictionSettings& settings) {
+    if (sinceUpdateSec > settings.disconnectSec) {
+        pose.deviceIsConnected = false;
+        pose.poseIsValid = false;
+        ApplyPrediction(pose, sampleAgeSec, settings);
+        return CoastState::Disconnected;
+    }
+    if (!pose.poseIsValid || sinceUpdateSec <= settings.maxExtrapolationSec) {
+        ApplyPrediction(pose, sampleAgeSec, settings);
+        return CoastState::Tracking;
+    }
+
+    // Сдвигаем позу к "сейчас": до coastSec с полной скоростью, дальше
+    // скорость v * exp(-t / tau), путь за затухание не больше v * tau.
+    // Ускорение за такие интервалы - шум, его не интегрируем.
+    double tau = std::max((double)settings.coastDecaySec, kMinCoastDecaySec);
+    double decaySec = std::max(0.0, sinceUpdateSec - settings.coastSec);
+    double k = std::exp(-decaySec / tau);
+    double horizon = std::max(0.0, sampleAgeSec - decaySec) + tau * (1.0 - k);
+
+    for (int i = 0; i < 3; i++) {
+        pose.vecPosition[i] += pose.vecVelocity[i] * horizon;
+    }
+    IntegrateRotation(pose, horizon);
+    for (int i = 0; i < 3; i++) {
+        pose.vecVelocity[i] *= k;
+        pose.vecAngularVelocity[i] *= k;
+        pose.vecAcceleration[i] = 0.0;
+        pose.vecAngularAcceleration[i] = 0.0;
+    }
+
+    // Поза уже на "сейчас": дальше только упреждение (или SteamVR)
+    ApplyPrediction(pose, 0.0, settings);
+    if (decaySec > 0.0) {
+        pose.result = vr::TrackingResult_Running_OutOfRange;
+        return CoastState::OutOfRange;
+    }
+    return CoastState::Coasting;
+}
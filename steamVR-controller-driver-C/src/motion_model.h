@@ -0,0 +1,88 @@
+// src/motion_model.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <chrono>
+#include <cstdint>
+
+// Настройки предсказания позы (читаются из vrsettings при Init)
+struct PredictionSettings {
+    // false - отдаем скорость/ускорение и poseTimeOffset, экстраполирует SteamVR.
+    // true  - драйвер сам экстраполирует позу к моменту отправки (+ predictionSec).
+    bool extrapolateInDriver = false;
+    float predictionSec = 0.0f;          // дополнительное упреждение в режиме драйвера
+    float maxExtrapolationSec = 0.05f;   // ограничение возраста сэмпла для экстраполяции
+    
+    // Без новых сэмплов (по времени прихода последнего): до coastSec поза
+    // движется дальше по скорости, затем скорость затухает с постоянной
+    // coastDecaySec, после disconnectSec устройство отключается
+    float coastSec = 0.15f;
+    float coastDecaySec = 0.1f;
+    float disconnectSec = 1.0f;
+};
+
+// Состояние позы кадра по давности последнего сэмпла (PredictFramePose)
+enum class CoastState : uint8_t {
+    Tracking,       // сэмпл не старше maxExtrapolationSec: обычное предсказание
+    Coasting,       // движение по скорости последнего сэмпла
+    OutOfRange,     // скорость затухает, TrackingResult_Running_OutOfRange
+    Disconnected    // poseIsValid и deviceIsConnected сброшены
+};
+
+// Оценка линейной скорости и ускорения устройства по истории сэмплов.
+//
+// Время прихода UDP-пакетов сильно "дрожит" (пачки после паузы Wi-Fi),
+// поэтому интервал между сэмплами берется не по времени прихода, а по
+// разнице packet_number, умноженной на оцененный период отправителя.
+// Период оценивается как отношение скользящих средних dt/dn.
+//
+// Вызывается только из сетевого потока.
+class MotionModel {
+public:
+    MotionModel() { Reset(); }
+
+    void Reset();
+
+    // Добавляет сэмпл позиции. sampleTime - время захвата, если оно известно,
+    // иначе время прихода. Возвращает false для устаревших/повторных пакетов;
+    // откат номера дольше kMaxSampleGapSec после прошлого сэмпла или больше
+    // kRestartGap - перезапуск отправителя, история сбрасывается.
+    bool AddSample(uint32_t packetNumber,
+                   std::chrono::steady_clock::time_point sampleTime,
+                   const double position[3]);
+
+    const double* Velocity() const { return m_velocity; }
+    const double* Acceleration() const { return m_acceleration; }
+    double SamplePeriod() const { return m_periodDt / m_periodDn; }
+    // Интервал от последнего сэмпла до пакета packetNumber по шкале отправителя.
+    // 0, если истории нет, пакет устаревший или после разрыва потока.
+    double SampleInterval(uint32_t packetNumber) const;
+
+    // Заполняет vecVelocity / vecAcceleration позы текущей оценкой
+    void FillPose(vr::DriverPose_t& pose) const;
+
+private:
+    bool m_hasSample;
+    bool m_hasVelocity;
+    uint32_t m_lastPacket;
+    std::chrono::steady_clock::time_point m_lastTime;
+    double m_lastPosition[3];
+
+    double m_periodDt;   // скользящее среднее интервала прихода, с
+    double m_periodDn;   // скользящее среднее шага packet_number
+
+    double m_velocity[3];
+    double m_acceleration[3];
+};
+
+// Поток кадра: подготавливает позу к отправке с учетом возраста сэмпла.
+// В режиме SteamVR выставляет poseTimeOffset = -age, в режиме драйвера
+// сдвигает позицию/ориентацию вперед по скорости и ускорению.
+void ApplyPrediction(vr::DriverPose_t& pose, double sampleAgeSec, const PredictionSettings& settings);
+
+// Поток кадра: ApplyPrediction с учетом пропадания данных. sinceUpdateSec -
+// с прихода последнего сэмпла, sampleAgeSec - возраст позы. Пока данных нет,
+// поза сдвигается к "сейчас" по скорости (а не повторяется замершей) и
+// скорость затухает, так что после короткого провала Wi-Fi нет рывка.
+CoastState PredictFramePose(vr::DriverPose_t& pose, double sinceUpdateSec, double sampleAgeSec,
+                            const PredictionSettings& settings);
@@ -0,0 +1,403 @@
+// src/native_hub.cpp
+#include "native_hub.h"
+#include "json_lite.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace vr;
+
+namespace {
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+bool ParseId(const std::string& text, uint8_t& id) {
+    char* end = nullptr;
+    long value = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != 0 || value < 0 || value >= (long)kMaxTrackedDevices) {
+        return false;
+    }
+    id = static_cast<uint8_t>(value);
+    return true;
+}
+
+// Массив из count чисел (так хаб сохраняет векторы и кватернионы)
+bool ReadNumbers(const JsonValue* value, double* out, size_t count) {
+    if (value == nullptr) {
+        return true;   // нет ключа - значение по умолчанию
+    }
+    if (!value->IsArray() || value->items.size() != count) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!value->items[i].IsNumber() || !std::isfinite(value->items[i].number)) return false;
+        out[i] = value->items[i].number;
+    }
+    return true;
+}
+
+bool ReadFlags(const JsonValue* value, bool out[3]) {
+    if (value == nullptr) {
+        return true;
+    }
+    if (!value->IsArray() || value->items.size() != 3) {
+        return false;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        if (value->items[i].type != JsonValue::Type::Bool) return false;
+        out[i] = value->items[i].boolean;
+    }
+    return true;
+}
+
+bool ReadQuaternion(const JsonValue* value, HmdQuaternion_t& q) {
+    double wxyz[4] = { q.w, q.x, q.y, q.z };
+    if (!ReadNumbers(value, wxyz, 4)) {
+        return false;
+    }
+    double norm = std::sqrt(wxyz[0] * wxyz[0] + wxyz[1] * wxyz[1] + wxyz[2] * wxyz[2] + wxyz[3] * wxyz[3]);
+    if (norm < 1e-6) {
+        return false;
+    }
+    q = { wxyz[0] / norm, wxyz[1] / norm, wxyz[2] / norm, wxyz[3] / norm };
+    return true;
+}
+
+HmdQuaternion_t Multiply(const HmdQuaternion_t& a, const HmdQuaternion_t& b) {
+    return {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+    };
+}
+
+HmdQuaternion_t Conjugate(const HmdQuaternion_t& q) {
+    return { q.w, -q.x, -q.y, -q.z };
+}
+
+HmdQuaternion_t Normalize(HmdQuaternion_t q) {
+    double norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    if (norm < 1e-9) {
+        return { 1.0, 0.0, 0.0, 0.0 };
+    }
+    return { q.w / norm, q.x / norm, q.y / norm, q.z / norm };
+}
+
+// Нормализованная интерполяция по кратчайшей дуге: шаги коррекции малы
+void Rotate(const HmdQuaternion_t& q, const double v[3], double out[3]) {
+    HmdQuaternion_t p = { 0.0, v[0], v[1], v[2] };
+    HmdQuaternion_t r = Multiply(Multiply(q, p), Conjugate(q));
+    out[0] = r.x;
+    out[1] = r.y;
+    out[2] = r.z;
+}
+
+HmdQuaternion_t QuaternionOf(const ControllerData& data) {
+    return { data.quat_w, data.quat_x, data.quat_y, data.quat_z };
+}
+
+void StoreQuaternion(ControllerData& data, const FusionQuaternion& q) {
+    data.quat_w = static_cast<float>(q.w);
+    data.quat_x = static_cast<float>(q.x);
+    data.quat_y = static_cast<float>(q.y);
+    data.quat_z = static_cast<float>(q.z);
+}
+
+FusionQuaternion ToFusion(const HmdQuaternion_t& q) {
+    FusionQuaternion f;
+    f.w = q.w;
+    f.x = q.x;
+    f.y = q.y;
+    f.z = q.z;
+    return f;
+}
+
+// Время входа для FusionEngine: захват по ClockSync, иначе приход
+std::chrono::steady_clock::time_point SourceTime(const CoalescedSample& sample,
+                                                 std::chrono::steady_clock::time_point receivedAt) {
+    return sample.capturedAt != std::chrono::steady_clock::time_point() ? sample.capturedAt : receivedAt;
+}
+
+} // namespace
+
+bool ParseHubConfig(const std::string& text, HubCalibrationTable& table, std::string& error) {
+    table = HubCalibrationTable();
+    JsonValue root;
+    if (!ParseJson(text, root, error)) {
+        return false;
+    }
+    if (!root.IsObject()) {
+        error = "top level is not an object";
+        return false;
+    }
+
+    for (const auto& member : root.members) {
+        uint8_t id;
+        if (!ParseId(member.first, id)) {
+            continue;   // webcam_calibration, source_config, general_settings
+        }
+        const JsonValue& entry = member.second;
+        HubCalibration& c = table[id];
+        if (!entry.IsObject() ||
+            !ReadNumbers(entry.Find("position_offset"), c.offset, 3) ||
+            !ReadNumbers(entry.Find("position_scale"), c.scale, 3) ||
+            !ReadFlags(entry.Find("axis_invert"), c.axisInvert) ||
+            !ReadFlags(entry.Find("rotation_invert"), c.rotationInvert) ||
+            !ReadQuaternion(entry.Find("rotation_offset_quat"), c.rotationOffset) ||
+            !ReadNumbers(entry.Find("calibration_reference_position"), c.referencePosition, 3) ||
+            !ReadQuaternion(entry.Find("calibration_reference_rotation"), c.referenceRotation)) {
+            error = "bad calibration for controller " + member.first;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseOrientationSources(const char* text, std::array<uint8_t, kMaxTrackedDevices>& sources,
+                             std::string& error) {
+    sources.fill(NativeHub::kNoSource);
+    std::string list = text ? text : "";
+
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find_first_of(";,", start);
+        if (end == std::string::npos) end = list.size();
+        std::string entry = Trim(list.substr(start, end - start));
+        start = end + 1;
+        if (entry.empty()) {
+            continue;
+        }
+
+        size_t equals = entry.find('=');
+        uint8_t device, gyro;
+        if (equals == std::string::npos ||
+            !ParseId(Trim(entry.substr(0, equals)), device) ||
+            !ParseId(Trim(entry.substr(equals + 1)), gyro)) {
+            error = "expected '<device>=<gyroId>' in '" + entry + "'";
+            return false;
+        }
+        if (device == gyro || sources[device] != NativeHub::kNoSource) {
+            error = "bad orientation source in '" + entry + "'";
+            return false;
+        }
+        sources[device] = gyro;
+    }
+
+    // Гиромышь не может сама быть целью: ее пакеты уходят в хаб
+    for (uint8_t device = 0; device < kMaxTrackedDevices; device++) {
+        if (sources[device] != NativeHub::kNoSource && sources[sources[device]] != NativeHub::kNoSource) {
+            error = "controller " + std::to_string(sources[device]) + " is both a target and a source";
+            return false;
+        }
+    }
+    return true;
+}
+
+NativeHub::NativeHub()
+    : m_enabled(false), m_sourceMask(0), m_touchedCount(0) {
+    m_orientationSource.fill(kNoSource);
+    m_isTouched.fill(false);
+}
+
+bool NativeHub::Configure(const NativeHubSettings& settings, const HubCalibrationTable& calibration,
+                          std::string& error) {
+    m_enabled = false;
+    m_sourceMask = 0;
+    if (!ParseOrientationSources(settings.orientation.c_str(), m_orientationSource, error)) {
+        return false;
+    }
+    for (uint8_t source : m_orientationSource) {
+        if (source != kNoSource) {
+            m_sourceMask |= 1u << source;
+        }
+    }
+    m_calibration = calibration;
+
+    FusionSettings fusion = settings.fusion;
+    fusion.orientationTimeConstantSec = std::max(fusion.orientationTimeConstantSec, 0.01);
+    fusion.positionNoiseM = std::max(fusion.positionNoiseM, 1e-4);
+    fusion.accelerationNoise = std::max(fusion.accelerationNoise, 0.01);
+    fusion.maxPredictionSec = std::max(fusion.maxPredictionSec, 0.0);
+    for (Target& target : m_targets) {
+        target.fusion.Configure(fusion);
+        target.outputNumber = 0;
+    }
+    m_enabled = settings.enabled;
+    return true;
+}
+
+void NativeHub::MarkTouched(uint8_t id) {
+    if (!m_isTouched[id]) {
+        m_isTouched[id] = true;
+        m_touched[m_touchedCount++] = id;
+    }
+}
+
+void NativeHub::AddOrientation(const CoalescedSample& sample, std::chrono::steady_clock::time_point now) {
+    uint8_t id = sample.latest.controller_id;
+    Source& gyro = m_gyros[id];
+    gyro.valid = true;
+    gyro.touched = true;
+    gyro.sample = sample;
+    gyro.receivedAt = now;
+
+    FusionQuaternion orientation = ToFusion(QuaternionOf(sample.latest));
+    for (uint8_t device = 0; device < kMaxTrackedDevices; device++) {
+        if (m_orientationSource[device] == id) {
+            m_targets[device].fusion.AddGyro(orientation, SourceTime(sample, now));
+            MarkTouched(device);
+        }
+    }
+}
+
+void NativeHub::AddMarker(const CoalescedSample& sample, std::chrono::steady_clock::time_point now) {
+    uint8_t id = sample.latest.controller_id;
+    Target& target = m_targets[id];
+    target.marker.valid = true;
+    target.marker.touched = true;
+    target.marker.sample = sample;
+    target.marker.receivedAt = now;
+
+    double position[3];
+    HmdQuaternion_t rotation;
+    Calibrate(id, sample.latest, position, rotation);
+    target.fusion.AddOptical(position, ToFusion(rotation), SourceTime(sample, now));
+    MarkTouched(id);
+}
+
+// Порт CalibrationManager.apply_calibration хаба
+void NativeHub::Calibrate(uint8_t id, const ControllerData& raw, double position[3],
+                          HmdQuaternion_t& rotation) const {
+    const HubCalibration& c = m_calibration[id];
+
+    // Позиция: от точки калибровки, в мировые оси, инверсия, масштаб, смещение
+    double relative[3] = {
+        raw.accel_x - c.referencePosition[0],
+        raw.accel_y - c.referencePosition[1],
+        raw.accel_z - c.referencePosition[2]
+    };
+    double rotated[3];
+    Rotate(c.rotationOffset, relative, rotated);
+    for (int i = 0; i < 3; i++) {
+        double value = c.axisInvert[i] ? -rotated[i] : rotated[i];
+        position[i] = value * c.scale[i] + c.offset[i];
+    }
+
+    // Поворот с момента калибровки (оси камеры), переведенный в мировые оси
+    HmdQuaternion_t relativeRotation = Multiply(QuaternionOf(raw), Conjugate(c.referenceRotation));
+    HmdQuaternion_t world = Multiply(Multiply(c.rotationOffset, relativeRotation), Conjugate(c.rotationOffset));
+    if (c.rotationInvert[0]) world.x = -world.x;
+    if (c.rotationInvert[1]) world.y = -world.y;
+    if (c.rotationInvert[2]) world.z = -world.z;
+    rotation = Normalize(world);
+}
+
+// Момент выхода - самый свежий вход этой пачки, в той же шкале, что и
+// входы FusionEngine (SourceTime)
+std::chrono::steady_clock::time_point NativeHub::FuseTime(const Target& target, const Source* gyro,
+                                                          std::chrono::steady_clock::time_point now) const {
+    std::chrono::steady_clock::time_point t;
+    if (target.marker.touched) {
+        t = SourceTime(target.marker.sample, target.marker.receivedAt);
+    }
+    if (gyro && gyro->touched) {
+        t = std::max(t, SourceTime(gyro->sample, gyro->receivedAt));
+    }
+    return t != std::chrono::steady_clock::time_point() ? t : now;
+}
+
+size_t NativeHub::Fuse(std::chrono::steady_clock::time_point now,
+                       std::array<CoalescedSample, kMaxTrackedDevices>& out) {
+    size_t count = 0;
+    for (size_t i = 0; i < m_touchedCount; i++) {
+        uint8_t id = m_touched[i];
+        m_isTouched[id] = false;
+        Target& target = m_targets[id];
+        Source* gyro = m_orientationSource[id] != kNoSource ? &m_gyros[m_orientationSource[id]] : nullptr;
+
+        bool markerFresh = target.marker.valid && now - target.marker.receivedAt < kSourceTimeout;
+        bool gyroFresh = gyro && gyro->valid && now - gyro->receivedAt < kSourceTimeout;
+        if (!markerFresh && !gyroFresh) {
+            continue;
+        }
+
+        FusedPose fused;
+        if (!target.fusion.Output(FuseTime(target, gyro, now), fused)) {
+            continue;
+        }
+
+        CoalescedSample& sample = out[count++];
+        if (markerFresh) {
+            sample = target.marker.sample;
+            if (!target.marker.touched) {
+                sample.buttonsPressed = 0;
+                sample.buttonsReleased = 0;
+                sample.packetCount = 0;
+            }
+        } else {
+            // Только гироскоп: кнопки маркера не держатся
+            sample = gyro->sample;
+            sample.latest.buttons = 0;
+            sample.latest.trigger = 0;
+            sample.buttonsPressed = 0;
+            sample.buttonsReleased = 0;
+            sample.packetCount = 0;
+        }
+
+        ControllerData& data = sample.latest;
+        data.controller_id = id;
+        data.packet_number = ++target.outputNumber;
+        data.accel_x = static_cast<float>(fused.position[0]);
+        data.accel_y = static_cast<float>(fused.position[1]);
+        data.accel_z = static_cast<float>(fused.position[2]);
+        StoreQuaternion(data, fused.rotation);
+        if (fused.hasAngularVelocity) {
+            data.gyro_x = static_cast<float>(fused.angularVelocity[0]);
+            data.gyro_y = static_cast<float>(fused.angularVelocity[1]);
+            data.gyro_z = static_cast<float>(fused.angularVelocity[2]);
+        }
+        // Скорость фильтра позиции - точнее разностей экстраполированных поз
+        sample.hasVelocity = fused.hasPosition;
+        // Номера выхода хаба свои, перезапуск источника их не трогает
+        sample.restarted = false;
+        for (int axis = 0; axis < 3; axis++) {
+            sample.velocity[axis] = static_cast<float>(fused.velocity[axis]);
+        }
+
+        if (gyroFresh) {
+            const CoalescedSample& g = gyro->sample;
+
+            // Кнопки - объединение обоих источников. Отпускание считается,
+            // только если бит не держит и второй источник.
+            uint16_t markerButtons = markerFresh ? target.marker.sample.latest.buttons : 0;
+            if (gyro->touched) {
+                uint16_t released = static_cast<uint16_t>(g.buttonsReleased & ~markerButtons);
+                sample.buttonsReleased = target.marker.touched
+                    ? static_cast<uint16_t>(sample.buttonsReleased & g.buttonsReleased) : released;
+                sample.buttonsPressed |= g.buttonsPressed;
+                sample.packetCount += g.packetCount;
+                if (g.capturedAt > sample.capturedAt) {
+                    sample.capturedAt = g.capturedAt;
+                }
+            } else {
+                sample.buttonsReleased &= static_cast<uint16_t>(~g.latest.buttons);
+            }
+            data.buttons = markerButtons | g.latest.buttons;
+            if (g.latest.trigger > data.trigger) {
+                data.trigger = g.latest.trigger;
+            }
+        }
+    }
+
+    for (uint8_t id = 0; id < kMaxTrackedDevices; id++) {
+        m_targets[id].marker.touched = false;
+        m_gyros[id].touched = false;
+    }
+    m_touchedCount = 0;
+    return count;
+}
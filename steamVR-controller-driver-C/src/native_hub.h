@@ -0,0 +1,120 @@
+// src/native_hub.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "fusion_engine.h"
+#include "packet_batch.h"
+
+// Встроенный хаб: то, что делает hub_tracker_autocalibrated (Python), но в
+// сетевом потоке драйвера, без лишнего UDP-перехода через интерпретатор.
+//
+// Телефон (ArUcoTransform.kt) шлет сырые позы маркеров прямо на порт
+// native_hub_port. Каждый маркер калибруется так же, как в хабе
+// (CalibrationManager.apply_calibration, калибровка из vr_config.json), и
+// становится устройством с тем же controller_id. Если для устройства задан
+// источник ориентации (гиромышь), поворот берется из него - он приходит
+// чаще и без шума детектора, - а ArUco только подтягивает его к себе,
+// убирая дрейф гироскопа. Маркер и гироскоп сводит FusionEngine
+// устройства; выход - с частотой гироскопа, вместе со скоростью.
+//
+// Используется только сетевым потоком, кроме Configure.
+
+// Калибровка одного маркера, поля как в CalibrationData хаба
+struct HubCalibration {
+    double referencePosition[3] = { 0.0, 0.0, 0.0 };           // calibration_reference_position
+    vr::HmdQuaternion_t referenceRotation = { 1.0, 0.0, 0.0, 0.0 };   // calibration_reference_rotation
+    vr::HmdQuaternion_t rotationOffset = { 1.0, 0.0, 0.0, 0.0 };      // rotation_offset_quat
+    bool axisInvert[3] = { false, false, false };
+    bool rotationInvert[3] = { false, false, false };
+    double scale[3] = { 1.0, 1.0, 1.0 };
+    double offset[3] = { 0.0, 0.0, 0.0 };
+};
+
+using HubCalibrationTable = std::array<HubCalibration, kMaxTrackedDevices>;
+
+// Разбирает vr_config.json хаба: калибровка телефона лежит под ключами
+// "0", "1", ... (controller_id), остальные разделы игнорируются.
+// Маркеры без записи получают калибровку по умолчанию (без изменений).
+bool ParseHubConfig(const std::string& text, HubCalibrationTable& table, std::string& error);
+
+// Источники ориентации "<device>=<gyroId>;...", например "0=3": поворот
+// устройства 0 - от гиромыши с controller_id 3. Пусто - только ArUco.
+bool ParseOrientationSources(const char* text, std::array<uint8_t, kMaxTrackedDevices>& sources,
+                             std::string& error);
+
+// Настройки встроенного хаба (vrsettings, см. LoadDriverSettings)
+struct NativeHubSettings {
+    bool enabled = false;
+    uint16_t port = 5554;             // сырые пакеты телефона
+    std::string configFile;           // vr_config.json хаба; пусто - без калибровки
+    std::string orientation;          // ParseOrientationSources
+    FusionSettings fusion;            // native_hub_fusion_*, см. FusionEngine
+};
+
+class NativeHub {
+public:
+    static constexpr uint8_t kNoSource = 0xFF;
+    // Источник старше этого не участвует (как has_aruco / has_gyro хаба)
+    static constexpr std::chrono::milliseconds kSourceTimeout{500};
+
+    NativeHub();
+
+    // Init, до старта сетевого потока. false - ошибка в настройках (error).
+    bool Configure(const NativeHubSettings& settings, const HubCalibrationTable& calibration,
+                   std::string& error);
+
+    bool Enabled() const { return m_enabled; }
+    bool HasOrientationSources() const { return m_sourceMask != 0; }
+    // id - источник ориентации: его пакеты идут в хаб, а не в устройство
+    bool IsOrientationSource(uint8_t id) const {
+        return id < kMaxTrackedDevices && (m_sourceMask & (1u << id)) != 0;
+    }
+
+    // Сетевой поток: сэмпл гиромыши из обычной пачки
+    void AddOrientation(const CoalescedSample& sample, std::chrono::steady_clock::time_point now);
+    // Сетевой поток: сэмпл маркера с порта хаба
+    void AddMarker(const CoalescedSample& sample, std::chrono::steady_clock::time_point now);
+
+    // Сетевой поток, после всех Add* пачки: готовые сэмплы устройств,
+    // чьи источники обновились. Возвращает число сэмплов в out.
+    size_t Fuse(std::chrono::steady_clock::time_point now,
+                std::array<CoalescedSample, kMaxTrackedDevices>& out);
+
+private:
+    struct Source {
+        bool valid = false;
+        bool touched = false;               // пришел в текущей пачке
+        CoalescedSample sample;
+        std::chrono::steady_clock::time_point receivedAt;
+    };
+
+    struct Target {
+        Source marker;
+        FusionEngine fusion;
+        // Свой номер пакета у каждого выхода Fuse: выходов больше, чем
+        // маркеров, и каждый - новая поза для MotionModel
+        uint32_t outputNumber = 0;
+    };
+
+    void Calibrate(uint8_t id, const ControllerData& raw, double position[3],
+                   vr::HmdQuaternion_t& rotation) const;
+    std::chrono::steady_clock::time_point FuseTime(const Target& target, const Source* gyro,
+                                                   std::chrono::steady_clock::time_point now) const;
+    void MarkTouched(uint8_t id);
+
+    bool m_enabled;
+    HubCalibrationTable m_calibration;
+    std::array<uint8_t, kMaxTrackedDevices> m_orientationSource;   // устройство -> гиромышь
+    uint32_t m_sourceMask;
+
+    std::array<Target, kMaxTrackedDevices> m_targets;
+    std::array<Source, kMaxTrackedDevices> m_gyros;    // по controller_id гиромыши
+    std::array<uint8_t, kMaxTrackedDevices> m_touched; // устройства этой пачки
+    std::array<bool, kMaxTrackedDevices> m_isTouched;
+    size_t m_touchedCount;
+};
@@ -1,93 +1,709 @@
 // src/network_client.cpp
 #include "driver.h"
+#include "packet_batch.h"
+#include "async_log.h"
+#include "rio_receiver.h"
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iostream>
 #include <chrono>
+#include <cstdio>
 
 #pragma comment(lib, "ws2_32.lib")
 
-NetworkClient::NetworkClient(uint16_t port) 
-    : m_port(port), m_socket(reinterpret_cast<void*>(INVALID_SOCKET)), m_running(false) {}
+namespace {
+
+// Первые запросы синхронизации чаще, чтобы быстрее набрать окно фильтра
+constexpr uint32_t kFastClockRequests = ClockSync::kWindow;
+constexpr auto kFastClockInterval = std::chrono::milliseconds(100);
+constexpr auto kClockInterval = std::chrono::seconds(1);
+// Отправитель замолчал - забываем его синхронизацию
+constexpr auto kClockSourceTimeout = std::chrono::seconds(5);
+// Время захвата старше этого - ошибка оценки, берем время прихода
+constexpr int64_t kMaxCaptureAgeUs = 500000;
+// Ответ на запрос старше этого числа обменов не принимаем
+constexpr uint32_t kMaxReplyLag = 16;
+// Закрепленный отправитель молчит дольше этого - id отдается новому
+// (отправитель перезапустился с другим портом, телефон сменил адрес)
+constexpr auto kSenderPinTimeout = std::chrono::seconds(2);
+
+static_assert(kMaxTrackedDevices <= kMaxSenderPins, "sender pin table must cover every controller_id");
+static_assert(kMaxListenPorts <= RioReceiver::kMaxSockets, "RIO receiver must cover every listen port");
+
+} // namespace
+
+NetworkClient::NetworkClient()
+    : m_portCount(0), m_readEvent(WSA_INVALID_EVENT), m_wakeEvent(WSA_INVALID_EVENT),
+      m_running(false) {
+    m_ports.fill(0);
+    m_roles.fill(PortRole::Devices);
+    m_sockets.fill(reinterpret_cast<void*>(INVALID_SOCKET));
+}
 
 NetworkClient::~NetworkClient() { 
     Stop(); 
 }
 
+bool NetworkClient::AddPort(uint16_t port, PortRole role) {
+    if (m_running) {
+        return false;
+    }
+    for (size_t i = 0; i < m_portCount; i++) {
+        if (m_ports[i] == port) {
+            return m_roles[i] == role;
+        }
+    }
+    if (m_portCount >= kMaxListenPorts) {
+        return false;
+    }
+    m_roles[m_portCount] = role;
+    m_ports[m_portCount++] = port;
+    return true;
+}
+
 bool NetworkClient::Start() {
+    if (m_portCount == 0 && m_sharedRingName.empty()) {
+        return false;
+    }
+    
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         return false;
     }
     
-    SOCKET socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (socket == INVALID_SOCKET) {
+    // Событие FD_READ: поток спит в WaitForData, пока не придут данные,
+    // вместо опроса сокета с sleep (который на Windows округляется до 1-15 мс).
+    // Одно событие на все сокеты - один поток ждет все порты сразу.
+    m_readEvent = WSACreateEvent();
+    m_wakeEvent = WSACreateEvent();
+    if (m_readEvent == WSA_INVALID_EVENT || m_wakeEvent == WSA_INVALID_EVENT) {
         return false;
     }
     
-    m_socket = reinterpret_cast<void*>(socket);
+    for (size_t i = 0; i < m_portCount; i++) {
+        // Для RIO сокет нужен с WSA_FLAG_REGISTERED_IO; до Windows 8 такого
+        // флага нет - тогда обычный сокет и прием через recvfrom
+        SOCKET socket = INVALID_SOCKET;
+        if (m_registeredIoRequested) {
+            socket = WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_REGISTERED_IO);
+        }
+        if (socket == INVALID_SOCKET) {
+            socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        }
+        if (socket == INVALID_SOCKET) {
+            CloseSockets();
+            return false;
+        }
+        m_sockets[i] = reinterpret_cast<void*>(socket);
+        
+        sockaddr_in serverAddr;
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(m_ports[i]);
+        serverAddr.sin_addr.s_addr = INADDR_ANY;
+        
+        if (bind(socket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+            CloseSockets();
+            return false;
+        }
+        
+        // Устанавливаем неблокирующий режим
+        u_long mode = 1;
+        ioctlsocket(socket, FIONBIO, &mode);
+        
+        // Увеличиваем приемный буфер: при всплесках после Wi-Fi паузы
+        // датаграммы не должны теряться, пока поток их вычитывает
+        int rcvBuf = 1 << 20;
+        setsockopt(socket, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvBuf, sizeof(rcvBuf));
+    }
+    
+    if (m_registeredIoRequested && m_portCount > 0) {
+        uintptr_t sockets[kMaxListenPorts];
+        for (size_t i = 0; i < m_portCount; i++) {
+            sockets[i] = reinterpret_cast<uintptr_t>(m_sockets[i]);
+        }
+        m_registeredIoError.clear();
+        m_rio = std::make_unique<RioReceiver>();
+        if (!m_rio->Start(sockets, m_portCount)) {
+            char reason[128];
+            snprintf(reason, sizeof(reason), "%s failed, error %d",
+                     m_rio->FailedStep(), m_rio->LastError());
+            m_registeredIoError = reason;
+            m_rio.reset();
+        }
+    }
     
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(m_port);
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    // Без RIO - FD_READ на общее событие; с RIO завершения сигналят свое
+    if (!m_rio) {
+        for (size_t i = 0; i < m_portCount; i++) {
+            if (WSAEventSelect(reinterpret_cast<SOCKET>(m_sockets[i]), m_readEvent, FD_READ) == SOCKET_ERROR) {
+                CloseSockets();
+                return false;
+            }
+        }
+    }
     
-    if (bind(socket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        closesocket(socket);
-        return false;
+    // Запись не открылась - принимаем как обычно, main.cpp сообщит
+    if (!m_capturePath.empty()) {
+        CaptureFileHeader header = {};
+        header.startUs = LocalMicros(std::chrono::steady_clock::now());
+        header.portCount = (uint8_t)m_portCount;
+        for (size_t i = 0; i < m_portCount; i++) {
+            header.ports[i] = m_ports[i];
+            header.roles[i] = (uint8_t)m_roles[i];
+        }
+        header.gyroMouseDeviceId = m_decodeOptions.gyroMouseDeviceId;
+        m_capture.Open(m_capturePath, header);
     }
     
-    // Устанавливаем неблокирующий режим
-    u_long mode = 1;
-    ioctlsocket(socket, FIONBIO, &mode);
+    // Общая память - дополнение к UDP: не открылась (занято имя, нет прав) -
+    // локальные отправители продолжат слать по UDP
+    if (!m_sharedRingName.empty()) {
+        m_sharedRing.Open(m_sharedRingName);
+    }
     
     m_running = true;
     return true;
 }
 
+void NetworkClient::CloseSockets() {
+    for (size_t i = 0; i < m_portCount; i++) {
+        SOCKET socket = reinterpret_cast<SOCKET>(m_sockets[i]);
+        if (socket != INVALID_SOCKET) {
+            closesocket(socket);
+            m_sockets[i] = reinterpret_cast<void*>(INVALID_SOCKET);
+        }
+    }
+}
+
 void NetworkClient::Stop() {
     m_running = false;
-    SOCKET socket = reinterpret_cast<SOCKET>(m_socket);
-    if (socket != INVALID_SOCKET) {
-        closesocket(socket);
-        m_socket = reinterpret_cast<void*>(INVALID_SOCKET);
+    CloseSockets();
+    // После сокетов: их закрытие отменяет выставленные приемы RIO
+    m_rio.reset();
+    m_sharedRing.Close();
+    m_capture.Close();
+    if (m_readEvent != WSA_INVALID_EVENT) {
+        WSACloseEvent(m_readEvent);
+        m_readEvent = WSA_INVALID_EVENT;
+    }
+    if (m_wakeEvent != WSA_INVALID_EVENT) {
+        WSACloseEvent(m_wakeEvent);
+        m_wakeEvent = WSA_INVALID_EVENT;
     }
     WSACleanup();
 }
 
-bool NetworkClient::Receive(ControllerData& data) {
-    SOCKET socket = reinterpret_cast<SOCKET>(m_socket);
-    if (socket == INVALID_SOCKET) return false;
+bool NetworkClient::RegisteredIoActive() const {
+    return m_rio != nullptr;
+}
+
+bool NetworkClient::WaitForData(uint32_t timeoutMs) {
+    if (!m_running) return false;
     
+    // Запись в кольце уже есть - не спим. Иначе отправитель, увидев флаг
+    // ожидания, просигналит событие кольца.
+    if (!m_sharedRing.PrepareWait()) {
+        return true;
+    }
+    
+    // С RIO вместо FD_READ ждем событие завершений: RIONotify сигналит
+    // сразу, если завершения уже есть
+    if (m_rio) {
+        m_rio->Arm();
+    }
+    WSAEVENT events[3] = { m_rio ? m_rio->Event() : m_readEvent, m_wakeEvent, m_sharedRing.Event() };
+    DWORD eventCount = m_sharedRing.IsOpen() ? 3 : 2;
+    DWORD result = WSAWaitForMultipleEvents(eventCount, events, FALSE, timeoutMs, FALSE);
+    m_sharedRing.EndWait();
+    
+    if (result == WSA_WAIT_EVENT_0 + 2) {
+        return true;
+    }
+    
+    if (result == WSA_WAIT_EVENT_0 && m_rio) {
+        m_rio->Notified();
+        return true;
+    }
+    
+    if (result == WSA_WAIT_EVENT_0) {
+        // Сбрасываем событие и FD_READ каждого сокета; FD_READ снова
+        // взведется, если после вычитывания в сокете останутся данные
+        bool readable = false;
+        for (size_t i = 0; i < m_portCount; i++) {
+            WSANETWORKEVENTS networkEvents;
+            if (WSAEnumNetworkEvents(reinterpret_cast<SOCKET>(m_sockets[i]), m_readEvent,
+                                     &networkEvents) == 0 &&
+                (networkEvents.lNetworkEvents & FD_READ) != 0) {
+                readable = true;
+            }
+        }
+        return readable;
+    }
+    
+    if (result == WSA_WAIT_EVENT_0 + 1) {
+        WSAResetEvent(m_wakeEvent);
+    }
+    return false;
+}
+
+void NetworkClient::Wake() {
+    if (m_wakeEvent != WSA_INVALID_EVENT) {
+        WSASetEvent(m_wakeEvent);
+    }
+}
+
+ReceiveStatus NetworkClient::Receive(size_t index, PacketBatch& batch) {
+    SOCKET socket = reinterpret_cast<SOCKET>(m_sockets[index]);
+    if (socket == INVALID_SOCKET) return ReceiveStatus::Empty;
+    
+    uint8_t buffer[kMaxDatagramSize];
     sockaddr_in clientAddr;
     int clientAddrSize = sizeof(clientAddr);
     
     int bytesReceived = recvfrom(socket, 
-        (char*)&data, sizeof(ControllerData), 
+        (char*)buffer, sizeof(buffer), 
         0, (sockaddr*)&clientAddr, &clientAddrSize);
     
     if (bytesReceived == SOCKET_ERROR) {
+        int error = WSAGetLastError();
+        // WSAEMSGSIZE - датаграмма больше буфера (обрезана),
+        // WSAECONNRESET - ICMP port unreachable от прошлого sendto.
+        // В обоих случаях в очереди могут оставаться другие пакеты.
+        if (error == WSAEMSGSIZE || error == WSAECONNRESET) {
+            batch.AddRejected();
+            return ReceiveStatus::Invalid;
+        }
+        return ReceiveStatus::Empty;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    CaptureDatagram(index, buffer, (size_t)bytesReceived, clientAddr.sin_addr.s_addr,
+                    clientAddr.sin_port, LocalMicros(now));
+    return ProcessDatagram(index, buffer, (size_t)bytesReceived,
+                           clientAddr.sin_addr.s_addr, clientAddr.sin_port, now, batch);
+}
+
+ReceiveStatus NetworkClient::ReplayDatagram(size_t index, const uint8_t* data, size_t size,
+                                            uint32_t address, uint16_t port,
+                                            std::chrono::steady_clock::time_point now,
+                                            PacketBatch& batch) {
+    if (index >= m_portCount) {
+        batch.AddRejected();
+        return ReceiveStatus::Invalid;
+    }
+    return ProcessDatagram(index, data, size, address, port, now, batch);
+}
+
+void NetworkClient::CaptureDatagram(size_t index, const uint8_t* data, size_t size, uint32_t address,
+                                    uint16_t port, int64_t arrivalUs) {
+    if (!m_capture.IsOpen()) {
+        return;
+    }
+    CaptureRecordHeader record = {};
+    record.arrivalUs = arrivalUs;
+    record.wakeup = m_wakeup;
+    record.address = address;
+    record.port = port;
+    record.size = (uint16_t)size;
+    record.source = (uint8_t)CaptureSource::Datagram;
+    record.socketIndex = (uint8_t)index;
+    record.captureAgeUs = -1;
+    m_capture.Write(record, data);
+}
+
+ReceiveStatus NetworkClient::ProcessDatagram(size_t index, const uint8_t* buffer, size_t size,
+                                             uint32_t address, uint16_t port,
+                                             std::chrono::steady_clock::time_point now,
+                                             PacketBatch& batch) {
+    int64_t nowUs = LocalMicros(now);
+    
+    TimeReply reply;
+    if (DecodeTimeReply(buffer, size, reply)) {
+        ClockSource* source = FindClockSource(address, port, index, false, now);
+        if (source && source->nextSequence - reply.sequence <= kMaxReplyLag) {
+            source->clock.AddExchange((int64_t)reply.requestUs, (int64_t)reply.receiveUs,
+                                      (int64_t)reply.transmitUs, nowUs);
+            source->repliesReceived++;
+        }
+        return ReceiveStatus::Ok;
+    }
+    
+    ControllerData records[kMaxTrackedDevices];
+    CaptureStamp stamps[kMaxTrackedDevices];
+    DecodeError error = DecodeError::None;
+    size_t count = DecodeDatagram(buffer, size, m_decodeOptions,
+                                  records, kMaxTrackedDevices, &error, stamps);
+    if (count == 0) {
+        if (error == DecodeError::Checksum) {
+            // Сбой checksum относим к устройству, если его id можно прочитать
+            uint8_t claimedId = kMaxTrackedDevices;
+            ClaimedDeviceId(buffer, size, m_decodeOptions, claimedId);
+            batch.AddChecksumFailure(claimedId);
+        } else {
+            batch.AddRejected();
+        }
+        return ReceiveStatus::Invalid;
+    }
+    
+    ClockSource* source = nullptr;
+    // Записи порта встроенного хаба - номера маркеров, а не устройств:
+    // в таблицу закрепления устройств они не попадают
+    bool devicesPort = m_roles[index] == PortRole::Devices;
+    for (size_t i = 0; i < count; i++) {
+        if (devicesPort && !AcceptSender(records[i].controller_id, address, port, index, now)) {
+            batch.AddRejected();
+            continue;
+        }
+        // Время захвата по часам драйвера; без синхронизации - неизвестно
+        std::chrono::steady_clock::time_point capturedAt;
+        if (stamps[i].valid) {
+            if (!source) {
+                source = FindClockSource(address, port, index, true, now);
+            }
+            int64_t localUs;
+            if (source && source->clock.ToLocal(stamps[i].senderUs, nowUs, localUs) &&
+                nowUs - localUs <= kMaxCaptureAgeUs) {
+                // Из будущего - погрешность оценки смещения
+                capturedAt = FromLocalMicros(localUs < nowUs ? localUs : nowUs);
+            }
+        }
+        // address:port - ключ отправителя для распознавания перезапуска
+        batch.Add(records[i], capturedAt, (uint64_t)address << 16 | port, now);
+    }
+    if (source) {
+        source->lastSeen = now;
+    }
+    return ReceiveStatus::Ok;
+}
+
+size_t NetworkClient::ReceiveRegisteredIo(PacketBatch& batch, size_t max, PacketBatch* hubBatch) {
+    // Датаграммы разбираются прямо в зарегистрированном буфере, затем
+    // слоты пачкой выставляются на прием снова
+    constexpr size_t kChunk = 64;
+    RioDatagram datagrams[kChunk];
+    size_t total = 0;
+    while (total < max) {
+        size_t count = m_rio->Dequeue(datagrams, max - total < kChunk ? max - total : kChunk);
+        // Одно время прихода на пачку завершений: они уже лежали в очереди
+        auto now = std::chrono::steady_clock::now();
+        int64_t nowUs = LocalMicros(now);
+        for (size_t i = 0; i < count; i++) {
+            const RioDatagram& datagram = datagrams[i];
+            PacketBatch& target = (m_roles[datagram.socketIndex] == PortRole::NativeHub && hubBatch)
+                ? *hubBatch : batch;
+            if (datagram.failed) {
+                // Как WSAEMSGSIZE/WSAECONNRESET у recvfrom
+                target.AddRejected();
+                continue;
+            }
+            CaptureDatagram(datagram.socketIndex, datagram.data, datagram.size,
+                            datagram.address, datagram.port, nowUs);
+            ProcessDatagram(datagram.socketIndex, datagram.data, datagram.size,
+                            datagram.address, datagram.port, now, target);
+        }
+        m_rio->Release(datagrams, count);
+        total += count;
+        if (count < kChunk) {
+            break;
+        }
+    }
+    return total;
+}
+
+bool NetworkClient::AcceptSender(uint8_t id, uint32_t address, uint16_t port, size_t socketIndex,
+                                 std::chrono::steady_clock::time_point now) {
+    if (id >= kMaxTrackedDevices) {
+        // Отбросит PacketBatch::Add
+        return true;
+    }
+    SenderPin& pin = m_senderPins[id];
+    if (pin.valid && pin.address == address && pin.port == port) {
+        pin.socketIndex = socketIndex;
+        pin.lastSeen = now;
+        return true;
+    }
+    if (m_pinSenders && pin.valid && now - pin.lastSeen < kSenderPinTimeout) {
+        m_foreignRecords++;
+        return false;
+    }
+    
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(&address);
+    LogAsync(LogCategory::Link, "CVDriver: Device %u sender %u.%u.%u.%u:%u",
+             (unsigned)id, ip[0], ip[1], ip[2], ip[3], (unsigned)ntohs(port));
+    pin.valid = true;
+    pin.address = address;
+    pin.port = port;
+    pin.socketIndex = socketIndex;
+    pin.lastSeen = now;
+    return true;
+}
+
+bool NetworkClient::SenderOf(uint8_t id, std::chrono::steady_clock::time_point now,
+                             SenderAddress& sender) const {
+    if (id >= kMaxSenderPins) {
         return false;
     }
+    const SenderPin& pin = m_senderPins[id];
+    if (!pin.valid || now - pin.lastSeen >= kSenderPinTimeout) {
+        return false;
+    }
+    sender.address = pin.address;
+    sender.port = pin.port;
+    sender.socketIndex = pin.socketIndex;
+    return true;
+}
+
+void NetworkClient::SendRateHint(const SenderAddress& sender, RateHint hint) {
+    if (!m_running || sender.socketIndex >= m_portCount) {
+        return;
+    }
+    hint.sequence = m_rateHintSequence++;
+    uint8_t message[kV2RateHintSize];
+    size_t size = EncodeRateHint(hint, message, sizeof(message));
+    
+    sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = sender.address;
+    target.sin_port = sender.port;
+    // Как и запросы часов: потерянная подсказка повторится через период
+    SOCKET socket = reinterpret_cast<SOCKET>(m_sockets[sender.socketIndex]);
+    sendto(socket, (const char*)message, (int)size, 0, (const sockaddr*)&target, sizeof(target));
+}
+
+size_t NetworkClient::ReceiveSharedRing(PacketBatch& batch, size_t max) {
+    if (!m_sharedRing.IsOpen()) {
+        return 0;
+    }
     
-    if (bytesReceived == sizeof(ControllerData)) {
-        // Проверяем контрольную сумму
-        if (VerifyChecksum(data)) {
-            return true;
+    auto now = std::chrono::steady_clock::now();
+    size_t count = m_sharedRing.Drain(max, [&](const SharedRingEntry& entry) {
+        // Время захвата - по общему для процессов счетчику, без ClockSync
+        std::chrono::steady_clock::time_point capturedAt;
+        int64_t ageUs;
+        bool aged = m_sharedRing.EntryAgeUs(entry, ageUs) && ageUs <= kMaxCaptureAgeUs;
+        if (aged) {
+            capturedAt = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::microseconds(ageUs));
         }
+        
+        if (m_capture.IsOpen()) {
+            CaptureRecordHeader record = {};
+            record.arrivalUs = LocalMicros(now);
+            record.wakeup = m_wakeup;
+            record.size = (uint16_t)sizeof(ControllerData);
+            record.source = (uint8_t)CaptureSource::SharedRing;
+            record.flags = entry.flags;
+            record.captureAgeUs = aged ? (int32_t)ageUs : -1;
+            m_capture.Write(record, &entry.data);
+        }
+        AddSharedRingRecord(entry.data, entry.flags, capturedAt, now, batch);
+    });
+    m_sharedRingRecords += count;
+    return count;
+}
+
+void NetworkClient::ReplaySharedRingRecord(const ControllerData& data, uint8_t flags,
+                                           std::chrono::steady_clock::time_point capturedAt,
+                                           std::chrono::steady_clock::time_point now,
+                                           PacketBatch& batch) {
+    AddSharedRingRecord(data, flags, capturedAt, now, batch);
+}
+
+void NetworkClient::AddSharedRingRecord(const ControllerData& data, uint8_t flags,
+                                        std::chrono::steady_clock::time_point capturedAt,
+                                        std::chrono::steady_clock::time_point now,
+                                        PacketBatch& batch) {
+    // Отправитель в общей памяти безымянный: перезапуск - только по паузе
+    if ((flags & kSharedRingGyroMouse) == 0) {
+        // Запись читается прямо из общей памяти
+        batch.Add(data, capturedAt, 0, now);
+        return;
+    }
+    // Гиромышь нумерует устройства с 0, как в датаграммах с kV2FlagGyroMouse
+    unsigned id = (unsigned)data.controller_id + m_decodeOptions.gyroMouseDeviceId;
+    if (id >= kMaxTrackedDevices) {
+        batch.AddRejected();
+        return;
+    }
+    ControllerData remapped = data;
+    remapped.controller_id = (uint8_t)id;
+    batch.Add(remapped, capturedAt, 0, now);
+}
+
+void NetworkClient::LogTransportStats() {
+    if (m_foreignRecords != 0) {
+        LogAsync(LogCategory::Link,
+            "CVDriver: Sender pinning - %llu records from other senders dropped",
+            (unsigned long long)m_foreignRecords);
+        m_foreignRecords = 0;
     }
     
-    return false;
+    if (m_capture.IsOpen()) {
+        // Раз в период - на диск: при падении vrserver теряется не больше
+        m_capture.Flush();
+        if (m_capture.RecordCount() != m_captureLoggedRecords) {
+            LogAsync(LogCategory::IoLoop, "CVDriver: Capture - %llu records, %.1f MB%s",
+                (unsigned long long)m_capture.RecordCount(), m_capture.ByteCount() / 1048576.0,
+                m_capture.Failed() ? ", write failed, stopped" : "");
+            m_captureLoggedRecords = m_capture.RecordCount();
+        }
+    }
+    
+    if (!m_sharedRing.IsOpen()) {
+        return;
+    }
+    uint32_t dropped = m_sharedRing.DroppedCount();
+    uint32_t skipped = m_sharedRing.SkippedCount();
+    if (m_sharedRingRecords == 0 && dropped == m_sharedRingDropped && skipped == m_sharedRingSkipped) {
+        return;
+    }
+    LogAsync(LogCategory::IoLoop,
+        "CVDriver: Shared memory input - %llu records, %u dropped (ring full), %u skipped (producer stalled)",
+        (unsigned long long)m_sharedRingRecords, dropped - m_sharedRingDropped, skipped - m_sharedRingSkipped);
+    m_sharedRingRecords = 0;
+    m_sharedRingDropped = dropped;
+    m_sharedRingSkipped = skipped;
 }
 
-bool NetworkClient::VerifyChecksum(const ControllerData& data) {
-    uint8_t sum = 0;
-    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&data);
+NetworkClient::ClockSource* NetworkClient::FindClockSource(uint32_t address, uint16_t port,
+                                                           size_t socketIndex, bool create,
+                                                           std::chrono::steady_clock::time_point now) {
+    ClockSource* free = nullptr;
+    for (ClockSource& source : m_clockSources) {
+        if (source.active && source.address == address && source.port == port) {
+            return &source;
+        }
+        if (!source.active && !free) {
+            free = &source;
+        }
+    }
+    if (!create || !free) {
+        return nullptr;
+    }
     
-    // Суммируем все байты кроме checksum
-    for (size_t i = 0; i < sizeof(ControllerData) - 1; i++) {
-        sum += bytes[i];
+    *free = ClockSource();
+    free->active = true;
+    free->address = address;
+    free->port = port;
+    free->socketIndex = socketIndex;
+    free->lastSeen = now;
+    free->nextRequest = now;
+    return free;
+}
+
+void NetworkClient::ExpireClockSources(std::chrono::steady_clock::time_point now) {
+    for (ClockSource& source : m_clockSources) {
+        if (source.active && now - source.lastSeen > kClockSourceTimeout) {
+            source.active = false;
+        }
     }
+}
+
+void NetworkClient::PollClockSync(std::chrono::steady_clock::time_point now) {
+    ExpireClockSources(now);
+    for (ClockSource& source : m_clockSources) {
+        if (!source.active || now < source.nextRequest) {
+            continue;
+        }
+        
+        SOCKET socket = reinterpret_cast<SOCKET>(m_sockets[source.socketIndex]);
+        uint8_t request[kV2TimeRequestSize];
+        int64_t nowUs = LocalMicros(now);
+        size_t size = EncodeTimeRequest(source.nextSequence, (uint64_t)nowUs, request, sizeof(request));
+        
+        sockaddr_in target;
+        memset(&target, 0, sizeof(target));
+        target.sin_family = AF_INET;
+        target.sin_addr.s_addr = source.address;
+        target.sin_port = source.port;
+        // Ошибку не обрабатываем: следующий запрос уйдет по расписанию
+        sendto(socket, (const char*)request, (int)size, 0, (const sockaddr*)&target, sizeof(target));
+        
+        if (m_capture.IsOpen()) {
+            // Replay принимает ответы по номерам этих запросов
+            CaptureRecordHeader record = {};
+            record.arrivalUs = nowUs;
+            record.wakeup = m_wakeup;
+            record.address = source.address;
+            record.port = source.port;
+            record.size = (uint16_t)size;
+            record.source = (uint8_t)CaptureSource::ClockRequest;
+            record.socketIndex = (uint8_t)source.socketIndex;
+            record.captureAgeUs = -1;
+            m_capture.Write(record, request);
+        }
+        AdvanceClockRequest(source, now);
+    }
+}
+
+void NetworkClient::ReplayClockRequest(uint32_t address, uint16_t port,
+                                       std::chrono::steady_clock::time_point now) {
+    ClockSource* source = FindClockSource(address, port, 0, false, now);
+    if (source) {
+        AdvanceClockRequest(*source, now);
+    }
+}
+
+void NetworkClient::AdvanceClockRequest(ClockSource& source, std::chrono::steady_clock::time_point now) {
+    source.nextSequence++;
+    source.requestsSent++;
+    source.nextRequest = now + (source.requestsSent < kFastClockRequests
+        ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(kFastClockInterval)
+        : std::chrono::duration_cast<std::chrono::steady_clock::duration>(kClockInterval));
+}
+
+void NetworkClient::LogClockSync() const {
+    for (const ClockSource& source : m_clockSources) {
+        if (!source.active) {
+            continue;
+        }
+        const uint8_t* ip = reinterpret_cast<const uint8_t*>(&source.address);
+        if (source.clock.IsSynced()) {
+            int64_t nowUs = LocalMicros(std::chrono::steady_clock::now());
+            LogAsync(LogCategory::ClockSync,
+                "CVDriver: Clock sync %u.%u.%u.%u:%u - offset %+.3f ms, drift %+.1f ppm, "
+                "best round trip %.2f ms, %u/%u replies",
+                ip[0], ip[1], ip[2], ip[3], (unsigned)ntohs(source.port),
+                source.clock.OffsetAt(nowUs) / 1000.0, source.clock.DriftPpm(),
+                source.clock.BestDelayUs() / 1000.0, source.repliesReceived, source.requestsSent);
+        } else {
+            LogAsync(LogCategory::ClockSync,
+                "CVDriver: Clock sync %u.%u.%u.%u:%u - not synced yet (%u/%u replies), "
+                "using arrival time",
+                ip[0], ip[1], ip[2], ip[3], (unsigned)ntohs(source.port),
+                source.repliesReceived, source.requestsSent);
+        }
+    }
+}
+
+size_t NetworkClient::ReceiveBatch(PacketBatch& batch, size_t maxDatagrams, PacketBatch* hubBatch) {
+    size_t datagrams = 0;
+    m_wakeup++;
     
-    return sum == data.checksum;
-}
\ No newline at end of file
+    // RIO: завершения всех сокетов уже в одной очереди
+    if (m_rio) {
+        datagrams = ReceiveRegisteredIo(batch, maxDatagrams, hubBatch);
+    }
+    
+    // По кругу по всем сокетам, пока все не опустеют: ни один порт
+    // не может надолго занять поток
+    bool anyPending = !m_rio;
+    while (anyPending && datagrams < maxDatagrams) {
+        anyPending = false;
+        for (size_t i = 0; i < m_portCount && datagrams < maxDatagrams; i++) {
+            PacketBatch& target = (m_roles[i] == PortRole::NativeHub && hubBatch) ? *hubBatch : batch;
+            ReceiveStatus status = Receive(i, target);
+            if (status == ReceiveStatus::Empty) {
+                continue;
+            }
+            anyPending = true;
+            datagrams++;
+        }
+    }
+    
+    // Кольцо со своим лимитом: поток датаграмм не должен его вытеснять
+    datagrams += ReceiveSharedRing(batch, maxDatagrams);
+    
+    return datagrams;
+}
@@ -0,0 +1,76 @@
+// src/packet_batch.cpp
+#include "packet_batch.h"
+
+static_assert(kMaxTrackedDevices <= 32, "ChangedCounters() is a 32-bit mask");
+
+void PacketBatch::Clear() {
+    for (size_t i = 0; i < m_touchedCount; i++) {
+        m_used[m_touched[i]] = false;
+    }
+    m_touchedCount = 0;
+    m_countersChanged = 0;
+    m_packets = 0;
+    m_superseded = 0;
+    m_stale = 0;
+    m_rejected = 0;
+    m_checksumFailures = 0;
+}
+
+void PacketBatch::AddChecksumFailure(uint8_t claimedId) {
+    m_rejected++;
+    m_checksumFailures++;
+    if (claimedId < kMaxTrackedDevices) {
+        m_sequence[claimedId].CountChecksumFailure();
+        m_countersChanged |= 1u << claimedId;
+    }
+}
+
+void PacketBatch::Add(const ControllerData& data, std::chrono::steady_clock::time_point capturedAt,
+                      uint64_t sender, std::chrono::steady_clock::time_point arrivedAt) {
+    if (data.controller_id >= kMaxTrackedDevices) {
+        m_rejected++;
+        return;
+    }
+
+    m_packets++;
+    m_countersChanged |= 1u << data.controller_id;
+
+    // Устаревший пакет не применяем совсем: его поза и кнопки уже
+    // перекрыты более новым пакетом, в том числе из прошлой пачки
+    PacketOrder order = m_sequence[data.controller_id].Track(data.packet_number, sender, arrivedAt);
+    if (order == PacketOrder::Late) {
+        m_stale++;
+        return;
+    }
+
+    CoalescedSample& slot = m_slots[data.controller_id];
+
+    if (!m_used[data.controller_id]) {
+        m_used[data.controller_id] = true;
+        m_touched[m_touchedCount++] = data.controller_id;
+
+        slot.latest = data;
+        slot.capturedAt = capturedAt;
+        slot.buttonsPressed = data.buttons;
+        slot.buttonsReleased = static_cast<uint16_t>(~data.buttons);
+        slot.packetCount = 1;
+        slot.hasVelocity = false;
+        slot.restarted = order == PacketOrder::Restart;
+        return;
+    }
+
+    // Фронты кнопок учитываем из каждого принятого пакета
+    slot.buttonsPressed |= data.buttons;
+    slot.buttonsReleased |= static_cast<uint16_t>(~data.buttons);
+    slot.packetCount++;
+    m_superseded++;
+    if (order == PacketOrder::Restart) {
+        slot.restarted = true;
+    }
+
+    // Поза - из самого нового пакета (latest-sample-wins). Устаревшие уже
+    // отброшены, поэтому это последний принятый: повтор того же номера
+    // несет свежие кнопки, а после перезапуска номер мог уменьшиться.
+    slot.latest = data;
+    slot.capturedAt = capturedAt;
+}
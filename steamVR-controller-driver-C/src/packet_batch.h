@@ -0,0 +1,108 @@
+// src/packet_batch.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "driver.h"
+#include "device_telemetry.h"
+
+// Максимальное число устройств (controller_id 0..kMaxTrackedDevices-1)
+constexpr size_t kMaxTrackedDevices = 16;
+
+// Результат слияния всех пакетов одного устройства за одну пачку:
+// поза берется из самого нового пакета, а фронты кнопок накапливаются,
+// чтобы короткое нажатие внутри пачки не потерялось.
+struct CoalescedSample {
+    ControllerData latest;
+    uint16_t buttonsPressed;    // биты, нажатые хотя бы в одном пакете
+    uint16_t buttonsReleased;   // биты, отпущенные хотя бы в одном пакете
+    uint32_t packetCount;       // сколько пакетов слито в этот сэмпл
+    // Время захвата latest по часам драйвера (метка отправителя через
+    // ClockSync); time_point() - неизвестно, берется время прихода
+    std::chrono::steady_clock::time_point capturedAt;
+    // Линейная скорость, м/с, если ее уже оценил источник (FusionEngine
+    // встроенного хаба); иначе ее оценивает MotionModel устройства
+    bool hasVelocity;
+    float velocity[3];
+    // В пачке был перезапуск отправителя (PacketOrder::Restart): история
+    // MotionModel и фильтра устройства к новому потоку не относится
+    bool restarted;
+};
+
+// Состояния кнопок, которые нужно последовательно отправить в SteamVR,
+// чтобы воспроизвести все фронты пачки. Сначала отпускания, потом нажатия,
+// потом итоговое состояние. Возвращает число состояний (0..3) в out.
+inline int ExpandButtonEdges(uint16_t previous, const CoalescedSample& sample, uint16_t out[3]) {
+    const uint16_t states[3] = {
+        static_cast<uint16_t>(previous & ~sample.buttonsReleased),
+        static_cast<uint16_t>((previous & ~sample.buttonsReleased) | sample.buttonsPressed),
+        sample.latest.buttons
+    };
+
+    int count = 0;
+    uint16_t last = previous;
+    for (uint16_t state : states) {
+        if (state != last) {
+            out[count++] = state;
+            last = state;
+        }
+    }
+    return count;
+}
+
+// Пачка датаграмм, вычитанных за одно пробуждение сетевого потока.
+// Память выделена заранее, Clear() сбрасывает только затронутые слоты.
+//
+// Номера пакетов каждого устройства отслеживаются между пачками:
+// пакет старше уже принятого отбрасывается целиком и только считается.
+class PacketBatch {
+public:
+    PacketBatch()
+        : m_touchedCount(0), m_countersChanged(0), m_packets(0), m_superseded(0),
+          m_stale(0), m_rejected(0), m_checksumFailures(0) {}
+
+    void Clear();
+    // sender и arrivedAt - см. SequenceTracker::Track
+    void Add(const ControllerData& data,
+             std::chrono::steady_clock::time_point capturedAt = std::chrono::steady_clock::time_point(),
+             uint64_t sender = 0,
+             std::chrono::steady_clock::time_point arrivedAt = std::chrono::steady_clock::time_point());
+    void AddRejected() { m_rejected++; }
+    // Датаграмма не прошла checksum; claimedId >= kMaxTrackedDevices - устройство неизвестно
+    void AddChecksumFailure(uint8_t claimedId);
+
+    // Устройства, получившие данные в этой пачке, в порядке первого пакета
+    size_t DeviceCount() const { return m_touchedCount; }
+    const CoalescedSample& Device(size_t index) const { return m_slots[m_touched[index]]; }
+
+    uint32_t PacketCount() const { return m_packets; }
+    uint32_t SupersededCount() const { return m_superseded; }
+    uint32_t StaleCount() const { return m_stale; }
+    uint32_t RejectedCount() const { return m_rejected; }
+    uint32_t ChecksumFailureCount() const { return m_checksumFailures; }
+
+    // Биты controller_id, чьи счетчики изменились в этой пачке, - в том
+    // числе устройств, все пакеты которых отброшены
+    uint32_t ChangedCounters() const { return m_countersChanged; }
+    // Накопительные счетчики устройства с момента запуска
+    const LinkCounters& Counters(uint8_t id) const { return m_sequence[id].Counters(); }
+
+private:
+    std::array<CoalescedSample, kMaxTrackedDevices> m_slots;
+    std::array<bool, kMaxTrackedDevices> m_used{};
+    std::array<uint8_t, kMaxTrackedDevices> m_touched{};
+    size_t m_touchedCount;
+
+    // Не сбрасываются в Clear(): последовательность живет дольше пачки
+    std::array<SequenceTracker, kMaxTrackedDevices> m_sequence;
+    uint32_t m_countersChanged;
+
+    uint32_t m_packets;            // валидных пакетов в пачке
+    uint32_t m_superseded;         // пакетов, поза которых заменена более новой
+    uint32_t m_stale;              // устаревших пакетов, отброшенных по packet_number
+    uint32_t m_rejected;           // отброшенных датаграмм (размер/checksum/id)
+    uint32_t m_checksumFailures;   // из них не прошли checksum
+};
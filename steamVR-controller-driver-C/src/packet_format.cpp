@@ -0,0 +1,448 @@
+// src/packet_format.cpp
+#include "packet_format.h"
+#include "crc32c.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Контрольная сумма legacy-форматов: сумма всех байт, кроме последнего
+bool VerifyByteSum(const uint8_t* data, size_t size) {
+    uint8_t sum = 0;
+    for (size_t i = 0; i + 1 < size; i++) {
+        sum += data[i];
+    }
+    return sum == data[size - 1];
+}
+
+size_t DecodeController(const uint8_t* data, ControllerData* out, DecodeError& error) {
+    if (!VerifyByteSum(data, sizeof(ControllerData))) {
+        error = DecodeError::Checksum;
+        return 0;
+    }
+    memcpy(out, data, sizeof(ControllerData));
+    return 1;
+}
+
+size_t DecodeGyroMouse(const uint8_t* data, const DecodeOptions& options, ControllerData* out,
+                       DecodeError& error) {
+    if (!VerifyByteSum(data, sizeof(MouseControllerData))) {
+        error = DecodeError::Checksum;
+        return 0;
+    }
+    MouseControllerData mouse;
+    memcpy(&mouse, data, sizeof(mouse));
+
+    ControllerData& record = *out;
+    record.controller_id = static_cast<uint8_t>(options.gyroMouseDeviceId + mouse.controller_id);
+    record.packet_number = mouse.packet_number;
+    record.quat_w = mouse.quat_w;
+    record.quat_x = mouse.quat_x;
+    record.quat_y = mouse.quat_y;
+    record.quat_z = mouse.quat_z;
+    // Как и в ControllerData, "accel" несет позицию
+    record.accel_x = mouse.pos_x;
+    record.accel_y = mouse.pos_y;
+    record.accel_z = mouse.pos_z;
+    record.gyro_x = mouse.gyro_x;
+    record.gyro_y = mouse.gyro_y;
+    record.gyro_z = mouse.gyro_z;
+    record.buttons = mouse.buttons;
+    // Триггер у мыши только кнопочный
+    record.trigger = (mouse.buttons & 0x01) ? 255 : 0;
+    record.checksum = 0;
+    return 1;
+}
+
+// --- Протокол v2 ---
+
+// Компоненты smallest-three лежат в [-1/sqrt(2), 1/sqrt(2)]
+constexpr float kQuatComponentMax = 0.70710678f;
+constexpr uint32_t kQuatComponentMask = (1u << 15) - 1;
+// Симметричная шкала: ноль представим точно
+constexpr float kQuatComponentHalfRange = 16383.0f;
+
+void WriteU16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void WriteU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint16_t ReadU16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+void WriteU64(uint8_t* out, uint64_t value) {
+    WriteU32(out, static_cast<uint32_t>(value));
+    WriteU32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+uint64_t ReadU64(const uint8_t* data) {
+    return ReadU32(data) | (static_cast<uint64_t>(ReadU32(data + 4)) << 32);
+}
+
+// Размер записи v2 с данными флагами
+size_t RecordSizeV2(uint8_t recordFlags) {
+    return kV2MinRecordSize
+        + ((recordFlags & kV2RecordSequence32) ? 3 : 0)
+        + ((recordFlags & kV2RecordPosition) ? 6 : 0)
+        + ((recordFlags & kV2RecordAngularVelocity) ? 6 : 0)
+        + ((recordFlags & kV2RecordInput) ? 3 : 0)
+        + ((recordFlags & kV2RecordTimestamp) ? 4 : 0);
+}
+
+int16_t QuantizeFixed(float value, float scale) {
+    float scaled = std::round(value * scale);
+    return static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, scaled)));
+}
+
+// Неотрицательное значение поля uint16 (подсказка частоты)
+uint16_t SaturateU16(float value) {
+    return static_cast<uint16_t>(std::max(0.0f, std::min(65535.0f, std::round(value))));
+}
+
+void WriteFixed3(uint8_t* out, float x, float y, float z, float scale) {
+    WriteU16(out, static_cast<uint16_t>(QuantizeFixed(x, scale)));
+    WriteU16(out + 2, static_cast<uint16_t>(QuantizeFixed(y, scale)));
+    WriteU16(out + 4, static_cast<uint16_t>(QuantizeFixed(z, scale)));
+}
+
+void ReadFixed3(const uint8_t* data, float scale, float& x, float& y, float& z) {
+    x = static_cast<int16_t>(ReadU16(data)) / scale;
+    y = static_cast<int16_t>(ReadU16(data + 2)) / scale;
+    z = static_cast<int16_t>(ReadU16(data + 4)) / scale;
+}
+
+// Smallest-three: наибольшая по модулю компонента не передается, а
+// восстанавливается из нормы; знак выбирается так, чтобы она была >= 0
+// (q и -q - один и тот же поворот)
+void WriteQuaternion(uint8_t* out, float w, float x, float y, float z) {
+    float q[4] = { w, x, y, z };
+    float norm = std::sqrt(w * w + x * x + y * y + z * z);
+    if (norm < 1e-6f) {
+        q[0] = 1.0f; q[1] = q[2] = q[3] = 0.0f;
+        norm = 1.0f;
+    }
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(q[i]) > std::fabs(q[largest])) largest = i;
+    }
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint64_t packed = static_cast<uint64_t>(largest);
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        float v = sign * q[i] / norm;
+        float unit = std::max(-kQuatComponentMax, std::min(kQuatComponentMax, v)) / kQuatComponentMax;
+        packed = (packed << 15) | static_cast<uint32_t>(std::lround(unit * kQuatComponentHalfRange) + 16383);
+    }
+    for (int i = 0; i < 6; i++) {
+        out[i] = static_cast<uint8_t>(packed >> (8 * i));
+    }
+}
+
+void ReadQuaternion(const uint8_t* data, ControllerData& record) {
+    uint64_t packed = 0;
+    for (int i = 0; i < 6; i++) {
+        packed |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    int largest = static_cast<int>((packed >> 45) & 0x03);
+
+    float q[4];
+    float sumSquares = 0.0f;
+    int shift = 30;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        int32_t steps = static_cast<int32_t>((packed >> shift) & kQuatComponentMask) - 16383;
+        q[i] = steps / kQuatComponentHalfRange * kQuatComponentMax;
+        sumSquares += q[i] * q[i];
+        shift -= 15;
+    }
+    q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+
+    record.quat_w = q[0];
+    record.quat_x = q[1];
+    record.quat_y = q[2];
+    record.quat_z = q[3];
+}
+
+size_t DecodeV2(const uint8_t* data, size_t size, const DecodeOptions& options,
+                ControllerData* out, size_t maxRecords, DecodeError& error, CaptureStamp* stamps) {
+    error = DecodeError::Malformed;
+    if (size < kV2HeaderSize + kV2TrailerSize || data[1] != kV2Version) {
+        error = DecodeError::Size;
+        return 0;
+    }
+    if (Crc32c(data, size - kV2TrailerSize) != ReadU32(data + size - kV2TrailerSize)) {
+        error = DecodeError::Checksum;
+        return 0;
+    }
+
+    uint8_t flags = data[2];
+    size_t count = data[3];
+    uint32_t basePacket = ReadU32(data + 4);
+    if (count == 0 || count > maxRecords) {
+        return 0;
+    }
+
+    const uint8_t* cursor = data + kV2HeaderSize;
+    const uint8_t* end = data + size - kV2TrailerSize;
+    for (size_t i = 0; i < count; i++) {
+        if (end - cursor < (ptrdiff_t)kV2MinRecordSize) {
+            return 0;
+        }
+        uint8_t recordFlags = cursor[1];
+        size_t recordSize = RecordSizeV2(recordFlags);
+        if (end - cursor < (ptrdiff_t)recordSize) {
+            return 0;
+        }
+
+        ControllerData& record = out[i];
+        memset(&record, 0, sizeof(record));
+        record.controller_id = cursor[0];
+        if (flags & kV2FlagGyroMouse) {
+            record.controller_id = static_cast<uint8_t>(options.gyroMouseDeviceId + cursor[0]);
+        }
+
+        const uint8_t* field = cursor + 2;
+        if (recordFlags & kV2RecordSequence32) {
+            record.packet_number = ReadU32(field);
+            field += 4;
+        } else {
+            record.packet_number = basePacket + field[0];
+            field += 1;
+        }
+
+        ReadQuaternion(field, record);
+        field += 6;
+        if (recordFlags & kV2RecordPosition) {
+            ReadFixed3(field, kV2PositionScale, record.accel_x, record.accel_y, record.accel_z);
+            field += 6;
+        }
+        if (recordFlags & kV2RecordAngularVelocity) {
+            ReadFixed3(field, kV2AngularScale, record.gyro_x, record.gyro_y, record.gyro_z);
+            field += 6;
+        }
+        if (recordFlags & kV2RecordInput) {
+            record.buttons = ReadU16(field);
+            record.trigger = field[2];
+            field += 3;
+        }
+        if (stamps) {
+            stamps[i].valid = (recordFlags & kV2RecordTimestamp) != 0;
+            stamps[i].senderUs = stamps[i].valid ? ReadU32(field) : 0;
+        }
+        if (recordFlags & kV2RecordTimestamp) {
+            field += 4;
+        }
+        if (flags & kV2FlagGyroMouse) {
+            // Как в MouseControllerData: триггер у мыши только кнопочный
+            record.trigger = (record.buttons & 0x01) ? 255 : 0;
+        }
+        cursor = field;
+    }
+    if (cursor != end) {
+        return 0;
+    }
+    error = DecodeError::None;
+    return count;
+}
+
+} // namespace
+
+PacketFormat DetectPacketFormat(const uint8_t* data, size_t size) {
+    if (size >= kV2HeaderSize && data[0] == kV2Magic) {
+        return PacketFormat::V2;
+    }
+    switch (size) {
+    case sizeof(ControllerData):      return PacketFormat::Controller;
+    case sizeof(MouseControllerData): return PacketFormat::GyroMouse;
+    default:                          return PacketFormat::Unknown;
+    }
+}
+
+size_t DecodeDatagram(const uint8_t* data, size_t size, const DecodeOptions& options,
+                      ControllerData* out, size_t maxRecords, DecodeError* error,
+                      CaptureStamp* stamps) {
+    DecodeError ignored;
+    DecodeError& result = error ? *error : ignored;
+    result = DecodeError::None;
+    if (size == 0 || maxRecords == 0) {
+        result = DecodeError::Size;
+        return 0;
+    }
+    if (stamps) {
+        // Legacy-форматы времени захвата не несут
+        stamps[0].valid = false;
+        stamps[0].senderUs = 0;
+    }
+
+    switch (DetectPacketFormat(data, size)) {
+    case PacketFormat::Controller: return DecodeController(data, out, result);
+    case PacketFormat::GyroMouse:  return DecodeGyroMouse(data, options, out, result);
+    case PacketFormat::V2:         return DecodeV2(data, size, options, out, maxRecords, result, stamps);
+    default:
+        result = DecodeError::Size;
+        return 0;
+    }
+}
+
+bool ClaimedDeviceId(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t& id) {
+    if (size == 0) {
+        return false;
+    }
+    // controller_id - первый байт обоих legacy-форматов
+    switch (DetectPacketFormat(data, size)) {
+    case PacketFormat::Controller:
+        id = data[0];
+        return true;
+    case PacketFormat::GyroMouse:
+        id = static_cast<uint8_t>(options.gyroMouseDeviceId + data[0]);
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t EncodeDatagramV2(const ControllerData* records, size_t count, uint8_t flags,
+                        uint8_t* out, size_t capacity, const CaptureStamp* stamps) {
+    if (count == 0 || count > 255 || capacity < kV2HeaderSize + kV2TrailerSize) {
+        return 0;
+    }
+
+    // База - наименьший номер, тогда разности неотрицательны
+    uint32_t basePacket = records[0].packet_number;
+    for (size_t i = 1; i < count; i++) {
+        if (static_cast<int32_t>(records[i].packet_number - basePacket) < 0) {
+            basePacket = records[i].packet_number;
+        }
+    }
+
+    out[0] = kV2Magic;
+    out[1] = kV2Version;
+    out[2] = flags;
+    out[3] = static_cast<uint8_t>(count);
+    WriteU32(out + 4, basePacket);
+
+    size_t offset = kV2HeaderSize;
+    for (size_t i = 0; i < count; i++) {
+        const ControllerData& record = records[i];
+        uint32_t delta = record.packet_number - basePacket;
+
+        uint8_t recordFlags = 0;
+        if (delta > 0xFF) recordFlags |= kV2RecordSequence32;
+        if (record.accel_x != 0.0f || record.accel_y != 0.0f || record.accel_z != 0.0f) {
+            recordFlags |= kV2RecordPosition;
+        }
+        if (record.gyro_x != 0.0f || record.gyro_y != 0.0f || record.gyro_z != 0.0f) {
+            recordFlags |= kV2RecordAngularVelocity;
+        }
+        if (record.buttons != 0 || record.trigger != 0) {
+            recordFlags |= kV2RecordInput;
+        }
+        if (stamps && stamps[i].valid) {
+            recordFlags |= kV2RecordTimestamp;
+        }
+
+        size_t recordSize = RecordSizeV2(recordFlags);
+        if (offset + recordSize + kV2TrailerSize > capacity) {
+            return 0;
+        }
+
+        uint8_t* field = out + offset;
+        *field++ = record.controller_id;
+        *field++ = recordFlags;
+        if (recordFlags & kV2RecordSequence32) {
+            WriteU32(field, record.packet_number);
+            field += 4;
+        } else {
+            *field++ = static_cast<uint8_t>(delta);
+        }
+        WriteQuaternion(field, record.quat_w, record.quat_x, record.quat_y, record.quat_z);
+        field += 6;
+        if (recordFlags & kV2RecordPosition) {
+            WriteFixed3(field, record.accel_x, record.accel_y, record.accel_z, kV2PositionScale);
+            field += 6;
+        }
+        if (recordFlags & kV2RecordAngularVelocity) {
+            WriteFixed3(field, record.gyro_x, record.gyro_y, record.gyro_z, kV2AngularScale);
+            field += 6;
+        }
+        if (recordFlags & kV2RecordInput) {
+            WriteU16(field, record.buttons);
+            field[2] = record.trigger;
+            field += 3;
+        }
+        if (recordFlags & kV2RecordTimestamp) {
+            WriteU32(field, stamps[i].senderUs);
+            field += 4;
+        }
+        offset += recordSize;
+    }
+
+    WriteU32(out + offset, Crc32c(out, offset));
+    return offset + kV2TrailerSize;
+}
+
+size_t EncodeTimeRequest(uint32_t sequence, uint64_t localUs, uint8_t* out, size_t capacity) {
+    if (capacity < kV2TimeRequestSize) {
+        return 0;
+    }
+    out[0] = kV2Magic;
+    out[1] = kV2Version;
+    out[2] = kV2FlagTimeRequest;
+    out[3] = 0;
+    WriteU32(out + 4, sequence);
+    WriteU64(out + 8, localUs);
+    WriteU32(out + 16, Crc32c(out, 16));
+    return kV2TimeRequestSize;
+}
+
+size_t EncodeRateHint(const RateHint& hint, uint8_t* out, size_t capacity) {
+    if (capacity < kV2RateHintSize) {
+        return 0;
+    }
+    memset(out, 0, kV2RateHintSize);
+    out[0] = kV2Magic;
+    out[1] = kV2Version;
+    out[2] = kV2FlagRateHint;
+    out[3] = 0;
+    WriteU32(out + 4, hint.sequence);
+    WriteU16(out + 8, SaturateU16(hint.requestedHz));
+    WriteU16(out + 10, SaturateU16(hint.displayHz * 100.0f));
+    WriteU16(out + 12, SaturateU16(hint.loss * 10000.0f));
+    WriteU16(out + 14, SaturateU16(hint.jitterMs * 100.0f));
+    out[16] = hint.flags;
+    WriteU32(out + 20, Crc32c(out, 20));
+    return kV2RateHintSize;
+}
+
+bool DecodeTimeReply(const uint8_t* data, size_t size, TimeReply& reply) {
+    if (size != kV2TimeReplySize || data[0] != kV2Magic || data[1] != kV2Version ||
+        data[2] != kV2FlagTimeReply || data[3] != 0) {
+        return false;
+    }
+    if (Crc32c(data, size - kV2TrailerSize) != ReadU32(data + size - kV2TrailerSize)) {
+        return false;
+    }
+    reply.sequence = ReadU32(data + 4);
+    reply.requestUs = ReadU64(data + 8);
+    reply.receiveUs = ReadU64(data + 16);
+    reply.transmitUs = ReadU64(data + 24);
+    return true;
+}
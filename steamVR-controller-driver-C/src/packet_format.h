@@ -0,0 +1,196 @@
+// src/packet_format.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Структура данных от Arduino контроллера
+#pragma pack(push, 1)
+struct ControllerData {
+    uint8_t controller_id;      // 0 = левый, 1 = правый, 2 = HMD
+    uint32_t packet_number;     // Номер пакета
+    float quat_w, quat_x, quat_y, quat_z;  // Кватернион
+    float accel_x, accel_y, accel_z;       // ПОЗИЦИЯ (не ускорение!)
+    float gyro_x, gyro_y, gyro_z;          // Угловая скорость
+    uint16_t buttons;           // Флаги кнопок
+    uint8_t trigger;            // Значение триггера
+    uint8_t checksum;           // Контрольная сумма
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ControllerData) == 49, "ControllerData size mismatch!");
+
+// Структура данных от гироскопической мыши через UDP (48 байт, без триггера)
+#pragma pack(push, 1)
+struct MouseControllerData {
+    uint8_t controller_id;      // 0 = левый контроллер (гиромышь)
+    uint32_t packet_number;     // Номер пакета
+    float quat_w, quat_x, quat_y, quat_z;  // Кватернион из гироскопа
+    float pos_x, pos_y, pos_z;  // Позиция из ArUco tracking
+    float gyro_x, gyro_y, gyro_z;          // Угловая скорость
+    uint16_t buttons;           // Флаги кнопок мыши
+    uint8_t checksum;           // Контрольная сумма
+};
+#pragma pack(pop)
+
+static_assert(sizeof(MouseControllerData) == 48, "MouseControllerData size mismatch!");
+
+// Максимальный размер принимаемой датаграммы
+constexpr size_t kMaxDatagramSize = 1472;
+
+// Протокол v2: несколько устройств в одной датаграмме, сжатые поля.
+// Все многобайтовые поля little-endian.
+//
+// Заголовок (8 байт):
+//   [0]    kV2Magic (legacy-пакеты начинаются с controller_id < 16)
+//   [1]    kV2Version
+//   [2]    флаги датаграммы (kV2Flag*)
+//   [3]    число записей
+//   [4:8]  базовый packet_number
+// Запись (9..31 байт):
+//   [0]    controller_id
+//   [1]    флаги записи (kV2Record*)
+//   +1/+4  packet_number: разность с базовым (uint8) или полный uint32
+//          при kV2RecordSequence32
+//   +6     кватернион smallest-three: 48 бит = индекс наибольшей по модулю
+//          компоненты (2 бита, w=0..z=3) << 45 | три остальные по 15 бит
+//          (round(v / sqrt(0.5) * 16383) + 16383)
+//   +6     позиция, 3 x int16 по 1/kV2PositionScale м      (kV2RecordPosition)
+//   +6     угловая скорость, 3 x int16 по 1/kV2AngularScale рад/с
+//                                                        (kV2RecordAngularVelocity)
+//   +3     buttons (uint16) + trigger (uint8)           (kV2RecordInput)
+//   +4     время захвата сэмпла по часам отправителя: младшие 32 бита
+//          монотонных микросекунд (kV2RecordTimestamp, см. CaptureStamp)
+// Трейлер: CRC-32C всех предыдущих байт (uint32, crc32c.h). В отличие от
+// суммы байт legacy-форматов ловит перестановки и многобитовые ошибки.
+//
+// Отсутствующие поля равны нулю: отправитель опускает нулевые
+// позицию/скорость/кнопки, каждая запись остается самодостаточной
+// (потеря датаграммы не ломает следующие).
+//
+// Синхронизация часов (NTP-подобно, через тот же UDP-сокет): заголовок v2
+// с count = 0 и одним из флагов kV2FlagTime*, номер обмена в [4:8].
+//   Запрос  (драйвер -> отправитель, 20 байт): [8:16] t1 - время отправки
+//           по часам драйвера, мкс; CRC.
+//   Ответ   (отправитель -> драйвер, 36 байт): [8:16] t1 из запроса,
+//           [16:24] t2 - прием запроса, [24:32] t3 - отправка ответа
+//           (оба по монотонным часам отправителя, мкс); CRC.
+// Драйвер шлет запросы только источникам, присылающим kV2RecordTimestamp.
+//
+// Подсказка частоты (драйвер -> отправитель, 24 байта, rate_hint.h):
+// заголовок v2 с count = 0 и kV2FlagRateHint, номер подсказки в [4:8].
+//   [8:10]  запрошенная частота отправки, Гц (uint16)
+//   [10:12] частота дисплея SteamVR, 1/100 Гц (uint16; 0 - неизвестна)
+//   [12:14] потери за период, 1/10000 (uint16)
+//   [14:16] дрожание интервала прихода, 1/100 мс (uint16)
+//   [16]    флаги kRateHint*
+//   [17:20] резерв, 0; CRC.
+// Отправитель, который подсказки не понимает, их просто не читает.
+constexpr uint8_t kV2Magic = 0xC5;
+constexpr uint8_t kV2Version = 2;
+constexpr size_t kV2HeaderSize = 8;
+constexpr size_t kV2MinRecordSize = 9;
+constexpr size_t kV2TrailerSize = 4;
+
+// Флаги датаграммы
+constexpr uint8_t kV2FlagGyroMouse = 0x01;   // id относительно DecodeOptions::gyroMouseDeviceId
+constexpr uint8_t kV2FlagRateHint = 0x20;
+constexpr uint8_t kV2FlagTimeRequest = 0x40;
+constexpr uint8_t kV2FlagTimeReply = 0x80;
+
+// Флаги записи
+constexpr uint8_t kV2RecordPosition = 0x01;
+constexpr uint8_t kV2RecordAngularVelocity = 0x02;
+constexpr uint8_t kV2RecordInput = 0x04;
+constexpr uint8_t kV2RecordSequence32 = 0x08;
+constexpr uint8_t kV2RecordTimestamp = 0x10;
+
+constexpr size_t kV2TimeRequestSize = 20;
+constexpr size_t kV2TimeReplySize = 36;
+constexpr size_t kV2RateHintSize = 24;
+
+// Флаги подсказки частоты
+constexpr uint8_t kRateHintStandby = 0x01;   // SteamVR в режиме ожидания
+constexpr uint8_t kRateHintIdle = 0x02;      // устройства отправителя неподвижны
+
+constexpr float kV2PositionScale = 2048.0f;   // шаг ~0.5 мм, диапазон +-16 м
+constexpr float kV2AngularScale = 1024.0f;    // шаг ~0.06 град/с, диапазон +-32 рад/с
+
+// Форматы датаграмм, которые понимает драйвер
+enum class PacketFormat : uint8_t {
+    Unknown,
+    Controller,   // ControllerData, 49 байт (хаб / Arduino / симуляторы)
+    GyroMouse,    // MouseControllerData, 48 байт (трекер гиромыши)
+    V2            // протокол v2 с заголовком, любой размер
+};
+
+// Параметры разбора, общие для всех сокетов
+struct DecodeOptions {
+    // Пакеты гиромыши нумеруют устройства с 0, поэтому их controller_id
+    // сдвигается на это значение, чтобы не пересекаться с устройствами хаба
+    uint8_t gyroMouseDeviceId = 3;
+};
+
+// Почему датаграмма отброшена
+enum class DecodeError : uint8_t {
+    None,
+    Size,        // размер не подходит ни к одному формату
+    Checksum,    // не сошлась контрольная сумма
+    Malformed    // заголовок или записи v2 не разбираются
+};
+
+// Время захвата сэмпла по часам отправителя (kV2RecordTimestamp).
+// 32 бита переполняются раз в ~71 мин - разворачивает ClockSync.
+struct CaptureStamp {
+    bool valid;
+    uint32_t senderUs;
+};
+
+// Ответ на запрос синхронизации часов
+struct TimeReply {
+    uint32_t sequence;
+    uint64_t requestUs;    // t1, часы драйвера
+    uint64_t receiveUs;    // t2, часы отправителя
+    uint64_t transmitUs;   // t3, часы отправителя
+};
+
+// Определяет формат датаграммы. Форматы с заголовком распознаются по
+// байту версии, форматы без заголовка (legacy) - по размеру.
+PacketFormat DetectPacketFormat(const uint8_t* data, size_t size);
+
+// Разбирает датаграмму в записи ControllerData (одна датаграмма может
+// нести несколько устройств). Проверяет контрольную сумму.
+// Возвращает число записей в out; 0 - датаграмма отброшена, причина - в error.
+// stamps (если задан) получает время захвата каждой записи.
+size_t DecodeDatagram(const uint8_t* data, size_t size, const DecodeOptions& options,
+                      ControllerData* out, size_t maxRecords, DecodeError* error = nullptr,
+                      CaptureStamp* stamps = nullptr);
+
+// controller_id из legacy-датаграммы, не прошедшей проверку, - чтобы
+// отнести сбой checksum к устройству. false для v2 и неизвестных форматов:
+// там id лежит внутри поврежденных данных.
+bool ClaimedDeviceId(const uint8_t* data, size_t size, const DecodeOptions& options, uint8_t& id);
+
+// Кодирует записи в датаграмму v2 (flags - kV2Flag*). Поле checksum
+// записей не используется; stamps (если задан) - время захвата записей.
+// Возвращает размер датаграммы или 0, если записи не помещаются в capacity.
+size_t EncodeDatagramV2(const ControllerData* records, size_t count, uint8_t flags,
+                        uint8_t* out, size_t capacity, const CaptureStamp* stamps = nullptr);
+
+// Подсказка частоты отправки (см. формат выше)
+struct RateHint {
+    uint32_t sequence;
+    float requestedHz;
+    float displayHz;   // 0 - неизвестна
+    float loss;        // доля потерянных пакетов за период, 0..1
+    float jitterMs;
+    uint8_t flags;     // kRateHint*
+};
+
+// Запрос синхронизации часов. Возвращает размер или 0, если мало места.
+size_t EncodeTimeRequest(uint32_t sequence, uint64_t localUs, uint8_t* out, size_t capacity);
+// true, если датаграмма - целый ответ на запрос синхронизации
+bool DecodeTimeReply(const uint8_t* data, size_t size, TimeReply& reply);
+// Подсказка частоты; значения вне диапазона полей насыщаются.
+// Возвращает размер или 0, если мало места.
+size_t EncodeRateHint(const RateHint& hint, uint8_t* out, size_t capacity);
@@ -0,0 +1,87 @@
+// src/pose_filter.cpp
+#include "pose_filter.h"
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Коэффициент экспоненциального сглаживания для частоты среза cutoffHz
+inline double SmoothingAlpha(double cutoffHz, double dt) {
+    double tau = 1.0 / (2.0 * kPi * cutoffHz);
+    return 1.0 / (1.0 + tau / dt);
+}
+
+inline double QuatDot(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b) {
+    return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Нормализованная интерполяция по кратчайшей дуге. Для малых шагов
+// фильтра (alpha * угол) отличие от slerp пренебрежимо.
+vr::HmdQuaternion_t Nlerp(const vr::HmdQuaternion_t& a, const vr::HmdQuaternion_t& b, double t) {
+    double sign = QuatDot(a, b) < 0.0 ? -1.0 : 1.0;
+    vr::HmdQuaternion_t q = {
+        a.w + (sign * b.w - a.w) * t, a.x + (sign * b.x - a.x) * t,
+        a.y + (sign * b.y - a.y) * t, a.z + (sign * b.z - a.z) * t
+    };
+    double norm = std::sqrt(QuatDot(q, q));
+    if (norm > 0.0) {
+        q.w /= norm; q.x /= norm; q.y /= norm; q.z /= norm;
+    }
+    return q;
+}
+
+} // namespace
+
+double OneEuroFilter::Filter(double value, double dt, double minCutoffHz, double beta, double derivativeCutoffHz) {
+    if (!m_hasValue || dt <= 0.0) {
+        m_hasValue = true;
+        m_value = value;
+        m_derivative = 0.0;
+        return value;
+    }
+
+    double derivative = (value - m_value) / dt;
+    m_derivative += SmoothingAlpha(derivativeCutoffHz, dt) * (derivative - m_derivative);
+
+    double cutoff = minCutoffHz + beta * std::fabs(m_derivative);
+    m_value += SmoothingAlpha(cutoff, dt) * (value - m_value);
+    return m_value;
+}
+
+void PoseFilter::Reset() {
+    for (OneEuroFilter& filter : m_position) {
+        filter.Reset();
+    }
+    m_hasRotation = false;
+    m_rotation = { 1, 0, 0, 0 };
+    m_angularRate = 0.0;
+}
+
+void PoseFilter::Apply(double position[3], vr::HmdQuaternion_t& rotation, double dt) {
+    if (!m_settings.enabled) {
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        position[i] = m_position[i].Filter(position[i], dt, m_settings.minCutoffHz,
+                                           m_settings.beta, m_settings.derivativeCutoffHz);
+    }
+
+    if (!m_hasRotation || dt <= 0.0) {
+        m_hasRotation = true;
+        m_rotation = rotation;
+        m_angularRate = 0.0;
+        return;
+    }
+
+    // Угол между отфильтрованным и новым поворотом задает скорость,
+    // от нее - частота среза, как в One-Euro
+    double dot = std::fabs(QuatDot(m_rotation, rotation));
+    double angle = 2.0 * std::acos(dot > 1.0 ? 1.0 : dot);
+    m_angularRate += SmoothingAlpha(m_settings.derivativeCutoffHz, dt) * (angle / dt - m_angularRate);
+
+    double cutoff = m_settings.rotationMinCutoffHz + m_settings.rotationBeta * m_angularRate;
+    m_rotation = Nlerp(m_rotation, rotation, SmoothingAlpha(cutoff, dt));
+    rotation = m_rotation;
+}
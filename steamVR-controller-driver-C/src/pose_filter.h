@@ -0,0 +1,55 @@
+// src/pose_filter.h
+#pragma once
+
+#include <openvr_driver.h>
+
+// Параметры фильтра позы одного устройства (vrsettings, см. LoadFilterSettings).
+// Чем меньше min cutoff, тем меньше дрожание в покое; чем больше beta,
+// тем меньше отставание при быстром движении.
+struct FilterSettings {
+    bool enabled = false;
+    float minCutoffHz = 1.0f;           // позиция: частота среза в покое
+    float beta = 0.5f;                  // позиция: рост среза на 1 м/с
+    float derivativeCutoffHz = 1.0f;    // сглаживание оценки скорости
+    float rotationMinCutoffHz = 1.0f;   // поворот: частота среза в покое
+    float rotationBeta = 0.1f;          // поворот: рост среза на 1 рад/с
+};
+
+// One-Euro фильтр одной величины (Casiez et al., 2012): низкочастотный
+// фильтр, частота среза которого растет со скоростью сигнала.
+class OneEuroFilter {
+public:
+    OneEuroFilter() { Reset(); }
+
+    void Reset() { m_hasValue = false; m_value = 0.0; m_derivative = 0.0; }
+    double Filter(double value, double dt, double minCutoffHz, double beta, double derivativeCutoffHz);
+
+private:
+    bool m_hasValue;
+    double m_value;
+    double m_derivative;
+};
+
+// Фильтр позы между разбором пакета и публикацией: One-Euro по каждой оси
+// позиции и адаптивный slerp-фильтр поворота (срез растет с угловой
+// скоростью). Без выделения памяти, вызывается только из сетевого потока.
+class PoseFilter {
+public:
+    PoseFilter() { Reset(); }
+
+    void Configure(const FilterSettings& settings) { m_settings = settings; Reset(); }
+    bool IsEnabled() const { return m_settings.enabled; }
+    void Reset();
+
+    // dt - интервал от предыдущего сэмпла, с. dt <= 0 (первый сэмпл,
+    // разрыв потока) сбрасывает фильтр на текущее значение.
+    void Apply(double position[3], vr::HmdQuaternion_t& rotation, double dt);
+
+private:
+    FilterSettings m_settings;
+    OneEuroFilter m_position[3];
+
+    bool m_hasRotation;
+    vr::HmdQuaternion_t m_rotation;
+    double m_angularRate;   // сглаженная угловая скорость, рад/с
+};
@@ -0,0 +1,95 @@
+// src/pose_history.cpp
+#include "pose_history.h"
+#include <cmath>
+
+namespace {
+
+// Сферическая интерполяция по кратчайшей дуге, t в [0, 1]
+vr::HmdQuaternion_t Slerp(const vr::HmdQuaternion_t& a, vr::HmdQuaternion_t b, double t) {
+    double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+    if (dot < 0.0) {
+        b = { -b.w, -b.x, -b.y, -b.z };
+        dot = -dot;
+    }
+
+    double wa, wb;
+    if (dot > 0.9995) {
+        // Почти совпадают - достаточно линейной интерполяции с нормализацией
+        wa = 1.0 - t;
+        wb = t;
+    } else {
+        double theta = std::acos(dot);
+        double sinTheta = std::sin(theta);
+        wa = std::sin((1.0 - t) * theta) / sinTheta;
+        wb = std::sin(t * theta) / sinTheta;
+    }
+
+    vr::HmdQuaternion_t q = {
+        wa * a.w + wb * b.w, wa * a.x + wb * b.x,
+        wa * a.y + wb * b.y, wa * a.z + wb * b.z
+    };
+    double norm = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    if (norm > 0.0) {
+        q.w /= norm; q.x /= norm; q.y /= norm; q.z /= norm;
+    }
+    return q;
+}
+
+void Lerp3(double out[3], const double a[3], const double b[3], double t) {
+    for (int i = 0; i < 3; i++) {
+        out[i] = a[i] + (b[i] - a[i]) * t;
+    }
+}
+
+} // namespace
+
+void PoseHistory::Push(const PoseSample& sample) {
+    if (m_count > 0 && At(m_count - 1).sequence == sample.sequence) {
+        return;
+    }
+    m_samples[m_head] = sample;
+    m_head = (m_head + 1) % kCapacity;
+    if (m_count < kCapacity) {
+        m_count++;
+    }
+}
+
+bool PoseHistory::Interpolate(std::chrono::steady_clock::time_point time, vr::DriverPose_t& pose,
+                              std::chrono::steady_clock::time_point& poseTime) const {
+    if (m_count == 0) {
+        return false;
+    }
+
+    const PoseSample& oldest = At(0);
+    const PoseSample& newest = At(m_count - 1);
+    if (time <= oldest.capturedAt) {
+        pose = oldest.pose;
+        poseTime = oldest.capturedAt;
+        return true;
+    }
+    if (time >= newest.capturedAt) {
+        pose = newest.pose;
+        poseTime = newest.capturedAt;
+        return true;
+    }
+
+    // Ищем с конца: нужный интервал почти всегда среди последних сэмплов
+    size_t i = m_count - 1;
+    while (i > 0 && At(i - 1).capturedAt > time) {
+        i--;
+    }
+    const PoseSample& a = At(i - 1);
+    const PoseSample& b = At(i);
+
+    double span = std::chrono::duration<double>(b.capturedAt - a.capturedAt).count();
+    double t = span > 0.0 ? std::chrono::duration<double>(time - a.capturedAt).count() / span : 1.0;
+
+    // Флаги, скорости и прочее - из более нового сэмпла
+    pose = b.pose;
+    Lerp3(pose.vecPosition, a.pose.vecPosition, b.pose.vecPosition, t);
+    Lerp3(pose.vecVelocity, a.pose.vecVelocity, b.pose.vecVelocity, t);
+    Lerp3(pose.vecAngularVelocity, a.pose.vecAngularVelocity, b.pose.vecAngularVelocity, t);
+    pose.qRotation = Slerp(a.pose.qRotation, b.pose.qRotation, t);
+    poseTime = time;
+    return true;
+}
@@ -0,0 +1,57 @@
+// src/pose_history.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "pose_slot.h"
+
+// Больше 100 мс задержка уже заметнее, чем рывки, которые она убирает
+constexpr float kMaxInterpolationDelaySec = 0.1f;
+
+inline float ClampInterpolationDelay(float seconds) {
+    return seconds < 0.0f ? 0.0f : (seconds > kMaxInterpolationDelaySec ? kMaxInterpolationDelaySec : seconds);
+}
+
+// Короткая история сэмплов позы одного устройства для интерполяции.
+//
+// Трекинг с телефона приходит неровно (30-60 Гц), а SteamVR рисует на
+// 90-144 Гц: если каждый кадр отправлять последний сэмпл, движение
+// "ступенчатое". Поток кадра складывает сюда сэмплы из PoseSlot и
+// отправляет позу на момент "сейчас - задержка воспроизведения",
+// интерполируя между соседними сэмплами (lerp позиции, slerp поворота).
+//
+// Память фиксированная, используется только потоком кадра.
+class PoseHistory {
+public:
+    static constexpr size_t kCapacity = 16;
+
+    PoseHistory() : m_head(0), m_count(0) {}
+
+    void Clear() { m_head = 0; m_count = 0; }
+    bool Empty() const { return m_count == 0; }
+
+    // Добавляет сэмпл; повтор уже добавленного sequence игнорируется
+    void Push(const PoseSample& sample);
+
+    // Поза на момент time по времени захвата сэмплов (PoseSample::capturedAt:
+    // метка отправителя, если часы синхронизированы, иначе время прихода).
+    // Между сэмплами - интерполяция, раньше самого
+    // старого - самый старый сэмпл, позже самого нового - самый новый.
+    // В poseTime возвращается момент, которому соответствует поза.
+    // Возвращает false, если история пуста.
+    bool Interpolate(std::chrono::steady_clock::time_point time, vr::DriverPose_t& pose,
+                     std::chrono::steady_clock::time_point& poseTime) const;
+
+private:
+    // i = 0 - самый старый сэмпл
+    const PoseSample& At(size_t i) const {
+        return m_samples[(m_head + kCapacity - m_count + i) % kCapacity];
+    }
+
+    std::array<PoseSample, kCapacity> m_samples;
+    size_t m_head;    // куда пишется следующий сэмпл
+    size_t m_count;
+};
@@ -0,0 +1,219 @@
+// src/pose_pipeline.cpp
+#include "pose_pipeline.h"
+#include "packet_batch.h"
+#include "calibration.h"
+#include "debug_request.h"
+#include "rate_hint.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace vr;
+
+namespace {
+
+double Length3(const double v[3]) {
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+} // namespace
+
+DevicePosePipeline::DevicePosePipeline(const char* logName)
+    : m_logName(logName), m_deviceIndex(k_unTrackedDeviceIndexInvalid),
+      m_sampleSequence(0), m_frameSequence(0), m_frameState(CoastState::Tracking), m_frameInterpolated(false),
+      m_interpolationDelaySec(0.0f), m_calibration(nullptr), m_calibrationId(0) {
+    memset(&m_pose, 0, sizeof(m_pose));
+    m_pose.qWorldFromDriverRotation = {1, 0, 0, 0};
+    m_pose.qDriverFromHeadRotation = {1, 0, 0, 0};
+    m_pose.qRotation = {1, 0, 0, 0};
+    SetInitialPose(m_pose);
+    m_submitter.SetTelemetry(&m_telemetry);
+}
+
+void DevicePosePipeline::SetInitialPose(const vr::DriverPose_t& pose) {
+    m_pose = pose;
+    auto created = std::chrono::steady_clock::now();
+    m_poseSlot.Write({m_pose, created, created, 0, 0});
+    m_framePose = m_pose;
+    m_submittedPose = m_pose;
+    m_frameReceivedAt = created;
+    m_frameTime = created;
+}
+
+std::chrono::steady_clock::time_point DevicePosePipeline::Update(const CoalescedSample& sample) {
+    // Маршрутизация по controller_id уже сделана в DeviceRegistry
+    const ControllerData& data = sample.latest;
+
+    // Обновляем ориентацию
+    m_pose.qRotation.w = data.quat_w;
+    m_pose.qRotation.x = data.quat_x;
+    m_pose.qRotation.y = data.quat_y;
+    m_pose.qRotation.z = data.quat_z;
+
+    // accel_x/y/z содержит ПОЗИЦИЮ (координаты от хаба), а не ускорение
+    m_pose.vecPosition[0] = data.accel_x;
+    m_pose.vecPosition[1] = data.accel_y;
+    m_pose.vecPosition[2] = data.accel_z;
+
+    // Калибровка (calibration.json): масштаб - в позицию, поворот и
+    // смещение - в world-from-driver, их применит SteamVR
+    if (m_calibration) {
+        m_calibration->For(m_calibrationId).Apply(m_pose);
+    }
+
+    // Обновляем угловую скорость из гироскопа
+    m_pose.vecAngularVelocity[0] = data.gyro_x;
+    m_pose.vecAngularVelocity[1] = data.gyro_y;
+    m_pose.vecAngularVelocity[2] = data.gyro_z;
+
+    // Перезапущенный отправитель начинает новый поток: старая история
+    // (номера, скорость, сглаживание) к нему не относится
+    if (sample.restarted) {
+        m_motion.Reset();
+        m_filter.Reset();
+    }
+
+    // Фильтр дрожания до оценки скорости и публикации позы; интервал
+    // между сэмплами - по шкале отправителя, как в MotionModel
+    m_filter.Apply(m_pose.vecPosition, m_pose.qRotation, m_motion.SampleInterval(data.packet_number));
+
+    // Время захвата по часам отправителя, если они синхронизированы
+    // (ClockSync), иначе время прихода. От него считаются возраст позы,
+    // интервалы MotionModel и интерполяция.
+    auto receivedAt = std::chrono::steady_clock::now();
+    auto sampleTime = receivedAt;
+    if (sample.capturedAt != std::chrono::steady_clock::time_point()) {
+        sampleTime = sample.capturedAt;
+        m_telemetry.RecordCaptureAge(std::chrono::duration<double, std::micro>(receivedAt - sampleTime).count());
+    }
+    m_telemetry.RecordArrival(receivedAt);
+
+    // Оцениваем линейную скорость и ускорение по истории сэмплов,
+    // чтобы SteamVR (или мы сами) мог экстраполировать позу
+    m_motion.AddSample(data.packet_number, sampleTime, m_pose.vecPosition);
+    m_motion.FillPose(m_pose);
+    if (sample.hasVelocity) {
+        // Скорость уже оценена источником (встроенный хаб)
+        for (int i = 0; i < 3; i++) {
+            m_pose.vecVelocity[i] = sample.velocity[i];
+            m_pose.vecAcceleration[i] = 0.0;
+        }
+        if (m_calibration) {
+            m_calibration->For(m_calibrationId).ScaleVector(m_pose.vecVelocity);
+        }
+    }
+
+    m_pose.poseIsValid = true;
+    m_pose.result = TrackingResult_Running_OK;
+    m_pose.deviceIsConnected = true;
+
+    // Публикуем позу для потока кадра (wait-free)
+    uint32_t sequence = ++m_sampleSequence;
+    m_poseSlot.Write({m_pose, receivedAt, sampleTime, data.packet_number, sequence});
+
+    // Немедленная отправка: не ждем следующего RunFrame
+    // (при интерполяции поза кадра строится из истории, см. CheckConnection).
+    // До Activate и после Deactivate устройства в SteamVR нет.
+    vr::TrackedDeviceIndex_t deviceIndex = m_deviceIndex.load(std::memory_order_acquire);
+    if (deviceIndex != k_unTrackedDeviceIndexInvalid && m_submitter.IsImmediate() &&
+        m_interpolationDelaySec.load(std::memory_order_relaxed) <= 0.0f) {
+        vr::DriverPose_t pose = m_pose;
+        ApplyPrediction(pose, std::chrono::duration<double>(receivedAt - sampleTime).count(), m_prediction);
+        if (m_submitter.SubmitImmediate(deviceIndex, pose, sequence, receivedAt)) {
+            StoreSubmittedPose(pose);
+        }
+    }
+    return sampleTime;
+}
+
+void DevicePosePipeline::ReadLinkState(DeviceLinkState& state) const {
+    TelemetrySnapshot snapshot = m_telemetry.Snapshot();
+    state.received = snapshot.counters.received;
+    state.dropped = snapshot.counters.dropped;
+    state.jitterUs = m_telemetry.JitterUs();
+    state.linearSpeed = Length3(m_pose.vecVelocity);
+    state.angularSpeed = Length3(m_pose.vecAngularVelocity);
+}
+
+void DevicePosePipeline::CheckConnection(std::chrono::steady_clock::time_point now) {
+    // Забираем самую свежую позу из сетевого потока (если она есть)
+    if (m_poseSlot.Fetch()) {
+        m_history.Push(m_poseSlot.Latest());
+    }
+    const PoseSample& sample = m_poseSlot.Latest();
+    m_framePose = sample.pose;
+    m_frameSequence = sample.sequence;
+    m_frameReceivedAt = sample.receivedAt;
+    m_frameTime = now;
+
+    float time_since_update = std::chrono::duration<float>(now - sample.receivedAt).count();
+    float poseAge = std::chrono::duration<float>(now - sample.capturedAt).count();
+
+    // Воспроизведение с задержкой: поза между двумя сэмплами вместо
+    // повтора последнего, ценой delay мс задержки
+    float delay = m_interpolationDelaySec.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::time_point poseTime;
+    m_frameInterpolated = delay > 0.0f && m_history.Interpolate(
+        now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(delay)),
+        m_framePose, poseTime);
+    if (m_frameInterpolated) {
+        poseAge = std::chrono::duration<float>(now - poseTime).count();
+    }
+
+    // Данных нет: движение по скорости, затухание, отключение
+    CoastState state = PredictFramePose(m_framePose, time_since_update, poseAge, m_prediction);
+    if (state != m_frameState && state != CoastState::Tracking) {
+        m_telemetry.RecordCoastState(state);
+    }
+    m_frameState = state;
+}
+
+void DevicePosePipeline::RunFrame() {
+    // КРИТИЧЕСКИ ВАЖНО! Отправляем обновления позы в SteamVR каждый кадр.
+    // В режиме немедленной отправки сэмпл, уже отправленный сетевым
+    // потоком, повторно не отправляется (кроме интерполированной позы,
+    // она своя на каждый кадр). Сетевой поток RunFrame не ждет.
+    vr::TrackedDeviceIndex_t deviceIndex = m_deviceIndex.load(std::memory_order_acquire);
+    if (deviceIndex != k_unTrackedDeviceIndexInvalid &&
+        m_submitter.SubmitFrame(deviceIndex, m_framePose, m_frameSequence,
+                                m_frameReceivedAt, m_frameState != CoastState::Tracking || m_frameInterpolated)) {
+        StoreSubmittedPose(m_framePose);
+    }
+    m_telemetry.MaybeLog(m_frameTime);
+}
+
+vr::DriverPose_t DevicePosePipeline::SubmittedPose() {
+    std::lock_guard<std::mutex> lock(m_submittedPoseMutex);
+    return m_submittedPose;
+}
+
+void DevicePosePipeline::StoreSubmittedPose(const vr::DriverPose_t& pose) {
+    // Копия для GetPose(); обновляется через try_lock, поэтому никогда не ждет
+    if (m_submittedPoseMutex.try_lock()) {
+        m_submittedPose = pose;
+        m_submittedPoseMutex.unlock();
+    }
+}
+
+bool DevicePosePipeline::HandleDebugCommand(const DebugCommand& command, char* response, uint32_t responseSize) {
+    if (strcmp(command.name, "telemetry") == 0) {
+        // Потери, порядок, интервалы и задержка отправки с момента запуска
+        m_telemetry.WriteReport(response, responseSize);
+        return true;
+    }
+    if (strcmp(command.name, "interpolation_delay_ms") == 0) {
+        // "interpolation_delay_ms" - текущее значение, "interpolation_delay_ms 20" - задать
+        if (command.hasValue) {
+            SetInterpolationDelay((float)command.value / 1000.0f);
+
+            char logMsg[128];
+            snprintf(logMsg, sizeof(logMsg), "%s: Interpolation delay set to %.1f ms",
+                m_logName, m_interpolationDelaySec.load() * 1000.0f);
+            VRDriverLog()->Log(logMsg);
+        }
+        WriteDebugResponse(response, responseSize, "interpolation_delay_ms %.1f",
+            m_interpolationDelaySec.load() * 1000.0f);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,110 @@
+// src/pose_pipeline.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "pose_slot.h"
+#include "pose_history.h"
+#include "pose_submitter.h"
+#include "pose_filter.h"
+#include "motion_model.h"
+#include "device_telemetry.h"
+
+struct CoalescedSample;
+struct DeviceLinkState;
+struct DebugCommand;
+class CalibrationStore;
+
+// Путь позы одного устройства от пакета до SteamVR, общий для
+// контроллеров, трекеров и HMD; устройству остается только ввод.
+//
+// Сетевой поток (Update): калибровка -> фильтр дрожания -> время захвата
+// -> MotionModel -> публикация в PoseSlot -> немедленная отправка.
+// Поток кадра (CheckConnection/RunFrame): свежая поза из слота,
+// интерполяция по истории, экстраполяция и отключение при пропадании
+// данных, отправка без дублей с сетевым потоком.
+class DevicePosePipeline {
+public:
+    // logName - префикс сообщений в лог ("CVController", "CVHeadset")
+    explicit DevicePosePipeline(const char* logName);
+
+    // Поза до первого сэмпла; вызывать из конструктора устройства
+    void SetInitialPose(const vr::DriverPose_t& pose);
+
+    // Активация/деактивация устройства в SteamVR (поток vrserver);
+    // k_unTrackedDeviceIndexInvalid - позу отправлять некому
+    void SetDeviceIndex(vr::TrackedDeviceIndex_t index) { m_deviceIndex.store(index, std::memory_order_release); }
+
+    // Настройка до старта потоков (интерполяция - из любого потока)
+    void SetPredictionSettings(const PredictionSettings& settings) { m_prediction = settings; }
+    void SetFilterSettings(const FilterSettings& settings) { m_filter.Configure(settings); }
+    void SetSubmitSettings(const SubmitSettings& settings, const char* name) {
+        m_submitter.Configure(settings, name);
+        m_telemetry.SetName(name);
+    }
+    // Задержка воспроизведения для интерполяции (0 - выключено)
+    void SetInterpolationDelay(float seconds) { m_interpolationDelaySec = ClampInterpolationDelay(seconds); }
+    // Калибровка по controller_id устройства; store живет дольше сетевого потока
+    void SetCalibration(const CalibrationStore* store, uint8_t id) {
+        m_calibration = store;
+        m_calibrationId = id;
+    }
+
+    // Сетевой поток: поза из самого нового пакета пачки. Возвращает время
+    // сэмпла (захвата или прихода) - от него устройство датирует ввод.
+    std::chrono::steady_clock::time_point Update(const CoalescedSample& sample);
+    // Сетевой поток: счетчики потока пакетов (телеметрия)
+    void UpdateLinkCounters(const LinkCounters& counters) { m_telemetry.UpdateCounters(counters); }
+    // Сетевой поток: счетчики, дрожание и скорость для подсказки частоты
+    void ReadLinkState(DeviceLinkState& state) const;
+
+    // Поток кадра: забирает свежую позу и строит позу кадра; now - одно
+    // время на весь кадр
+    void CheckConnection(std::chrono::steady_clock::time_point now);
+    // Поток кадра: отправляет позу кадра, если сетевой поток ее не отправил
+    void RunFrame();
+
+    // Последняя отправленная поза для GetPose()
+    vr::DriverPose_t SubmittedPose();
+
+    // Команды "telemetry" и "interpolation_delay_ms"; false - команда не
+    // относится к позе
+    bool HandleDebugCommand(const DebugCommand& command, char* response, uint32_t responseSize);
+
+private:
+    void StoreSubmittedPose(const vr::DriverPose_t& pose);
+
+    const char* m_logName;
+    std::atomic<vr::TrackedDeviceIndex_t> m_deviceIndex;   // читают сетевой поток и поток кадра
+
+    // Поза собирается в сетевом потоке и публикуется через wait-free слот;
+    // поток кадра работает со своей копией и отправляет ее без блокировок
+    vr::DriverPose_t m_pose;        // только сетевой поток
+    PoseSlot m_poseSlot;
+    vr::DriverPose_t m_framePose;   // только поток кадра
+    uint32_t m_sampleSequence;      // сетевой поток: sequence последней публикации
+    uint32_t m_frameSequence;       // поток кадра: sequence и время сэмпла m_framePose
+    std::chrono::steady_clock::time_point m_frameReceivedAt;
+    std::chrono::steady_clock::time_point m_frameTime;   // now последнего CheckConnection
+    CoastState m_frameState;
+    bool m_frameInterpolated;
+    PoseHistory m_history;          // поток кадра: сэмплы для интерполяции
+    std::atomic<float> m_interpolationDelaySec;
+    PoseSubmitter m_submitter;      // отправка из сетевого потока и RunFrame без дублей
+    DeviceTelemetry m_telemetry;    // потери/порядок/задержка для DebugRequest "telemetry"
+
+    // Копия последней отправленной позы для GetPose(); RunFrame обновляет
+    // ее через try_lock, поэтому никогда не ждет
+    std::mutex m_submittedPoseMutex;
+    vr::DriverPose_t m_submittedPose;
+
+    PoseFilter m_filter;              // сетевой поток
+    MotionModel m_motion;             // сетевой поток
+    PredictionSettings m_prediction;  // задается до старта потоков
+    const CalibrationStore* m_calibration;   // nullptr - без калибровки
+    uint8_t m_calibrationId;
+};
@@ -0,0 +1,72 @@
+// src/pose_slot.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Wait-free тройной буфер для передачи значения от одного потока-писателя
+// к одному потоку-читателю. Писатель никогда не ждет читателя и наоборот:
+// индексы буферов меняются одной атомарной операцией exchange.
+//
+// Писатель (сетевой поток):   Write(value)
+// Читатель (поток кадра):     Fetch(), затем Latest()
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_state(1), m_back(0), m_front(2) {}
+
+    explicit TripleBuffer(const T& initial) : TripleBuffer() {
+        for (Slot& slot : m_slots) {
+            slot.value = initial;
+        }
+    }
+
+    // Только поток-писатель
+    void Write(const T& value) {
+        m_slots[m_back].value = value;
+        uint8_t previous = m_state.exchange(static_cast<uint8_t>(m_back | kFreshBit),
+                                            std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+    }
+
+    // Только поток-читатель. Забирает самое свежее опубликованное значение,
+    // возвращает false, если с прошлого вызова писатель ничего не публиковал.
+    bool Fetch() {
+        if ((m_state.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+            return false;
+        }
+        uint8_t previous = m_state.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & kIndexMask;
+        return true;
+    }
+
+    // Только поток-читатель. Значение, полученное последним Fetch()
+    const T& Latest() const { return m_slots[m_front].value; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x03;
+    static constexpr uint8_t kFreshBit = 0x04;
+
+    // Каждый буфер на своей кэш-линии, чтобы писатель и читатель не делили их
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    Slot m_slots[3];
+    alignas(64) std::atomic<uint8_t> m_state;   // индекс среднего буфера + флаг свежести
+    alignas(64) uint8_t m_back;                 // принадлежит писателю
+    alignas(64) uint8_t m_front;                // принадлежит читателю
+};
+
+// Один сэмпл позы, передаваемый из сетевого потока в поток кадра
+struct PoseSample {
+    vr::DriverPose_t pose;
+    std::chrono::steady_clock::time_point receivedAt;   // приход в драйвер: таймаут, задержка отправки
+    std::chrono::steady_clock::time_point capturedAt;   // захват у отправителя (или приход): возраст позы
+    uint32_t packetNumber;
+    uint32_t sequence;   // порядковый номер публикации, растет с каждым Write
+};
+
+using PoseSlot = TripleBuffer<PoseSample>;
@@ -0,0 +1,149 @@
+// src/pose_submitter.cpp
+#include "pose_submitter.h"
+#include "device_telemetry.h"
+#include "async_log.h"
+#include <cstdio>
+
+using namespace vr;
+
+namespace {
+
+// Период вывода статистики задержки отправки
+constexpr int kSubmitStatsPeriodSec = 10;
+
+inline bool IsNewerSequence(uint32_t candidate, uint32_t current) {
+    return static_cast<int32_t>(candidate - current) > 0;
+}
+
+} // namespace
+
+PoseSubmitter::PoseSubmitter()
+    : m_telemetry(nullptr),
+      m_minInterval(0),
+      // Начальный сэмпл устройства имеет sequence 0 и должен считаться новым
+      m_submittedSequence(UINT32_MAX) {
+    m_immediateStats.name = "immediate";
+    m_frameStats.name = "frame";
+}
+
+void PoseSubmitter::Configure(const SubmitSettings& settings, const char* deviceName) {
+    m_settings = settings;
+    m_deviceName = deviceName;
+    m_minInterval = std::chrono::steady_clock::duration(0);
+    if (settings.maxRateHz > 0.0f) {
+        m_minInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / settings.maxRateHz));
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    m_immediateStats.periodStart = now;
+    m_frameStats.periodStart = now;
+}
+
+bool PoseSubmitter::Claim(uint32_t sequence) {
+    if (!IsNewerSequence(sequence, m_submittedSequence)) {
+        return false;
+    }
+    m_submittedSequence = sequence;
+    return true;
+}
+
+bool PoseSubmitter::SubmitImmediate(vr::TrackedDeviceIndex_t deviceIndex, const vr::DriverPose_t& pose,
+                                    uint32_t sequence, std::chrono::steady_clock::time_point receivedAt) {
+    if (!m_settings.immediate || deviceIndex == vr::k_unTrackedDeviceIndexInvalid) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastImmediate < m_minInterval) {
+        // Сэмпл не теряется: его дошлет RunFrame
+        m_immediateStats.skipped++;
+        MaybeLog(m_immediateStats, now);
+        return false;
+    }
+
+    bool submitted = false;
+    {
+        std::unique_lock<std::mutex> lock(m_submitMutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            // Поток кадра отправляет прямо сейчас - ждем его
+            m_immediateStats.contended++;
+            lock.lock();
+        }
+        if (Claim(sequence)) {
+            VRServerDriverHost()->TrackedDevicePoseUpdated(deviceIndex, pose, sizeof(DriverPose_t));
+            submitted = true;
+        }
+    }
+
+    if (submitted) {
+        m_lastImmediate = now;
+        Record(m_immediateStats, now, receivedAt);
+    } else {
+        m_immediateStats.skipped++;
+    }
+    MaybeLog(m_immediateStats, now);
+    return submitted;
+}
+
+bool PoseSubmitter::SubmitFrame(vr::TrackedDeviceIndex_t deviceIndex, const vr::DriverPose_t& pose,
+                                uint32_t sequence, std::chrono::steady_clock::time_point receivedAt, bool force) {
+    if (deviceIndex == vr::k_unTrackedDeviceIndexInvalid) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    bool fresh = false;
+    bool submitted = false;
+
+    // Занят только если сетевой поток прямо сейчас отправляет еще более
+    // свежую позу - тогда кадру отправлять нечего
+    std::unique_lock<std::mutex> lock(m_submitMutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        fresh = Claim(sequence);
+        if (fresh || force || !m_settings.immediate) {
+            VRServerDriverHost()->TrackedDevicePoseUpdated(deviceIndex, pose, sizeof(DriverPose_t));
+            submitted = true;
+        }
+        lock.unlock();
+    } else {
+        m_frameStats.contended++;
+    }
+
+    if (fresh) {
+        Record(m_frameStats, now, receivedAt);
+    } else if (!submitted) {
+        m_frameStats.skipped++;
+    }
+    MaybeLog(m_frameStats, now);
+    return submitted;
+}
+
+void PoseSubmitter::Record(PathStats& stats, std::chrono::steady_clock::time_point now,
+                           std::chrono::steady_clock::time_point receivedAt) {
+    double latencyUs = std::chrono::duration<double, std::micro>(now - receivedAt).count();
+    stats.submitted++;
+    stats.totalLatencyUs += latencyUs;
+    if (latencyUs > stats.maxLatencyUs) stats.maxLatencyUs = latencyUs;
+    if (m_telemetry) {
+        m_telemetry->RecordSubmit(latencyUs);
+    }
+}
+
+void PoseSubmitter::MaybeLog(PathStats& stats, std::chrono::steady_clock::time_point now) {
+    if (now - stats.periodStart < std::chrono::seconds(kSubmitStatsPeriodSec)) {
+        return;
+    }
+
+    if (stats.submitted > 0) {
+        LogAsync(LogCategory::Submit,
+            "%s: %s submit - %llu fresh poses (%llu skipped, %llu contended), sample->submit avg %.2f ms max %.2f ms",
+            m_deviceName, stats.name, stats.submitted, stats.skipped, stats.contended,
+            stats.totalLatencyUs / stats.submitted / 1000.0, stats.maxLatencyUs / 1000.0);
+    }
+
+    const char* name = stats.name;
+    stats = PathStats();
+    stats.name = name;
+    stats.periodStart = now;
+}
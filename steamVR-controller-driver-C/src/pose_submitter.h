@@ -0,0 +1,79 @@
+// src/pose_submitter.h
+#pragma once
+
+#include <openvr_driver.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+class DeviceTelemetry;
+
+// Как поза устройства попадает в SteamVR
+struct SubmitSettings {
+    // false - только из RunFrame (раз в кадр).
+    // true  - сетевой поток отправляет позу сразу по приходу сэмпла,
+    //         RunFrame досылает только то, что сетевой поток пропустил.
+    bool immediate = false;
+    float maxRateHz = 500.0f;   // ограничение частоты немедленной отправки
+};
+
+// Отправка позы одного устройства из двух потоков (сетевого и кадра)
+// без дублей: каждый опубликованный сэмпл отправляется первым успевшим
+// потоком, более старый сэмпл после более нового не отправляется никогда.
+//
+// Считает задержку "сэмпл принят -> TrackedDevicePoseUpdated" отдельно
+// для каждого пути и периодически пишет ее в лог, чтобы сравнивать режимы.
+class PoseSubmitter {
+public:
+    PoseSubmitter();
+
+    // Вызывать до старта потоков
+    void Configure(const SubmitSettings& settings, const char* deviceName);
+    // Куда дополнительно писать задержку каждой отправки; вызывать до старта потоков
+    void SetTelemetry(DeviceTelemetry* telemetry) { m_telemetry = telemetry; }
+    bool IsImmediate() const { return m_settings.immediate; }
+
+    // Сетевой поток: отправляет свежий сэмпл сразу, если позволяет лимит частоты.
+    // Возвращает true, если поза отправлена.
+    bool SubmitImmediate(vr::TrackedDeviceIndex_t deviceIndex, const vr::DriverPose_t& pose,
+                         uint32_t sequence, std::chrono::steady_clock::time_point receivedAt);
+
+    // Поток кадра. Без немедленной отправки поза уходит каждый кадр, как раньше.
+    // С ней - только если сэмпл еще не отправлен сетевым потоком или force
+    // (например, устройство пропало и нужно отправить невалидную позу).
+    // Никогда не ждет сетевой поток. Возвращает true, если поза отправлена.
+    bool SubmitFrame(vr::TrackedDeviceIndex_t deviceIndex, const vr::DriverPose_t& pose,
+                     uint32_t sequence, std::chrono::steady_clock::time_point receivedAt, bool force);
+
+private:
+    // Статистика одного пути отправки; принадлежит своему потоку
+    struct PathStats {
+        const char* name = "";
+        uint64_t submitted = 0;   // отправлено сэмплов впервые
+        uint64_t skipped = 0;     // пропущено: дубль или лимит частоты
+        uint64_t contended = 0;   // m_submitMutex был занят другим потоком
+        double totalLatencyUs = 0.0;
+        double maxLatencyUs = 0.0;
+        std::chrono::steady_clock::time_point periodStart;
+    };
+
+    // Под m_submitMutex: true, если sequence новее последнего отправленного
+    bool Claim(uint32_t sequence);
+    void Record(PathStats& stats, std::chrono::steady_clock::time_point now,
+                std::chrono::steady_clock::time_point receivedAt);
+    void MaybeLog(PathStats& stats, std::chrono::steady_clock::time_point now);
+
+    SubmitSettings m_settings;
+    std::string m_deviceName;
+    DeviceTelemetry* m_telemetry;
+    std::chrono::steady_clock::duration m_minInterval;
+
+    // Сериализует отправку из двух потоков, чтобы поза не "откатывалась"
+    std::mutex m_submitMutex;
+    uint32_t m_submittedSequence;   // последний отправленный сэмпл (под мьютексом)
+
+    std::chrono::steady_clock::time_point m_lastImmediate;   // сетевой поток
+    PathStats m_immediateStats;   // сетевой поток
+    PathStats m_frameStats;       // поток кадра
+};
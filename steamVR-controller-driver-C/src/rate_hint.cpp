@@ -0,0 +1,63 @@
+// src/rate_hint.cpp
+#include "rate_hint.h"
+#include <algorithm>
+
+namespace {
+
+// Скорости, с которых движение считается быстрым (запрашивается maxHz)
+constexpr double kFastLinearSpeed = 0.5;    // м/с
+constexpr double kFastAngularSpeed = 2.0;   // рад/с
+// Ниже этой доли движения устройство считается неподвижным
+constexpr double kIdleMotion = 0.05;
+// Сколько держится пик движения
+constexpr auto kMotionHold = std::chrono::seconds(2);
+// Частота дисплея, пока SteamVR ее не сообщил
+constexpr float kDefaultDisplayHz = 90.0f;
+
+} // namespace
+
+RateHint RateHintPlanner::Plan(uint8_t id, const DeviceLinkState& state, float displayHz, bool standby,
+                               std::chrono::steady_clock::time_point now) {
+    RateHint hint = {};
+    hint.displayHz = displayHz;
+    hint.jitterMs = (float)(state.jitterUs / 1000.0);
+    if (id >= kMaxTrackedDevices) {
+        return hint;
+    }
+    Track& track = m_tracks[id];
+
+    // dropped уменьшается, когда опоздавший пакет все-таки приходит
+    uint64_t received = state.received - track.received;
+    uint64_t dropped = state.dropped > track.dropped ? state.dropped - track.dropped : 0;
+    track.received = state.received;
+    track.dropped = state.dropped;
+    hint.loss = received + dropped > 0 ? (float)dropped / (float)(received + dropped) : 0.0f;
+
+    double motion = std::min(1.0, std::max(state.linearSpeed / kFastLinearSpeed,
+                                           state.angularSpeed / kFastAngularSpeed));
+    if (motion >= track.peakMotion || now - track.peakTime > kMotionHold) {
+        track.peakMotion = motion;
+        track.peakTime = now;
+    }
+
+    float maxHz = m_settings.maxHz > 0.0f ? m_settings.maxHz
+        : (displayHz > 0.0f ? displayHz : kDefaultDisplayHz);
+    float idleHz = std::min(m_settings.idleHz, maxHz);
+    if (standby) {
+        hint.requestedHz = idleHz;
+        hint.flags = kRateHintStandby | kRateHintIdle;
+        return hint;
+    }
+    hint.requestedHz = idleHz + (maxHz - idleHz) * (float)track.peakMotion;
+    if (track.peakMotion < kIdleMotion) {
+        hint.flags |= kRateHintIdle;
+    }
+    return hint;
+}
+
+void MergeRateHint(RateHint& target, const RateHint& hint) {
+    target.requestedHz = std::max(target.requestedHz, hint.requestedHz);
+    target.loss = std::max(target.loss, hint.loss);
+    target.jitterMs = std::max(target.jitterMs, hint.jitterMs);
+    target.flags &= hint.flags;
+}
@@ -0,0 +1,57 @@
+// src/rate_hint.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "packet_format.h"
+#include "packet_batch.h"
+
+// Подсказки частоты отправителям ("rate_hints"): сколько пакетов в секунду
+// драйверу сейчас нужно от устройства
+struct RateHintSettings {
+    bool enabled = false;
+    float idleHz = 10.0f;   // устройство неподвижно или SteamVR в ожидании
+    float maxHz = 0.0f;     // при быстром движении; 0 - частота дисплея
+};
+
+// Сетевой поток: что устройство сообщает для подсказки частоты
+struct DeviceLinkState {
+    uint64_t received = 0;   // накопительные, как LinkCounters
+    uint64_t dropped = 0;
+    double jitterUs = 0.0;        // DeviceTelemetry::JitterUs
+    double linearSpeed = 0.0;     // м/с, по последней позе
+    double angularSpeed = 0.0;    // рад/с
+};
+
+// Желаемая частота устройства по его движению и состоянию SteamVR: от
+// idleHz для неподвижного устройства до maxHz при быстром движении.
+// Пик движения держится kMotionHold: рука, которая только что двигалась,
+// скорее всего сейчас двинется снова, и ждать разгона отправителя ей не
+// нужно. Потери и дрожание - за период с прошлого Plan для того же id.
+//
+// Только сетевой поток.
+class RateHintPlanner {
+public:
+    void Configure(const RateHintSettings& settings) { m_settings = settings; }
+
+    // sequence подсказки ставит NetworkClient::SendRateHint
+    RateHint Plan(uint8_t id, const DeviceLinkState& state, float displayHz, bool standby,
+                  std::chrono::steady_clock::time_point now);
+
+private:
+    struct Track {
+        uint64_t received = 0;
+        uint64_t dropped = 0;
+        double peakMotion = 0.0;   // 0..1, доля "быстрого" движения
+        std::chrono::steady_clock::time_point peakTime;
+    };
+
+    RateHintSettings m_settings;
+    std::array<Track, kMaxTrackedDevices> m_tracks;
+};
+
+// Одна подсказка на отправителя нескольких устройств (хаб): самая высокая
+// частота, худшие потери и дрожание, флаги - только общие для всех
+void MergeRateHint(RateHint& target, const RateHint& hint);
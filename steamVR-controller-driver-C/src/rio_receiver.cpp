@@ -0,0 +1,235 @@
+// src/rio_receiver.cpp
+#include "rio_receiver.h"
+#include "packet_format.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#include <array>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+
+// Слот данных с запасом до кратного 64, чтобы слоты не делили кэш-линию
+constexpr size_t kDataSlotSize = (kMaxDatagramSize + 63) / 64 * 64;
+constexpr size_t kAddressSlotSize = (sizeof(SOCKADDR_INET) + 7) / 8 * 8;
+// Сколько завершений забирается одним RIODequeueCompletion
+constexpr size_t kDequeueChunk = 64;
+// Отправка через RIO не используется (запросы часов идут sendto), но
+// очередь запросов требует ненулевой лимит
+constexpr size_t kSendsPerSocket = 1;
+
+} // namespace
+
+struct RioReceiver::Impl {
+    RIO_EXTENSION_FUNCTION_TABLE rio = {};
+    RIO_CQ queue = RIO_INVALID_CQ;
+    std::array<RIO_RQ, kMaxSockets> requests;
+    size_t socketCount = 0;
+    char* buffer = nullptr;
+    size_t addressOffset = 0;   // адреса отправителей - после всех слотов данных
+    RIO_BUFFERID bufferId = RIO_INVALID_BUFFERID;
+    HANDLE event = nullptr;
+    bool armed = false;
+
+    size_t SlotCount() const { return socketCount * kReceivesPerSocket; }
+
+    bool Post(uint32_t slot, DWORD flags) {
+        RIO_BUF data;
+        data.BufferId = bufferId;
+        data.Offset = (ULONG)(slot * kDataSlotSize);
+        data.Length = (ULONG)kMaxDatagramSize;
+        RIO_BUF address;
+        address.BufferId = bufferId;
+        address.Offset = (ULONG)(addressOffset + slot * kAddressSlotSize);
+        address.Length = (ULONG)sizeof(SOCKADDR_INET);
+        return rio.RIOReceiveEx(requests[slot / kReceivesPerSocket], &data, 1, nullptr, &address,
+                                nullptr, nullptr, flags, reinterpret_cast<PVOID>((ULONG_PTR)slot)) != FALSE;
+    }
+
+    void Commit(size_t socketIndex) {
+        rio.RIOReceive(requests[socketIndex], nullptr, 0, RIO_MSG_COMMIT_ONLY, nullptr);
+    }
+};
+
+RioReceiver::RioReceiver() : m_impl(std::make_unique<Impl>()) {}
+
+RioReceiver::~RioReceiver() {
+    Stop();
+}
+
+bool RioReceiver::Start(const uintptr_t* sockets, size_t count) {
+    Stop();
+    m_failedStep = "";
+    m_lastError = 0;
+    if (count == 0 || count > kMaxSockets) {
+        m_failedStep = "socket count";
+        return false;
+    }
+    Impl& impl = *m_impl;
+
+    GUID functionTableId = WSAID_MULTIPLE_RIO;
+    DWORD bytes = 0;
+    impl.rio.cbSize = sizeof(impl.rio);
+    if (WSAIoctl((SOCKET)sockets[0], SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER,
+                 &functionTableId, sizeof(functionTableId), &impl.rio, sizeof(impl.rio),
+                 &bytes, nullptr, nullptr) == SOCKET_ERROR) {
+        return Fail("WSAIoctl(WSAID_MULTIPLE_RIO)");
+    }
+
+    impl.socketCount = count;
+    impl.event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (!impl.event) {
+        return Fail("CreateEvent");
+    }
+
+    RIO_NOTIFICATION_COMPLETION notification = {};
+    notification.Type = RIO_EVENT_COMPLETION;
+    notification.Event.EventHandle = impl.event;
+    notification.Event.NotifyReset = TRUE;
+    // RIO резервирует в очереди завершений место и под приемы, и под
+    // отправки каждой очереди запросов (kSendsPerSocket)
+    impl.queue = impl.rio.RIOCreateCompletionQueue(
+        (DWORD)(count * (kReceivesPerSocket + kSendsPerSocket)), &notification);
+    if (impl.queue == RIO_INVALID_CQ) {
+        return Fail("RIOCreateCompletionQueue");
+    }
+
+    // Один зарегистрированный буфер на все слоты: данные, затем адреса
+    impl.addressOffset = impl.SlotCount() * kDataSlotSize;
+    size_t bufferSize = impl.addressOffset + impl.SlotCount() * kAddressSlotSize;
+    impl.buffer = static_cast<char*>(VirtualAlloc(nullptr, bufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (!impl.buffer) {
+        return Fail("VirtualAlloc");
+    }
+    impl.bufferId = impl.rio.RIORegisterBuffer(impl.buffer, (DWORD)bufferSize);
+    if (impl.bufferId == RIO_INVALID_BUFFERID) {
+        return Fail("RIORegisterBuffer");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        impl.requests[i] = impl.rio.RIOCreateRequestQueue((SOCKET)sockets[i],
+            (ULONG)kReceivesPerSocket, 1, (ULONG)kSendsPerSocket, 1, impl.queue, impl.queue,
+            reinterpret_cast<PVOID>((ULONG_PTR)i));
+        if (impl.requests[i] == RIO_INVALID_RQ) {
+            return Fail("RIOCreateRequestQueue");
+        }
+    }
+
+    for (uint32_t slot = 0; slot < impl.SlotCount(); slot++) {
+        if (!impl.Post(slot, RIO_MSG_DEFER)) {
+            return Fail("RIOReceiveEx");
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        impl.Commit(i);
+    }
+    impl.armed = false;
+    return true;
+}
+
+bool RioReceiver::Fail(const char* step) {
+    m_failedStep = step;
+    m_lastError = WSAGetLastError();
+    Stop();
+    return false;
+}
+
+void RioReceiver::Stop() {
+    Impl& impl = *m_impl;
+    // Очереди запросов закрываются вместе с сокетами
+    impl.requests.fill(RIO_INVALID_RQ);
+    if (impl.queue != RIO_INVALID_CQ) {
+        impl.rio.RIOCloseCompletionQueue(impl.queue);
+        impl.queue = RIO_INVALID_CQ;
+    }
+    if (impl.bufferId != RIO_INVALID_BUFFERID) {
+        impl.rio.RIODeregisterBuffer(impl.bufferId);
+        impl.bufferId = RIO_INVALID_BUFFERID;
+    }
+    if (impl.buffer) {
+        VirtualFree(impl.buffer, 0, MEM_RELEASE);
+        impl.buffer = nullptr;
+    }
+    if (impl.event) {
+        CloseHandle(impl.event);
+        impl.event = nullptr;
+    }
+    impl.socketCount = 0;
+    impl.armed = false;
+}
+
+bool RioReceiver::Started() const {
+    return m_impl->queue != RIO_INVALID_CQ && m_impl->socketCount > 0;
+}
+
+void* RioReceiver::Event() const {
+    return m_impl->event;
+}
+
+void RioReceiver::Arm() {
+    Impl& impl = *m_impl;
+    if (!impl.armed && impl.queue != RIO_INVALID_CQ) {
+        impl.rio.RIONotify(impl.queue);
+        impl.armed = true;
+    }
+}
+
+void RioReceiver::Notified() {
+    m_impl->armed = false;
+}
+
+size_t RioReceiver::Dequeue(RioDatagram* out, size_t max) {
+    Impl& impl = *m_impl;
+    if (impl.queue == RIO_INVALID_CQ) {
+        return 0;
+    }
+
+    size_t total = 0;
+    RIORESULT results[kDequeueChunk];
+    while (total < max) {
+        size_t want = max - total < kDequeueChunk ? max - total : kDequeueChunk;
+        ULONG count = impl.rio.RIODequeueCompletion(impl.queue, results, (ULONG)want);
+        if (count == 0 || count == RIO_CORRUPT_CQ) {
+            break;
+        }
+        for (ULONG i = 0; i < count; i++) {
+            const RIORESULT& result = results[i];
+            uint32_t slot = (uint32_t)result.RequestContext;
+            RioDatagram& datagram = out[total++];
+            datagram.socketIndex = (size_t)result.SocketContext;
+            datagram.slot = slot;
+            datagram.data = reinterpret_cast<const uint8_t*>(impl.buffer + slot * kDataSlotSize);
+            datagram.size = result.BytesTransferred;
+            datagram.failed = result.Status != 0;
+
+            const SOCKADDR_INET* from = reinterpret_cast<const SOCKADDR_INET*>(
+                impl.buffer + impl.addressOffset + slot * kAddressSlotSize);
+            datagram.address = from->si_family == AF_INET ? from->Ipv4.sin_addr.s_addr : 0;
+            datagram.port = from->si_family == AF_INET ? from->Ipv4.sin_port : 0;
+        }
+        if (count < want) {
+            break;
+        }
+    }
+    return total;
+}
+
+void RioReceiver::Release(const RioDatagram* datagrams, size_t count) {
+    Impl& impl = *m_impl;
+    if (impl.queue == RIO_INVALID_CQ) {
+        return;
+    }
+
+    bool touched[kMaxSockets] = {};
+    for (size_t i = 0; i < count; i++) {
+        impl.Post(datagrams[i].slot, RIO_MSG_DEFER);
+        touched[datagrams[i].socketIndex] = true;
+    }
+    // Одно уведомление ядра на сокет за пачку
+    for (size_t i = 0; i < impl.socketCount; i++) {
+        if (touched[i]) {
+            impl.Commit(i);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+// src/rio_receiver.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Датаграмма, принятая через RioReceiver. data указывает прямо в
+// зарегистрированный буфер и действительна до Release().
+struct RioDatagram {
+    size_t socketIndex;     // индекс сокета, переданного в Start()
+    const uint8_t* data;
+    size_t size;
+    uint32_t address;       // IPv4 отправителя, сетевой порядок байт
+    uint16_t port;          // сетевой порядок байт
+    bool failed;            // прием завершился ошибкой (обрезана и т.п.), data не разбирать
+    uint32_t slot;          // слот буфера, возвращается в Release()
+};
+
+// Прием UDP через Registered I/O (Windows 8+): буфер под все датаграммы
+// выделяется и регистрируется один раз, на каждый сокет заранее выставлено
+// kReceivesPerSocket приемов. Завершения всех сокетов приходят в одну
+// очередь и забираются пачкой одним вызовом, без recvfrom и копирования в
+// стек на каждую датаграмму.
+//
+// Только сетевой поток (RIO требует, чтобы вызовы к одной очереди не шли
+// параллельно).
+class RioReceiver {
+public:
+    static constexpr size_t kMaxSockets = 4;
+    static constexpr size_t kReceivesPerSocket = 128;
+
+    RioReceiver();
+    ~RioReceiver();
+    RioReceiver(const RioReceiver&) = delete;
+    RioReceiver& operator=(const RioReceiver&) = delete;
+
+    // sockets - SOCKET, созданные с WSA_FLAG_REGISTERED_IO. false - RIO
+    // недоступен (старая Windows, не тот сокет), можно принимать как обычно;
+    // что не удалось - в FailedStep() и LastError().
+    bool Start(const uintptr_t* sockets, size_t count);
+    // Вызывать после закрытия сокетов: они отменяют выставленные приемы
+    void Stop();
+    bool Started() const;
+    // После неудачного Start: вызов, который не прошел, и код WSAGetLastError
+    const char* FailedStep() const { return m_failedStep; }
+    int LastError() const { return m_lastError; }
+
+    // HANDLE события завершений для WaitForMultipleObjects
+    void* Event() const;
+    // Перед сном на Event(): просит RIO просигналить о следующем
+    // завершении (сразу, если они уже есть)
+    void Arm();
+    // Event() сработало - перед следующим сном нужен новый Arm()
+    void Notified();
+
+    // Забирает до max завершенных приемов. Слоты заняты до Release().
+    size_t Dequeue(RioDatagram* out, size_t max);
+    // Снова выставляет прием в слоты этих датаграмм
+    void Release(const RioDatagram* datagrams, size_t count);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    const char* m_failedStep = "";
+    int m_lastError = 0;
+    
+    bool Fail(const char* step);
+};
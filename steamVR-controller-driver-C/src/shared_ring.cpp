@@ -0,0 +1,274 @@
+// src/shared_ring.cpp
+#include "shared_ring.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+namespace {
+
+int64_t QueryTicks() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+// Отображение кольца: create - драйвер, иначе открыть существующее
+SharedRing* MapRing(const std::string& name, bool create, HANDLE& mapping, bool& existed) {
+    existed = false;
+    if (create) {
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                     0, (DWORD)sizeof(SharedRing), name.c_str());
+        existed = mapping != nullptr && GetLastError() == ERROR_ALREADY_EXISTS;
+    } else {
+        mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str());
+    }
+    if (!mapping) {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(SharedRing));
+    if (!view) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return nullptr;
+    }
+    return static_cast<SharedRing*>(view);
+}
+
+void UnmapRing(SharedRing*& ring, void*& mapping, void*& event) {
+    if (ring) {
+        UnmapViewOfFile(ring);
+        ring = nullptr;
+    }
+    if (mapping) {
+        CloseHandle(static_cast<HANDLE>(mapping));
+        mapping = nullptr;
+    }
+    if (event) {
+        CloseHandle(static_cast<HANDLE>(event));
+        event = nullptr;
+    }
+}
+
+bool LayoutMatches(const SharedRingHeader& header) {
+    return header.version == kSharedRingVersion && header.capacity == kSharedRingCapacity &&
+           header.entrySize == sizeof(SharedRingEntry);
+}
+
+// Все слоты свободны, начиная с индекса start
+void ResetSlots(SharedRing& ring, uint32_t start) {
+    for (uint32_t k = 0; k < kSharedRingCapacity; k++) {
+        uint32_t index = start + ((k - start) & (kSharedRingCapacity - 1));
+        ring.entries[k].sequence.store(index + kSharedRingSlotFree, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+bool SharedRingReader::Open(const std::string& name) {
+    Close();
+    if (name.empty()) {
+        return false;
+    }
+
+    HANDLE mapping = nullptr;
+    bool existed = false;
+    SharedRing* ring = MapRing(name, true, mapping, existed);
+    if (!ring) {
+        return false;
+    }
+    m_ring = ring;
+    m_mapping = mapping;
+
+    SharedRingHeader& header = m_ring->header;
+    if (existed && header.magic == kSharedRingMagic) {
+        // Кольцо держал открытым отправитель, пока vrserver перезапускался:
+        // раскладка должна совпасть, старые записи не нужны
+        if (!LayoutMatches(header)) {
+            Close();
+            return false;
+        }
+        uint32_t write = header.writeIndex.load(std::memory_order_acquire);
+        ResetSlots(*m_ring, write);
+        header.readIndex.store(write, std::memory_order_release);
+    } else {
+        // Новое отображение обнулено системой; sequence = 0 свободен только
+        // у слота 0
+        ResetSlots(*m_ring, 0);
+        header.version = kSharedRingVersion;
+        header.capacity = kSharedRingCapacity;
+        header.entrySize = sizeof(SharedRingEntry);
+        std::atomic_thread_fence(std::memory_order_release);
+        header.magic = kSharedRingMagic;
+    }
+
+    m_event = CreateEventA(nullptr, FALSE, FALSE, (name + kSharedRingEventSuffix).c_str());
+    if (!m_event) {
+        Close();
+        return false;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    m_ticksPerSecond = frequency.QuadPart;
+    m_stuckSinceTicks = 0;
+    m_skipped = 0;
+
+    header.consumerWaiting.store(0);
+    header.consumerActive.store(1, std::memory_order_release);
+    return true;
+}
+
+void SharedRingReader::Close() {
+    if (m_ring) {
+        m_ring->header.consumerActive.store(0, std::memory_order_release);
+        m_ring->header.consumerWaiting.store(0);
+    }
+    UnmapRing(m_ring, m_mapping, m_event);
+}
+
+bool SharedRingReader::PrepareWait() {
+    if (!m_ring) {
+        return true;
+    }
+    // Флаг ставится до проверки: отправитель, опубликовавший запись после
+    // проверки, увидит его и разбудит
+    m_ring->header.consumerWaiting.store(1, std::memory_order_seq_cst);
+    uint32_t read = m_ring->header.readIndex.load(std::memory_order_relaxed);
+    if (HeadPublished(read, std::memory_order_seq_cst)) {
+        m_ring->header.consumerWaiting.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void SharedRingReader::EndWait() {
+    if (m_ring) {
+        m_ring->header.consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool SharedRingReader::SkipStuckHead(uint32_t read) {
+    SharedRingEntry& entry = m_ring->entries[read & (kSharedRingCapacity - 1)];
+    uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+    // Метка прошлого поколения: тот отправитель еще не вернул слот, и
+    // отправитель этого индекса его не займет - ждать нечего
+    if (SharedRingSlotState(sequence, read) == kSharedRingSlotSkipped &&
+        sequence != read + kSharedRingSlotSkipped) {
+        return true;
+    }
+
+    if (m_stuckSinceTicks == 0 || m_stuckIndex != read) {
+        m_stuckIndex = read;
+        m_stuckSinceTicks = m_drainTicks;
+        return false;
+    }
+    if ((m_drainTicks - m_stuckSinceTicks) * 1000000 / m_ticksPerSecond < kStuckEntryUs) {
+        return false;
+    }
+    // Метка вместо чтения: опоздавший отправитель не опубликует запись
+    // после того, как драйвер прошел мимо
+    if (!entry.sequence.compare_exchange_strong(sequence, read + kSharedRingSlotSkipped,
+                                                std::memory_order_acq_rel)) {
+        // Отправитель успел занять слот или опубликовать запись - ждем заново
+        m_stuckSinceTicks = m_drainTicks;
+        return false;
+    }
+    m_stuckSinceTicks = 0;
+    m_skipped++;
+    return true;
+}
+
+bool SharedRingReader::EntryAgeUs(const SharedRingEntry& entry, int64_t& ageUs) const {
+    if (entry.captureTicks == 0) {
+        return false;
+    }
+    int64_t ticks = m_drainTicks - entry.captureTicks;
+    // Из будущего - запись сделана после начала Drain
+    ageUs = ticks > 0 ? ticks * 1000000 / m_ticksPerSecond : 0;
+    return true;
+}
+
+int64_t SharedRingReader::NowTicks() const {
+    return QueryTicks();
+}
+
+bool SharedRingWriter::Open(const std::string& name) {
+    Close();
+    if (name.empty()) {
+        return false;
+    }
+
+    HANDLE mapping = nullptr;
+    bool existed = false;
+    SharedRing* ring = MapRing(name, false, mapping, existed);
+    if (!ring) {
+        return false;
+    }
+    m_ring = ring;
+    m_mapping = mapping;
+
+    if (m_ring->header.magic != kSharedRingMagic || !LayoutMatches(m_ring->header)) {
+        Close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    m_event = OpenEventA(EVENT_MODIFY_STATE, FALSE, (name + kSharedRingEventSuffix).c_str());
+    if (!m_event) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedRingWriter::Close() {
+    UnmapRing(m_ring, m_mapping, m_event);
+}
+
+bool SharedRingWriter::Write(const ControllerData& data, uint8_t flags, int64_t captureTicks) {
+    if (!ConsumerActive()) {
+        return false;
+    }
+    SharedRingHeader& header = m_ring->header;
+
+    uint32_t write = header.writeIndex.load(std::memory_order_relaxed);
+    do {
+        if (write - header.readIndex.load(std::memory_order_acquire) >= kSharedRingCapacity) {
+            header.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!header.writeIndex.compare_exchange_weak(write, write + 1, std::memory_order_acq_rel));
+
+    // Слот свободен, если его прошлую запись прочитали или вернул опоздавший
+    // отправитель. Иначе на нем метка пропуска, а тот отправитель, возможно,
+    // еще пишет - его данные не должны попасть в нашу запись
+    SharedRingEntry& entry = m_ring->entries[write & (kSharedRingCapacity - 1)];
+    uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+    if (SharedRingSlotState(sequence, write) != kSharedRingSlotFree ||
+        !entry.sequence.compare_exchange_strong(sequence, write + kSharedRingSlotWriting,
+                                                std::memory_order_acq_rel)) {
+        header.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    entry.flags = flags;
+    entry.captureTicks = captureTicks != 0 ? captureTicks : QueryTicks();
+    entry.data = data;
+
+    uint32_t writing = write + kSharedRingSlotWriting;
+    if (!entry.sequence.compare_exchange_strong(writing, write + kSharedRingSlotPublished,
+                                                std::memory_order_seq_cst)) {
+        // Драйвер не дождался записи и пропустил ее. Метка держала слот, так
+        // что его никто не занял: возвращаем его следующим поколениям
+        entry.sequence.store(write + kSharedRingSlotFree, std::memory_order_release);
+        header.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Будим драйвер, только если он спит: один SetEvent на простой, а не на запись
+    if (header.consumerWaiting.exchange(0) != 0) {
+        SetEvent(static_cast<HANDLE>(m_event));
+    }
+    return true;
+}
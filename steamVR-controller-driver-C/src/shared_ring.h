@@ -0,0 +1,202 @@
+// src/shared_ring.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "packet_format.h"
+
+// Локальный транспорт для отправителей на той же машине, что и vrserver
+// (хуки гиромыши): именованная общая память с кольцом записей ControllerData
+// и событие для пробуждения сетевого потока. В отличие от loopback UDP -
+// без syscall на пакет у отправителя, без checksum и без копирования
+// датаграммы: драйвер читает запись прямо из отображения.
+//
+// Кольцо создает драйвер (SharedRingReader) под именем из vrsettings
+// "shared_memory_name", отправители открывают его (SharedRingWriter) и,
+// пока драйвер не запущен, шлют по UDP как раньше. Событие - то же имя
+// с суффиксом kSharedRingEventSuffix.
+//
+// Отправителей может быть несколько, читатель один. Отправитель занимает
+// индекс через CAS по writeIndex, затем сам слот - CAS его sequence из
+// "свободен" в "пишется", заполняет запись и публикует ее вторым CAS.
+// Читатель идет по индексам подряд и останавливается на первой
+// неопубликованной записи. Полное кольцо - запись отбрасывается
+// отправителем и считается в dropped.
+//
+// sequence слота = индекс + состояние (kSharedRingSlot*): слот k проходит
+// индексы k, k + capacity, ..., так что поколения не пересекаются. Запись,
+// которую драйвер не дождался, помечается пропущенной; опоздавший
+// отправитель (его не убили, а вытеснили) видит метку на публикации,
+// отбрасывает запись и сам возвращает слот. Пока метка стоит, новые
+// отправители слот не занимают - их данные не перетрет опоздавший.
+constexpr uint32_t kSharedRingMagic = 0x52535643;   // "CVSR"
+constexpr uint32_t kSharedRingVersion = 2;
+constexpr uint32_t kSharedRingCapacity = 1024;      // степень двойки; ~0.5 с при 2 кГц
+constexpr const char* kSharedRingEventSuffix = "_event";
+
+// Состояния слота: sequence - индекс, к которому они относятся
+constexpr uint32_t kSharedRingSlotFree = 0;        // свободен для этого индекса и следующих поколений
+constexpr uint32_t kSharedRingSlotPublished = 1;   // запись готова к чтению
+constexpr uint32_t kSharedRingSlotWriting = 2;     // отправитель заполняет запись
+constexpr uint32_t kSharedRingSlotSkipped = 3;     // драйвер не дождался записи
+static_assert(kSharedRingCapacity > kSharedRingSlotSkipped, "slot states must not reach the next generation");
+
+// Состояние слота по его sequence относительно индекса index того же слота
+inline uint32_t SharedRingSlotState(uint32_t sequence, uint32_t index) {
+    return (sequence - index) & (kSharedRingCapacity - 1);
+}
+
+// Флаги записи
+constexpr uint8_t kSharedRingGyroMouse = 0x01;   // id относительно DecodeOptions::gyroMouseDeviceId
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared ring atomics must be lock-free to work across processes");
+
+struct SharedRingEntry {
+    std::atomic<uint32_t> sequence;   // индекс + kSharedRingSlot*
+    uint8_t flags;                    // kSharedRing*
+    uint8_t reserved[3];
+    // Момент захвата по QueryPerformanceCounter (общий для процессов
+    // одной машины, синхронизация часов не нужна); 0 - неизвестен
+    int64_t captureTicks;
+    ControllerData data;              // checksum не используется
+    uint8_t padding[7];
+};
+
+static_assert(sizeof(SharedRingEntry) == 72, "SharedRingEntry layout is shared with producers");
+
+struct SharedRingHeader {
+    uint32_t magic;          // kSharedRingMagic, пишется последним
+    uint32_t version;        // kSharedRingVersion
+    uint32_t capacity;       // kSharedRingCapacity
+    uint32_t entrySize;      // sizeof(SharedRingEntry)
+    std::atomic<uint32_t> consumerActive;    // драйвер читает кольцо
+    std::atomic<uint32_t> consumerWaiting;   // драйвер спит на событии - его надо разбудить
+    std::atomic<uint32_t> dropped;           // записей не вошло: кольцо было полным
+    uint32_t reserved;
+    alignas(64) std::atomic<uint32_t> writeIndex;   // занимают отправители, без обнуления
+    alignas(64) std::atomic<uint32_t> readIndex;    // двигает только драйвер
+};
+
+struct SharedRing {
+    SharedRingHeader header;
+    SharedRingEntry entries[kSharedRingCapacity];   // индекс & (capacity - 1)
+};
+
+// Сторона драйвера; только сетевой поток (кроме Open/Close)
+class SharedRingReader {
+public:
+    // Неопубликованная запись дольше этого - отправитель умер или надолго
+    // вытеснен посреди записи, она пропускается, чтобы кольцо не встало
+    static constexpr int64_t kStuckEntryUs = 100000;
+
+    SharedRingReader() = default;
+    ~SharedRingReader() { Close(); }
+    SharedRingReader(const SharedRingReader&) = delete;
+    SharedRingReader& operator=(const SharedRingReader&) = delete;
+
+    // Создает (или подхватывает оставшееся от прошлого запуска) кольцо.
+    // Старые записи пропускаются.
+    bool Open(const std::string& name);
+    void Close();
+    bool IsOpen() const { return m_ring != nullptr; }
+
+    // HANDLE события для WaitForMultipleObjects
+    void* Event() const { return m_event; }
+
+    // Перед сном на Event(): просит отправителей разбудить драйвер.
+    // false - в кольце уже есть запись, спать не нужно.
+    bool PrepareWait();
+    void EndWait();
+
+    // Передает f(const SharedRingEntry&) до max опубликованных записей
+    // прямо из общей памяти, затем освобождает их. Возвращает число записей.
+    template <typename F>
+    size_t Drain(size_t max, F&& f);
+
+    // Возраст записи по ее captureTicks; false - время захвата неизвестно
+    bool EntryAgeUs(const SharedRingEntry& entry, int64_t& ageUs) const;
+
+    uint32_t DroppedCount() const { return m_ring ? m_ring->header.dropped.load(std::memory_order_relaxed) : 0; }
+    uint32_t SkippedCount() const { return m_skipped; }
+
+private:
+    bool HeadPublished(uint32_t read, std::memory_order order = std::memory_order_acquire) const {
+        return m_ring->entries[read & (kSharedRingCapacity - 1)].sequence.load(order) ==
+               read + kSharedRingSlotPublished;
+    }
+    // Запись на голове не опубликована: пропустить ее, если ее уже не будет
+    // или она висит слишком долго
+    bool SkipStuckHead(uint32_t read);
+    int64_t NowTicks() const;
+
+    SharedRing* m_ring = nullptr;
+    void* m_mapping = nullptr;   // HANDLE
+    void* m_event = nullptr;     // HANDLE, auto-reset
+    int64_t m_ticksPerSecond = 1;
+    int64_t m_drainTicks = 0;    // QPC начала текущего Drain
+
+    uint32_t m_stuckIndex = 0;
+    int64_t m_stuckSinceTicks = 0;
+    uint32_t m_skipped = 0;
+};
+
+// Сторона отправителя (собирается и в хуках гиромыши, без OpenVR SDK)
+class SharedRingWriter {
+public:
+    SharedRingWriter() = default;
+    ~SharedRingWriter() { Close(); }
+    SharedRingWriter(const SharedRingWriter&) = delete;
+    SharedRingWriter& operator=(const SharedRingWriter&) = delete;
+
+    // Открывает кольцо драйвера; false - драйвер его еще не создал
+    bool Open(const std::string& name);
+    void Close();
+    bool IsOpen() const { return m_ring != nullptr; }
+
+    // Драйвер сейчас читает кольцо (иначе писать в него бессмысленно)
+    bool ConsumerActive() const {
+        return m_ring && m_ring->header.consumerActive.load(std::memory_order_acquire) != 0;
+    }
+
+    // Кладет запись в кольцо; captureTicks = 0 - текущий момент.
+    // false - кольцо не открыто, драйвер не читает или кольцо полно.
+    bool Write(const ControllerData& data, uint8_t flags, int64_t captureTicks = 0);
+
+private:
+    SharedRing* m_ring = nullptr;
+    void* m_mapping = nullptr;   // HANDLE
+    void* m_event = nullptr;     // HANDLE
+};
+
+template <typename F>
+size_t SharedRingReader::Drain(size_t max, F&& f) {
+    if (!m_ring) {
+        return 0;
+    }
+    m_drainTicks = NowTicks();
+
+    uint32_t read = m_ring->header.readIndex.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (count < max) {
+        if (!HeadPublished(read)) {
+            if (read == m_ring->header.writeIndex.load(std::memory_order_acquire) || !SkipStuckHead(read)) {
+                break;
+            }
+            read++;
+            continue;
+        }
+        SharedRingEntry& entry = m_ring->entries[read & (kSharedRingCapacity - 1)];
+        f(entry);
+        entry.sequence.store(read + kSharedRingCapacity + kSharedRingSlotFree, std::memory_order_release);
+        read++;
+        count++;
+    }
+    // Записи освобождаются только после обработки: до этого отправитель не
+    // может занять их индекс
+    m_ring->header.readIndex.store(read, std::memory_order_release);
+    return count;
+}
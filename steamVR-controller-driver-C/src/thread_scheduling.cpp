@@ -0,0 +1,158 @@
+// src/thread_scheduling.cpp
+#include "thread_scheduling.h"
+#include <windows.h>
+#include <avrt.h>
+#include <mmsystem.h>
+#include <cstdio>
+
+#pragma comment(lib, "avrt.lib")
+#pragma comment(lib, "winmm.lib")
+
+namespace {
+
+struct PriorityName {
+    const char* name;
+    ThreadPriority priority;
+};
+
+const PriorityName kPriorityNames[] = {
+    { "normal",        ThreadPriority::Normal },
+    { "above_normal",  ThreadPriority::AboveNormal },
+    { "highest",       ThreadPriority::Highest },
+    { "time_critical", ThreadPriority::TimeCritical },
+};
+
+int Win32Priority(ThreadPriority priority) {
+    switch (priority) {
+    case ThreadPriority::AboveNormal:  return THREAD_PRIORITY_ABOVE_NORMAL;
+    case ThreadPriority::Highest:      return THREAD_PRIORITY_HIGHEST;
+    case ThreadPriority::TimeCritical: return THREAD_PRIORITY_TIME_CRITICAL;
+    default:                           return THREAD_PRIORITY_NORMAL;
+    }
+}
+
+AVRT_PRIORITY MmcssPriority(ThreadPriority priority) {
+    switch (priority) {
+    case ThreadPriority::AboveNormal:
+    case ThreadPriority::Highest:      return AVRT_PRIORITY_HIGH;
+    case ThreadPriority::TimeCritical: return AVRT_PRIORITY_CRITICAL;
+    default:                           return AVRT_PRIORITY_NORMAL;
+    }
+}
+
+const char* MmcssPriorityName(AVRT_PRIORITY priority) {
+    switch (priority) {
+    case AVRT_PRIORITY_HIGH:     return "high";
+    case AVRT_PRIORITY_CRITICAL: return "critical";
+    default:                     return "normal";
+    }
+}
+
+void Append(std::string& description, const char* part) {
+    if (!description.empty()) description += ", ";
+    description += part;
+}
+
+} // namespace
+
+bool ParseThreadPriority(const std::string& name, ThreadPriority& priority) {
+    for (const PriorityName& entry : kPriorityNames) {
+        if (name == entry.name) {
+            priority = entry.priority;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ThreadPriorityName(ThreadPriority priority) {
+    for (const PriorityName& entry : kPriorityNames) {
+        if (entry.priority == priority) {
+            return entry.name;
+        }
+    }
+    return "normal";
+}
+
+void ThreadScheduling::Apply(const IoThreadSettings& settings) {
+    Revert();
+    m_description.clear();
+    char part[160];
+    ThreadPriority threadPriority = ThreadPriority::Normal;
+    ParseThreadPriority(settings.priority, threadPriority);
+
+    if (!settings.mmcssTask.empty()) {
+        // Имена задач MMCSS - ASCII
+        std::wstring task(settings.mmcssTask.begin(), settings.mmcssTask.end());
+        DWORD taskIndex = 0;
+        m_mmcssHandle = AvSetMmThreadCharacteristicsW(task.c_str(), &taskIndex);
+        if (m_mmcssHandle) {
+            AVRT_PRIORITY priority = MmcssPriority(threadPriority);
+            bool prioritySet = AvSetMmThreadPriority(m_mmcssHandle, priority) != FALSE;
+            snprintf(part, sizeof(part), "MMCSS '%s' (%s%s)", settings.mmcssTask.c_str(),
+                MmcssPriorityName(priority), prioritySet ? "" : " rejected");
+        } else {
+            snprintf(part, sizeof(part), "MMCSS '%s' failed (error %lu)", settings.mmcssTask.c_str(),
+                (unsigned long)GetLastError());
+        }
+        Append(m_description, part);
+    }
+
+    // Без MMCSS (или если регистрация не удалась) - обычный приоритет
+    if (!m_mmcssHandle) {
+        if (SetThreadPriority(GetCurrentThread(), Win32Priority(threadPriority))) {
+            snprintf(part, sizeof(part), "priority %s", ThreadPriorityName(threadPriority));
+        } else {
+            snprintf(part, sizeof(part), "priority %s failed (error %lu)",
+                ThreadPriorityName(threadPriority), (unsigned long)GetLastError());
+        }
+        Append(m_description, part);
+    }
+
+    if (settings.core >= 0) {
+        DWORD_PTR processMask = 0;
+        DWORD_PTR systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+        DWORD_PTR mask = settings.core < (int)(sizeof(DWORD_PTR) * 8) ? (DWORD_PTR)1 << settings.core : 0;
+        if ((mask & processMask) != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0) {
+            snprintf(part, sizeof(part), "core %d", settings.core);
+        } else {
+            snprintf(part, sizeof(part), "core %d not available, not pinned", settings.core);
+        }
+        Append(m_description, part);
+    }
+}
+
+void ThreadScheduling::Revert() {
+    if (m_mmcssHandle) {
+        AvRevertMmThreadCharacteristics(m_mmcssHandle);
+        m_mmcssHandle = nullptr;
+    }
+}
+
+uint32_t CurrentProcessorNumber() {
+    return GetCurrentProcessorNumber();
+}
+
+bool TimerResolution::Begin(uint32_t periodMs, uint32_t& minMs, uint32_t& maxMs) {
+    End();
+    TIMECAPS caps = {};
+    if (timeGetDevCaps(&caps, sizeof(caps)) != MMSYSERR_NOERROR) {
+        caps.wPeriodMin = 1;
+        caps.wPeriodMax = 1000000;
+    }
+    minMs = caps.wPeriodMin;
+    maxMs = caps.wPeriodMax;
+    if (periodMs < minMs || periodMs > maxMs || timeBeginPeriod(periodMs) != TIMERR_NOERROR) {
+        return false;
+    }
+    m_periodMs = periodMs;
+    return true;
+}
+
+void TimerResolution::End() {
+    if (m_periodMs != 0) {
+        timeEndPeriod(m_periodMs);
+        m_periodMs = 0;
+    }
+}
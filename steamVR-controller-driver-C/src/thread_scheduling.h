@@ -0,0 +1,75 @@
+// src/thread_scheduling.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Приоритет потока: имена из vrsettings "io_thread_priority"
+enum class ThreadPriority : uint8_t {
+    Normal,
+    AboveNormal,
+    Highest,
+    TimeCritical
+};
+
+// Как планировать сетевой поток драйвера (прием и немедленная отправка поз)
+struct IoThreadSettings {
+    // Задача MMCSS ("Pro Audio", "Games", ... из
+    // HKLM\...\Multimedia\SystemProfile\Tasks). Пусто - без MMCSS.
+    std::string mmcssTask;
+    std::string priority = "normal";   // ParseThreadPriority; проверяется в Init
+    int core = -1;   // номер логического процессора; -1 - без привязки
+    // Разрешение системного таймера (timeBeginPeriod), мс; 0 - как у системы
+    uint32_t timerResolutionMs = 0;
+};
+
+// "normal", "above_normal", "highest", "time_critical"; false - неизвестное имя
+bool ParseThreadPriority(const std::string& name, ThreadPriority& priority);
+const char* ThreadPriorityName(ThreadPriority priority);
+
+// Планирование текущего потока: MMCSS, приоритет, привязка к ядру.
+// Apply и Revert вызываются из самого потока.
+//
+// С MMCSS приоритет задается через AvSetMmThreadPriority (above_normal и
+// highest - HIGH, time_critical - CRITICAL): MMCSS сам поднимает поток в
+// диапазон реального времени и обычный SetThreadPriority перебил бы это.
+class ThreadScheduling {
+public:
+    ThreadScheduling() = default;
+    ~ThreadScheduling() { Revert(); }
+    ThreadScheduling(const ThreadScheduling&) = delete;
+    ThreadScheduling& operator=(const ThreadScheduling&) = delete;
+
+    // Что не удалось, описано в Describe(); остальное применено
+    void Apply(const IoThreadSettings& settings);
+    // Снимает регистрацию MMCSS (до выхода из потока)
+    void Revert();
+
+    // "MMCSS 'Pro Audio' (high), core 2" и т.п. для лога
+    const std::string& Describe() const { return m_description; }
+
+private:
+    void* m_mmcssHandle = nullptr;
+    std::string m_description;
+};
+
+// Номер логического процессора, на котором сейчас выполняется поток
+uint32_t CurrentProcessorNumber();
+
+// Разрешение системного таймера на время жизни драйвера (timeBeginPeriod).
+// Действует на весь процесс vrserver: тайм-ауты ожиданий и Sleep.
+class TimerResolution {
+public:
+    TimerResolution() = default;
+    ~TimerResolution() { End(); }
+    TimerResolution(const TimerResolution&) = delete;
+    TimerResolution& operator=(const TimerResolution&) = delete;
+
+    // false - значение вне диапазона системы (он - в minMs/maxMs)
+    bool Begin(uint32_t periodMs, uint32_t& minMs, uint32_t& maxMs);
+    void End();
+    uint32_t PeriodMs() const { return m_periodMs; }
+
+private:
+    uint32_t m_periodMs = 0;
+};
@@ -0,0 +1,129 @@
+// tests/sequence_restart_test.cpp
+// Перезапуск отправителя: после 500 пакетов счет packet_number снова с 0.
+// Новые пакеты не должны отбрасываться как устаревшие, пока номер не
+// догонит старый, - ни в PacketBatch, ни в MotionModel.
+//
+//   cmake -DCVDRIVER_BUILD_TESTS=ON ..
+//   cmake --build . --target cvdriver_sequence_restart_test
+//   ctest -R sequence_restart
+#include "packet_batch.h"
+#include "motion_model.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kSenderA = (uint64_t)0x1401A8C0 << 16 | 0x5000;   // 192.168.1.20
+constexpr uint64_t kSenderB = (uint64_t)0x1401A8C0 << 16 | 0x5001;   // тот же адрес, новый порт
+const auto kPeriod = std::chrono::microseconds(16667);
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        g_failures++;
+    }
+}
+
+ControllerData Packet(uint32_t number) {
+    ControllerData data;
+    memset(&data, 0, sizeof(data));
+    data.controller_id = 0;
+    data.packet_number = number;
+    data.quat_w = 1.0f;
+    data.accel_x = 0.001f * (float)number;
+    return data;
+}
+
+// Один пакет - одна пачка, как при приходе по одному. true - пакет принят.
+bool Deliver(PacketBatch& batch, uint32_t number, uint64_t sender, Clock::time_point arrivedAt,
+             bool* restarted = nullptr) {
+    batch.Clear();
+    batch.Add(Packet(number), Clock::time_point(), sender, arrivedAt);
+    if (restarted) {
+        *restarted = batch.DeviceCount() == 1 && batch.Device(0).restarted;
+    }
+    return batch.DeviceCount() == 1;
+}
+
+// 500 пакетов, затем перезапуск с 0 от отправителя restartSender через паузу gap
+void ReplayRestart(const char* name, uint64_t restartSender, Clock::duration gap, bool expectRestart) {
+    PacketBatch batch;
+    Clock::time_point t = Clock::now();
+    for (uint32_t n = 1; n <= 500; n++) {
+        Deliver(batch, n, kSenderA, t);
+        t += kPeriod;
+    }
+    t += gap;
+
+    bool restarted = false;
+    bool accepted = Deliver(batch, 0, restartSender, t, &restarted);
+    char what[160];
+    snprintf(what, sizeof(what), "%s: first packet after restart %s", name,
+             expectRestart ? "accepted as restart" : "dropped as late");
+    Check(accepted == expectRestart && restarted == expectRestart, what);
+    if (!expectRestart) {
+        return;
+    }
+
+    // Дальше поток идет обычным порядком
+    size_t acceptedCount = 0;
+    for (uint32_t n = 1; n < 100; n++) {
+        t += kPeriod;
+        acceptedCount += Deliver(batch, n, restartSender, t) ? 1 : 0;
+    }
+    snprintf(what, sizeof(what), "%s: all packets after restart accepted", name);
+    Check(acceptedCount == 99, what);
+    snprintf(what, sizeof(what), "%s: one restart counted", name);
+    Check(batch.Counters(0).restarts == 1 && batch.Counters(0).outOfOrder == 0, what);
+}
+
+void TestMotionModelRestart() {
+    MotionModel motion;
+    Clock::time_point t = Clock::now();
+    double position[3] = { 0.0, 0.0, 0.0 };
+    for (uint32_t n = 1; n <= 500; n++) {
+        position[0] = 0.001 * n;
+        motion.AddSample(n, t, position);
+        t += kPeriod;
+    }
+
+    // Переупорядоченный пакет сразу после нового - отбрасывается
+    Check(!motion.AddSample(499, t, position), "MotionModel: reordered packet rejected");
+
+    // Перезапуск с 0 через 1 с: новая история, а не устаревший пакет
+    t += std::chrono::seconds(1);
+    position[0] = 0.0;
+    Check(motion.AddSample(0, t, position), "MotionModel: packet 0 after restart accepted");
+    t += kPeriod;
+    position[0] = 0.001;
+    Check(motion.AddSample(1, t, position), "MotionModel: packet 1 after restart accepted");
+    Check(motion.SampleInterval(2) > 0.0, "MotionModel: interval known after restart");
+}
+
+} // namespace
+
+int main() {
+    // Тот же адрес:порт, приложение перезапущено за 1 с
+    ReplayRestart("same sender, 1 s pause", kSenderA, std::chrono::seconds(1), true);
+    // Новый сокет (новый порт) - перезапуск сразу, без паузы
+    ReplayRestart("new sender, no pause", kSenderB, std::chrono::seconds(0), true);
+    // Тот же отправитель без паузы - это опоздавший пакет
+    ReplayRestart("same sender, no pause", kSenderA, std::chrono::seconds(0), false);
+    // Общая память (отправитель неизвестен): только по паузе
+    ReplayRestart("unknown sender, 1 s pause", 0, std::chrono::seconds(1), true);
+
+    TestMotionModelRestart();
+
+    if (g_failures != 0) {
+        printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
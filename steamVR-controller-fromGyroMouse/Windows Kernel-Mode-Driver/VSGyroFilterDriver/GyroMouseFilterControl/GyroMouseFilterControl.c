@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../gyro_ring.h"
+
 // IOCTL команды (должны совпадать с драйвером)
 #define IOCTL_GYRO_SET_BLOCK     CTL_CODE(FILE_DEVICE_MOUSE, 0x800, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_GYRO_SET_FILTER    CTL_CODE(FILE_DEVICE_MOUSE, 0x801, METHOD_BUFFERED, FILE_ANY_ACCESS)
@@ -17,13 +19,14 @@ void PrintUsage(const char* programName) {
     printf("  block-input                - Block all mouse input\n");
     printf("  unblock-input              - Unblock mouse input\n");
     printf("  get-info                   - Get device information\n");
+    printf("  watch [seconds]            - Read raw reports from the driver's ring (default 10 s)\n");
     printf("\nExamples:\n");
     printf("  %s enable-filter\n", programName);
     printf("  %s set-threshold 10\n", programName);
     printf("  %s block-input\n", programName);
 }
 
-HANDLE OpenDevice() {
+HANDLE OpenDevice(DWORD flags) {
     // Try different device names
     const char* deviceNames[] = {
         "\\\\.\\GyroMouseFilter",
@@ -38,7 +41,7 @@ HANDLE OpenDevice() {
             0,
             NULL,
             OPEN_EXISTING,
-            0,
+            flags,
             NULL
         );
 
@@ -185,19 +188,98 @@ int GetInfo(HANDLE hDevice) {
     return 0;
 }
 
+// Чтение кольца отчетов драйвера (gyro_ring.h): так же его читает
+// продюсер, только вместо печати - отправка пакетов
+int Watch(DWORD seconds) {
+    // Запрос кольца висит, пока его не отменят: нужен асинхронный описатель
+    HANDLE hDevice = OpenDevice(FILE_FLAG_OVERLAPPED);
+    if (hDevice == INVALID_HANDLE_VALUE) {
+        return 1;
+    }
+
+    PGYRO_REPORT_RING ring = (PGYRO_REPORT_RING)VirtualAlloc(NULL, sizeof(GYRO_REPORT_RING),
+        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    HANDLE event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    OVERLAPPED overlapped = { 0 };
+    overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (ring == NULL || event == NULL || overlapped.hEvent == NULL) {
+        printf("Error: Out of resources\n");
+        CloseHandle(hDevice);
+        return 1;
+    }
+
+    GYRO_RING_MAP map;
+    map.EventHandle = (ULONG64)(ULONG_PTR)event;
+    DWORD bytesReturned = 0;
+    if (DeviceIoControl(hDevice, IOCTL_GYRO_MAP_RING, &map, sizeof(map),
+            ring, sizeof(GYRO_REPORT_RING), &bytesReturned, &overlapped) ||
+        GetLastError() != ERROR_IO_PENDING) {
+        printf("Error: Failed to map report ring (0x%x)\n", GetLastError());
+        CloseHandle(hDevice);
+        return 1;
+    }
+
+    printf("Report ring mapped, reading for %lu s\n", seconds);
+    ULONG read = 0;
+    ULONGLONG start = GetTickCount64();
+    ULONGLONG lastPrint = start;
+    ULONG reports = 0;
+    LONG sumX = 0, sumY = 0;
+    USHORT buttonFlags = 0;
+
+    while (GetTickCount64() - start < seconds * 1000ULL) {
+        WaitForSingleObject(event, 100);
+
+        ULONG write = ring->WriteIndex;
+        MemoryBarrier();
+        while (read != write) {
+            const GYRO_RING_ENTRY* entry = &ring->Entries[read & (GYRO_RING_CAPACITY - 1)];
+            sumX += entry->LastX;
+            sumY += entry->LastY;
+            buttonFlags |= entry->ButtonFlags;
+            reports++;
+            read++;
+        }
+        ring->ReadIndex = read;
+
+        ULONGLONG now = GetTickCount64();
+        if (now - lastPrint >= 1000) {
+            printf("  %5lu reports/s  dx %6ld  dy %6ld  buttons 0x%04X  dropped %lu\n",
+                reports, sumX, sumY, buttonFlags, ring->Dropped);
+            reports = 0;
+            sumX = sumY = 0;
+            buttonFlags = 0;
+            lastPrint = now;
+        }
+    }
+
+    // Буфер можно освободить только после завершения запроса
+    CancelIoEx(hDevice, &overlapped);
+    GetOverlappedResult(hDevice, &overlapped, &bytesReturned, TRUE);
+    CloseHandle(overlapped.hEvent);
+    CloseHandle(event);
+    CloseHandle(hDevice);
+    VirtualFree(ring, 0, MEM_RELEASE);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         PrintUsage(argv[0]);
         return 1;
     }
 
-    HANDLE hDevice = OpenDevice();
+    const char* command = argv[1];
+    if (strcmp(command, "watch") == 0) {
+        return Watch(argc >= 3 ? (DWORD)atol(argv[2]) : 10);
+    }
+
+    HANDLE hDevice = OpenDevice(0);
     if (hDevice == INVALID_HANDLE_VALUE) {
         return 1;
     }
 
     int result = 0;
-    const char* command = argv[1];
 
     if (strcmp(command, "enable-filter") == 0) {
         result = EnableFilter(hDevice);
@@ -96,6 +96,10 @@ GyroMouseCreateDevice(
     deviceContext->LastX = 0;
     deviceContext->LastY = 0;
     deviceContext->FilterThreshold = 5;
+    KeInitializeSpinLock(&deviceContext->RingLock);
+    deviceContext->Ring = NULL;
+    deviceContext->RingEvent = NULL;
+    deviceContext->RingWriteIndex = 0;
 
     // Создать I/O Target для пересылки запросов вниз по стеку
     WDF_OBJECT_ATTRIBUTES attributes;
@@ -186,6 +190,17 @@ GyroMouseCreateControlDevice(
         return status;
     }
 
+    // Описатель события IOCTL_GYRO_MAP_RING действителен только в
+    // контексте вызывающего процесса - разбираем его до постановки в очередь
+    WdfDeviceInitSetIoInCallerContextCallback(deviceInit, GyroMouseEvtIoInCallerContext);
+
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, REQUEST_CONTEXT);
+    attributes.EvtCleanupCallback = GyroMouseEvtRequestCleanup;
+    WdfDeviceInitSetRequestAttributes(deviceInit, &attributes);
+
+    // Уведомление о выключении задается до WdfDeviceCreate
+    WdfControlDeviceInitSetShutdownNotification(deviceInit, NULL, WdfDeviceShutdown);
+
     // Инициализировать контекст
     WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, CONTROL_DEVICE_CONTEXT);
     attributes.ParentObject = FilterDevice;
@@ -227,9 +242,28 @@ GyroMouseCreateControlDevice(
         return status;
     }
 
+    // Ручная очередь для IOCTL_GYRO_MAP_RING: запрос лежит в ней, пока
+    // приложение читает кольцо, и отменяется при закрытии описателя
+    WDF_IO_QUEUE_CONFIG ringQueueConfig;
+    WDF_IO_QUEUE_CONFIG_INIT(&ringQueueConfig, WdfIoQueueDispatchManual);
+    ringQueueConfig.EvtIoCanceledOnQueue = GyroMouseEvtRingCanceledOnQueue;
+
+    status = WdfIoQueueCreate(controlDevice,
+        &ringQueueConfig,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &controlContext->RingQueue);
+
+    if (!NT_SUCCESS(status)) {
+        KdPrint(("GyroMouseFilter: WdfIoQueueCreate for ring queue failed 0x%x\n", status));
+        WdfObjectDelete(controlDevice);
+        return status;
+    }
+
     // Установить устройство как контрольное
     WdfDeviceSetCharacteristics(controlDevice, FILE_DEVICE_SECURE_OPEN);
-    WdfControlDeviceInitSetShutdownNotification(deviceInit, NULL, WdfDeviceShutdown);
+
+    // Без этого контрольное устройство не принимает запросы
+    WdfControlFinishInitializing(controlDevice);
 
     KdPrint(("GyroMouseFilter: Control device created successfully\n"));
     return STATUS_SUCCESS;
@@ -255,14 +289,258 @@ GyroMouseFilterMouseData(
         abs(deltaY) < (LONG)DeviceContext->FilterThreshold) {
         MouseData->LastX = 0;
         MouseData->LastY = 0;
-        KdPrint(("GyroMouseFilter: Filtered small movement X=%d Y=%d\n", deltaX, deltaY));
     }
     else {
         MouseData->LastX = (deltaX * 3 + DeviceContext->LastX) / 4;
         MouseData->LastY = (deltaY * 3 + DeviceContext->LastY) / 4;
         DeviceContext->LastX = MouseData->LastX;
         DeviceContext->LastY = MouseData->LastY;
-        KdPrint(("GyroMouseFilter: Filtered movement X=%d Y=%d\n", MouseData->LastX, MouseData->LastY));
+    }
+}
+
+//
+// Кольцо отчетов для user-mode (gyro_ring.h)
+//
+
+//
+// Запись пачки отчетов в кольцо приложения. IRQL <= DISPATCH_LEVEL,
+// вызывается из completion routine: без KdPrint и без выделения памяти.
+// Событие сигналится один раз на пачку.
+//
+VOID
+GyroMouseRingWrite(
+    _In_ PDEVICE_CONTEXT DeviceContext,
+    _In_reads_(Count) const MOUSE_INPUT_DATA* MouseData,
+    _In_ ULONG Count,
+    _In_ USHORT Flags
+)
+{
+    KIRQL irql;
+    LARGE_INTEGER now;
+    PGYRO_REPORT_RING ring;
+
+    // Быстрая проверка без блокировки: кольцо обычно не подключено
+    if (DeviceContext->Ring == NULL || Count == 0) {
+        return;
+    }
+
+    now = KeQueryPerformanceCounter(NULL);
+
+    KeAcquireSpinLock(&DeviceContext->RingLock, &irql);
+
+    ring = DeviceContext->Ring;
+    if (ring != NULL) {
+        ULONG write = DeviceContext->RingWriteIndex;
+        // ReadIndex пишет приложение: только сравниваем, индексом не служит
+        ULONG read = ring->ReadIndex;
+
+        for (ULONG i = 0; i < Count; i++) {
+            if ((ULONG)(write - read) >= GYRO_RING_CAPACITY) {
+                // Приложение не успевает: старые отчеты не затираем
+                ring->Dropped += Count - i;
+                break;
+            }
+
+            PGYRO_RING_ENTRY entry = &ring->Entries[write & (GYRO_RING_CAPACITY - 1)];
+            entry->Timestamp = now.QuadPart;
+            entry->LastX = MouseData[i].LastX;
+            entry->LastY = MouseData[i].LastY;
+            entry->ButtonFlags = MouseData[i].ButtonFlags;
+            entry->ButtonData = MouseData[i].ButtonData;
+            entry->Flags = Flags;
+            entry->Reserved = 0;
+            write++;
+        }
+
+        // Записи видны приложению раньше нового WriteIndex
+        KeMemoryBarrier();
+        ring->WriteIndex = write;
+        DeviceContext->RingWriteIndex = write;
+
+        if (DeviceContext->RingEvent != NULL) {
+            KeSetEvent(DeviceContext->RingEvent, IO_MOUSE_INCREMENT, FALSE);
+        }
+    }
+
+    KeReleaseSpinLock(&DeviceContext->RingLock, irql);
+}
+
+//
+// IOCTL_GYRO_MAP_RING: подключить кольцо приложения. Запрос не
+// завершается, а ждет в RingQueue - пока он там, буфер зафиксирован в
+// памяти и доступен по системному адресу.
+//
+VOID
+GyroMouseMapRing(
+    _In_ PCONTROL_DEVICE_CONTEXT ControlContext,
+    _In_ WDFREQUEST Request
+)
+{
+    PDEVICE_CONTEXT deviceContext = ControlContext->FilterContext;
+    PREQUEST_CONTEXT requestContext = GetRequestContext(Request);
+    PMDL mdl = NULL;
+    PGYRO_REPORT_RING ring = NULL;
+    LARGE_INTEGER frequency;
+    KIRQL irql;
+    BOOLEAN busy;
+    NTSTATUS status;
+
+    status = WdfRequestRetrieveOutputWdmMdl(Request, &mdl);
+    if (NT_SUCCESS(status) && MmGetMdlByteCount(mdl) < sizeof(GYRO_REPORT_RING)) {
+        status = STATUS_BUFFER_TOO_SMALL;
+    }
+    if (NT_SUCCESS(status)) {
+        ring = (PGYRO_REPORT_RING)MmGetSystemAddressForMdlSafe(mdl, NormalPagePriority | MdlMappingNoExecute);
+        if (ring == NULL) {
+            status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+        else if (((ULONG_PTR)ring & (sizeof(LONG64) - 1)) != 0) {
+            status = STATUS_DATATYPE_MISALIGNMENT;
+        }
+    }
+    if (!NT_SUCCESS(status)) {
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    KeQueryPerformanceCounter(&frequency);
+    ring->Version = GYRO_RING_VERSION;
+    ring->Capacity = GYRO_RING_CAPACITY;
+    ring->Frequency = frequency.QuadPart;
+    ring->WriteIndex = 0;
+    ring->ReadIndex = 0;
+    ring->Dropped = 0;
+    ring->Reserved = 0;
+
+    KeAcquireSpinLock(&deviceContext->RingLock, &irql);
+    busy = deviceContext->Ring != NULL;
+    if (!busy) {
+        deviceContext->Ring = ring;
+        deviceContext->RingEvent = requestContext->RingEvent;
+        deviceContext->RingWriteIndex = 0;
+        requestContext->RingEvent = NULL;   // теперь принадлежит кольцу
+    }
+    KeReleaseSpinLock(&deviceContext->RingLock, irql);
+
+    if (busy) {
+        // Кольцо уже у другого приложения
+        WdfRequestComplete(Request, STATUS_DEVICE_BUSY);
+        return;
+    }
+
+    status = WdfRequestForwardToIoQueue(Request, ControlContext->RingQueue);
+    if (!NT_SUCCESS(status)) {
+        GyroMouseUnmapRing(deviceContext);
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    KdPrint(("GyroMouseFilter: Report ring mapped\n"));
+}
+
+//
+// Отключить кольцо до завершения удерживающего его запроса
+//
+VOID
+GyroMouseUnmapRing(
+    _In_ PDEVICE_CONTEXT DeviceContext
+)
+{
+    KIRQL irql;
+    PKEVENT event;
+
+    KeAcquireSpinLock(&DeviceContext->RingLock, &irql);
+    event = DeviceContext->RingEvent;
+    DeviceContext->Ring = NULL;
+    DeviceContext->RingEvent = NULL;
+    KeReleaseSpinLock(&DeviceContext->RingLock, irql);
+
+    if (event != NULL) {
+        ObDereferenceObject(event);
+    }
+}
+
+//
+// Запрос кольца отменен (CancelIoEx, закрытие описателя, удаление устройства)
+//
+VOID
+GyroMouseEvtRingCanceledOnQueue(
+    _In_ WDFQUEUE Queue,
+    _In_ WDFREQUEST Request
+)
+{
+    PCONTROL_DEVICE_CONTEXT controlContext = GetControlDeviceContext(WdfIoQueueGetDevice(Queue));
+
+    GyroMouseUnmapRing(controlContext->FilterContext);
+    WdfRequestComplete(Request, STATUS_CANCELLED);
+
+    KdPrint(("GyroMouseFilter: Report ring unmapped\n"));
+}
+
+//
+// Разбор IOCTL_GYRO_MAP_RING в контексте вызывающего процесса:
+// описатель события превращается в указатель на объект
+//
+VOID
+GyroMouseEvtIoInCallerContext(
+    _In_ WDFDEVICE Device,
+    _In_ WDFREQUEST Request
+)
+{
+    WDF_REQUEST_PARAMETERS params;
+    NTSTATUS status;
+
+    WDF_REQUEST_PARAMETERS_INIT(&params);
+    WdfRequestGetParameters(Request, &params);
+
+    if (params.Type == WdfRequestTypeDeviceControl &&
+        params.Parameters.DeviceIoControl.IoControlCode == IOCTL_GYRO_MAP_RING) {
+        PGYRO_RING_MAP map = NULL;
+        size_t length = 0;
+
+        status = WdfRequestRetrieveInputBuffer(Request,
+            sizeof(GYRO_RING_MAP),
+            (PVOID*)&map,
+            &length);
+
+        if (NT_SUCCESS(status) && map->EventHandle != 0) {
+            PKEVENT event = NULL;
+            status = ObReferenceObjectByHandle((HANDLE)(ULONG_PTR)map->EventHandle,
+                EVENT_MODIFY_STATE,
+                *ExEventObjectType,
+                UserMode,
+                (PVOID*)&event,
+                NULL);
+            if (NT_SUCCESS(status)) {
+                GetRequestContext(Request)->RingEvent = event;
+            }
+        }
+
+        if (!NT_SUCCESS(status)) {
+            WdfRequestComplete(Request, status);
+            return;
+        }
+    }
+
+    status = WdfDeviceEnqueueRequest(Device, Request);
+    if (!NT_SUCCESS(status)) {
+        WdfRequestComplete(Request, status);
+    }
+}
+
+//
+// Событие, не перешедшее к кольцу (ошибка или отмена до разбора)
+//
+VOID
+GyroMouseEvtRequestCleanup(
+    _In_ WDFOBJECT Object
+)
+{
+    PREQUEST_CONTEXT requestContext = GetRequestContext((WDFREQUEST)Object);
+
+    if (requestContext->RingEvent != NULL) {
+        ObDereferenceObject(requestContext->RingEvent);
+        requestContext->RingEvent = NULL;
     }
 }
 
@@ -295,14 +573,19 @@ GyroMouseRequestCompletionRoutine(
             PMOUSE_INPUT_DATA mouseData = (PMOUSE_INPUT_DATA)buffer;
             ULONG numEntries = (ULONG)(bufferLength / sizeof(MOUSE_INPUT_DATA));
 
+            // Сырые дельты - в кольцо приложения, до фильтрации и
+            // блокировки: заблокированное движение не теряется.
+            // Здесь нет KdPrint: отчеты идут с частотой устройства.
+            GyroMouseRingWrite(deviceContext, mouseData, numEntries,
+                deviceContext->BlockInput ? GYRO_RING_ENTRY_BLOCKED :
+                deviceContext->FilterEnabled ? GYRO_RING_ENTRY_FILTERED : 0);
+
             for (ULONG i = 0; i < numEntries; i++) {
                 PMOUSE_INPUT_DATA entry = &mouseData[i];
 
                 if (deviceContext->BlockInput) {
                     entry->LastX = 0;
                     entry->LastY = 0;
-                    KdPrint(("GyroMouseFilter: BLOCKED Delta X=%d Y=%d\n",
-                        entry->LastX, entry->LastY));
                 }
                 else if (deviceContext->FilterEnabled) {
                     GyroMouseFilterMouseData(deviceContext, entry);
@@ -357,6 +640,11 @@ GyroMouseEvtDeviceControl(
 
     switch (IoControlCode) {
 
+    case IOCTL_GYRO_MAP_RING:
+        // Завершается при отмене (GyroMouseEvtRingCanceledOnQueue)
+        GyroMouseMapRing(controlContext, Request);
+        break;
+
     case IOCTL_GYRO_SET_BLOCK: {
         BOOLEAN* blockFlag = NULL;
         size_t length = 0;
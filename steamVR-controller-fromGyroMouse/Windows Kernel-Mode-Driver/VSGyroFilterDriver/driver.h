@@ -8,6 +8,8 @@
 #include <vhf.h>
 #include <initguid.h>
 
+#include "gyro_ring.h"
+
 #ifndef IOCTL_INTERNAL_MOUSE_CONNECT
 #define IOCTL_INTERNAL_MOUSE_CONNECT \
     CTL_CODE(FILE_DEVICE_MOUSE, 0x0080, METHOD_NEITHER, FILE_ANY_ACCESS)
@@ -27,6 +29,12 @@ typedef struct _DEVICE_CONTEXT {
     LONG LastY;
     ULONG FilterThreshold;
     PVOID VhfHandle;
+
+    // Кольцо отчетов для user-mode (gyro_ring.h), под RingLock
+    KSPIN_LOCK RingLock;
+    PGYRO_REPORT_RING Ring;     // системный адрес буфера приложения или NULL
+    PKEVENT RingEvent;          // событие приложения или NULL
+    ULONG RingWriteIndex;       // своя копия: Ring доступен приложению на запись
 } DEVICE_CONTEXT, *PDEVICE_CONTEXT;
 
 //
@@ -34,10 +42,20 @@ typedef struct _DEVICE_CONTEXT {
 //
 typedef struct _CONTROL_DEVICE_CONTEXT {
     PDEVICE_CONTEXT FilterContext;
+    WDFQUEUE RingQueue;         // ручная очередь: держит IOCTL_GYRO_MAP_RING
 } CONTROL_DEVICE_CONTEXT, *PCONTROL_DEVICE_CONTEXT;
 
+//
+// Контекст запроса к контрольному устройству: событие, полученное по
+// описателю в контексте вызывающего процесса
+//
+typedef struct _REQUEST_CONTEXT {
+    PKEVENT RingEvent;
+} REQUEST_CONTEXT, *PREQUEST_CONTEXT;
+
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_CONTEXT, GetDeviceContext)
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(CONTROL_DEVICE_CONTEXT, GetControlDeviceContext)
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(REQUEST_CONTEXT, GetRequestContext)
 
 //
 // IOCTL для управления из user-mode
@@ -46,6 +64,7 @@ WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(CONTROL_DEVICE_CONTEXT, GetControlDeviceConte
 #define IOCTL_GYRO_SET_FILTER    CTL_CODE(FILE_DEVICE_MOUSE, 0x801, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_GYRO_SET_THRESHOLD CTL_CODE(FILE_DEVICE_MOUSE, 0x802, METHOD_BUFFERED, FILE_ANY_ACCESS)
 #define IOCTL_GYRO_GET_INFO      CTL_CODE(FILE_DEVICE_MOUSE, 0x803, METHOD_BUFFERED, FILE_ANY_ACCESS)
+// IOCTL_GYRO_MAP_RING (0x804) - в gyro_ring.h
 
 //
 // HID Report Descriptor
@@ -68,6 +87,9 @@ EVT_WDF_DRIVER_DEVICE_ADD GyroMouseEvtDeviceAdd;
 EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL GyroMouseEvtInternalDeviceControl;
 EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL GyroMouseEvtDeviceControl;
 EVT_WDF_REQUEST_COMPLETION_ROUTINE GyroMouseRequestCompletionRoutine;
+EVT_WDF_IO_IN_CALLER_CONTEXT GyroMouseEvtIoInCallerContext;
+EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE GyroMouseEvtRingCanceledOnQueue;
+EVT_WDF_OBJECT_CONTEXT_CLEANUP GyroMouseEvtRequestCleanup;
 
 NTSTATUS
 GyroMouseCreateDevice(
@@ -86,6 +108,25 @@ GyroMouseFilterMouseData(
     _Inout_ PMOUSE_INPUT_DATA MouseData
 );
 
+VOID
+GyroMouseMapRing(
+    _In_ PCONTROL_DEVICE_CONTEXT ControlContext,
+    _In_ WDFREQUEST Request
+);
+
+VOID
+GyroMouseUnmapRing(
+    _In_ PDEVICE_CONTEXT DeviceContext
+);
+
+VOID
+GyroMouseRingWrite(
+    _In_ PDEVICE_CONTEXT DeviceContext,
+    _In_reads_(Count) const MOUSE_INPUT_DATA* MouseData,
+    _In_ ULONG Count,
+    _In_ USHORT Flags
+);
+
 VOID
 GyroMouseEvtVhfAsyncOperationComplete(
     _In_ PVHF_CONFIG VhfConfig,
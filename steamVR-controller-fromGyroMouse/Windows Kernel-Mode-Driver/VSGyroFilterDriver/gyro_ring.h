@@ -0,0 +1,55 @@
+#ifndef GYRO_RING_H
+#define GYRO_RING_H
+
+//
+// Кольцо отчетов мыши, общее для драйвера и user-mode.
+// Подключается и из driver.h (ntddk.h), и из приложения (windows.h).
+//
+// Приложение выделяет GYRO_REPORT_RING у себя, создает событие и
+// отправляет IOCTL_GYRO_MAP_RING: буфер (METHOD_OUT_DIRECT) и описатель
+// события остаются у драйвера, пока запрос не отменен (CancelIoEx или
+// закрытие описателя устройства). Драйвер пишет в кольцо сырые дельты и
+// кнопки каждого MOUSE_INPUT_DATA до фильтрации и блокировки и сигналит
+// событие один раз на пачку. Один писатель (драйвер), один читатель.
+//
+// Драйвер не доверяет полям, которые пишет приложение: свое значение
+// WriteIndex он хранит у себя, ReadIndex только сравнивает.
+//
+
+#define GYRO_RING_VERSION  1
+#define GYRO_RING_CAPACITY 1024     // степень двойки; ~1 с при 1000 Гц
+
+// Вход IOCTL_GYRO_MAP_RING: описатель события (auto-reset) или 0
+typedef struct _GYRO_RING_MAP {
+    ULONG64 EventHandle;
+} GYRO_RING_MAP, *PGYRO_RING_MAP;
+
+// Флаги записи
+#define GYRO_RING_ENTRY_BLOCKED  0x0001   // в систему ушли нули (BlockInput)
+#define GYRO_RING_ENTRY_FILTERED 0x0002   // в систему ушли сглаженные дельты
+
+typedef struct _GYRO_RING_ENTRY {
+    LONG64 Timestamp;       // KeQueryPerformanceCounter = QueryPerformanceCounter
+    LONG LastX;             // сырые дельты устройства
+    LONG LastY;
+    USHORT ButtonFlags;     // MOUSE_INPUT_DATA.ButtonFlags (RI_MOUSE_* совпадают)
+    USHORT ButtonData;      // колесо
+    USHORT Flags;           // GYRO_RING_ENTRY_*
+    USHORT Reserved;
+} GYRO_RING_ENTRY, *PGYRO_RING_ENTRY;
+
+typedef struct _GYRO_REPORT_RING {
+    ULONG Version;                  // GYRO_RING_VERSION, пишет драйвер
+    ULONG Capacity;                 // GYRO_RING_CAPACITY, пишет драйвер
+    LONG64 Frequency;               // частота счетчика Timestamp
+    volatile ULONG WriteIndex;      // растет без обнуления, пишет драйвер
+    volatile ULONG ReadIndex;       // растет без обнуления, пишет приложение
+    volatile ULONG Dropped;         // отчетов не вошло: кольцо было полным
+    ULONG Reserved;
+    GYRO_RING_ENTRY Entries[GYRO_RING_CAPACITY];   // индекс & (Capacity - 1)
+} GYRO_REPORT_RING, *PGYRO_REPORT_RING;
+
+// METHOD_OUT_DIRECT: выходной буфер - сам GYRO_REPORT_RING
+#define IOCTL_GYRO_MAP_RING CTL_CODE(FILE_DEVICE_MOUSE, 0x804, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+
+#endif // GYRO_RING_H
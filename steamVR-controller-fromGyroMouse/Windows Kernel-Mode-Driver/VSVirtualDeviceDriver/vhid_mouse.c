@@ -37,6 +37,17 @@ static const UCHAR g_VhidMouseReportDescriptor[] = {
 };
 
 // Forward declarations
+static BOOLEAN
+VhidMouseQueueReport(
+    _In_ PVHID_MOUSE_CONTEXT DeviceContext,
+    _In_ const VHID_MOUSE_DATA* MouseData
+);
+
+static VOID
+VhidMouseSubmitNext(
+    _In_ PVHID_MOUSE_CONTEXT DeviceContext
+);
+
 VOID
 VhidMouseEvtVhfReadyForNextReadReport(
     _In_ VHFHANDLE VhfHandle,
@@ -121,11 +132,13 @@ VhidMouseCreateDevice(
     WDF_IO_QUEUE_CONFIG queueConfig;
     VHF_CONFIG vhfConfig;
     VHFHANDLE vhfHandle;
+    UNICODE_STRING symbolicLinkName;
 
     PAGED_CODE();
 
     // Создать атрибуты устройства с контекстом
     WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&deviceAttributes, VHID_MOUSE_CONTEXT);
+    deviceAttributes.EvtCleanupCallback = VhidMouseEvtDeviceCleanup;
 
     // Создать устройство
     status = WdfDeviceCreate(&DeviceInit, &deviceAttributes, &device);
@@ -139,9 +152,25 @@ VhidMouseCreateDevice(
     deviceContext->Device = device;
     deviceContext->MouseActive = FALSE;
     deviceContext->VhfHandle = NULL;
+    deviceContext->WriteIndex = 0;
+    deviceContext->ReadIndex = 0;
+    deviceContext->ReadyForNextReport = 0;
+    deviceContext->Submitted = 0;
+    deviceContext->Dropped = 0;
+    deviceContext->Failed = 0;
+
+    // Пакеты очереди выделены вместе с контекстом и указывают на свои
+    // отчеты: на пути отчета нет выделения памяти
+    for (ULONG i = 0; i < VHID_REPORT_QUEUE_SIZE; i++) {
+        PVHID_REPORT_SLOT slot = &deviceContext->Reports[i];
+        RtlZeroMemory(&slot->Report, sizeof(slot->Report));
+        slot->Packet.reportId = 0;
+        slot->Packet.reportBuffer = (PUCHAR)&slot->Report;
+        slot->Packet.reportBufferLen = sizeof(VHID_MOUSE_INPUT_REPORT);
+    }
 
-    // Создать очередь для IOCTL
-    WDF_IO_QUEUE_CONFIG_INIT_DEFAULT_QUEUE(&queueConfig, WdfIoQueueDispatchParallel);
+    // Создать очередь для IOCTL. Sequential: у очереди отчетов один писатель
+    WDF_IO_QUEUE_CONFIG_INIT_DEFAULT_QUEUE(&queueConfig, WdfIoQueueDispatchSequential);
     queueConfig.EvtIoDeviceControl = VhidMouseEvtIoDeviceControl;
 
     status = WdfIoQueueCreate(device,
@@ -154,10 +183,19 @@ VhidMouseCreateDevice(
         return status;
     }
 
+    // Имя для user-mode: \\.\GyroVhidMouse
+    RtlInitUnicodeString(&symbolicLinkName, L"\\DosDevices\\GyroVhidMouse");
+    status = WdfDeviceCreateSymbolicLink(device, &symbolicLinkName);
+    if (!NT_SUCCESS(status)) {
+        KdPrint(("VhidMouse: WdfDeviceCreateSymbolicLink failed 0x%x\n", status));
+        return status;
+    }
+
     // Инициализировать VHF конфигурацию
     RtlZeroMemory(&vhfConfig, sizeof(VHF_CONFIG));
     vhfConfig.Size = sizeof(VHF_CONFIG);
     vhfConfig.DeviceObject = WdfDeviceWdmGetDeviceObject(device);
+    vhfConfig.VhfClientContext = deviceContext;
     vhfConfig.ReportDescriptor = (PUCHAR)g_VhidMouseReportDescriptor;
     vhfConfig.ReportDescriptorLength = sizeof(g_VhidMouseReportDescriptor);
     vhfConfig.EvtVhfReadyForNextReadReport = VhidMouseEvtVhfReadyForNextReadReport;
@@ -178,6 +216,7 @@ VhidMouseCreateDevice(
     if (!NT_SUCCESS(status)) {
         KdPrint(("VhidMouse: VhfStart failed 0x%x\n", status));
         VhfDelete(vhfHandle, FALSE);
+        deviceContext->VhfHandle = NULL;
         return status;
     }
 
@@ -188,7 +227,104 @@ VhidMouseCreateDevice(
 }
 
 //
-// VhidMouseEvtVhfReadyForNextReadReport - VHF готов принять следующий отчет
+// VhidMouseEvtDeviceCleanup - удаление устройства: после VhfDelete с
+// ожиданием VHF больше не вызывает callback'и и не читает пакеты очереди
+//
+VOID
+VhidMouseEvtDeviceCleanup(
+    _In_ WDFOBJECT Object
+)
+{
+    PVHID_MOUSE_CONTEXT deviceContext = GetVhidMouseContext((WDFDEVICE)Object);
+
+    deviceContext->MouseActive = FALSE;
+    if (deviceContext->VhfHandle != NULL) {
+        VhfDelete(deviceContext->VhfHandle, TRUE);
+        deviceContext->VhfHandle = NULL;
+    }
+}
+
+//
+// Поставить отчет в очередь. Только из обработчика IOCTL (один писатель).
+// Полная очередь не затирает старые отчеты: новый отбрасывается.
+//
+static BOOLEAN
+VhidMouseQueueReport(
+    _In_ PVHID_MOUSE_CONTEXT DeviceContext,
+    _In_ const VHID_MOUSE_DATA* MouseData
+)
+{
+    ULONG write = DeviceContext->WriteIndex;
+
+    // Один слот всегда свободен: отчет последнего отданного слота
+    // может еще копироваться в VHF
+    if ((ULONG)(write - DeviceContext->ReadIndex) >= VHID_REPORT_QUEUE_SIZE - 1) {
+        InterlockedIncrement(&DeviceContext->Dropped);
+        return FALSE;
+    }
+
+    PVHID_MOUSE_INPUT_REPORT report = &DeviceContext->Reports[write & (VHID_REPORT_QUEUE_SIZE - 1)].Report;
+    report->ButtonFlags = MouseData->ButtonFlags;
+    report->DeltaX = MouseData->DeltaX;
+    report->DeltaY = MouseData->DeltaY;
+
+    // Отчет виден читателю раньше нового WriteIndex
+    KeMemoryBarrier();
+    DeviceContext->WriteIndex = write + 1;
+    return TRUE;
+}
+
+//
+// Отдать VHF следующий отчет, если VHF его ждет. IRQL <= DISPATCH_LEVEL.
+// Вызывается писателем после постановки отчета и из
+// EvtVhfReadyForNextReadReport. Очередь читает только тот, кто сбросил
+// ReadyForNextReport, поэтому два вызова не отдадут один отчет дважды.
+//
+static VOID
+VhidMouseSubmitNext(
+    _In_ PVHID_MOUSE_CONTEXT DeviceContext
+)
+{
+    for (;;) {
+        if (InterlockedExchange(&DeviceContext->ReadyForNextReport, 0) == 0) {
+            // VHF еще не просил следующий отчет: его отдаст callback
+            return;
+        }
+
+        ULONG read = DeviceContext->ReadIndex;
+        if (read == DeviceContext->WriteIndex) {
+            // Очередь пуста: вернуть готовность. Писатель мог поставить
+            // отчет между проверкой и возвратом и не застать готовность -
+            // поэтому проверка повторяется после возврата
+            InterlockedExchange(&DeviceContext->ReadyForNextReport, 1);
+            if (read == DeviceContext->WriteIndex) {
+                return;
+            }
+            continue;
+        }
+
+        // Отчет читается после WriteIndex
+        KeMemoryBarrier();
+        PVHID_REPORT_SLOT slot = &DeviceContext->Reports[read & (VHID_REPORT_QUEUE_SIZE - 1)];
+        DeviceContext->ReadIndex = read + 1;
+
+        // Здесь нет KdPrint: отчеты идут с частотой устройства
+        if (NT_SUCCESS(VhfReadReportSubmit(DeviceContext->VhfHandle, &slot->Packet))) {
+            InterlockedIncrement(&DeviceContext->Submitted);
+        }
+        else {
+            // Отчет потерян; VHF по-прежнему ждет - следующий отдаст писатель
+            InterlockedIncrement(&DeviceContext->Failed);
+            InterlockedExchange(&DeviceContext->ReadyForNextReport, 1);
+        }
+        return;
+    }
+}
+
+//
+// VhidMouseEvtVhfReadyForNextReadReport - VHF готов принять следующий отчет.
+// С этим callback'ом VHF не буферизует отчеты сам: VhfReadReportSubmit
+// вызывается один раз на каждый вызов callback'а, остальные ждут в очереди.
 //
 VOID
 VhidMouseEvtVhfReadyForNextReadReport(
@@ -196,8 +332,16 @@ VhidMouseEvtVhfReadyForNextReadReport(
     _In_opt_ PVOID Context
 )
 {
+    PVHID_MOUSE_CONTEXT deviceContext = (PVHID_MOUSE_CONTEXT)Context;
+
     UNREFERENCED_PARAMETER(VhfHandle);
-    UNREFERENCED_PARAMETER(Context);
+
+    if (deviceContext == NULL) {
+        return;
+    }
+
+    InterlockedExchange(&deviceContext->ReadyForNextReport, 1);
+    VhidMouseSubmitNext(deviceContext);
 }
 
 //
@@ -256,8 +400,13 @@ VhidMouseEvtIoDeviceControl(
     deviceContext = GetVhidMouseContext(WdfIoQueueGetDevice(Queue));
 
     switch (IoControlCode) {
-    case IOCTL_VHID_SEND_MOUSE_DATA: {
-        KdPrint(("VhidMouse: IOCTL_VHID_SEND_MOUSE_DATA\n"));
+    case IOCTL_VHID_SEND_MOUSE_DATA:
+    case IOCTL_VHID_SEND_MOUSE_BATCH: {
+        // Здесь нет KdPrint: отчеты идут с частотой устройства
+        if (!deviceContext->MouseActive || deviceContext->VhfHandle == NULL) {
+            status = STATUS_DEVICE_NOT_READY;
+            break;
+        }
 
         // Проверить размер входного буфера
         if (InputBufferLength < sizeof(VHID_MOUSE_DATA)) {
@@ -276,34 +425,36 @@ VhidMouseEvtIoDeviceControl(
             break;
         }
 
-        // Создать HID Input Report
-        VHID_MOUSE_INPUT_REPORT inputReport;
-        inputReport.ButtonFlags = mouseData->ButtonFlags;
-        inputReport.DeltaX = mouseData->DeltaX;
-        inputReport.DeltaY = mouseData->DeltaY;
-
-        // Отправить отчет через VHF
-        if (deviceContext->MouseActive && deviceContext->VhfHandle != NULL) {
-            HID_XFER_PACKET packet;
-            packet.reportId = 0;
-            packet.reportBuffer = (PUCHAR)&inputReport;
-            packet.reportBufferLen = sizeof(VHID_MOUSE_INPUT_REPORT);
-
-            status = VhfReadReportSubmit(deviceContext->VhfHandle, &packet);
-
-            if (NT_SUCCESS(status)) {
-                KdPrint(("VhidMouse: Sent mouse data X=%d Y=%d Buttons=0x%x\n",
-                    inputReport.DeltaX,
-                    inputReport.DeltaY,
-                    inputReport.ButtonFlags));
-            }
-            else {
-                KdPrint(("VhidMouse: VhfReadReportSubmit failed 0x%x\n", status));
+        // Один отчет или пачка: отчеты встают в очередь, VHF получает их
+        // по мере готовности (EvtVhfReadyForNextReadReport)
+        size_t count = IoControlCode == IOCTL_VHID_SEND_MOUSE_BATCH ?
+            length / sizeof(VHID_MOUSE_DATA) : 1;
+        for (size_t i = 0; i < count; i++) {
+            if (!VhidMouseQueueReport(deviceContext, &mouseData[i])) {
+                // Остальные тоже не войдут; учтены в Dropped
+                InterlockedAdd(&deviceContext->Dropped, (LONG)(count - i - 1));
+                break;
             }
         }
-        else {
-            status = STATUS_DEVICE_NOT_READY;
-            KdPrint(("VhidMouse: Device not active\n"));
+
+        VhidMouseSubmitNext(deviceContext);
+        break;
+    }
+
+    case IOCTL_VHID_GET_STATS: {
+        PVHID_MOUSE_STATS stats = NULL;
+
+        status = WdfRequestRetrieveOutputBuffer(Request,
+            sizeof(VHID_MOUSE_STATS),
+            (PVOID*)&stats,
+            &length);
+
+        if (NT_SUCCESS(status) && stats != NULL) {
+            stats->Submitted = (ULONG)deviceContext->Submitted;
+            stats->Dropped = (ULONG)deviceContext->Dropped;
+            stats->Failed = (ULONG)deviceContext->Failed;
+            stats->Queued = (ULONG)(deviceContext->WriteIndex - deviceContext->ReadIndex);
+            WdfRequestSetInformation(Request, sizeof(VHID_MOUSE_STATS));
         }
 
         break;
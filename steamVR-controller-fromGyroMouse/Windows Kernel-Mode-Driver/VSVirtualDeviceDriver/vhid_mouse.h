@@ -8,9 +8,18 @@
 
 #define VHID_MOUSE_POOL_TAG 'VHID'
 
-// IOCTL для отправки данных мыши из user-mode
+// IOCTL для отправки данных мыши из user-mode (\\.\GyroVhidMouse)
 #define IOCTL_VHID_SEND_MOUSE_DATA \
     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x800, METHOD_BUFFERED, FILE_ANY_ACCESS)
+// Пачка отчетов за один вызов: вход - массив VHID_MOUSE_DATA
+#define IOCTL_VHID_SEND_MOUSE_BATCH \
+    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x801, METHOD_BUFFERED, FILE_ANY_ACCESS)
+// Выход - VHID_MOUSE_STATS
+#define IOCTL_VHID_GET_STATS \
+    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x802, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+// Очередь отчетов к VHF; степень двойки, ~60 мс при 1000 Гц
+#define VHID_REPORT_QUEUE_SIZE 64
 
 // Структура для передачи данных мыши
 typedef struct _VHID_MOUSE_DATA {
@@ -19,27 +28,56 @@ typedef struct _VHID_MOUSE_DATA {
     UCHAR ButtonFlags;
 } VHID_MOUSE_DATA, * PVHID_MOUSE_DATA;
 
+// Счетчики с загрузки драйвера
+typedef struct _VHID_MOUSE_STATS {
+    ULONG Submitted;    // отчетов отдано VHF
+    ULONG Dropped;      // не вошло: очередь была полной
+    ULONG Failed;       // VhfReadReportSubmit вернул ошибку
+    ULONG Queued;       // ждут VHF сейчас
+} VHID_MOUSE_STATS, * PVHID_MOUSE_STATS;
+
+// Структура HID Input Report
+typedef struct _VHID_MOUSE_INPUT_REPORT {
+    UCHAR ButtonFlags;
+    CHAR DeltaX;
+    CHAR DeltaY;
+} VHID_MOUSE_INPUT_REPORT, * PVHID_MOUSE_INPUT_REPORT;
+
+// Слот очереди: пакет заранее указывает на свой отчет
+typedef struct _VHID_REPORT_SLOT {
+    HID_XFER_PACKET Packet;
+    VHID_MOUSE_INPUT_REPORT Report;
+} VHID_REPORT_SLOT, * PVHID_REPORT_SLOT;
+
 // Контекст устройства
 typedef struct _VHID_MOUSE_CONTEXT {
     WDFDEVICE Device;
     WDFQUEUE DefaultQueue;
     VHFHANDLE VhfHandle;
     BOOLEAN MouseActive;
+
+    // Очередь отчетов без блокировок. Пишет только обработчик IOCTL
+    // (очередь WdfIoQueueDispatchSequential), читает только тот, кто
+    // сбросил ReadyForNextReport (VhidMouseSubmitNext). Индексы растут
+    // без обнуления, слот - индекс & (VHID_REPORT_QUEUE_SIZE - 1).
+    VHID_REPORT_SLOT Reports[VHID_REPORT_QUEUE_SIZE];
+    volatile ULONG WriteIndex;
+    volatile ULONG ReadIndex;
+    // 1 - VHF ждет отчет (EvtVhfReadyForNextReadReport), пока его не отдали
+    volatile LONG ReadyForNextReport;
+
+    volatile LONG Submitted;
+    volatile LONG Dropped;
+    volatile LONG Failed;
 } VHID_MOUSE_CONTEXT, * PVHID_MOUSE_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(VHID_MOUSE_CONTEXT, GetVhidMouseContext)
 
-// Структура HID Input Report
-typedef struct _VHID_MOUSE_INPUT_REPORT {
-    UCHAR ButtonFlags;
-    CHAR DeltaX;
-    CHAR DeltaY;
-} VHID_MOUSE_INPUT_REPORT, * PVHID_MOUSE_INPUT_REPORT;
-
 // Function declarations
 DRIVER_INITIALIZE DriverEntry;
 EVT_WDF_DRIVER_DEVICE_ADD VhidMouseEvtDeviceAdd;
 EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL VhidMouseEvtIoDeviceControl;
+EVT_WDF_OBJECT_CONTEXT_CLEANUP VhidMouseEvtDeviceCleanup;
 
 NTSTATUS
 VhidMouseCreateDevice(
@@ -12,6 +12,11 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
+
+// Кольцо общей памяти драйвера (steamVR-controller-driver-C/src)
+#include "shared_ring.h"
 
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "user32.lib")
@@ -22,6 +27,17 @@
 #define HUB_HOST "127.0.0.1"
 #define CONFIG_FILE "mouse_config.txt"
 
+// 1 - отправлять компактный протокол v2 драйвера (packet_format.h в
+// steamVR-controller-driver-C), который драйвер принимает напрямую.
+// 0 - прежний 65-байтный пакет для Hub.
+#ifndef HUB_PROTOCOL_V2
+#define HUB_PROTOCOL_V2 0
+#endif
+
+// shared_memory_name драйвера gyromouse по умолчанию. С HUB_PROTOCOL_V2
+// пакеты идут в кольцо драйвера, пока он его читает, иначе - по UDP.
+#define SHARED_RING_NAME "Local\\gyromouse_input"
+
 SOCKET g_socket;
 sockaddr_in g_hubAddr;
 HWND g_hwnd;
@@ -58,6 +74,15 @@ struct VirtualMousePosition {
 
 VirtualMousePosition g_mousePos;
 
+// Размеры экрана: читаются при старте и по WM_DISPLAYCHANGE, а не на
+// каждое событие мыши
+struct ScreenMetrics {
+    int width = 0;
+    int height = 0;
+};
+
+ScreenMetrics g_screen;
+
 // Состояние кнопок
 struct ButtonState {
     bool button1 = false;
@@ -95,7 +120,19 @@ void EulerToQuaternion(float yaw, float pitch, float roll, float* quat) {
 
 // =================== ПОСТРОЕНИЕ ПАКЕТА ДЛЯ HUB ===================
 
-std::vector<BYTE> BuildHubPacket() {
+// Пакеты собираются на месте в буферы на стеке: при 1000 событий в секунду
+// выделение памяти на каждое заметно нагружает поток окна
+const size_t kHubPacketSize = 65;
+// Датаграмма v2 с одной записью: заголовок 8 + запись до 18 + CRC 4
+const size_t kMaxV2PacketSize = 32;
+
+template <typename T>
+void WriteValue(BYTE* packet, size_t& offset, const T& value) {
+    memcpy(packet + offset, &value, sizeof(value));
+    offset += sizeof(value);
+}
+
+void BuildHubPacket(BYTE* packet) {
     /*
      * Расширенный протокол для Hub (65 байт):
      * 
@@ -113,30 +150,25 @@ std::vector<BYTE> BuildHubPacket() {
      * 64      1     uint8    checksum
      */
     
-    std::vector<BYTE> packet(65);
+    memset(packet, 0, kHubPacketSize);
     size_t offset = 0;
     
     // 1. Controller ID
     packet[offset++] = (BYTE)g_controllerId;
     
     // 2. Packet number
-    *reinterpret_cast<uint32_t*>(&packet[offset]) = g_packetNumber++;
-    offset += 4;
+    WriteValue(packet, offset, g_packetNumber++);
     
     // 3. Quaternion (from Euler angles)
     float quat[4];
     EulerToQuaternion(g_orientation.yaw, g_orientation.pitch, g_orientation.roll, quat);
     
     for (int i = 0; i < 4; i++) {
-        *reinterpret_cast<float*>(&packet[offset]) = quat[i];
-        offset += 4;
+        WriteValue(packet, offset, quat[i]);
     }
     
     // 4. Position (пока заполнено нулями, Hub вычислит позицию из ArUco)
-    for (int i = 0; i < 3; i++) {
-        *reinterpret_cast<float*>(&packet[offset]) = 0.0f;
-        offset += 4;
-    }
+    offset += 12;
     
     // 5. Gyro (angular velocity) - вычисляем из изменения ориентации
     ULONGLONG now = GetTickCount64();
@@ -147,12 +179,9 @@ std::vector<BYTE> BuildHubPacket() {
         float gyro_y = (g_orientation.yaw - g_orientation.lastYaw) / dt;
         float gyro_z = (g_orientation.roll - g_orientation.lastRoll) / dt;
         
-        *reinterpret_cast<float*>(&packet[offset]) = gyro_x;
-        offset += 4;
-        *reinterpret_cast<float*>(&packet[offset]) = gyro_y;
-        offset += 4;
-        *reinterpret_cast<float*>(&packet[offset]) = gyro_z;
-        offset += 4;
+        WriteValue(packet, offset, gyro_x);
+        WriteValue(packet, offset, gyro_y);
+        WriteValue(packet, offset, gyro_z);
     } else {
         offset += 12;  // Пропустить gyro
     }
@@ -168,23 +197,18 @@ std::vector<BYTE> BuildHubPacket() {
     if (g_buttons.button2) buttons |= 0x0002;
     if (g_buttons.button3) buttons |= 0x0004;
     
-    *reinterpret_cast<uint16_t*>(&packet[offset]) = buttons;
-    offset += 2;
+    WriteValue(packet, offset, buttons);
     
     // 7. Trigger (0-255)
     packet[offset++] = g_buttons.trigger;
     
     // 8. Mouse screen position (абсолютная позиция на экране)
-    *reinterpret_cast<float*>(&packet[offset]) = g_mousePos.screenX;
-    offset += 4;
-    *reinterpret_cast<float*>(&packet[offset]) = g_mousePos.screenY;
-    offset += 4;
+    WriteValue(packet, offset, g_mousePos.screenX);
+    WriteValue(packet, offset, g_mousePos.screenY);
     
     // 9. Mouse virtual position (нормализованная -1 до 1)
-    *reinterpret_cast<float*>(&packet[offset]) = g_mousePos.x;
-    offset += 4;
-    *reinterpret_cast<float*>(&packet[offset]) = g_mousePos.y;
-    offset += 4;
+    WriteValue(packet, offset, g_mousePos.x);
+    WriteValue(packet, offset, g_mousePos.y);
     
     // 10. Checksum
     uint8_t checksum = 0;
@@ -192,8 +216,129 @@ std::vector<BYTE> BuildHubPacket() {
         checksum += packet[i];
     }
     packet[64] = checksum;
-    
-    return packet;
+}
+
+// =================== ПРОТОКОЛ V2 ===================
+
+// Перекодирует 65-байтный пакет в датаграмму v2 с одной записью в packet
+// (kMaxV2PacketSize байт). Возвращает размер датаграммы.
+// Формат и шкалы - как в steamVR-controller-driver-C/src/packet_format.h.
+size_t EncodeProtocolV2(const BYTE* hubPacket, BYTE* packet) {
+    const uint8_t kMagic = 0xC5, kVersion = 2;
+    const uint8_t kFlagGyroMouse = 0x01;   // id относительно gyromouse_device_id драйвера
+    const uint8_t kRecordAngularVelocity = 0x02, kRecordInput = 0x04;
+    const float kAngularScale = 1024.0f;
+    const float kQuatMax = 0.70710678f;
+
+    uint32_t packetNumber;
+    float quat[4], gyro[3];
+    uint16_t buttons;
+    memcpy(&packetNumber, &hubPacket[1], 4);
+    memcpy(quat, &hubPacket[5], 16);
+    memcpy(gyro, &hubPacket[33], 12);
+    memcpy(&buttons, &hubPacket[45], 2);
+    uint8_t trigger = hubPacket[47];
+
+    uint8_t recordFlags = 0;
+    if (gyro[0] != 0.0f || gyro[1] != 0.0f || gyro[2] != 0.0f) recordFlags |= kRecordAngularVelocity;
+    if (buttons != 0 || trigger != 0) recordFlags |= kRecordInput;
+
+    size_t size = 0;
+    packet[size++] = kMagic;
+    packet[size++] = kVersion;
+    packet[size++] = kFlagGyroMouse;
+    packet[size++] = 1;
+    for (int i = 0; i < 4; i++) packet[size++] = (BYTE)(packetNumber >> (8 * i));
+    packet[size++] = hubPacket[0];
+    packet[size++] = recordFlags;
+    packet[size++] = 0;   // packet_number = базовый + 0
+
+    // Кватернион smallest-three: 2 бита индекса + 3 x 15 бит
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(quat[i]) > fabsf(quat[largest])) largest = i;
+    }
+    float sign = quat[largest] < 0.0f ? -1.0f : 1.0f;
+    uint64_t packed = (uint64_t)largest;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        float v = (std::max)(-kQuatMax, (std::min)(kQuatMax, sign * quat[i])) / kQuatMax;
+        packed = (packed << 15) | (uint64_t)(lroundf(v * 16383.0f) + 16383);
+    }
+    for (int i = 0; i < 6; i++) packet[size++] = (BYTE)(packed >> (8 * i));
+
+    if (recordFlags & kRecordAngularVelocity) {
+        for (int i = 0; i < 3; i++) {
+            float scaled = (std::max)(-32767.0f, (std::min)(32767.0f, roundf(gyro[i] * kAngularScale)));
+            int16_t value = (int16_t)scaled;
+            packet[size++] = (BYTE)(value & 0xFF);
+            packet[size++] = (BYTE)((value >> 8) & 0xFF);
+        }
+    }
+    if (recordFlags & kRecordInput) {
+        packet[size++] = (BYTE)(buttons & 0xFF);
+        packet[size++] = (BYTE)(buttons >> 8);
+        packet[size++] = trigger;
+    }
+
+    // CRC-32C всех предыдущих байт (как crc32c.h драйвера, табличный вариант)
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) c = (c >> 1) ^ ((c & 1) ? 0x82F63B78u : 0u);
+            table[i] = c;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) crc = (crc >> 8) ^ table[(crc ^ packet[i]) & 0xFF];
+    crc ^= 0xFFFFFFFF;
+    for (int i = 0; i < 4; i++) packet[size++] = (BYTE)(crc >> (8 * i));
+    return size;
+}
+
+// =================== ОБЩАЯ ПАМЯТЬ ===================
+
+SharedRingWriter g_sharedRing;
+ULONGLONG g_sharedRingRetryTime = 0;
+
+// Кладет 65-байтный пакет записью ControllerData в кольцо драйвера.
+// false - драйвер кольцо не создал или не читает: отправить по UDP.
+bool WriteSharedRing(const BYTE* hubPacket) {
+    if (!g_sharedRing.IsOpen()) {
+        // Драйвер мог еще не стартовать - пробуем раз в секунду
+        ULONGLONG now = GetTickCount64();
+        if (now < g_sharedRingRetryTime) {
+            return false;
+        }
+        g_sharedRingRetryTime = now + 1000;
+        if (!g_sharedRing.Open(SHARED_RING_NAME)) {
+            return false;
+        }
+        std::cout << "Shared memory ring " << SHARED_RING_NAME << " opened" << std::endl;
+    }
+
+    uint32_t packetNumber;
+    float quat[4], gyro[3];
+    uint16_t buttons;
+    memcpy(&packetNumber, &hubPacket[1], 4);
+    memcpy(quat, &hubPacket[5], 16);
+    memcpy(gyro, &hubPacket[33], 12);
+    memcpy(&buttons, &hubPacket[45], 2);
+
+    ControllerData data = {};
+    data.controller_id = hubPacket[0];
+    data.packet_number = packetNumber;
+    data.quat_w = quat[0];
+    data.quat_x = quat[1];
+    data.quat_y = quat[2];
+    data.quat_z = quat[3];
+    data.gyro_x = gyro[0];
+    data.gyro_y = gyro[1];
+    data.gyro_z = gyro[2];
+    data.buttons = buttons;
+    data.trigger = hubPacket[47];
+    return g_sharedRing.Write(data, kSharedRingGyroMouse);
 }
 
 // =================== ПОЛУЧЕНИЕ VID/PID ===================
@@ -308,23 +453,31 @@ bool InitUDP() {
 
 // =================== БЛОКИРОВКА/РАЗБЛОКИРОВКА КУРСОРА ===================
 
+void RefreshScreenMetrics() {
+    g_screen.width = GetSystemMetrics(SM_CXSCREEN);
+    g_screen.height = GetSystemMetrics(SM_CYSCREEN);
+}
+
+// Прижать курсор к центру экрана (размеры - из g_screen)
+void ClipCursorToCenter() {
+    int screenWidth = g_screen.width;
+    int screenHeight = g_screen.height;
+    
+    RECT rect;
+    rect.left = screenWidth / 2;
+    rect.top = screenHeight / 2;
+    rect.right = rect.left + 1;
+    rect.bottom = rect.top + 1;
+    
+    ClipCursor(&rect);
+    SetCursorPos(screenWidth / 2, screenHeight / 2);
+}
+
 void BlockCursor(bool block) {
     if (block) {
         // Скрыть курсор и заблокировать в центре экрана
         ShowCursor(FALSE);
-        
-        // Получить центр экрана
-        int screenWidth = GetSystemMetrics(SM_CXSCREEN);
-        int screenHeight = GetSystemMetrics(SM_CYSCREEN);
-        
-        RECT rect;
-        rect.left = screenWidth / 2;
-        rect.top = screenHeight / 2;
-        rect.right = rect.left + 1;
-        rect.bottom = rect.top + 1;
-        
-        ClipCursor(&rect);
-        SetCursorPos(screenWidth / 2, screenHeight / 2);
+        ClipCursorToCenter();
         
         std::cout << "Cursor blocked (hidden and centered)" << std::endl;
     } else {
@@ -343,15 +496,15 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         case WM_INPUT: {
             if (!g_capturing) break;
             
-            UINT size = 0;
-            GetRawInputData((HRAWINPUT)lParam, RID_INPUT, nullptr, &size, sizeof(RAWINPUTHEADER));
-            
-            std::vector<BYTE> buffer(size);
-            if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, buffer.data(), &size, sizeof(RAWINPUTHEADER)) != size) {
+            // Событие мыши всегда помещается в RAWINPUT: читаем сразу в
+            // буфер на стеке, без запроса размера и выделения памяти
+            RAWINPUT rawBuffer;
+            UINT size = sizeof(rawBuffer);
+            if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &rawBuffer, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1) {
                 break;
             }
             
-            RAWINPUT* raw = (RAWINPUT*)buffer.data();
+            RAWINPUT* raw = &rawBuffer;
             
             // Проверяем, что это событие от нужной мыши
             if (raw->header.dwType == RIM_TYPEMOUSE && raw->header.hDevice == g_targetMouseHandle) {
@@ -382,11 +535,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 if (g_orientation.pitch > maxPitch) g_orientation.pitch = maxPitch;
                 if (g_orientation.pitch < -maxPitch) g_orientation.pitch = -maxPitch;
                 
-                // Обновить виртуальную позицию мыши на экране
-                POINT cursorPos;
-                if (GetCursorPos(&cursorPos)) {
-                    int screenWidth = GetSystemMetrics(SM_CXSCREEN);
-                    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+                // Обновить виртуальную позицию мыши на экране. Заблокированный
+                // курсор стоит в центре - спрашивать систему незачем.
+                POINT cursorPos = { g_screen.width / 2, g_screen.height / 2 };
+                if (g_blockCursor || GetCursorPos(&cursorPos)) {
+                    int screenWidth = g_screen.width;
+                    int screenHeight = g_screen.height;
                     
                     g_mousePos.screenX = (float)cursorPos.x;
                     g_mousePos.screenY = (float)cursorPos.y;
@@ -397,9 +551,19 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 }
                 
                 // Построить и отправить пакет в Hub
-                std::vector<BYTE> packet = BuildHubPacket();
-                sendto(g_socket, (const char*)packet.data(), (int)packet.size(), 0,
-                    (sockaddr*)&g_hubAddr, sizeof(g_hubAddr));
+                BYTE hubPacket[kHubPacketSize];
+                BuildHubPacket(hubPacket);
+#if HUB_PROTOCOL_V2
+                BYTE packet[kMaxV2PacketSize];
+                size_t packetSize = WriteSharedRing(hubPacket) ? 0 : EncodeProtocolV2(hubPacket, packet);
+#else
+                const BYTE* packet = hubPacket;
+                size_t packetSize = kHubPacketSize;
+#endif
+                if (packetSize > 0) {
+                    sendto(g_socket, (const char*)packet, (int)packetSize, 0,
+                        (sockaddr*)&g_hubAddr, sizeof(g_hubAddr));
+                }
                 
                 // Лог каждые 100 пакетов
                 static int logCounter = 0;
@@ -435,6 +599,16 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             break;
         }
         
+        case WM_DISPLAYCHANGE: {
+            // Сменилось разрешение: обновить размеры и центр блокировки
+            RefreshScreenMetrics();
+            if (g_blockCursor) {
+                ClipCursorToCenter();
+            }
+            std::cout << "Display changed: " << g_screen.width << "x" << g_screen.height << std::endl;
+            break;
+        }
+        
         case WM_DESTROY:
             PostQuitMessage(0);
             break;
@@ -601,8 +775,10 @@ int main() {
         return 1;
     }
     
+    // Скрытое окно верхнего уровня, а не HWND_MESSAGE: окнам только для
+    // сообщений не приходит широковещательный WM_DISPLAYCHANGE
     g_hwnd = CreateWindowEx(0, L"GyroMouseClass", L"VR Gyro Mouse", 0, 
-                           0, 0, 0, 0, HWND_MESSAGE, nullptr, wc.hInstance, nullptr);
+                           0, 0, 0, 0, nullptr, nullptr, wc.hInstance, nullptr);
     
     if (!g_hwnd) {
         std::cerr << "Failed to create window!" << std::endl;
@@ -622,6 +798,7 @@ int main() {
     }
     
     // Применить блокировку курсора
+    RefreshScreenMetrics();
     BlockCursor(g_blockCursor);
     
     std::cout << "\n========================================" << std::endl;
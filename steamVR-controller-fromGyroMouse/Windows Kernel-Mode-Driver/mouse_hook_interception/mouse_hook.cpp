@@ -3,6 +3,7 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#include <mmsystem.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -11,17 +12,26 @@
 #include <iomanip>
 #include <thread>
 #include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
 
 // Interception API
 extern "C" {
     #include "interception.h"
 }
 
+// Кольцо общей памяти драйвера (steamVR-controller-driver-C/src)
+#include "shared_ring.h"
+
 #pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "winmm.lib")
 
 #define UDP_PORT 5556
 #define HOST "127.0.0.1"
 #define CONFIG_FILE "mouse_config.txt"
+// shared_memory_name драйвера gyromouse по умолчанию
+#define SHARED_RING_NAME "Local\\gyromouse_input"
 
 // Глобальные переменные
 SOCKET g_socket;
@@ -154,20 +164,331 @@ void SaveConfig(InterceptionDevice device, const std::wstring& hardwareId) {
     }
 }
 
-// Отправить данные мыши по UDP
-void SendMouseDataUDP(int deltaX, int deltaY, unsigned short buttons) {
-    char buffer[64];
-    int len = sprintf_s(buffer, sizeof(buffer),
-        "MOUSE:%d,%d,%u,%llu",
-        deltaX,
-        deltaY,
-        buttons,
-        GetTickCount64());
-    
-    sendto(g_socket, buffer, len, 0,
+// Конвертация углов Эйлера в кватернион (w, x, y, z), как в mouse_hook_block
+void EulerToQuaternion(float yaw, float pitch, float roll, float* quat) {
+    float cy = cosf(yaw * 0.5f);
+    float sy = sinf(yaw * 0.5f);
+    float cp = cosf(pitch * 0.5f);
+    float sp = sinf(pitch * 0.5f);
+    float cr = cosf(roll * 0.5f);
+    float sr = sinf(roll * 0.5f);
+    
+    quat[0] = cr * cp * cy + sr * sp * sy;  // w
+    quat[1] = sr * cp * cy - cr * sp * sy;  // x
+    quat[2] = cr * sp * cy + sr * cp * sy;  // y
+    quat[3] = cr * cp * sy - sr * sp * cy;  // z
+}
+
+// =================== ОЧЕРЕДЬ СОБЫТИЙ ===================
+
+// Поток Interception только складывает события гиромыши в кольцо и сразу
+// возвращается к пересылке событий остальных устройств: форматирование и
+// sendto на нем добавляли задержку вводу всей системы. Отправкой занимается
+// отдельный поток (SenderLoop). Один писатель, один читатель, без блокировок.
+struct MouseEvent {
+    int dx;
+    int dy;
+    uint16_t buttons;     // состояние кнопок после события (kButton*)
+    LONGLONG timestamp;   // QueryPerformanceCounter
+};
+
+const uint32_t kEventQueueSize = 4096;   // степень двойки; ~4 с при 1000 Гц
+
+MouseEvent g_events[kEventQueueSize];
+std::atomic<uint32_t> g_eventWrite(0);   // пишет только поток Interception
+std::atomic<uint32_t> g_eventRead(0);    // пишет только поток отправки
+std::atomic<uint32_t> g_eventsDropped(0);
+std::atomic<uint32_t> g_eventsPassed(0);
+
+// Поток отправки ждет на событии, когда очередь пуста; будит его первое
+// событие после простоя, а не каждое
+HANDLE g_senderWake = nullptr;
+std::atomic<bool> g_senderIdle(false);
+
+// Вызывается только из потока Interception
+void PushMouseEvent(int dx, int dy, uint16_t buttons) {
+    uint32_t write = g_eventWrite.load(std::memory_order_relaxed);
+    if (write - g_eventRead.load(std::memory_order_acquire) >= kEventQueueSize) {
+        g_eventsDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    MouseEvent& event = g_events[write & (kEventQueueSize - 1)];
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    event.dx = dx;
+    event.dy = dy;
+    event.buttons = buttons;
+    event.timestamp = now.QuadPart;
+    g_eventWrite.store(write + 1, std::memory_order_seq_cst);
+
+    if (g_senderIdle.exchange(false)) {
+        SetEvent(g_senderWake);
+    }
+}
+
+// =================== ПРОТОКОЛ V2 ===================
+
+// Кнопки в записи v2 (buttons драйвера): полная битовая маска, аккорды
+// не теряются
+const uint16_t kButtonLeft = 0x0001;
+const uint16_t kButtonRight = 0x0002;
+const uint16_t kButtonMiddle = 0x0004;
+const uint16_t kButton4 = 0x0008;
+const uint16_t kButton5 = 0x0010;
+
+// Обновить маску кнопок по флагам INTERCEPTION_MOUSE_*_DOWN/UP события
+uint16_t ApplyButtonState(uint16_t buttons, unsigned short state) {
+    struct Edge { unsigned short down, up; uint16_t bit; };
+    static const Edge edges[] = {
+        { INTERCEPTION_MOUSE_LEFT_BUTTON_DOWN, INTERCEPTION_MOUSE_LEFT_BUTTON_UP, kButtonLeft },
+        { INTERCEPTION_MOUSE_RIGHT_BUTTON_DOWN, INTERCEPTION_MOUSE_RIGHT_BUTTON_UP, kButtonRight },
+        { INTERCEPTION_MOUSE_MIDDLE_BUTTON_DOWN, INTERCEPTION_MOUSE_MIDDLE_BUTTON_UP, kButtonMiddle },
+        { INTERCEPTION_MOUSE_BUTTON_4_DOWN, INTERCEPTION_MOUSE_BUTTON_4_UP, kButton4 },
+        { INTERCEPTION_MOUSE_BUTTON_5_DOWN, INTERCEPTION_MOUSE_BUTTON_5_UP, kButton5 },
+    };
+    for (const Edge& edge : edges) {
+        if (state & edge.down) buttons |= edge.bit;
+        if (state & edge.up) buttons &= ~edge.bit;
+    }
+    return buttons;
+}
+
+// Датаграмма v2 с одной записью: заголовок 8 + запись до 18 + CRC 4
+const size_t kMaxV2PacketSize = 32;
+
+// Собирает датаграмму v2 в packet (kMaxV2PacketSize байт), возвращает размер.
+// Формат и шкалы - как в steamVR-controller-driver-C/src/packet_format.h.
+size_t EncodeProtocolV2(uint32_t packetNumber, const float quat[4], const float gyro[3],
+                        uint16_t buttons, uint8_t trigger, BYTE* packet) {
+    const uint8_t kMagic = 0xC5, kVersion = 2;
+    const uint8_t kFlagGyroMouse = 0x01;   // id относительно gyromouse_device_id драйвера
+    const uint8_t kRecordAngularVelocity = 0x02, kRecordInput = 0x04;
+    const float kAngularScale = 1024.0f;
+    const float kQuatMax = 0.70710678f;
+
+    uint8_t recordFlags = 0;
+    if (gyro[0] != 0.0f || gyro[1] != 0.0f || gyro[2] != 0.0f) recordFlags |= kRecordAngularVelocity;
+    if (buttons != 0 || trigger != 0) recordFlags |= kRecordInput;
+
+    size_t size = 0;
+    packet[size++] = kMagic;
+    packet[size++] = kVersion;
+    packet[size++] = kFlagGyroMouse;
+    packet[size++] = 1;
+    for (int i = 0; i < 4; i++) packet[size++] = (BYTE)(packetNumber >> (8 * i));
+    packet[size++] = 0;   // controller_id: первая гиромышь
+    packet[size++] = recordFlags;
+    packet[size++] = 0;   // packet_number = базовый + 0
+
+    // Кватернион smallest-three: 2 бита индекса + 3 x 15 бит
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(quat[i]) > fabsf(quat[largest])) largest = i;
+    }
+    float sign = quat[largest] < 0.0f ? -1.0f : 1.0f;
+    uint64_t packed = (uint64_t)largest;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        float v = (std::max)(-kQuatMax, (std::min)(kQuatMax, sign * quat[i])) / kQuatMax;
+        packed = (packed << 15) | (uint64_t)(lroundf(v * 16383.0f) + 16383);
+    }
+    for (int i = 0; i < 6; i++) packet[size++] = (BYTE)(packed >> (8 * i));
+
+    if (recordFlags & kRecordAngularVelocity) {
+        for (int i = 0; i < 3; i++) {
+            float scaled = (std::max)(-32767.0f, (std::min)(32767.0f, roundf(gyro[i] * kAngularScale)));
+            int16_t value = (int16_t)scaled;
+            packet[size++] = (BYTE)(value & 0xFF);
+            packet[size++] = (BYTE)((value >> 8) & 0xFF);
+        }
+    }
+    if (recordFlags & kRecordInput) {
+        packet[size++] = (BYTE)(buttons & 0xFF);
+        packet[size++] = (BYTE)(buttons >> 8);
+        packet[size++] = trigger;
+    }
+
+    // CRC-32C всех предыдущих байт (как crc32c.h драйвера, табличный вариант)
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) c = (c >> 1) ^ ((c & 1) ? 0x82F63B78u : 0u);
+            table[i] = c;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) crc = (crc >> 8) ^ table[(crc ^ packet[i]) & 0xFF];
+    crc ^= 0xFFFFFFFF;
+    for (int i = 0; i < 4; i++) packet[size++] = (BYTE)(crc >> (8 * i));
+    return size;
+}
+
+// =================== ОБЩАЯ ПАМЯТЬ ===================
+
+// Драйвер на этой же машине: записи идут в его кольцо без sendto и без
+// checksum. Пока драйвер кольцо не создал или не читает - UDP.
+SharedRingWriter g_sharedRing;
+ULONGLONG g_sharedRingRetryTime = 0;
+
+// Только поток отправки
+bool WriteSharedRing(const ControllerData& data, LONGLONG timestamp) {
+    if (!g_sharedRing.IsOpen()) {
+        // Драйвер мог еще не стартовать - пробуем раз в секунду
+        ULONGLONG now = GetTickCount64();
+        if (now < g_sharedRingRetryTime) {
+            return false;
+        }
+        g_sharedRingRetryTime = now + 1000;
+        if (!g_sharedRing.Open(SHARED_RING_NAME)) {
+            return false;
+        }
+        std::cout << "Shared memory ring " << SHARED_RING_NAME << " opened" << std::endl;
+    }
+    return g_sharedRing.Write(data, kSharedRingGyroMouse, timestamp);
+}
+
+// =================== ПОТОК ОТПРАВКИ ===================
+
+// Интервал, за который дельты складываются в один пакет
+const DWORD kSendSliceMs = 1;
+// Интегрирование движения в ориентацию - как в mouse_hook_block
+const float kSensitivity = 0.001f;   // рад на единицу дельты
+const float kMaxPitch = 3.14159f / 2.0f;
+
+struct SenderState {
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    uint16_t buttons = 0;           // отправленные последними
+    LONGLONG lastTimestamp = 0;     // событие, которым закончился прошлый пакет
+    uint32_t packetNumber = 0;
+    uint32_t packets = 0;           // за окно статистики
+    uint32_t ringPackets = 0;       // из них через общую память
+    uint32_t events = 0;
+};
+
+// Отправить накопленное движение и текущее состояние кнопок
+void SendSlice(SenderState& state, int dx, int dy, uint16_t buttons, LONGLONG timestamp, double frequency) {
+    float yawStep = dx * kSensitivity;
+    float pitchStart = state.pitch;
+    state.yaw += yawStep;
+    state.pitch = (std::max)(-kMaxPitch, (std::min)(kMaxPitch, state.pitch + dy * kSensitivity));
+
+    // Угловая скорость по времени событий, а не по времени отправки. После
+    // простоя (dt >= 100 мс) скорость неизвестна, меньше 0.2 мс - шум.
+    float gyro[3] = { 0.0f, 0.0f, 0.0f };
+    if (state.lastTimestamp != 0) {
+        float dt = (float)((timestamp - state.lastTimestamp) / frequency);
+        if (dt >= 0.0002f && dt < 0.1f) {
+            gyro[0] = (state.pitch - pitchStart) / dt;
+            gyro[1] = yawStep / dt;
+        }
+    }
+    state.lastTimestamp = timestamp;
+    state.buttons = buttons;
+
+    float quat[4];
+    EulerToQuaternion(state.yaw, state.pitch, 0.0f, quat);
+    uint8_t trigger = (buttons & kButtonLeft) ? 255 : 0;
+    // Один счетчик на оба транспорта: драйвер отслеживает порядок пакетов
+    uint32_t packetNumber = state.packetNumber++;
+    state.packets++;
+
+    ControllerData data = {};
+    data.controller_id = 0;   // первая гиромышь
+    data.packet_number = packetNumber;
+    data.quat_w = quat[0];
+    data.quat_x = quat[1];
+    data.quat_y = quat[2];
+    data.quat_z = quat[3];
+    data.gyro_x = gyro[0];
+    data.gyro_y = gyro[1];
+    data.gyro_z = gyro[2];
+    data.buttons = buttons;
+    data.trigger = trigger;
+    if (WriteSharedRing(data, timestamp)) {
+        state.ringPackets++;
+        return;
+    }
+
+    BYTE packet[kMaxV2PacketSize];
+    size_t size = EncodeProtocolV2(packetNumber, quat, gyro, buttons, trigger, packet);
+    sendto(g_socket, (const char*)packet, (int)size, 0,
         (sockaddr*)&g_serverAddr, sizeof(g_serverAddr));
 }
 
+// Разбирает очередь раз в kSendSliceMs: дельты внутри интервала
+// суммируются, на каждой смене кнопок пакет уходит сразу, поэтому
+// нажатие и отпускание в одном интервале не теряются
+void SenderLoop() {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    double ticksPerSecond = (double)frequency.QuadPart;
+
+    SenderState state;
+    ULONGLONG lastPrintTime = GetTickCount64();
+
+    // Первое событие после простоя уходит сразу, дальше - раз в интервал,
+    // пока за интервал приходит хоть одно
+    bool active = false;
+    
+    while (g_running) {
+        uint32_t read = g_eventRead.load(std::memory_order_relaxed);
+        if (active) {
+            // Дать интервалу набраться событий
+            Sleep(kSendSliceMs);
+        } else if (read == g_eventWrite.load(std::memory_order_seq_cst)) {
+            // Очередь пуста: спать до первого события (или проверки g_running)
+            g_senderIdle.store(true, std::memory_order_seq_cst);
+            if (read == g_eventWrite.load(std::memory_order_seq_cst)) {
+                WaitForSingleObject(g_senderWake, 100);
+            }
+            g_senderIdle.store(false);
+        }
+
+        uint32_t write = g_eventWrite.load(std::memory_order_acquire);
+        active = read != write;
+        int dx = 0, dy = 0;
+        bool pending = false;
+        LONGLONG timestamp = 0;
+        for (; read != write; read++) {
+            const MouseEvent& event = g_events[read & (kEventQueueSize - 1)];
+            dx += event.dx;
+            dy += event.dy;
+            timestamp = event.timestamp;
+            pending = true;
+            state.events++;
+            if (event.buttons != state.buttons) {
+                SendSlice(state, dx, dy, event.buttons, timestamp, ticksPerSecond);
+                dx = dy = 0;
+                pending = false;
+            }
+        }
+        g_eventRead.store(read, std::memory_order_release);
+
+        if (pending && (dx != 0 || dy != 0)) {
+            SendSlice(state, dx, dy, state.buttons, timestamp, ticksPerSecond);
+        }
+
+        // Статистика раз в секунду
+        if (GetTickCount64() - lastPrintTime > 1000) {
+            std::cout << "Stats: Blocked=" << state.events
+                     << " Packets=" << state.packets
+                     << " (shared memory " << state.ringPackets << ")"
+                     << " Passed=" << g_eventsPassed.exchange(0, std::memory_order_relaxed)
+                     << " Dropped=" << g_eventsDropped.exchange(0, std::memory_order_relaxed)
+                     << " (Yaw: " << std::fixed << std::setprecision(2) << state.yaw
+                     << " Pitch: " << state.pitch << ")"
+                     << std::endl;
+            lastPrintTime = GetTickCount64();
+            state.events = 0;
+            state.packets = 0;
+            state.ringPackets = 0;
+        }
+    }
+}
+
 // Основной цикл обработки событий
 void ProcessEvents(InterceptionContext context) {
     InterceptionDevice device;
@@ -178,9 +499,8 @@ void ProcessEvents(InterceptionContext context) {
     std::cout << "Blocking enabled for gyro mouse" << std::endl;
     std::cout << "Other mice will work normally\n" << std::endl;
     
-    ULONGLONG lastPrintTime = GetTickCount64();
-    int blockedEvents = 0;
-    int passedEvents = 0;
+    // Состояние кнопок гиромыши: в событии приходят только фронты
+    uint16_t buttons = 0;
     
     while (g_running && interception_receive(context, device = interception_wait(context), &stroke, 1) > 0) {
         
@@ -193,27 +513,11 @@ void ProcessEvents(InterceptionContext context) {
         InterceptionMouseStroke& mstroke = *(InterceptionMouseStroke*)&stroke;
         
         if (device == g_targetDevice) {
-            // Это наша целевая гиро-мышь - БЛОКИРУЕМ и отправляем по UDP
-            
-            // Отправить данные по UDP
-            unsigned short buttons = 0;
-            if (mstroke.state & INTERCEPTION_MOUSE_LEFT_BUTTON_DOWN) buttons = 1;
-            if (mstroke.state & INTERCEPTION_MOUSE_RIGHT_BUTTON_DOWN) buttons = 2;
-            
-            if (mstroke.x != 0 || mstroke.y != 0) {
-                SendMouseDataUDP(mstroke.x, mstroke.y, buttons);
-                blockedEvents++;
-                
-                // Вывод в консоль (раз в секунду)
-                if (GetTickCount64() - lastPrintTime > 1000) {
-                    std::cout << "Stats: Blocked=" << blockedEvents 
-                             << " Passed=" << passedEvents 
-                             << " (Delta: X=" << mstroke.x << " Y=" << mstroke.y << ")"
-                             << std::endl;
-                    lastPrintTime = GetTickCount64();
-                    blockedEvents = 0;
-                    passedEvents = 0;
-                }
+            // Это наша целевая гиро-мышь - БЛОКИРУЕМ и передаем потоку отправки
+            uint16_t newButtons = ApplyButtonState(buttons, mstroke.state);
+            if (mstroke.x != 0 || mstroke.y != 0 || newButtons != buttons) {
+                PushMouseEvent(mstroke.x, mstroke.y, newButtons);
+                buttons = newButtons;
             }
             
             // НЕ пересылаем событие в Windows - мышь заблокирована!
@@ -222,7 +526,7 @@ void ProcessEvents(InterceptionContext context) {
         } else {
             // Это другая мышь - пересылаем в Windows как обычно
             interception_send(context, device, &stroke, 1);
-            passedEvents++;
+            g_eventsPassed.fetch_add(1, std::memory_order_relaxed);
         }
     }
     
@@ -376,9 +680,21 @@ int main() {
     // Установить обработчик Ctrl+C
     SetConsoleCtrlHandler(ConsoleHandler, TRUE);
     
+    // Поток отправки UDP: поток Interception только складывает события
+    // Sleep(kSendSliceMs) по умолчанию округляется до ~15.6 мс
+    timeBeginPeriod(1);
+    g_senderWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    std::thread sender(SenderLoop);
+    
     // Запустить обработку событий
     ProcessEvents(context);
     
+    g_running = false;
+    SetEvent(g_senderWake);
+    sender.join();
+    CloseHandle(g_senderWake);
+    timeEndPeriod(1);
+    
     // Очистка
     std::cout << "Cleaning up..." << std::endl;
     interception_destroy_context(context);
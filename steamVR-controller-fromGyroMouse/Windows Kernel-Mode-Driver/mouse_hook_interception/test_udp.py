@@ -1,7 +1,7 @@
 #!/usr/bin/env python3
 """
 UDP Mouse Data Receiver
-Тест для приёма данных от mouse_hook.exe
+Тест для приёма данных от mouse_hook.exe (протокол v2)
 """
 
 import socket
@@ -24,30 +24,90 @@ stats = {
 # Буфер для визуализации движения
 movement_buffer = deque(maxlen=50)
 
+# Протокол v2 драйвера (steamVR-controller-driver-C/src/packet_format.h)
+V2_MAGIC = 0xC5
+V2_VERSION = 2
+RECORD_POSITION = 0x01
+RECORD_ANGULAR_VELOCITY = 0x02
+RECORD_INPUT = 0x04
+RECORD_SEQUENCE32 = 0x08
+RECORD_TIMESTAMP = 0x10
+ANGULAR_SCALE = 1024.0
+
+BUTTON_NAMES = [(0x0001, 'LEFT'), (0x0002, 'RIGHT'), (0x0004, 'MIDDLE'),
+                (0x0008, 'X1'), (0x0010, 'X2')]
+
+def crc32c(data):
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+    return crc ^ 0xFFFFFFFF
+
+def unpack_quaternion(data):
+    """Кватернион smallest-three: 2 бита индекса + 3 x 15 бит"""
+    packed = int.from_bytes(data, 'little')
+    largest = (packed >> 45) & 0x3
+    rest = []
+    for shift in (30, 15, 0):
+        value = (packed >> shift) & 0x7FFF
+        rest.append((value - 16383) / 16383.0 * 0.70710678)
+    missing = max(0.0, 1.0 - sum(v * v for v in rest)) ** 0.5
+    rest.insert(largest, missing)
+    return tuple(rest)
+
 def parse_packet(data):
     """
-    Парсинг UDP пакета
-    Формат: MOUSE:deltaX,deltaY,buttons,timestamp
+    Парсинг датаграммы протокола v2 (первая запись)
     """
-    try:
-        if not data.startswith('MOUSE:'):
-            return None
-        
-        parts = data[6:].split(',')
-        if len(parts) != 4:
-            return None
-        
-        return {
-            'deltaX': int(parts[0]),
-            'deltaY': int(parts[1]),
-            'buttons': int(parts[2]),
-            'timestamp': int(parts[3])
-        }
-    except (ValueError, IndexError):
+    if len(data) < 8 + 9 + 4 or data[0] != V2_MAGIC or data[1] != V2_VERSION:
+        return None
+    if crc32c(data[:-4]) != int.from_bytes(data[-4:], 'little'):
+        return None
+    if data[3] == 0:
         return None
 
+    base = int.from_bytes(data[4:8], 'little')
+    offset = 8
+    controller_id = data[offset]
+    flags = data[offset + 1]
+    offset += 2
+    if flags & RECORD_SEQUENCE32:
+        number = int.from_bytes(data[offset:offset + 4], 'little')
+        offset += 4
+    else:
+        number = base + data[offset]
+        offset += 1
+
+    quat = unpack_quaternion(data[offset:offset + 6])
+    offset += 6
+    if flags & RECORD_POSITION:
+        offset += 6
+
+    gyro = (0.0, 0.0, 0.0)
+    if flags & RECORD_ANGULAR_VELOCITY:
+        gyro = tuple(int.from_bytes(data[offset + 2 * i:offset + 2 * i + 2], 'little', signed=True) / ANGULAR_SCALE
+                     for i in range(3))
+        offset += 6
+
+    buttons = 0
+    trigger = 0
+    if flags & RECORD_INPUT:
+        buttons = int.from_bytes(data[offset:offset + 2], 'little')
+        trigger = data[offset + 2]
+
+    return {
+        'id': controller_id,
+        'number': number,
+        'quat': quat,
+        'gyro': gyro,
+        'buttons': buttons,
+        'trigger': trigger
+    }
+
 def visualize_movement(deltaX, deltaY):
-    """Простая визуализация направления движения"""
+    """Простая визуализация направления движения (по угловой скорости)"""
     if deltaX == 0 and deltaY == 0:
         return "●"
     
@@ -98,27 +158,26 @@ def main():
         while True:
             # Получить данные
             data, addr = sock.recvfrom(BUFFER_SIZE)
-            packet = data.decode('utf-8', errors='ignore')
             
             # Парсинг
-            parsed = parse_packet(packet)
+            parsed = parse_packet(data)
             
             if parsed:
                 stats['packets'] += 1
                 
-                # Визуализация
-                arrow = visualize_movement(parsed['deltaX'], parsed['deltaY'])
+                # Визуализация: угловая скорость yaw/pitch вместо дельт
+                gyro = parsed['gyro']
+                arrow = visualize_movement(gyro[1] * 10, gyro[0] * 10)
                 movement_buffer.append(arrow)
                 
                 # Вывод данных
-                button_str = ""
-                if parsed['buttons'] == 1:
-                    button_str = "[LEFT]"
-                elif parsed['buttons'] == 2:
-                    button_str = "[RIGHT]"
+                button_str = ''.join(f"[{name}]" for bit, name in BUTTON_NAMES if parsed['buttons'] & bit)
+                quat = parsed['quat']
                 
-                print(f"{arrow} X={parsed['deltaX']:4d} Y={parsed['deltaY']:4d} {button_str:8s} "
-                      f"Time={parsed['timestamp']} Packets={stats['packets']}")
+                print(f"{arrow} #{parsed['number']} id={parsed['id']} "
+                      f"quat=({quat[0]:.3f}, {quat[1]:.3f}, {quat[2]:.3f}, {quat[3]:.3f}) "
+                      f"gyro=({gyro[0]:.2f}, {gyro[1]:.2f}, {gyro[2]:.2f}) "
+                      f"buttons=0x{parsed['buttons']:04X} {button_str}")
                 
                 # Статистика каждые 5 секунд
                 if time.time() - stats['last_print'] > 5:
@@ -127,7 +186,7 @@ def main():
                     
             else:
                 stats['errors'] += 1
-                print(f"[ERROR] Invalid packet: {packet}")
+                print(f"[ERROR] Invalid packet: {data.hex()}")
     
     except KeyboardInterrupt:
         print("\n\nShutting down...")
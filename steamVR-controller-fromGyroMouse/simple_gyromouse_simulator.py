@@ -8,11 +8,18 @@ import socket
 import struct
 import time
 import math
+import os
+import sys
+
+# Кодировщик протокола v2 лежит рядом с симуляторами драйвера
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'steamVR-controller-driver-C'))
+import protocol_v2
 
 class GyroMouseSimulator:
-    def __init__(self, host='127.0.0.1', port=5556):
+    def __init__(self, host='127.0.0.1', port=5556, use_v2=False):
         self.host = host
         self.port = port
+        self.use_v2 = use_v2  # компактный протокол v2 вместо 48-байтного пакета
         self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.packet_number = 0
     
@@ -40,6 +47,13 @@ class GyroMouseSimulator:
         self.packet_number += 1
         return data
     
+    def pack_data_v2(self, quat, position, gyro, buttons):
+        """Та же запись в протоколе v2 (id относительно gyromouse_device_id драйвера)"""
+        # Триггер у мыши кнопочный: драйвер выводит его из кнопки 1
+        record = (0, self.packet_number, quat, position, gyro, buttons, 0, protocol_v2.monotonic_us())
+        self.packet_number += 1
+        return protocol_v2.encode_datagram([record], protocol_v2.FLAG_GYROMOUSE)
+    
     def simulate_movement(self, t):
         """Симулировать движение контроллера"""
         # Вращение вокруг Y оси
@@ -94,8 +108,14 @@ class GyroMouseSimulator:
                 quat, position, gyro, buttons = self.simulate_movement(t)
                 
                 # Упаковываем и отправляем данные
-                packet = self.pack_data(quat, position, gyro, buttons)
+                if self.use_v2:
+                    packet = self.pack_data_v2(quat, position, gyro, buttons)
+                else:
+                    packet = self.pack_data(quat, position, gyro, buttons)
                 self.sock.sendto(packet, (self.host, self.port))
+                if self.use_v2:
+                    # Ответы на запросы синхронизации часов драйвера
+                    protocol_v2.answer_time_requests(self.sock)
                 
                 # Логируем каждые 100 пакетов
                 if self.packet_number % 100 == 0:
@@ -113,5 +133,6 @@ class GyroMouseSimulator:
 
 
 if __name__ == "__main__":
-    simulator = GyroMouseSimulator()
+    # --v2: отправлять протокол v2
+    simulator = GyroMouseSimulator(use_v2='--v2' in sys.argv[1:])
     simulator.run()
\ No newline at end of file